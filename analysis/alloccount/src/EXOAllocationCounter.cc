@@ -0,0 +1,193 @@
+//______________________________________________________________________________
+//
+// EXOAllocationCounter
+//
+// Counts heap allocations for EXOAnalysisProfiler by replacing the global
+// operators new and delete.  It is not linked into anything: preload it to
+// get allocation counts in the profile,
+//
+//   LD_PRELOAD=$EXOLIB/lib/libEXOAllocationCounter.so EXOAnalysis script.exo
+//
+// (DYLD_INSERT_LIBRARIES on Mac OS X).  Without it, the profiler reports
+// latencies only.  The profiler finds the counter through the two C
+// functions below; counting is only done while the profiler is enabled.
+//
+// All forms of new and delete, including the nothrow, sized and aligned
+// ones, are replaced here, so that memory is always allocated and freed by
+// the same pair.
+//______________________________________________________________________________
+#include <cstdlib>
+#include <new>
+
+namespace {
+  bool gfCountAllocations = false;
+  unsigned long gfAllocationCount = 0;
+
+  inline void CountAllocation()
+  {
+    if(not gfCountAllocations) return;
+#ifdef __GNUC__
+    __sync_fetch_and_add(&gfAllocationCount, 1);
+#else
+    gfAllocationCount++;
+#endif
+  }
+
+  void* CountedAllocate(size_t size)
+  {
+    CountAllocation();
+    if(size == 0) size = 1;
+    while(true) {
+      void* p = malloc(size);
+      if(p) return p;
+      std::new_handler handler = std::set_new_handler(0);
+      std::set_new_handler(handler);
+      if(not handler) throw std::bad_alloc();
+      handler();
+    }
+  }
+
+  void* CountedAllocateNoThrow(size_t size)
+  {
+    try {
+      return CountedAllocate(size);
+    } catch(std::bad_alloc&) {
+      return NULL;
+    }
+  }
+}
+
+extern "C" {
+  void EXOAllocationCounter_SetEnabled(int enabled) { gfCountAllocations = (enabled != 0); }
+  unsigned long EXOAllocationCounter_GetCount() { return gfAllocationCount; }
+}
+
+#if __cplusplus >= 201103L
+#define EXO_THROW_BAD_ALLOC
+#define EXO_NO_THROW noexcept
+#else
+#define EXO_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define EXO_NO_THROW throw()
+#endif
+
+//______________________________________________________________________________
+void* operator new(size_t size) EXO_THROW_BAD_ALLOC
+{
+  return CountedAllocate(size);
+}
+
+//______________________________________________________________________________
+void* operator new[](size_t size) EXO_THROW_BAD_ALLOC
+{
+  return CountedAllocate(size);
+}
+
+//______________________________________________________________________________
+void* operator new(size_t size, const std::nothrow_t&) EXO_NO_THROW
+{
+  return CountedAllocateNoThrow(size);
+}
+
+//______________________________________________________________________________
+void* operator new[](size_t size, const std::nothrow_t&) EXO_NO_THROW
+{
+  return CountedAllocateNoThrow(size);
+}
+
+//______________________________________________________________________________
+void operator delete(void* p) EXO_NO_THROW
+{
+  free(p);
+}
+
+//______________________________________________________________________________
+void operator delete[](void* p) EXO_NO_THROW
+{
+  free(p);
+}
+
+//______________________________________________________________________________
+void operator delete(void* p, const std::nothrow_t&) EXO_NO_THROW
+{
+  free(p);
+}
+
+//______________________________________________________________________________
+void operator delete[](void* p, const std::nothrow_t&) EXO_NO_THROW
+{
+  free(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+//______________________________________________________________________________
+void operator delete(void* p, size_t) EXO_NO_THROW
+{
+  free(p);
+}
+
+//______________________________________________________________________________
+void operator delete[](void* p, size_t) EXO_NO_THROW
+{
+  free(p);
+}
+#endif
+
+#if defined(__cpp_aligned_new)
+namespace {
+  void* CountedAllocateAligned(size_t size, std::align_val_t alignment)
+  {
+    CountAllocation();
+    if(size == 0) size = 1;
+    size_t align = static_cast<size_t>(alignment);
+    if(align < sizeof(void*)) align = sizeof(void*);
+    while(true) {
+      void* p = NULL;
+      if(posix_memalign(&p, align, size) == 0) return p;
+      std::new_handler handler = std::set_new_handler(0);
+      std::set_new_handler(handler);
+      if(not handler) throw std::bad_alloc();
+      handler();
+    }
+  }
+}
+
+//______________________________________________________________________________
+void* operator new(size_t size, std::align_val_t alignment)
+{
+  return CountedAllocateAligned(size, alignment);
+}
+
+//______________________________________________________________________________
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+  return CountedAllocateAligned(size, alignment);
+}
+
+//______________________________________________________________________________
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+  try {
+    return CountedAllocateAligned(size, alignment);
+  } catch(std::bad_alloc&) {
+    return NULL;
+  }
+}
+
+//______________________________________________________________________________
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+  try {
+    return CountedAllocateAligned(size, alignment);
+  } catch(std::bad_alloc&) {
+    return NULL;
+  }
+}
+
+//______________________________________________________________________________
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+#endif
@@ -0,0 +1,56 @@
+#!/usr/bin/env python
+#
+# Builds the per-run DNN index files read by the copy-dnn module
+# (/copy-dnn/indexDir), so that processing does not have to read the DNN
+# trees of each run.  The index of a run holds its DNN variables sorted by
+# event number; see EXOCopyDNNModule.
+#
+# Usage: python build_dnn_index.py [--source] index_dir run [run ...]
+#        python build_dnn_index.py [--source] index_dir first_run-last_run
+#
+# Runs are physics runs unless --source is given.  Runs without DNN trees
+# are skipped; the exit status is 1 if any run failed.
+
+from __future__ import print_function
+import os, sys
+import ROOT
+
+def parse_runs(args):
+    runs = []
+    for arg in args:
+        if '-' in arg:
+            first, last = arg.split('-')
+            runs.extend(range(int(first), int(last) + 1))
+        else:
+            runs.append(int(arg))
+    return runs
+
+def main(argv):
+    args = argv[1:]
+    flavor_name = 'physics'
+    if args and args[0] == '--source':
+        flavor_name = 'source'
+        args = args[1:]
+    if len(args) < 2:
+        sys.exit('Usage: python build_dnn_index.py [--source] index_dir run [run ...]')
+    index_dir = args[0]
+    if not os.path.isdir(index_dir):
+        os.makedirs(index_dir)
+
+    if ROOT.gSystem.Load("libEXOUtilities") < 0: sys.exit('Failed to load EXOUtilities')
+    if ROOT.gSystem.Load("libEXOAnalysisManager") < 0: sys.exit('Failed to load EXOAnalysisManager')
+    flavor = {'physics': ROOT.EXOBeginRecord.kDatPhysics,
+              'source':  ROOT.EXOBeginRecord.kDatSrcClb}[flavor_name]
+
+    failed = False
+    for run in parse_runs(args[1:]):
+        if ROOT.EXOCopyDNNModule.BuildDNNIndex(index_dir, run, flavor):
+            print('Run %d: wrote %s' % (run, ROOT.EXOCopyDNNModule.GetDNNIndexFile(index_dir, run)))
+        else:
+            print('Run %d: no DNN trees in %s, or could not write the index' %
+                  (run, ROOT.EXOCopyDNNModule.GetDNNFileName(run, flavor)))
+            failed = True
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
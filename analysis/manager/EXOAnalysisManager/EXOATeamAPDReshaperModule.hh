@@ -3,6 +3,7 @@
 
 #include "EXOAnalysisModule.hh"
 #include <string>
+#include <vector>
 class TH1F;
 class EXOAnalysisManger;
 class EXOEventData;
@@ -11,6 +12,21 @@ class EXOTalkToManager;
 class EXOATeamAPDReshaperModule : public EXOAnalysisModule 
 {
 
+public :
+
+  // Filters are identified by these IDs internally; the names are only used
+  // for the /apreshap/filter_method command and for printing.
+  enum FilterID {
+    kNoFilter = 0,
+    kFiniteCusp,
+    kTriangular,
+    kGaussian,
+    kRC_CR,
+    kInvalidFilter
+  };
+  static FilterID GetFilterID(const std::string& name);
+  static std::string GetFilterName(FilterID filter);
+
 private :
 
   // These pointers will reference data to be read-in from the command line
@@ -24,6 +40,8 @@ private :
   double CR2_param;
   bool overwriteSignals_param;
   bool makeNoiseCorners_param;
+  std::vector<int> noiseCornerTaus_param;
+  FilterID fFilterID;  // filter_param, set in Initialize
 
   void Settau_param(int aval) { tau_param = aval; }
   void SetT_param(double aval) { T_param = aval; }
@@ -33,6 +51,7 @@ private :
   void SetCR2_param(double aval) { CR2_param = aval; }
   void SetoverwriteSignals_param(bool aval) { overwriteSignals_param = aval; }
   void SetmakeNoiseCorners_param(bool aval) { makeNoiseCorners_param = aval; }
+  void SetnoiseCornerTaus_param(std::string aval);
 
 
   double p; // renormalization factor
@@ -43,6 +62,7 @@ protected:
 public :
 
   EXOATeamAPDReshaperModule();
+  ~EXOATeamAPDReshaperModule();
 
   int Initialize();
   EventStatus BeginOfRun(EXOEventData *ED);
@@ -64,6 +84,7 @@ private :
   void CR_unshaper(double signal[], int n, double tratio, double baseline );
   void RC_unshaper(double signal[], int n, double tratio );
 
+  static void GetBaselineWindow(int length, double trigger, int& begin, int& end);
   double Baseline(double signal[], int length, double trigger);
   double FindTrigger(int length, EXOEventData *_ED);
   double Max(double signal[], int length);
@@ -88,6 +109,7 @@ private :
     int GetArrayLength();
     void Add(int tau, double peakHeight);
     int GetBestTau();
+    double GetrmsValueForTau(int tau);
     
   private:
     std::string cornername;
@@ -112,22 +134,22 @@ private :
     Filters(std::string name, int length);
     Filters(std::string name, int length, int Tlength);
     ~Filters();
-    void Add(std::string filterType, int tau, double peakHeight);
-    void Add(std::string filterType, int tau, double T, double peakHeight);
+    void Add(FilterID filterType, int tau, double peakHeight);
+    void Add(FilterID filterType, int tau, double T, double peakHeight);
     int GetTArrayLength();
-    int GetArrayLength(std::string filterType);
-    int GetArrayLength(std::string filterType, double T);
+    int GetArrayLength(FilterID filterType);
+    int GetArrayLength(FilterID filterType, double T);
     double GetBestT();
     int GetBestTindex();
-    std::string GetBestShaper();
+    FilterID GetBestShaper();
     int GetBestShaperTau();
     double GetBestShaperT();
-    int* GetFilterShapingTimes(std::string filterType);
-    int* GetFilterShapingTimes(std::string filterType, double T);
-    double* GetFilterrmsValues(std::string filterType);
-    double* GetFilterrmsValues(std::string filterType, double T);
-    double* GetFilterrmsErrors(std::string filterType);
-    double* GetFilterrmsErrors(std::string filterType, double T);
+    int* GetFilterShapingTimes(FilterID filterType);
+    int* GetFilterShapingTimes(FilterID filterType, double T);
+    double* GetFilterrmsValues(FilterID filterType);
+    double* GetFilterrmsValues(FilterID filterType, double T);
+    double* GetFilterrmsErrors(FilterID filterType);
+    double* GetFilterrmsErrors(FilterID filterType, double T);
     
   private:
     int *tempval;
@@ -136,13 +158,14 @@ private :
     int maxlength;
     double *TTimes;
     int numTTimes;
+    int maxTTimes;
     void Init();
     NoiseCorner *triangular;
     NoiseCorner *gaussian;
     NoiseCorner *finiteCusp[25];
     int ArrayIndex(double T);
     bool BestNotCalculated;
-    std::string bestfilter;
+    FilterID bestfilter;
     int bestTau;
     double bestT;
     void CalculateBest();
@@ -155,22 +178,22 @@ private :
   public:
     APDNoiseCorners(std::string name, int length, int Tlength);
     ~APDNoiseCorners();
-    void Add(int ch, std::string filterType, int tau, double peakHeight);
-    void Add(int ch, std::string filterType, int tau, double T, double peakHeight);
+    void Add(int ch, FilterID filterType, int tau, double peakHeight);
+    void Add(int ch, FilterID filterType, int tau, double T, double peakHeight);
     int GetTArrayLength(int ch);
-    int GetArrayLength(int ch, std::string filterType);
-    int GetArrayLength(int ch, std::string filterType, double T);
+    int GetArrayLength(int ch, FilterID filterType);
+    int GetArrayLength(int ch, FilterID filterType, double T);
     double GetBestT(int ch);
     int GetBestTindex(int ch);
-    std::string GetBestShaper(int ch);
+    FilterID GetBestShaper(int ch);
     int GetBestShaperTau(int ch);
     double GetBestShaperT(int ch);
-    int* GetFilterShapingTimes(int ch, std::string filterType);
-    int* GetFilterShapingTimes(int ch, std::string filterType, double T);
-    double* GetFilterrmsValues(int ch, std::string filterType);
-    double* GetFilterrmsValues(int ch, std::string filterType, double T);
-    double* GetFilterrmsErrors(int ch, std::string filterType);
-    double* GetFilterrmsErrors(int ch, std::string filterType, double T);
+    int* GetFilterShapingTimes(int ch, FilterID filterType);
+    int* GetFilterShapingTimes(int ch, FilterID filterType, double T);
+    double* GetFilterrmsValues(int ch, FilterID filterType);
+    double* GetFilterrmsValues(int ch, FilterID filterType, double T);
+    double* GetFilterrmsErrors(int ch, FilterID filterType);
+    double* GetFilterrmsErrors(int ch, FilterID filterType, double T);
 
   private:
     std::string noisename;
@@ -178,6 +201,47 @@ private :
 
   };
 
+  // Applies one filter for a whole set of shaping times in a single pass
+  // over a waveform.  The state and output of all shaping times are kept
+  // interleaved (sample i, shaping time k at i*ntau + k), so the inner
+  // loops run over contiguous shaping times and vectorise.  Gaussian uses
+  // the same CR-(RC)^4 recursions as Gaussian(), triangular an equivalent
+  // running-sum recursion, and finite cusp the kernels of FiniteCusp().
+  class FilterBank
+  {
+  public:
+    FilterBank(FilterID filter, const std::vector<int>& taus, double T = 0.0);
+    void Apply(const double signal[], int length);
+    void GetAmplitudes(double trigger, std::vector<double>& amplitudes) const;
+    void GetOutput(size_t index, double output[]) const;
+    FilterID GetFilter() const { return fFilter; }
+    double GetT() const { return fT; }
+    int GetShapingTime(size_t index) const { return fTaus[index]; }
+    size_t GetNumShapingTimes() const { return fTaus.size(); }
+
+  private:
+    void ApplyGaussian(const double signal[]);
+    void ApplyTriangular(const double signal[]);
+    void ApplyKernels(const double signal[]);
+    void GetMaxima(std::vector<double>& maxima) const;
+
+    FilterID fFilter;
+    double fT;
+    std::vector<int> fTaus;
+    std::vector<double> fWeights;  // exp(-1/tau) or 1/tau, per shaping time
+    std::vector<double> fGains;    // height of the response to a unit step
+    std::vector<double> fKernels;  // finite cusp, sample m of kernel k at m*ntau + k
+    size_t fKernelLength;
+    std::vector<double> fOutput;
+    int fLength;
+  };
+
+  std::vector<FilterBank> fNoiseCornerBanks;
+  APDNoiseCorners* fNoiseCorners;
+  void FillNoiseCorners(int apdIndex, const double unshaped[], int length,
+                        double trigger, double gain);
+  void PrintNoiseCorners();
+
   DEFINE_EXO_ANALYSIS_MODULE( EXOATeamAPDReshaperModule )
 
 };
@@ -10,6 +10,7 @@ class EXOAnalysisModule;
 class EXOCalibManager;
 class EXOEventData;
 class EXOTalkToManager;
+class TFile;
 
 class EXOAnalysisManager  {
 
@@ -50,10 +51,20 @@ private :
 
   bool                verbose;
   bool                very_first_event;
+  std::string         profileFilename;
+
+  std::string         checkpointFilename;
+  int                 checkpointEvery;
+  bool                resumeFromCheckpoint;
+  TFile*              resumeFile;  // open until all modules are restored
   
   bool                UseAndOwnModule( EXOAnalysisModule* module,
                                        const std::string& asName, 
                                        bool managerOwnsModule );
+  void                LoadEventDataFor( size_t moduleIndex );
+  void                WriteCheckpoint();
+  void                OpenCheckpointForResume();
+  void                RestoreModulesFromCheckpoint();
 
 public :
 
@@ -108,6 +119,11 @@ public :
   void SetPrintMemory(bool aval) { printMemory = aval; }
   void SetVerbose(bool VALUE = true) { verbose = VALUE; }
   void SetInputFilename(std::string val);
+  void SetProfile(bool aval);
+  void SetProfileFilename(std::string val) { profileFilename = val; }
+  void SetCheckpointFilename(std::string val) { checkpointFilename = val; }
+  void SetCheckpointEvery(int aval) { checkpointEvery = (aval > 0 ? aval : 0); }
+  void SetResume(bool aval) { resumeFromCheckpoint = aval; }
 
   typedef std::vector<std::string> StrVec;
   const StrVec& GetListOfUsedModules(); 
@@ -10,6 +10,7 @@
 class EXOTalkToManager;
 class EXOEventData;
 class TClass;
+class TDirectory;
 class TObject;
 class TObjArray;
 
@@ -34,8 +35,26 @@ public:
     kDrop         // want to drop
   };
 
+  // Parts of EXOEventData which a module may declare that it reads or
+  // writes.  See GetEventDataReads() and GetEventDataWrites().
+  enum EventDataPart {
+    kNoEventData            = 0,
+    kEventHeader            = 1 << 0,
+    kMonteCarloData         = 1 << 1, // all MC info except pixelated charge
+    kMCPixelatedCharge      = 1 << 2,
+    kWaveformData           = 1 << 3,
+    kUWireSignals           = 1 << 4,
+    kUWireInductionSignals  = 1 << 5,
+    kVWireSignals           = 1 << 6,
+    kAPDSignals             = 1 << 7,
+    kChargeInjectionSignals = 1 << 8,
+    kChargeClusters         = 1 << 9,
+    kScintClusters          = 1 << 10,
+    kAllEventData           = (1 << 11) - 1
+  };
+
   enum {
-    irev = 20 // do not remove 44fac454
+    irev = 22 // do not remove 6b1e07d2
   };
   static const int crev;
 
@@ -79,6 +98,29 @@ public :
       the following *Alias() functions.  */
   virtual bool CanHaveMultipleClassInstances() const { return false; } 
 
+  /*! Declare which parts of EXOEventData (a mask of EventDataPart) this
+      module reads and writes.  Input modules which support it (e.g.
+      EXOTreeInputModule) only read the union of the parts declared by all
+      modules in the chain, and load a missing part on demand just before a
+      module declaring it is called.  The run and event numbers and the other
+      top-level scalars are always available.  The default is to read
+      everything, so modules which do not overload this are unaffected. */
+  virtual unsigned int GetEventDataReads() const { return kAllEventData; }
+  virtual unsigned int GetEventDataWrites() const { return kNoEventData; }
+
+  /*! Checkpointing.  When the analysis manager writes checkpoints, it calls
+      SaveCheckpoint after every n-th event has been processed by all
+      modules, passing this module's directory in the checkpoint file.
+      Modules that carry state from one event to the next (counters,
+      positions in auxiliary files, private random number generators, ...)
+      should write it there, and read it back in RestoreCheckpoint.  On a
+      restart, RestoreCheckpoint is called after BeginOfRun and
+      BeginOfRunSegment of the first event processed, so it overrides
+      whatever these set up.  Return false on failure.  The default has no
+      state to save. */
+  virtual bool SaveCheckpoint(TDirectory& /*dir*/) { return true; }
+  virtual bool RestoreCheckpoint(TDirectory& /*dir*/) { return true; }
+
   /*! The following provide an ability for classes to differentiate
       between different instances of the same class.  For example, 
       the TalkTo function can call these to prepend the alias name
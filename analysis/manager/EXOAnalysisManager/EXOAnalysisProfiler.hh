@@ -0,0 +1,80 @@
+#ifndef EXOAnalysisProfiler_hh
+#define EXOAnalysisProfiler_hh
+
+#include <string>
+#include <vector>
+#include <map>
+
+class EXOAnalysisProfiler
+{
+  public:
+    static EXOAnalysisProfiler& GetProfiler()
+    {
+      static EXOAnalysisProfiler gfProfiler; return gfProfiler;
+    }
+
+    void SetEnabled(bool aval = true);
+    bool IsEnabled() const { return fEnabled; }
+
+    // Record one call of a module's ProcessEvent and the number of heap
+    // allocations made during the call.
+    void RecordModuleCall(const std::string& module, double seconds,
+                          unsigned long allocations);
+
+    // Record the time spent in a sub-stage of a module for one event.
+    void RecordStage(const std::string& stage, double seconds);
+
+    // Whether allocations are counted, i.e. libEXOAllocationCounter is
+    // preloaded, and the number of calls to operator new so far, counted
+    // while enabled (0 if not counting).
+    static bool IsCountingAllocations();
+    static unsigned long GetAllocationCount();
+
+    void Reset();
+    void PrintSummary() const;
+    bool WriteReport(const std::string& filename) const;
+
+  protected:
+    // Histogram of latencies in log-spaced bins, from which quantiles are
+    // estimated.  Filling is O(1), so it can be done for every event.
+    class LatencyHistogram {
+      public:
+        enum { kBinsPerDecade = 20, kFirstDecade = -7, kLastDecade = 3,
+               kNumBins = (kLastDecade - kFirstDecade)*kBinsPerDecade };
+        LatencyHistogram();
+        void Fill(double seconds);
+        double GetQuantile(double q) const;
+        double GetMean() const { return fEntries ? fSum/fEntries : 0.0; }
+        static double GetBinLowEdge(int bin);
+
+        std::vector<unsigned long> fCounts; // underflow, kNumBins bins, overflow
+        unsigned long fEntries;
+        double fSum;
+        double fMin;
+        double fMax;
+    };
+
+    class Record {
+      public:
+        Record() : fAllocations(0) {}
+        std::string      fName;
+        bool             fIsModule;
+        LatencyHistogram fLatency;
+        unsigned long    fAllocations;
+    };
+
+    Record& GetOrCreateRecord(const std::string& name, bool isModule);
+    std::string MakeJSON() const;
+    bool WriteROOTFile(const std::string& filename) const;
+
+    bool                          fEnabled;
+    std::vector<Record>           fRecords;  // in order of first appearance
+    std::map<std::string, size_t> fIndex;    // "m:"/"s:" + name -> fRecords
+
+  private:
+    EXOAnalysisProfiler() : fEnabled(false) {}
+    EXOAnalysisProfiler(const EXOAnalysisProfiler&);
+    EXOAnalysisProfiler& operator=(const EXOAnalysisProfiler&);
+};
+
+#endif
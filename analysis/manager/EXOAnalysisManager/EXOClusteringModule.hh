@@ -140,6 +140,12 @@ public :
   virtual EventStatus EndOfRun(EXOEventData *ED);
   virtual int TalkTo(EXOTalkToManager *tm);
 
+  // Clustering only works on reconstructed signals.
+  virtual unsigned int GetEventDataReads() const
+    { return kEventHeader | kUWireSignals | kUWireInductionSignals | kVWireSignals | kAPDSignals; }
+  virtual unsigned int GetEventDataWrites() const
+    { return kChargeClusters | kScintClusters; }
+
   void SetVerbose(int val){fVerbose = val;}
   void SetAPDMatchTime(double val){fAPDMatchTime = val;}
   void SetChargeMatchTime(double val){fUMatchTime = val;}
@@ -0,0 +1,50 @@
+#ifndef EXOColumnarOutputModule_hh
+#define EXOColumnarOutputModule_hh
+
+#include "EXOAnalysisModule.hh"
+#include "EXOUtilities/EXOColumnarFileWriter.hh"
+#include <string>
+
+class EXOColumnarOutputModule : public EXOAnalysisModule
+{
+
+private :
+
+  // Columns of the file, in the order they are added.
+  enum EColumn {
+    kRun, kEventNumber, kTriggerSeconds, kTriggerMicroSeconds, kIsMC,
+    kSaturated, kMuonTag, kNoiseTag, kVetoed,
+    kNumCharge, kFirstCharge, kNumScint, kFirstScint,
+    kChargeX, kChargeY, kChargeZ, kChargeU, kChargeV, kChargeDriftTime,
+    kChargeCollectionTime, kChargeRawEnergy, kChargeCorrectedEnergy,
+    kChargePurityCorrectedEnergy, kChargeEnergyInV, kChargeDetectorHalf,
+    kChargeScint,
+    kScintX, kScintY, kScintZ, kScintTime, kScintEnergy, kScintRawEnergy,
+    kScintWeightedAPDEnergy, kScintDenoisedEnergy, kScintDNNVarRaw,
+    kScintDNNVarRecon, kScintDNNChargeEnergy,
+    kNumColumns
+  };
+
+  std::string fOutputFilename;
+  EXOColumnarFileWriter fWriter;
+  Long64_t fNumCharge;              // Charge clusters written so far
+  Long64_t fNumScint;
+
+public :
+
+  EXOColumnarOutputModule();
+
+  int Initialize();
+  EventStatus ProcessEvent(EXOEventData *ED);
+  int ShutDown();
+  int TalkTo(EXOTalkToManager *tm);
+
+  unsigned int GetEventDataReads() const
+    { return kEventHeader | kChargeClusters | kScintClusters; }
+
+  void SetOutputFilename(std::string aval) { fOutputFilename = aval; }
+
+  DEFINE_EXO_ANALYSIS_MODULE( EXOColumnarOutputModule )
+
+};
+#endif
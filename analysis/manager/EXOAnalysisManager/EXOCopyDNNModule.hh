@@ -29,13 +29,15 @@ public:
   {
         Int_t fRunNumber;
         Int_t fEventNumber;
+        Double_t fScintTime;
         Double_t fDNNVarRaw, fDNNVarRecon, fDNNChargeEnergy;
         
         EXODNNInfo(){}
         
-        EXODNNInfo(Int_t run, Int_t event, Double_t dnn_raw, Double_t dnn_recon, Double_t dnn_charge){
+        EXODNNInfo(Int_t run, Int_t event, Double_t scint_time, Double_t dnn_raw, Double_t dnn_recon, Double_t dnn_charge){
             fRunNumber      = run;
             fEventNumber    = event;
+            fScintTime      = scint_time;
             fDNNVarRaw      = dnn_raw;
             fDNNVarRecon    = dnn_recon;
             fDNNChargeEnergy= dnn_charge;
@@ -43,13 +45,45 @@ public:
 
   };
 
+  // The DNN trees an index was built from; the index is used only while they are unchanged.
+  struct EXODNNSource
+  {
+        ULong64_t fNumFiles;
+        ULong64_t fTotalSize;
+        Long64_t fLastModified;
+
+        EXODNNSource() : fNumFiles(0), fTotalSize(0), fLastModified(0) {}
+  };
+
+  // Directory holding the per-run DNN index files (empty: read the DNN trees every run).
+  void SetDNNIndexDirectory(std::string dir) { fIndexDirectory = dir; }
+
+  // DNN trees of a run, as a pattern for TChain::Add; empty if the run flavor has none.
+  static std::string GetDNNFileName(int runNumber, EXOBeginRecord::RunFlavor flavor);
+
+  // Read the DNN trees matching treeFiles into info, sorted for lookups.
+  static bool LoadDNNTree(const std::string& treeFiles, int runNumber, std::vector<EXODNNInfo>& info);
+
+  // Number, total size and latest modification time of the files matching treeFiles.
+  static EXODNNSource GetDNNSource(const std::string& treeFiles);
+
+  // The index file of a run holds its sorted DNN info.
+  static std::string GetDNNIndexFile(const std::string& dir, int runNumber);
+  static bool ReadDNNIndex(const std::string& indexFile, int runNumber,
+                           const EXODNNSource& source, std::vector<EXODNNInfo>& info);
+  static bool WriteDNNIndex(const std::string& indexFile, int runNumber,
+                            const EXODNNSource& source, const std::vector<EXODNNInfo>& info);
+
+  // Build the index file of a run in dir from its DNN trees; returns false if there are none or on failure.
+  static bool BuildDNNIndex(const std::string& dir, int runNumber, EXOBeginRecord::RunFlavor flavor);
+
 protected:
 
   void ClearDNNInfo();
-  size_t GetDNNInfoIdx(int event);
-  std::string GetDNNFileName(int runNumber);
+  size_t GetDNNInfoIdx(int event, double scintTime) const;
   EXOBeginRecord::RunFlavor fRunFlavor;
-  std::vector<EXODNNInfo> fDNNInfo;
+  std::string fIndexDirectory;
+  std::vector<EXODNNInfo> fDNNInfo;   // Sorted by event number, then scintillation time
 
 };
 #endif
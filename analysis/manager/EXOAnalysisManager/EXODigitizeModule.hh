@@ -7,6 +7,7 @@
 #include "EXOUtilities/EXOSmearMCIonizationEnergy.hh"
 #include "EXOUtilities/EXOTimingStatisticInfo.hh"
 #include "EXOUtilities/EXOTrimWaveforms.hh"
+#include "EXOUtilities/EXOCorrelatedNoiseGenerator.hh"
 #include <string>
 #include "EXOUtilities/EXO3DDigitizeWires.hh"
 
@@ -33,6 +34,9 @@ protected:
   EXOTimingStatisticInfo     fTimingInfo; // Timing information for digitization
   double                     fTriggerTime; // Mirrors times held in wire/APD digitizers
   double                     fACSmearSigma; //sigma used to determine the fraction of charge lost to light on per event basis for AC model
+  std::string                fCorrelatedNoiseFilename; // File with EXONoiseCorrelations; empty for per-channel noise
+  unsigned int               fCorrelatedNoiseCache; // Correlated noise drawn at once, in noise lengths; 0 for every event
+  EXOCorrelatedNoiseGenerator fCorrelatedNoise;
 public :
 
   EXODigitizeModule();
@@ -66,6 +70,10 @@ public :
       {fVWireDatabaseFlavor = aval;}
   void SetACSmearSigma(double aval)
       {fACSmearSigma = aval; }
+  void SetCorrelatedNoiseFilename(std::string aval)
+      {fCorrelatedNoiseFilename = aval; }
+  void SetCorrelatedNoiseCache(unsigned int aval)
+      {fCorrelatedNoiseCache = aval; }
 
   void SetWeightPotentialFiles(std::string);
   void SetElectricFieldFile(std::string);
@@ -56,5 +56,20 @@ class EXOInputModule: public EXOAnalysisModule
     void SetFilename(std::string aval);
     virtual bool FileIsOpen() const {return false;}
 
+    // Selective reading of EXOEventData, parts given as a mask of
+    // EXOAnalysisModule::EventDataPart.  SetEventDataUsage tells the input
+    // module which parts are needed for every event; EnsureEventDataLoaded
+    // is called before each module to load any other parts it declares.
+    // Input modules that always fill the full event ignore both.
+    virtual void SetEventDataUsage(unsigned int /*parts*/) {}
+    virtual void EnsureEventDataLoaded(unsigned int /*parts*/) {}
+
+    // Checkpointing of the position in the input.  Unlike other modules, an
+    // input module is restored before the first event is read.  Input
+    // modules which can not resume from a given position must keep these
+    // defaults, which refuse to save a checkpoint.
+    virtual bool SaveCheckpoint(TDirectory& dir);
+    virtual bool RestoreCheckpoint(TDirectory& dir);
+
 };
 #endif
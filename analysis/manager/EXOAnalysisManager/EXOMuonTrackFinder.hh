@@ -7,6 +7,8 @@
 #include "EXOUtilities/EXOTimingStatisticInfo.hh"
 #include "EXOUtilities/EXOTemplWaveform.hh"
 #include "EXOUtilities/EXOMiscUtil.hh"
+#include <vector>
+#include <utility>
 
 class TH2I;
 class TGraph;
@@ -81,6 +83,48 @@ public:
   int spots_contributing;
 };
 
+// Hough transform accumulator for the hot spots of one wire plane.
+// The cells have the binning of the TH2I (nx bins from x_min to x_max, ny
+// from y_min to y_max) that used to hold the transform, so it can be
+// copied into one for debugging.  Each vote adds 1 to one cell per angle
+// eta = k*(x_max - x_min)/n_angles + x_min, k = 0 ... n_angles-1.
+class MuonHoughAccumulator
+{
+private:
+
+  int nx;
+  int ny;
+  double x_min;
+  double x_max;
+  double y_min;
+  double y_max;
+
+  std::vector<double> cos_eta;
+  std::vector<double> sin_eta;
+  std::vector<int> row;       // Index of the first cell of the x bin of each angle
+  std::vector<int> vote_bin;  // Cell hit by each angle in the current vote, or -1
+  std::vector<int> cells;     // nx*ny counts, y bins contiguous
+
+public:
+  MuonHoughAccumulator(int n_angles, int nx, double x_min, double x_max,
+                       int ny, double y_min, double y_max);
+
+  void Reset();
+
+  // Add the curve r = t*cos(eta) + w*sin(eta)
+  void Vote(double t, double w);
+
+  // Find the median of the cells holding the most votes, in the order x
+  // bin then y bin.  Returns the maximum; x is the low edge and y the
+  // center of that cell (the average of two cells for an even count).
+  int FindPeak(double &x, double &y, int &n_at_max) const;
+
+  void FillHistogram(TH2I *h) const;
+};
+
+// Hot spot on a wire: sample and channel number
+typedef std::pair<int, int> MuonTrackSpot;
+
 class EXOMuonTrackFinder : public EXOTreeSaverModule
 {
 
@@ -95,12 +139,14 @@ private :
   
   void AddToRawHist(TH2I *h, MuonTrackChannelHelper *chan);
   
-  void HoughTransformSinglePoint(TH2I *h, MuonTrackChannelHelper *chan, double t);
-  void DoHoughTransform(TH2I *h, MuonTrackChannelHelper *chan,
-			TrackParams *track, TH2I *h_spot, double max_allowed_t);
+  void AddSpot(MuonHoughAccumulator *hough, MuonTrackChannelHelper *chan, int t,
+               std::vector<MuonTrackSpot> *spots, TH2I *h_spot);
+  void DoHoughTransform(MuonHoughAccumulator *hough, MuonTrackChannelHelper *chan,
+			TrackParams *track, std::vector<MuonTrackSpot> *spots,
+			TH2I *h_spot, double max_allowed_t);
   
-  void FindTrackFromHough(TH2I *h, TrackParams *track);
-  int GetTimeOfLastChargeOnTrack(TH2I *h_spots, TrackParams *track);
+  void FindTrackFromHough(const MuonHoughAccumulator *hough, TrackParams *track);
+  int GetTimeOfLastChargeOnTrack(std::vector<MuonTrackSpot> *spots, TrackParams *track);
   void MakeTrack(TGraph *g, TrackParams *track, int start_chan);
 
   void GetSphericalAngles(TrackParams *u_track, TrackParams *v_track, int tpc, double &theta, double &phi);
@@ -108,7 +154,8 @@ private :
   bool isMuon(TrackParams *track1, TrackParams *track2, int light_t);
 
   void LookForTracks(int start_chan_num, TrackParams *track, TH2I *h,
-		     TH2I *hough, TH2I *spots, double max_allowed_t);
+		     MuonHoughAccumulator *hough, std::vector<MuonTrackSpot> *spots,
+		     TH2I *h_spots, double max_allowed_t);
 
   void ResetHistogramsAndSetChannelNumbers(int tpc);
 
@@ -132,12 +179,16 @@ private :
   TH2I *h_u;
   TH2I *h_u_spots;
   TH2I *h_u_hough;
+  MuonHoughAccumulator *u_hough;
+  std::vector<MuonTrackSpot> u_spots;
   TrackParams *u_tracks[2];
   TGraph *u_track_graph;
 
   TH2I *h_v;
   TH2I *h_v_spots;
   TH2I *h_v_hough;
+  MuonHoughAccumulator *v_hough;
+  std::vector<MuonTrackSpot> v_spots;
   TrackParams *v_tracks[2];
   TGraph *v_track_graph;
 
@@ -0,0 +1,97 @@
+#ifndef EXONoiseBank_hh
+#define EXONoiseBank_hh
+
+#include "Rtypes.h"
+#include <string>
+#include <vector>
+#include <cstddef> //for size_t
+
+class TTree;
+
+class EXONoiseBank
+{
+  public:
+    // The noise file a bank is made from: its path, size and modification
+    // date (TFile::GetModificationDate), which also work for remote files.
+    struct Source {
+      std::string fPath;
+      Long64_t    fSize;
+      UInt_t      fModified;
+
+      Source(const std::string& path, Long64_t size, UInt_t modified)
+      : fPath(path), fSize(size), fModified(modified) {}
+    };
+
+    EXONoiseBank();
+    ~EXONoiseBank();
+
+    // Convert the noise events in tree (branch "EventBranch", as written by
+    // the realnoise module) into a bank file.  Samples are stored as
+    // noise - offset.  The realnoise module already subtracted the baseline
+    // of each channel of each trace and added offset when it made the noise
+    // file, so this is the same per-channel baseline subtraction; reading
+    // the noise file directly removes the same offset.  source identifies
+    // the noise file the bank was made from, see Matches.
+    static bool Build(TTree& tree, const std::string& bankFile,
+                      Int_t offset, const Source& source);
+
+    // Map a bank file read-only; the pages are shared with every other
+    // process mapping the same file.
+    bool Open(const std::string& bankFile);
+    void Close();
+    bool IsOpen() const { return fMapping != NULL; }
+
+    // Whether the open bank was built from the noise file source, with
+    // numTraces entries, and the given offset.
+    bool Matches(const Source& source, size_t numTraces, Int_t offset) const;
+
+    size_t GetNumTraces() const;
+    size_t GetNumChannels() const;
+    size_t GetNumSamples() const;
+    Int_t GetOffset() const;
+
+    // Samples (noise - offset) of channel in trace, or NULL if the bank has
+    // no such trace or channel.
+    const Short_t* GetTrace(size_t trace, Int_t channel) const;
+    // Trigger time of trace, or 0 if the bank has no such trace.
+    UInt_t GetTriggerSeconds(size_t trace) const;
+
+    // data[i] += noise[i] for i < n.
+    static void AddTo(Int_t* data, const Short_t* noise, size_t n);
+
+  private:
+    struct Header {
+      char      fMagic[8];          // "EXONBANK"
+      UInt_t    fVersion;
+      UInt_t    fNumTraces;
+      UInt_t    fNumChannels;
+      UInt_t    fNumSamples;
+      Int_t     fOffset;
+      UInt_t    fSourceModified;    // Modification date of the noise file
+      Long64_t  fSourceSize;        // Size of the noise file
+      ULong64_t fSourcePathHash;    // EXOHash of the path of the noise file
+      ULong64_t fSamplesOffset;     // Byte offset of the samples, page aligned
+      ULong64_t fTriggerOffset;     // Byte offset of the trigger seconds
+    };
+
+    EXONoiseBank(const EXONoiseBank&);
+    EXONoiseBank& operator=(const EXONoiseBank&);
+
+    const Header& GetHeader() const
+      { return *static_cast<const Header*>(fMapping); }
+
+    void* fMapping;                   // Start of the mapped file
+    size_t fMappingSize;
+    const Short_t* fSamples;
+    const UInt_t* fTriggerSeconds;
+    std::vector<Int_t> fChannelIndex; // Channel number -> index in a trace, or -1
+};
+
+//______________________________________________________________________________
+inline void EXONoiseBank::AddTo(Int_t* data, const Short_t* noise, size_t n)
+{
+  // A plain loop over contiguous arrays, which the compiler vectorizes.
+  for(size_t i = 0; i < n; i++) data[i] += noise[i];
+}
+
+#endif
@@ -4,28 +4,49 @@
 #include "EXOAnalysisModule.hh"
 #include "EXOUtilities/EXOEventInfo.hh"
 #include "EXOUtilities/EXOBaselineAndNoiseCalculator.hh"
+#include "EXOUtilities/EXORunningStatistics.hh"
 #include "TObject.h"
 #include <string>
-#include <set>
+#include <vector>
 
 class EXOEventData;
 class EXOTalkToManager;
 class EXOEventInfo;
 class TFile;
 class TTree;
+class TDirectory;
 
-class EXONoiseCalculator : public EXOAnalysisModule 
+class EXONoiseCalculator : public EXOAnalysisModule
 {
 
 private :
+  // Wire and APD planes, by type and side of the TPC.
+  enum EPlane { kUNorth, kUSouth, kVNorth, kVSouth, kAPDNorth, kAPDSouth, kNumPlanes };
+  static const char* GetPlaneName(int plane);
+  static const char* GetTypeName(int plane);
+
   EXOEventInfo* fEventInfo;
 
   std::string fFilenameBase;
+  bool fWriteTree;
   TFile *fFile;
   TTree *fTree;
   EXOBaselineAndNoiseCalculator fBaselineCalculator;
   int fNevents;
-  std::set<int> fChannels;
+
+  // Per-channel statistics, indexed by fChannelIndex[channel].
+  std::vector<int> fChannelIndex;
+  std::vector<int> fChannels;
+  std::vector<int> fChannelPlane;
+  std::vector<EXORunningStatistics> fBaselineStats;
+  std::vector<EXORunningStatistics> fNoiseStats;
+
+  // Statistics of the per-event plane averages.
+  EXORunningStatistics fPlaneBaselineStats[kNumPlanes];
+  EXORunningStatistics fPlaneNoiseStats[kNumPlanes];
+
+  void InitStatistics(EXORunningStatistics& stats) const;
+  void WriteSummary(TDirectory& noiseDir, TDirectory& baselineDir);
 
 public :
 
@@ -39,6 +60,7 @@ public :
   int TalkTo(EXOTalkToManager *talktoManager);
 
   void SetFilenameBase(std::string fn){fFilenameBase = fn;}
+  void SetWriteTree(bool write){fWriteTree = write;}
 
   DEFINE_EXO_ANALYSIS_MODULE( EXONoiseCalculator )
 };
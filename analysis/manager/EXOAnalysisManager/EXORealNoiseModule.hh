@@ -2,13 +2,16 @@
 #define EXORealNoiseModule_hh
 
 #include "EXOAnalysisModule.hh"
+#include "EXOAnalysisManager/EXONoiseBank.hh"
 #include <string>
 class EXOAnalysisManager;
 class EXOEventData;
 class EXOTalkToManager;
 class TFile;
 class TTree;
+class TRandom3;
 class EXOEventData;
+class EXOWaveformData;
 
 class EXORealNoiseModule : public EXOAnalysisModule 
 {
@@ -26,13 +29,22 @@ private :
   bool fSkipAPDs;
   bool fSkipVWires;
   bool fSkipUWires;
+  std::string fNoiseBankFilename;
+  bool fRandomNoiseTraces;
 
   TFile* fNoiseFile;
   TTree* fNoiseTree;
   EXOEventData* fNoiseEventData;
+  EXONoiseBank fNoiseBank;
+  TRandom3* fRandom;
 
 protected:
 
+  bool OpenNoiseBank();
+  int NextNoiseTrace();
+  bool SkipChannel(int channel) const;
+  EventStatus AddNoiseFromBank(EXOWaveformData* wf_data, int trace);
+
 public :
 
   EXORealNoiseModule();
@@ -43,6 +55,9 @@ public :
   EventStatus EndOfRun(EXOEventData *ED);
   int TalkTo(EXOTalkToManager *tm);
 
+  bool SaveCheckpoint(TDirectory& dir);
+  bool RestoreCheckpoint(TDirectory& dir);
+
   void SetMakeNoiseFile(bool aval);
   void SetUseNoiseFile(bool aval) { fUseNoiseFile = aval; }
   void SetNoiseFilename(std::string aval) {fNoiseFilenameParam = aval;}
@@ -50,6 +65,8 @@ public :
   void SetSkipAPDs(bool aval) {fSkipAPDs = aval;}
   void SetSkipVWires(bool aval) {fSkipVWires = aval;}
   void SetSkipUWires(bool aval) {fSkipUWires = aval;}
+  void SetNoiseBankFilename(std::string aval) {fNoiseBankFilename = aval;}
+  void SetRandomNoiseTraces(bool aval) {fRandomNoiseTraces = aval;}
 
 
 
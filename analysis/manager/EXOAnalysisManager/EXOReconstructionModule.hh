@@ -15,9 +15,11 @@
 #include "EXOUtilities/EXOTimingStatisticInfo.hh"
 #include "EXOUtilities/EXOControlRecord.hh"
 #include <string>
+#include <vector>
 
 class EXOChannelMap;
 class EXODriftVelocityCalib;
+class EXOElectronicsShapers;
 
 class EXOReconstructionModule: public EXOAnalysisModule
 {
@@ -43,6 +45,7 @@ class EXOReconstructionModule: public EXOAnalysisModule
     void SetUserDriftVelocity(double val){fUserDriftVelocity = val;}
     void SetUserCollectionVelocity(double val){fUserCollectionVelocity = val;}
     void SetZ_Separation(double val){fZ_Separation = val;}
+    void SetReuseUnchangedSignals(bool val){fReuseUnchangedSignals = val;}
     void EnableStage(std::string stage_plus_bool);
     void PrintStageStatus();
     EXOReconProcessList CompileUWireIndProcessList(const EXOReconProcessList&,const EXOSignalCollection&) const;
@@ -85,8 +88,31 @@ class EXOReconstructionModule: public EXOAnalysisModule
     double fCollectionVelocityTPC1;   //Collection velocity for tpc 1.
     double fCollectionVelocityTPC2;   //Collection velocity for tpc 2.
     void SetCollectionVelocity(EXOEventData* ED);
+    EventStatus DropEvent(EXOEventData *ED, bool haveStoredSignals);
+    void RecordStageTimes();
     double fZ_Separation;
 
+    // Provenance of the reconstructed signals: one hash per stage that can
+    // be rerun on its own, chained so that each covers the stages before it.
+    enum EReconStage {
+      kSignalFinding,          // Process lists, signal finders and extractors
+      kInductionSignalFinding, // U-wire induction signals
+      kParameterExtraction,    // Signals written to EXOEventData
+      kNumStages
+    };
+    void ComputeConfigurationHash();
+    void ComputeStageHashes(const EXOEventData& ED,
+                            const EXOReconProcessList& processList,
+                            const EXOElectronicsShapers& electronicsShapers);
+    void StoreStageSignals(const EXOSignalCollection& signals, EXOEventData& ED) const;
+    bool RestoreStageSignals(const EXOEventData& ED, size_t& pos,
+                             EXOSignalCollection& signals) const;
+    bool fReuseUnchangedSignals;        // Keep stored signals whose provenance is unchanged
+    bool fHaveConfigurationHash;        // Whether fConfigurationHash is set for this job
+    ULong64_t fConfigurationHash;       // Hash of the /rec/ commands
+    std::vector<std::string> fStageNames;
+    std::vector<ULong64_t> fStageHashes;
+
     EXOBeginRecord::RunFlavor fRunFlavor;
 
     typedef std::vector< std::pair<EXOVDefineReconProcessList*, RecProc> > ProcessLists;
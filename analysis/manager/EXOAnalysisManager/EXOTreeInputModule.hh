@@ -21,6 +21,9 @@ protected :
   long int fCurrentEventID;      // flags current serial ID
   std::list<std::string> fFiles;
   EXOControlRecordList   fControlRecords;
+  bool         fSelectiveReading; // only read the parts of the event used by modules
+  unsigned int fEventDataUsage;   // parts read for every event
+  unsigned int fLoadedParts;      // parts read for each entry, including those loaded on demand
 
   virtual void OpenFile(const std::string& aFile);
   virtual void CloseCurrentFile();
@@ -47,8 +50,17 @@ public :
 
   void AddFilesToProcess(std::string fileOrFiles);
 
+  void SetSelectiveReading(bool aval);
+  void SetEventDataUsage(unsigned int parts);
+  void EnsureEventDataLoaded(unsigned int parts);
+
+  bool SaveCheckpoint(TDirectory& dir);
+  bool RestoreCheckpoint(TDirectory& dir);
+
 protected:
   bool CheckNextFile();
+  void ApplyBranchStatus();
+  void SetPartStatus(unsigned int part, bool status);
 
   DEFINE_EXO_ANALYSIS_MODULE( EXOTreeInputModule )
 
@@ -26,6 +26,9 @@ private :
   TTree *fStatisticsTree;
   TFile *fRootFile;
   EXOEventData* fLastEvent;
+  bool   fCheckpointing;
+
+  int InitializeForResume();
 
 public :
 
@@ -38,6 +41,11 @@ public :
   int ShutDown();
   int TalkTo(EXOTalkToManager *tm);
 
+  unsigned int GetEventDataReads() const;
+
+  bool SaveCheckpoint(TDirectory& dir);
+  bool RestoreCheckpoint(TDirectory& dir);
+
   void SetOutputFilename(std::string aval) 
     { fOutputFilename = aval; }
   void SetWriteSignals(bool aval) { fWriteSignals = aval; }
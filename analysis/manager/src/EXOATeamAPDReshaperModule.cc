@@ -21,6 +21,10 @@
 //            recognition 3 in reconstruciton. ---psb
 // 11-27-10:  added a feature to measure the RMS. ---psb
 // 11-27-11:  Update for new EXOAPDSignals. --- V.Belov
+// Filters are now identified by FilterID internally.  The noise corner scan
+// (/apreshap/makeNoiseCorners) applies each filter for all shaping times
+// given by /apreshap/noiseCornerTaus in one pass with FilterBank, and prints
+// the shaper with the lowest noise for each APD channel at ShutDown.
 // ====================================================================================== 
 
 #include "EXOAnalysisManager/EXOATeamAPDReshaperModule.hh"
@@ -33,6 +37,8 @@
 #include "EXOUtilities/EXOEventData.hh"
 #include "EXOUtilities/EXOTalkToManager.hh"
 #include <iostream>
+#include <sstream>
+#include <algorithm>
 #include "TH1F.h"
 #include "TF1.h"
 using namespace std;
@@ -47,8 +53,57 @@ EXOATeamAPDReshaperModule::EXOATeamAPDReshaperModule():
   CR1_param(10.0),
   CR2_param(10.0),
   overwriteSignals_param(false),
-  makeNoiseCorners_param(false)
-{}
+  makeNoiseCorners_param(false),
+  fFilterID(kInvalidFilter),
+  fNoiseCorners(NULL)
+{
+  SetnoiseCornerTaus_param("2 4 6 8 10 12 14 16 18 20");
+}
+
+EXOATeamAPDReshaperModule::~EXOATeamAPDReshaperModule()
+{
+  delete fNoiseCorners;
+}
+
+EXOATeamAPDReshaperModule::FilterID EXOATeamAPDReshaperModule::GetFilterID(const string& name)
+{
+  if (name == "no_filter") return kNoFilter;
+  if (name == "finite_cusp") return kFiniteCusp;
+  if (name == "triangular") return kTriangular;
+  if (name == "gaussian") return kGaussian;
+  if (name == "rc_cr") return kRC_CR;
+  return kInvalidFilter;
+}
+
+string EXOATeamAPDReshaperModule::GetFilterName(FilterID filter)
+{
+  switch (filter) {
+    case kNoFilter: return "no_filter";
+    case kFiniteCusp: return "finite_cusp";
+    case kTriangular: return "triangular";
+    case kGaussian: return "gaussian";
+    case kRC_CR: return "rc_cr";
+    default: return "invalid";
+  }
+}
+
+void EXOATeamAPDReshaperModule::SetnoiseCornerTaus_param(string aval)
+{
+  // Shaping times for the noise corner scan, separated by spaces or commas.
+  std::replace(aval.begin(), aval.end(), ',', ' ');
+  istringstream is(aval);
+  vector<int> taus;
+  int tau;
+  while (is >> tau) {
+    if (tau <= 0) throw EXOMiscUtil::EXOBadCommand("Shaping times must be positive.");
+    taus.push_back(tau);
+  }
+  if (not is.eof()) throw EXOMiscUtil::EXOBadCommand("Could not read shaping times from: " + aval);
+  if (taus.empty() or taus.size() > 25) {
+    throw EXOMiscUtil::EXOBadCommand("Give between 1 and 25 shaping times.");
+  }
+  noiseCornerTaus_param = taus;
+}
 
 int EXOATeamAPDReshaperModule::Initialize() {
 
@@ -70,30 +125,41 @@ int EXOATeamAPDReshaperModule::Initialize() {
   // filter appropriately
   
   p_f = 0.0;   // renormalization factor: accounts for filtering
-  string filter = filter_param;
-
-  if (filter == "no_filter") {
-    // Needs to be handled later
-  }
-  else if (filter == "finite_cusp") {
-    FiniteCusp(signal, length);
-    double h_fin = Max(signal, length);
-    p_f = h_fin / step_height;
-  }
-  else if (filter == "triangular") {
-    Triangular(signal, length);
-    double h_tri = Max(signal, length);
-    p_f = h_tri / step_height;
-  }
-  else if (filter == "gaussian") {
-    Gaussian(signal, length);
-    double h_gauss = Max(signal, length);
-    p_f = h_gauss / step_height;
-  }
-  else if (filter == "rc_cr") {
-    RC_CR(signal, length);
-    double h_rc_cr = Max(signal, length);
-    p_f = h_rc_cr / step_height;
+  fFilterID = GetFilterID(filter_param);
+
+  switch (fFilterID) {
+    case kNoFilter:
+      // Needs to be handled later
+      break;
+    case kFiniteCusp:
+      FiniteCusp(signal, length);
+      p_f = Max(signal, length) / step_height;
+      break;
+    case kTriangular:
+      Triangular(signal, length);
+      p_f = Max(signal, length) / step_height;
+      break;
+    case kGaussian:
+      Gaussian(signal, length);
+      p_f = Max(signal, length) / step_height;
+      break;
+    case kRC_CR:
+      RC_CR(signal, length);
+      p_f = Max(signal, length) / step_height;
+      break;
+    default:
+      LogEXOMsg("invalid filtering method: " + filter_param, EEError);
+      return -1;
+  }
+
+  if (makeNoiseCorners_param) {
+    // One bank per filter, each covering all shaping times of the scan.
+    fNoiseCornerBanks.clear();
+    fNoiseCornerBanks.push_back(FilterBank(kTriangular, noiseCornerTaus_param));
+    fNoiseCornerBanks.push_back(FilterBank(kGaussian, noiseCornerTaus_param));
+    fNoiseCornerBanks.push_back(FilterBank(kFiniteCusp, noiseCornerTaus_param, T_param));
+    delete fNoiseCorners;
+    fNoiseCorners = new APDNoiseCorners("apdNoiseCorners", noiseCornerTaus_param.size(), 1);
   }
 
   return 0;
@@ -113,25 +179,19 @@ EXOAnalysisModule::EventStatus EXOATeamAPDReshaperModule::BeginOfRun(EXOEventDat
 
 EXOAnalysisModule::EventStatus EXOATeamAPDReshaperModule::ProcessEvent(EXOEventData *ED) {  
 
-  string filter = filter_param;
-
   int length = ED->GetWaveformData()->fNumSamples;  // length of waveform
 
   double t0 = FindTrigger(length, ED);
 
-  bool makeNoiseCorners = makeNoiseCorners_param;
-
   //---------------Begin Standard event by event reshaping------------//
   //loop over all APD channels
   const EXOElectronicsShapers* shapers = GetCalibrationFor(EXOElectronicsShapers, EXOElectronicsShapersHandler, "vanilla", ED->fEventHeader);
 
   for (size_t channelNum = NWIREPLANE*NCHANNEL_PER_WIREPLANE; channelNum < NUMBER_READOUT_CHANNELS; channelNum++) {
 
-    if(filter_param == "no_filter") p = 1.0;
-    else {
-      double gain = shapers->GetTransferFunctionForChannel(channelNum).GetGain();
-      p = p_f / gain;
-    }
+    double gain = shapers->GetTransferFunctionForChannel(channelNum).GetGain();
+    if(fFilterID == kNoFilter) p = 1.0;
+    else p = p_f / gain;
 
     EXOWaveform* wf_ptr = ED->GetWaveformData()->GetWaveformWithChannelToEdit(channelNum);
     if (!wf_ptr) {
@@ -162,24 +222,17 @@ EXOAnalysisModule::EventStatus EXOATeamAPDReshaperModule::ProcessEvent(EXOEventD
 
     t0 -= increment_forward;
 
-    //filter shortwfm.  Using the shorter one cleans things up a bit.
-    if (filter == "no_filter") {
-
-    }
-    else if (filter == "finite_cusp") {
-      FiniteCusp(unshaped, length);
-    }
-    else if (filter == "triangular") {
-      Triangular(unshaped, length);
+    if (fNoiseCorners) {
+      FillNoiseCorners(channelNum - NWIREPLANE*NCHANNEL_PER_WIREPLANE, unshaped, length, t0, gain);
     }
-    else if (filter == "gaussian") {
-      Gaussian(unshaped, length);
-    }
-    else if (filter == "rc_cr") {
-      RC_CR(unshaped, length);
-    }
-    else {
-      LogEXOMsg("invalid filtering method", EEError);
+
+    //filter shortwfm.  Using the shorter one cleans things up a bit.
+    switch (fFilterID) {
+      case kFiniteCusp: FiniteCusp(unshaped, length); break;
+      case kTriangular: Triangular(unshaped, length); break;
+      case kGaussian: Gaussian(unshaped, length); break;
+      case kRC_CR: RC_CR(unshaped, length); break;
+      default: break;
     }
 
     //renormalize waveforms...note that despite the name, they are no longer unshaped
@@ -269,6 +322,11 @@ int EXOATeamAPDReshaperModule::TalkTo(EXOTalkToManager *talktoManager) {
 
   talktoManager->CreateCommand("/apreshap/makeNoiseCorners", "produces noise corners and finds minimum noise", this, makeNoiseCorners_param, &EXOATeamAPDReshaperModule::SetmakeNoiseCorners_param );
 
+  talktoManager->CreateCommand("/apreshap/noiseCornerTaus",
+                               "shaping times scanned for the noise corners",
+                               this, "2 4 6 8 10 12 14 16 18 20",
+                               &EXOATeamAPDReshaperModule::SetnoiseCornerTaus_param );
+
   return 0;
 }
 
@@ -278,10 +336,10 @@ int EXOATeamAPDReshaperModule::ShutDown() {
 
   cout << "At ShutDown for " << GetName() << endl;
 
-  bool makeNoiseCorners = makeNoiseCorners_param;
-
-  if (makeNoiseCorners) {
- 
+  if (fNoiseCorners) {
+    PrintNoiseCorners();
+    delete fNoiseCorners;
+    fNoiseCorners = NULL;
     cout << "-- Done with Noise Corner Graphs for APD channels." << endl;
   }    
 
@@ -522,32 +580,38 @@ void EXOATeamAPDReshaperModule::RC_unshaper(double signal[], int n, double trati
 }
 
 // From pretrace time
-double EXOATeamAPDReshaperModule::Baseline(double signal[], int length, double trigger) {
-  
-  if (trigger > length) {
-    LogEXOMsg("trigger index out of bounds", EEError);
-    return -1.0;
-  }
-  
-  double sum = 0;
+void EXOATeamAPDReshaperModule::GetBaselineWindow(int length, double trigger, int& beginBaseLine, int& endBaseLine) {
+
   int PreTraceBuffer = int( 0.3*trigger );
   int BaseLineLength = int( 0.9*trigger - PreTraceBuffer );
   
-  int beginBaseLine = 0;
+  beginBaseLine = 0;
   if (trigger - PreTraceBuffer - BaseLineLength > beginBaseLine) {
     beginBaseLine = int(trigger -  PreTraceBuffer - BaseLineLength);
   }
 
-  int endBaseLine = 1;
+  endBaseLine = 1;
   if (trigger - PreTraceBuffer > endBaseLine) {
     endBaseLine = int(trigger - PreTraceBuffer); 
   }
+}
+
+double EXOATeamAPDReshaperModule::Baseline(double signal[], int length, double trigger) {
+  
+  if (trigger > length) {
+    LogEXOMsg("trigger index out of bounds", EEError);
+    return -1.0;
+  }
+  
+  double sum = 0;
+  int beginBaseLine, endBaseLine;
+  GetBaselineWindow(length, trigger, beginBaseLine, endBaseLine);
 
   for (int i = beginBaseLine; i < endBaseLine; i++) {
     sum += signal[i];
   }
 
-  BaseLineLength = endBaseLine - beginBaseLine;
+  int BaseLineLength = endBaseLine - beginBaseLine;
 
   return sum / BaseLineLength;
 }
@@ -650,6 +714,233 @@ double EXOATeamAPDReshaperModule::MeasureRMS(double signal[], int length, double
   return rms;
 }
 
+void EXOATeamAPDReshaperModule::FillNoiseCorners(int apdIndex, const double unshaped[], int length, double trigger, double gain) {
+
+  // Apply all filter banks to the unshaped waveform and add the peak height
+  // for every shaping time to the noise corners of this channel.  Heights
+  // are normalized like the standard reshaping, per filter and shaping time.
+  vector<double> amplitudes;
+  for (size_t ibank = 0; ibank < fNoiseCornerBanks.size(); ibank++) {
+    FilterBank& bank = fNoiseCornerBanks[ibank];
+    bank.Apply(unshaped, length);
+    bank.GetAmplitudes(trigger, amplitudes);
+    for (size_t k = 0; k < amplitudes.size(); k++) {
+      if (bank.GetFilter() == kFiniteCusp) {
+        fNoiseCorners->Add(apdIndex, kFiniteCusp, bank.GetShapingTime(k), bank.GetT(), amplitudes[k]*gain);
+      }
+      else {
+        fNoiseCorners->Add(apdIndex, bank.GetFilter(), bank.GetShapingTime(k), amplitudes[k]*gain);
+      }
+    }
+  }
+}
+
+void EXOATeamAPDReshaperModule::PrintNoiseCorners() {
+
+  cout << "-- Lowest noise shaper for APD channels:" << endl;
+  for (int i = 0; i < NUMBER_READOUT_CHANNELS - NWIREPLANE*NCHANNEL_PER_WIREPLANE; i++) {
+    FilterID best = fNoiseCorners->GetBestShaper(i);
+    cout << "   channel " << i + NWIREPLANE*NCHANNEL_PER_WIREPLANE << ": "
+         << GetFilterName(best) << ", tau = " << fNoiseCorners->GetBestShaperTau(i);
+    if (best == kFiniteCusp) cout << ", T = " << fNoiseCorners->GetBestShaperT(i);
+    cout << endl;
+  }
+}
+
+//==============================
+
+EXOATeamAPDReshaperModule::FilterBank::FilterBank(FilterID filter, const vector<int>& taus, double T) :
+  fFilter(filter),
+  fT(T),
+  fTaus(taus),
+  fKernelLength(0),
+  fLength(0)
+{
+  size_t ntau = fTaus.size();
+  fWeights.resize(ntau);
+  for (size_t k = 0; k < ntau; k++) {
+    int tau = fTaus[k];
+    if (fFilter == kGaussian) {
+      double tratio = 1.0 / tau;
+      fWeights[k] = exp( -1.0*tratio );
+    }
+    else {
+      fWeights[k] = 1.0 / tau;
+    }
+  }
+
+  if (fFilter == kFiniteCusp) {
+    // Tabulate the kernels of FiniteCusp(), zero-padded to the longest one.
+    for (size_t k = 0; k < ntau; k++) {
+      size_t last = int(T*fTaus[k]) + int(T/2);
+      fKernelLength = max(fKernelLength, last + 1);
+    }
+    fKernels.assign(fKernelLength*ntau, 0.0);
+    for (size_t k = 0; k < ntau; k++) {
+      int tau = fTaus[k];
+      for (int m = 1 + int(T/2); m < int(T*tau/2.0) + 1 + int(T/2); m++) {
+        double t = m - T/2.0;
+        fKernels[m*ntau + k] = sinh(t/tau);
+      }
+      for (int m = int(T*tau/2.0) + 1 + int(T/2); m < int(T*tau) + 1 + int(T/2); m++) {
+        double t = m - T/2.0;
+        fKernels[m*ntau + k] = sinh((T*tau-t)/tau);
+      }
+    }
+  }
+
+  // Normalize to the response to a unit step, as Initialize does for the
+  // standard reshaping.
+  int length = 1000;
+  vector<double> step(length, 0.0);
+  for (int i = length/2 + 1; i < length; i++) step[i] = 1.0;
+  fGains.assign(ntau, 1.0);
+  Apply(&step[0], length);
+  GetMaxima(fGains);
+  for (size_t k = 0; k < ntau; k++) {
+    if (fGains[k] == 0.0) fGains[k] = 1.0;
+  }
+}
+
+void EXOATeamAPDReshaperModule::FilterBank::Apply(const double signal[], int length) {
+
+  fLength = length;
+  fOutput.assign(length*fTaus.size(), 0.0);
+  if (length == 0 or fTaus.empty()) return;
+
+  switch (fFilter) {
+    case kGaussian: ApplyGaussian(signal); break;
+    case kTriangular: ApplyTriangular(signal); break;
+    case kFiniteCusp: ApplyKernels(signal); break;
+    default: LogEXOMsg("filter " + GetFilterName(fFilter) + " has no filter bank", EEError);
+  }
+}
+
+void EXOATeamAPDReshaperModule::FilterBank::ApplyGaussian(const double signal[]) {
+
+  // CR_shaper followed by four RC_shaper, as in Gaussian(), run sample by
+  // sample for all shaping times at once.  The arithmetic is the same as in
+  // the scalar recursions, so the results are identical.
+  size_t ntau = fTaus.size();
+  const double* w = &fWeights[0];
+  double* out = &fOutput[0];
+  vector<double> crOut(ntau, signal[0]);
+  vector<double> rcIn(4*ntau, signal[0]);
+  vector<double> rcD(4*ntau, 0.0);
+  vector<double> x(ntau);
+
+  // The first sample passes through all stages unchanged.
+  for (size_t k = 0; k < ntau; k++) out[k] = signal[0];
+
+  for (int i = 1; i < fLength; i++) {
+    double diff = signal[i] - signal[i-1];
+    double* cr = &crOut[0];
+    for (size_t k = 0; k < ntau; k++) {
+      cr[k] = diff + cr[k]*w[k];
+      x[k] = cr[k];
+    }
+    for (size_t stage = 0; stage < 4; stage++) {
+      double* in0 = &rcIn[stage*ntau];
+      double* d0 = &rcD[stage*ntau];
+      for (size_t k = 0; k < ntau; k++) {
+        double in = x[k];
+        x[k] = in*(1.0-w[k]) + in0[k]*w[k] - d0[k]*w[k]*w[k];
+        d0[k] = in - in0[k] + d0[k]*w[k];
+        in0[k] = in;
+      }
+    }
+    double* outi = out + i*ntau;
+    for (size_t k = 0; k < ntau; k++) outi[k] = x[k];
+  }
+}
+
+void EXOATeamAPDReshaperModule::FilterBank::ApplyTriangular(const double signal[]) {
+
+  // Triangular() convolves the derivative of the signal with a triangle of
+  // half-width tau.  The triangle is the convolution of two boxes of width
+  // tau, so the output follows from a second difference of the signal:
+  //   out[j] = out[j-1] + (s[j-1] - 2 s[j-1-tau] + s[j-1-2 tau]) / tau,
+  // with samples before the start taken to be s[0].
+  size_t ntau = fTaus.size();
+  const double* w = &fWeights[0];
+  const int* taus = &fTaus[0];
+  double* out = &fOutput[0];
+
+  for (int j = 1; j < fLength; j++) {
+    const double* prev = out + (j-1)*ntau;
+    double* cur = out + j*ntau;
+    double s1 = signal[j-1];
+    for (size_t k = 0; k < ntau; k++) {
+      int i2 = j - 1 - taus[k];
+      int i3 = j - 1 - 2*taus[k];
+      double s2 = signal[i2 > 0 ? i2 : 0];
+      double s3 = signal[i3 > 0 ? i3 : 0];
+      cur[k] = prev[k] + (s1 - 2.0*s2 + s3)*w[k];
+    }
+  }
+}
+
+void EXOATeamAPDReshaperModule::FilterBank::ApplyKernels(const double signal[]) {
+
+  // Convolve the derivative of the signal with the tabulated kernels.  The
+  // innermost loop runs over the shaping times.
+  size_t ntau = fTaus.size();
+  const double* kernels = &fKernels[0];
+  double* out = &fOutput[0];
+
+  for (int j = 2; j < fLength; j++) {
+    double* cur = out + j*ntau;
+    int mmax = min(int(fKernelLength) - 1, j - 1);
+    for (int m = 1; m <= mmax; m++) {
+      double d = signal[j-m] - signal[j-m-1];
+      const double* kern = kernels + m*ntau;
+      for (size_t k = 0; k < ntau; k++) cur[k] += d*kern[k];
+    }
+  }
+}
+
+void EXOATeamAPDReshaperModule::FilterBank::GetMaxima(vector<double>& maxima) const {
+
+  // Maximum of each output as in Max(), skipping 30 samples at either end.
+  size_t ntau = fTaus.size();
+  int buffer = 30;
+  maxima.assign(fOutput.begin(), fOutput.begin() + ntau);
+  for (int i = 1 + buffer; i < fLength - buffer; i++) {
+    const double* outi = &fOutput[i*ntau];
+    for (size_t k = 0; k < ntau; k++) {
+      if (outi[k] > maxima[k]) maxima[k] = outi[k];
+    }
+  }
+}
+
+void EXOATeamAPDReshaperModule::FilterBank::GetAmplitudes(double trigger, vector<double>& amplitudes) const {
+
+  // Amplitude() of each output, normalized to the step response.
+  size_t ntau = fTaus.size();
+  GetMaxima(amplitudes);
+  if (trigger > fLength) {
+    LogEXOMsg("trigger index out of bounds", EEError);
+    return;
+  }
+  int begin, end;
+  GetBaselineWindow(fLength, trigger, begin, end);
+  vector<double> sum(ntau, 0.0);
+  for (int i = begin; i < end; i++) {
+    const double* outi = &fOutput[i*ntau];
+    for (size_t k = 0; k < ntau; k++) sum[k] += outi[k];
+  }
+  for (size_t k = 0; k < ntau; k++) {
+    amplitudes[k] = fabs(amplitudes[k] - sum[k]/(end - begin)) / fGains[k];
+  }
+}
+
+void EXOATeamAPDReshaperModule::FilterBank::GetOutput(size_t index, double output[]) const {
+
+  // Copy the filtered waveform for shaping time number index.
+  size_t ntau = fTaus.size();
+  for (int i = 0; i < fLength; i++) output[i] = fOutput[i*ntau + index];
+}
+
 //==============================
 
 EXOATeamAPDReshaperModule::NoiseCorner::NoiseCorner()
@@ -705,7 +996,6 @@ void EXOATeamAPDReshaperModule::NoiseCorner::Init(){
     stringstream int_to_string;
     int_to_string << i;
     string htitle = cornername + "hist_" + int_to_string.str();
-    cout << htitle << endl;
     hPeakHeights[i] = new TH1F(htitle.c_str(), htitle.c_str(), 4096, 0, 4096 );
 
   }
@@ -779,6 +1069,13 @@ int EXOATeamAPDReshaperModule::NoiseCorner::GetArrayLength(){
   return numTimes;
 }
 
+double EXOATeamAPDReshaperModule::NoiseCorner::GetrmsValueForTau(int tau){
+  // rms for shaping time tau, 0 if tau was not scanned.
+  int index = ArrayIndex( tau );
+  if (index < 0) return 0.0;
+  return GetrmsValue(index);
+}
+
 int EXOATeamAPDReshaperModule::NoiseCorner::GetBestTau(){
   int val = 0;
   double minimum = -1.0;  
@@ -830,7 +1127,7 @@ EXOATeamAPDReshaperModule::Filters::Filters(){
   filtername = "";
   // here maxlength is the maximum number of shaping times for which information will be stored.
   maxlength = 25;
-  numTTimes = int (maxlength/2.0);
+  maxTTimes = int (maxlength/2.0);
   Init();
 }
 
@@ -838,7 +1135,7 @@ EXOATeamAPDReshaperModule::Filters::Filters(string name){
   filtername = name;
   // here maxlength is the maximum number of shaping times for which information will be stored.
   maxlength = 25;
-  numTTimes = int (maxlength/2.0);
+  maxTTimes = int (maxlength/2.0);
   Init();
 }
 
@@ -846,7 +1143,7 @@ EXOATeamAPDReshaperModule::Filters::Filters(string name, int length){
   filtername = name;
   // here maxlength is the maximum number of shaping times for which information will be stored.
   maxlength = length;
-  numTTimes = int (maxlength / 2.0);
+  maxTTimes = int (maxlength / 2.0);
   Init();
 }
 
@@ -856,7 +1153,7 @@ EXOATeamAPDReshaperModule::Filters::Filters(string name, int length, int Tlength
   filtername = name;
   // here maxlength is the maximum number of shaping times for which information will be stored.
   maxlength = length;
-  numTTimes = Tlength;
+  maxTTimes = min(Tlength, 25);
   Init();
 }
 
@@ -865,21 +1162,24 @@ EXOATeamAPDReshaperModule::Filters::~Filters(){
   delete triangular;
   delete gaussian;
 
-  for (int i = 0; i < numTTimes; i++){
+  for (int i = 0; i < maxTTimes; i++){
     delete finiteCusp[i];
   }
-  delete tempval;
-  delete tempval2;
+  delete [] TTimes;
+  delete [] tempval;
+  delete [] tempval2;
 }
 
 void EXOATeamAPDReshaperModule::Filters::Init(){
 
   BestNotCalculated = true;
+  numTTimes = 0;
+  TTimes = new double[maxTTimes];
 
   triangular = new NoiseCorner("triangular_" + filtername, maxlength );
   gaussian = new NoiseCorner("gaussian_" + filtername, maxlength );
   
-  for (int i = 0; i < numTTimes; i++){
+  for (int i = 0; i < maxTTimes; i++){
     stringstream int_to_string;
     int_to_string << i;
     finiteCusp[i] = new NoiseCorner("finiteCusp_" + int_to_string.str() + "_" + filtername, maxlength);
@@ -890,34 +1190,33 @@ void EXOATeamAPDReshaperModule::Filters::Init(){
 
 }
 
-void EXOATeamAPDReshaperModule::Filters::Add(string filterType, int tau, double peakHeight){
+void EXOATeamAPDReshaperModule::Filters::Add(FilterID filterType, int tau, double peakHeight){
 
   BestNotCalculated = true;
 
-  if (filterType == "triangular"){
+  if (filterType == kTriangular){
     triangular->Add(tau, peakHeight);
   }
-  else if (filterType == "gaussian"){
+  else if (filterType == kGaussian){
     gaussian->Add(tau, peakHeight);
   }
     
 }
 
-void EXOATeamAPDReshaperModule::Filters::Add(string filterType, int tau, double T, double peakHeight){
+void EXOATeamAPDReshaperModule::Filters::Add(FilterID filterType, int tau, double T, double peakHeight){
 
   int Tindex = ArrayIndex( T );
 
   BestNotCalculated = true;
 
-  if (filterType == "finiteCusp"){
+  if (filterType == kFiniteCusp){
     if (Tindex == -1){
+      if (numTTimes >= maxTTimes) return;
+      Tindex = numTTimes;
       TTimes[numTTimes] = T;
-      finiteCusp[numTTimes]->Add(tau, peakHeight);
       numTTimes++;
     }
-    else{
-      finiteCusp[numTTimes]->Add(tau, peakHeight);
-    }
+    finiteCusp[Tindex]->Add(tau, peakHeight);
   }
 
 }
@@ -939,28 +1238,28 @@ int EXOATeamAPDReshaperModule::Filters::GetTArrayLength(){
   return numTTimes;
 }
 
-int EXOATeamAPDReshaperModule::Filters::GetArrayLength(string filterType){
+int EXOATeamAPDReshaperModule::Filters::GetArrayLength(FilterID filterType){
   
   int val = 0;
 
-  if (filterType == "triangular"){
+  if (filterType == kTriangular){
     val = triangular->GetArrayLength();
   }
-  else if (filterType == "gaussian"){
+  else if (filterType == kGaussian){
     val = gaussian->GetArrayLength();
   }
-  else if (filterType == "finiteCusp"){
+  else if (filterType == kFiniteCusp){
     val = finiteCusp[0]->GetArrayLength();
   }
   return val;
 }
 
-int EXOATeamAPDReshaperModule::Filters::GetArrayLength(string filterType, double T){
+int EXOATeamAPDReshaperModule::Filters::GetArrayLength(FilterID filterType, double T){
   int Tindex = ArrayIndex( T );
   int val = 0;
   
 
-  if (filterType == "finiteCusp"){
+  if (filterType == kFiniteCusp){
     val = finiteCusp[Tindex]->GetArrayLength();
   }
 
@@ -978,11 +1277,11 @@ double EXOATeamAPDReshaperModule::Filters::GetBestT(){
     for (int i = 0; i < numTTimes; i++){
       if (minimum == -1.0){
 	bestindex = i;
-	minimum = finiteCusp[i]->GetrmsValue( finiteCusp[i]->GetBestTau() );
+	minimum = finiteCusp[i]->GetrmsValueForTau( finiteCusp[i]->GetBestTau() );
       }
       else {
-	if (minimum > finiteCusp[i]->GetrmsValue( finiteCusp[i]->GetBestTau() )){
-	  minimum = finiteCusp[i]->GetrmsValue( finiteCusp[i]->GetBestTau() );
+	if (minimum > finiteCusp[i]->GetrmsValueForTau( finiteCusp[i]->GetBestTau() )){
+	  minimum = finiteCusp[i]->GetrmsValueForTau( finiteCusp[i]->GetBestTau() );
 	  bestindex = i;		      
 	}
       }
@@ -1002,11 +1301,11 @@ int EXOATeamAPDReshaperModule::Filters::GetBestTindex(){
   for (int i = 0; i < numTTimes; i++){
     if (minimum == -1.0){
       bestindex = i;
-      minimum = finiteCusp[i]->GetrmsValue( finiteCusp[i]->GetBestTau() );
+      minimum = finiteCusp[i]->GetrmsValueForTau( finiteCusp[i]->GetBestTau() );
     }
     else {
-      if (minimum > finiteCusp[i]->GetrmsValue( finiteCusp[i]->GetBestTau() )){
-	minimum = finiteCusp[i]->GetrmsValue( finiteCusp[i]->GetBestTau() );
+      if (minimum > finiteCusp[i]->GetrmsValueForTau( finiteCusp[i]->GetBestTau() )){
+	minimum = finiteCusp[i]->GetrmsValueForTau( finiteCusp[i]->GetBestTau() );
 	bestindex = i;		      
       }
     }
@@ -1015,7 +1314,7 @@ int EXOATeamAPDReshaperModule::Filters::GetBestTindex(){
   return bestindex;
 }
 
-string EXOATeamAPDReshaperModule::Filters::GetBestShaper(){
+EXOATeamAPDReshaperModule::FilterID EXOATeamAPDReshaperModule::Filters::GetBestShaper(){
  
   if (BestNotCalculated){
     CalculateBest();
@@ -1038,8 +1337,8 @@ double EXOATeamAPDReshaperModule::Filters::GetBestShaperT(){
     CalculateBest();
   }
 
-  if (GetBestShaper() == "finiteCusp"){
-    val = GetBestT();
+  if (GetBestShaper() == kFiniteCusp){
+    val = bestT;
   }
   
   return val;
@@ -1047,109 +1346,119 @@ double EXOATeamAPDReshaperModule::Filters::GetBestShaperT(){
 
 void EXOATeamAPDReshaperModule::Filters::CalculateBest(){
   bestTau = 0;
-  bestfilter = "";
+  bestfilter = kNoFilter;
   bestT = 0.0;
 
   BestNotCalculated = false;
 
-  double minimum = 0.0;
+  double minimum = -1.0;
   if (triangular->GetArrayLength() > 0) {
     bestTau = triangular->GetBestTau();
-    minimum = triangular->GetrmsValue( bestTau );
-    bestfilter = "triangular";
+    minimum = triangular->GetrmsValueForTau( bestTau );
+    bestfilter = kTriangular;
   }
     
-  if (minimum > gaussian->GetrmsValue( gaussian->GetBestTau()) && gaussian->GetArrayLength() > 0 ){
-    bestfilter = "gaussian";
-    bestTau = gaussian->GetBestTau();
+  if (gaussian->GetArrayLength() > 0) {
+    int tau = gaussian->GetBestTau();
+    double rms = gaussian->GetrmsValueForTau( tau );
+    if (minimum < 0.0 || rms < minimum) {
+      minimum = rms;
+      bestfilter = kGaussian;
+      bestTau = tau;
+    }
   }
   
-  int BestTindex = GetBestTindex();
-  if (minimum > finiteCusp[ BestTindex ]->GetrmsValue( finiteCusp[ BestTindex ]->GetBestTau() ) && numTTimes > 0 ){
-    bestfilter = "finiteCusp";
-    bestT = GetBestT();
-    bestTau = finiteCusp[ BestTindex ]->GetBestTau();
+  if (numTTimes > 0) {
+    int BestTindex = GetBestTindex();
+    int tau = finiteCusp[ BestTindex ]->GetBestTau();
+    double rms = finiteCusp[ BestTindex ]->GetrmsValueForTau( tau );
+    if (minimum < 0.0 || rms < minimum) {
+      minimum = rms;
+      bestfilter = kFiniteCusp;
+      bestT = TTimes[ BestTindex ];
+      bestTau = tau;
+    }
   }
 }
 
-int* EXOATeamAPDReshaperModule::Filters::GetFilterShapingTimes(string filterType){
+int* EXOATeamAPDReshaperModule::Filters::GetFilterShapingTimes(FilterID filterType){
 
 
 
-  if (filterType == "triangular"){
+  if (filterType == kTriangular){
     return triangular->GetShapingTimes();
   }
-  else if (filterType == "gaussian"){
+  else if (filterType == kGaussian){
     return gaussian->GetShapingTimes();
   }
-  else if (filterType == "finiteCusp"){
+  else if (filterType == kFiniteCusp){
     return finiteCusp[0]->GetShapingTimes();
   }
 
   return tempval;
 }
 
-int* EXOATeamAPDReshaperModule::Filters::GetFilterShapingTimes(string filterType, double T){
+int* EXOATeamAPDReshaperModule::Filters::GetFilterShapingTimes(FilterID filterType, double T){
 
 
 
-  if (filterType == "finiteCusp"){
+  if (filterType == kFiniteCusp){
     return finiteCusp[ ArrayIndex(T) ]->GetShapingTimes();
   }
 
   return tempval;
 }
 
-double* EXOATeamAPDReshaperModule::Filters::GetFilterrmsValues(string filterType){
+double* EXOATeamAPDReshaperModule::Filters::GetFilterrmsValues(FilterID filterType){
 
 
 
-  if (filterType == "triangular"){
+  if (filterType == kTriangular){
     return triangular->GetrmsValues();
   }
-  else if (filterType == "gaussian"){
+  else if (filterType == kGaussian){
     return gaussian->GetrmsValues();
   }
-  else if (filterType == "finiteCusp"){
+  else if (filterType == kFiniteCusp){
     return finiteCusp[0]->GetrmsValues();
   }
 
   return tempval2;
 }
 
-double* EXOATeamAPDReshaperModule::Filters::GetFilterrmsValues(string filterType, double T){
+double* EXOATeamAPDReshaperModule::Filters::GetFilterrmsValues(FilterID filterType, double T){
 
 
 
-  if (filterType == "finiteCusp"){
+  if (filterType == kFiniteCusp){
     return finiteCusp[ ArrayIndex(T) ]->GetrmsValues();
   }
 
   return tempval2;
 }
 
-double* EXOATeamAPDReshaperModule::Filters::GetFilterrmsErrors(string filterType){
+double* EXOATeamAPDReshaperModule::Filters::GetFilterrmsErrors(FilterID filterType){
 
 
 
-  if (filterType == "triangular"){
+  if (filterType == kTriangular){
     return triangular->GetrmsErrors();
   }
-  else if (filterType == "gaussian"){
+  else if (filterType == kGaussian){
     return gaussian->GetrmsErrors();
   }
-  else if (filterType == "finiteCusp"){
+  else if (filterType == kFiniteCusp){
     return finiteCusp[0]->GetrmsErrors();
   }
 
   return tempval2;
 }
 
-double* EXOATeamAPDReshaperModule::Filters::GetFilterrmsErrors(string filterType, double T){
+double* EXOATeamAPDReshaperModule::Filters::GetFilterrmsErrors(FilterID filterType, double T){
 
 
 
-  if (filterType == "finiteCusp"){
+  if (filterType == kFiniteCusp){
     return finiteCusp[ ArrayIndex(T) ]->GetrmsErrors();
   }
 
@@ -1172,14 +1481,14 @@ EXOATeamAPDReshaperModule::APDNoiseCorners::~APDNoiseCorners(){
   }
 }
 
-void EXOATeamAPDReshaperModule::APDNoiseCorners::Add(int ch, string filterType, int tau, double peakHeight){
-  if (filterType == "triangular" || filterType == "gaussian"){
+void EXOATeamAPDReshaperModule::APDNoiseCorners::Add(int ch, FilterID filterType, int tau, double peakHeight){
+  if (filterType == kTriangular || filterType == kGaussian){
     channels[ch]->Add(filterType, tau, peakHeight);
   }
 }
 
-void EXOATeamAPDReshaperModule::APDNoiseCorners::Add(int ch, string filterType, int tau, double T, double peakHeight){
-  if (filterType == "finiteCusp"){
+void EXOATeamAPDReshaperModule::APDNoiseCorners::Add(int ch, FilterID filterType, int tau, double T, double peakHeight){
+  if (filterType == kFiniteCusp){
     channels[ch]->Add(filterType, tau, T, peakHeight);
   }
 }
@@ -1188,12 +1497,12 @@ int EXOATeamAPDReshaperModule::APDNoiseCorners::GetTArrayLength(int ch){
   return channels[ch]->GetTArrayLength();
 }
 
-int EXOATeamAPDReshaperModule::APDNoiseCorners::GetArrayLength(int ch, string filterType){
+int EXOATeamAPDReshaperModule::APDNoiseCorners::GetArrayLength(int ch, FilterID filterType){
   
   return channels[ch]->GetArrayLength(filterType);
 }
 
-int EXOATeamAPDReshaperModule::APDNoiseCorners::GetArrayLength(int ch, string filterType, double T){
+int EXOATeamAPDReshaperModule::APDNoiseCorners::GetArrayLength(int ch, FilterID filterType, double T){
   
   return channels[ch]->GetArrayLength(filterType, T);
 }
@@ -1208,7 +1517,7 @@ int EXOATeamAPDReshaperModule::APDNoiseCorners::GetBestTindex(int ch){
   return channels[ch]->GetBestTindex();
 }
 
-string EXOATeamAPDReshaperModule::APDNoiseCorners::GetBestShaper(int ch){
+EXOATeamAPDReshaperModule::FilterID EXOATeamAPDReshaperModule::APDNoiseCorners::GetBestShaper(int ch){
   
   return channels[ch]->GetBestShaper();
 }
@@ -1223,32 +1532,32 @@ double EXOATeamAPDReshaperModule::APDNoiseCorners::GetBestShaperT(int ch){
   return channels[ch]->GetBestShaperT();
 }
 
-int* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterShapingTimes(int ch, string filterType){
+int* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterShapingTimes(int ch, FilterID filterType){
   
   return channels[ch]->GetFilterShapingTimes(filterType);
 }
 
-int* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterShapingTimes(int ch, string filterType, double T){
+int* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterShapingTimes(int ch, FilterID filterType, double T){
 
   return channels[ch]->GetFilterShapingTimes(filterType, T);
 }
 
-double* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterrmsValues(int ch, string filterType){
+double* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterrmsValues(int ch, FilterID filterType){
 
   return channels[ch]->GetFilterrmsValues(filterType);
 }
 
-double* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterrmsValues(int ch, string filterType, double T){
+double* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterrmsValues(int ch, FilterID filterType, double T){
 
-  return channels[ch]->GetFilterrmsValues(filterType);
+  return channels[ch]->GetFilterrmsValues(filterType, T);
 }
 
-double* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterrmsErrors(int ch, string filterType){
+double* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterrmsErrors(int ch, FilterID filterType){
 
   return channels[ch]->GetFilterrmsErrors(filterType);
 }
 
-double* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterrmsErrors(int ch, string filterType, double T){
+double* EXOATeamAPDReshaperModule::APDNoiseCorners::GetFilterrmsErrors(int ch, FilterID filterType, double T){
 
   return channels[ch]->GetFilterrmsErrors(filterType, T);
 }
@@ -2,6 +2,7 @@
 #include "EXOAnalysisManager/EXOAnalysisManager.hh"
 #include "EXOAnalysisManager/EXOAnalysisModule.hh"
 #include "EXOAnalysisManager/EXOInputModule.hh"
+#include "EXOAnalysisManager/EXOAnalysisProfiler.hh"
 #include "EXOUtilities/EXODimensions.hh"
 #include "EXOUtilities/EXOErrorLogger.hh"
 #include "EXOUtilities/EXOTalkToManager.hh"
@@ -13,6 +14,11 @@
 #include "TProcessID.h"
 #include "TSystem.h"
 #include "TObjString.h"
+#include "TFile.h"
+#include "TParameter.h"
+#include "TRandom.h"
+#include "TKey.h"
+#include "TClass.h"
 using namespace std;
 
 
@@ -22,7 +28,11 @@ EXOAnalysisManager::EXOAnalysisManager( EXOTalkToManager *TALKTOMANAGER) :
   eventsProcessed(0),
   exoinputmodulename("input"),
   verbose(false),
-  very_first_event(true)
+  very_first_event(true),
+  checkpointFilename("checkpoint.root"),
+  checkpointEvery(0),
+  resumeFromCheckpoint(false),
+  resumeFile(NULL)
  
 {
 
@@ -84,6 +94,36 @@ EXOAnalysisManager::EXOAnalysisManager( EXOTalkToManager *TALKTOMANAGER) :
            false,
            &EXOAnalysisManager::SetVerbose);
 
+  talktoManager->CreateCommand("profile",
+           "record latency distributions (and allocation counts, with libEXOAllocationCounter preloaded) of each module",
+           this,
+           false,
+           &EXOAnalysisManager::SetProfile);
+
+  talktoManager->CreateCommand("profilefile",
+           "write the profile to this file (.root for ROOT, otherwise JSON)",
+           this,
+           "",
+           &EXOAnalysisManager::SetProfileFilename);
+
+  talktoManager->CreateCommand("checkpointfile",
+           "file to which checkpoints are written and from which to resume",
+           this,
+           checkpointFilename,
+           &EXOAnalysisManager::SetCheckpointFilename);
+
+  talktoManager->CreateCommand("checkpointevery",
+           "write a checkpoint every n events (0: never)",
+           this,
+           0,
+           &EXOAnalysisManager::SetCheckpointEvery);
+
+  talktoManager->CreateCommand("resume",
+           "resume processing from the last checkpoint in checkpointfile",
+           this,
+           false,
+           &EXOAnalysisManager::SetResume);
+
   std::string temp;
   for (int intlevel =  (int)EEOk; 
            intlevel <= (int)EEPanic; intlevel++ ) {
@@ -337,6 +377,12 @@ void EXOAnalysisManager::InitAnalysis()
 
     // Check that there are no problems with the module list.
     CheckModuleList();
+
+    // Let modules know that their output is to be continued, not restarted.
+    if ( resumeFromCheckpoint ) {
+      EXOAnalysisModule::RegisterObject("ResumeCheckpoint", 
+                                        TObjString(checkpointFilename.c_str()));
+    }
     
     if ( Initialize() < 0 ) throw FailedProcess("Initialize failed");
 
@@ -344,6 +390,7 @@ void EXOAnalysisManager::InitAnalysis()
     if ( printMemory ) PrintMemory();
  
     eventsProcessed = 0;
+    if ( resumeFromCheckpoint ) OpenCheckpointForResume();
     eventTimer.Start();
     very_first_event = false;
   } // end of very first event measures
@@ -409,6 +456,10 @@ EXOEventData* EXOAnalysisManager::StepAnalysis()
   EXOEventData* eventData = inputModule->GetNextEvent();
   moduleTimer.Stop();
   orderedModuleList[0].moduleExecutionTime += moduleTimer.RealTime();
+  if(eventData) {
+    EXOAnalysisProfiler::GetProfiler().RecordModuleCall(orderedModuleList[0].name,
+                                                        moduleTimer.RealTime(), 0);
+  }
 
   if(eventData == NULL) return NULL;
 
@@ -448,6 +499,9 @@ EXOEventData* EXOAnalysisManager::StepAnalysis()
     if(BeginOfRunSegment(eventData) < 0) throw FailedProcess("BeginOfRunSegment failed");
   }
 
+  // On a restart, the modules' state is restored once their run is set up.
+  if(resumeFile) RestoreModulesFromCheckpoint();
+
   // Get the event number from the input module
   if(inputModule->get_event_number() < 0) {
     LogEXOMsg("input module get_event_number return error", EECritical);
@@ -460,6 +514,7 @@ EXOEventData* EXOAnalysisManager::StepAnalysis()
   // See if we should run over another event.
   // Also keep track of the running time for the continue_analysis function
   CollectStatistics();
+  if(checkpointEvery > 0 and eventsProcessed % checkpointEvery == 0) WriteCheckpoint();
 
   if(verbose) cout<<"Just finished processing run "<<eventData->fRunNumber<<" event "<<eventData->fEventNumber<<"."<<endl;
   stale_run_number = runNumber;
@@ -522,6 +577,11 @@ void EXOAnalysisManager::print_statistics()
   cout << "****************************************************************" << endl;
   cout << endl;
 
+  EXOAnalysisProfiler& profiler = EXOAnalysisProfiler::GetProfiler();
+  if ( profiler.IsEnabled() ) {
+    profiler.PrintSummary();
+    cout << endl;
+  }
 }
 
 //______________________________________________________________________________
@@ -535,15 +595,37 @@ int EXOAnalysisManager::Initialize()
       return -1;
     }
   }
+
+  // Tell the input module which parts of the event are needed.  This is done
+  // after initialization since the declarations may depend on settings.
+  unsigned int eventDataUsage = EXOAnalysisModule::kNoEventData;
+  for ( size_t i = 1; i < orderedModuleList.size(); i++ ) {
+    eventDataUsage |= orderedModuleList[i].module->GetEventDataReads();
+    eventDataUsage |= orderedModuleList[i].module->GetEventDataWrites();
+  }
+  EXOInputModule* inputModule = dynamic_cast<EXOInputModule*>(orderedModuleList[0].module);
+  if ( inputModule ) inputModule->SetEventDataUsage(eventDataUsage);
   return 0;
 }
 
+//______________________________________________________________________________
+void EXOAnalysisManager::LoadEventDataFor( size_t i )
+{
+  // Make sure the parts of the event module i declares have been read.  The
+  // input module itself is skipped.
+  if ( i == 0 ) return;
+  EXOInputModule* inputModule = static_cast<EXOInputModule*>(orderedModuleList[0].module);
+  EXOAnalysisModule* module = orderedModuleList[i].module;
+  inputModule->EnsureEventDataLoaded(module->GetEventDataReads() | module->GetEventDataWrites());
+}
+
 
 //______________________________________________________________________________
 int EXOAnalysisManager::BeginOfRun( EXOEventData* eventData )
 {
   // Call BeginOfRun for all registered modules. 
   for ( size_t i = 0; i < orderedModuleList.size(); i++ ) {
+    LoadEventDataFor(i);
     int result = orderedModuleList[i].module->BeginOfRun(eventData);
     if ( result < 0 ) {
       LogEXOMsg(Form("module %s returns error",
@@ -559,6 +641,7 @@ int EXOAnalysisManager::BeginOfRunSegment( EXOEventData* eventData )
 {
   // Call BeginOfRunSegment for all registered modules.  
   for ( size_t i = 0; i < orderedModuleList.size(); i++ ) {
+    LoadEventDataFor(i);
     int result = orderedModuleList[i].module->BeginOfRunSegment(eventData);
     if ( result < 0 ) {
        LogEXOMsg(Form("module %s returns error",
@@ -575,6 +658,7 @@ int EXOAnalysisManager::ProcessEvent( EXOEventData* eventData )
 {
   // Call ProcessEvent for all registered modules.  Keep track of statistics.
   int passed_modules = 0;
+  EXOAnalysisProfiler& profiler = EXOAnalysisProfiler::GetProfiler();
   for ( size_t i = 0; i < orderedModuleList.size(); i++ ) {
 
     // Keep track of module running statistics
@@ -583,9 +667,13 @@ int EXOAnalysisManager::ProcessEvent( EXOEventData* eventData )
     EXOModuleContainer& module_container = orderedModuleList[i];
 
     module_container.moduleCallCount++;
+    unsigned long allocations = EXOAnalysisProfiler::GetAllocationCount();
     moduleTimer.ResetRealTime();
     moduleTimer.Start();
 
+    // Read any parts of the event this module needs that weren't read yet.
+    LoadEventDataFor(i);
+
     // Call the begin of event methods
 
     int result = orderedModuleList[i].module->ProcessEvent(eventData);
@@ -600,6 +688,8 @@ int EXOAnalysisManager::ProcessEvent( EXOEventData* eventData )
     }
     else {
         module_container.moduleExecutionTime += moduleTimer.RealTime();
+        profiler.RecordModuleCall(module_container.name, moduleTimer.RealTime(),
+                                  EXOAnalysisProfiler::GetAllocationCount() - allocations);
     }
 
     if ( result < 0 ) {
@@ -652,9 +742,133 @@ void EXOAnalysisManager::ShutDown()
       LogEXOMsg("module " + orderedModuleList[i].name + " returns error", EECritical);
     }
   }
+  if ( resumeFile ) {
+    resumeFile->Close();
+    delete resumeFile;
+    resumeFile = NULL;
+  }
+  EXOAnalysisProfiler& profiler = EXOAnalysisProfiler::GetProfiler();
+  if ( profiler.IsEnabled() && profileFilename != "" ) {
+    profiler.WriteReport(profileFilename);
+  }
   very_first_event = true;
 }
 
+//______________________________________________________________________________
+void EXOAnalysisManager::WriteCheckpoint()
+{
+  // Write a checkpoint: the number of events processed, the state of gRandom
+  // and one directory per module, filled by EXOAnalysisModule::SaveCheckpoint
+  // (the input module saves its position, output modules flush their trees).
+  // The checkpoint is written to a temporary file which replaces the
+  // previous checkpoint only when complete.  If a module can not save its
+  // state, checkpointing is switched off.
+  std::string tmpName = checkpointFilename + ".tmp";
+  TDirectory* oldDir = gDirectory;
+  TFile file(tmpName.c_str(), "RECREATE");
+  if ( file.IsZombie() ) {
+    LogEXOMsg("Unable to write checkpoint " + tmpName, EEError);
+    oldDir->cd();
+    return;
+  }
+  TParameter<Long64_t> events("eventsProcessed", eventsProcessed);
+  file.WriteTObject(&events);
+  if ( gRandom ) file.WriteTObject(gRandom, "gRandom");
+
+  std::string failedModule;
+  for ( size_t i = 0; i < orderedModuleList.size(); i++ ) {
+    TDirectory* dir = file.mkdir(orderedModuleList[i].name.c_str());
+    bool ok = (dir != NULL);
+    if ( ok ) {
+      dir->cd();
+      ok = orderedModuleList[i].module->SaveCheckpoint(*dir);
+    }
+    if ( !ok ) {
+      failedModule = orderedModuleList[i].name;
+      break;
+    }
+  }
+  file.Close();
+  oldDir->cd();
+
+  if ( failedModule != "" ) {
+    LogEXOMsg("module " + failedModule + " could not save a checkpoint, checkpoints are switched off", EEError);
+    checkpointEvery = 0;
+    gSystem->Unlink(tmpName.c_str());
+    return;
+  }
+  if ( gSystem->Rename(tmpName.c_str(), checkpointFilename.c_str()) != 0 ) {
+    LogEXOMsg("Unable to move checkpoint to " + checkpointFilename, EEError);
+  }
+}
+
+//______________________________________________________________________________
+void EXOAnalysisManager::OpenCheckpointForResume()
+{
+  // Open the checkpoint and restore the number of events processed and the
+  // position of the input module.  The other modules are restored in
+  // RestoreModulesFromCheckpoint, after BeginOfRun and BeginOfRunSegment of
+  // the first event have been called.
+  TDirectory* oldDir = gDirectory;
+  resumeFile = TFile::Open(checkpointFilename.c_str(), "READ");
+  if ( oldDir ) oldDir->cd();
+  if ( resumeFile == NULL or resumeFile->IsZombie() ) {
+    delete resumeFile;
+    resumeFile = NULL;
+    throw FailedProcess("Unable to open checkpoint " + checkpointFilename);
+  }
+
+  TParameter<Long64_t>* events = 
+    dynamic_cast<TParameter<Long64_t>*>(resumeFile->Get("eventsProcessed"));
+  TDirectory* dir = resumeFile->GetDirectory(orderedModuleList[0].name.c_str());
+  if ( events == NULL or dir == NULL ) {
+    delete events;
+    throw FailedProcess("Checkpoint " + checkpointFilename + " is incomplete");
+  }
+  eventsProcessed = events->GetVal();
+  delete events;
+
+  if ( !orderedModuleList[0].module->RestoreCheckpoint(*dir) ) {
+    throw FailedProcess("module " + orderedModuleList[0].name + " could not resume from the checkpoint");
+  }
+  cout << "Resuming from checkpoint " << checkpointFilename << " after " 
+       << eventsProcessed << " events." << endl;
+}
+
+//______________________________________________________________________________
+void EXOAnalysisManager::RestoreModulesFromCheckpoint()
+{
+  // Restore gRandom and the state of all modules but the input module, then
+  // close the checkpoint.  The state is read into the existing gRandom, since
+  // code may hold on to the pointer; it must be of the class that was saved.
+  TKey* randomKey = resumeFile->GetKey("gRandom");
+  if ( randomKey and gRandom ) {
+    if ( std::string(randomKey->GetClassName()) != gRandom->IsA()->GetName() ) {
+      throw FailedProcess(std::string("checkpoint holds a ") + randomKey->GetClassName() +
+                          " but gRandom is a " + gRandom->IsA()->GetName());
+    }
+    if ( resumeFile->ReadTObject(gRandom, "gRandom") <= 0 ) {
+      throw FailedProcess("Unable to read gRandom from checkpoint " + checkpointFilename);
+    }
+  }
+
+  std::string failedModule;
+  for ( size_t i = 1; i < orderedModuleList.size(); i++ ) {
+    TDirectory* dir = resumeFile->GetDirectory(orderedModuleList[i].name.c_str());
+    if ( dir == NULL or !orderedModuleList[i].module->RestoreCheckpoint(*dir) ) {
+      failedModule = orderedModuleList[i].name;
+      break;
+    }
+  }
+  resumeFile->Close();
+  delete resumeFile;
+  resumeFile = NULL;
+
+  if ( failedModule != "" ) {
+    throw FailedProcess("module " + failedModule + " could not resume from the checkpoint");
+  }
+}
+
 //______________________________________________________________________________
 void EXOAnalysisManager::CollectStatistics()
 {
@@ -683,6 +897,19 @@ const EXOAnalysisManager::StrVec& EXOAnalysisManager::GetListOfUsedModules()
   return vectorOfModuleNames;
 }
 
+//______________________________________________________________________________
+void EXOAnalysisManager::SetProfile(bool aval)
+{
+  // Record per-module latency distributions, and allocation counts if
+  // libEXOAllocationCounter is preloaded.  Stages within modules (e.g.
+  // reconstruction finders and fitters) are recorded by the modules
+  // themselves.  The summary is printed with the module
+  // statistics and written to "profilefile", if set.
+  EXOAnalysisProfiler& profiler = EXOAnalysisProfiler::GetProfiler();
+  if ( aval && !profiler.IsEnabled() ) profiler.Reset();
+  profiler.SetEnabled(aval);
+}
+
 //______________________________________________________________________________
 void EXOAnalysisManager::SetInputFilename(std::string val)
 {
@@ -0,0 +1,323 @@
+//______________________________________________________________________________
+//
+// EXOAnalysisProfiler
+//
+// Collects per-module and per-stage latency distributions over a run.
+// EXOAnalysisManager records the time of every ProcessEvent call of every
+// module when profiling is switched on ("profile true"); modules may
+// additionally record the time spent in their own sub-stages (e.g. the
+// reconstruction records its finders, fitters and extraction).  For each
+// entry the mean, p50/p95/p99 and maximum are reported together with the
+// number of heap allocations made during the module's calls.
+//
+// The report is written at the end of the run to the file given by
+// "profilefile".  If the name ends in ".root", a ROOT file with one
+// latency histogram per entry (plus the JSON report as a TObjString) is
+// written, otherwise a JSON file.  The JSON output lists entries in the
+// order in which they first appeared and is meant to be diffed between
+// releases.
+//
+// Allocations are only counted when libEXOAllocationCounter, which replaces
+// the global operators new and delete, is preloaded (see
+// EXOAllocationCounter.cc); the profiler finds it at run time, and reports
+// no allocation counts without it.  Counting is only done while the
+// profiler is enabled.
+//______________________________________________________________________________
+#include "EXOAnalysisManager/EXOAnalysisProfiler.hh"
+#include "EXOUtilities/EXOErrorLogger.hh"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TObjString.h"
+#include <cmath>
+#include <cstdio>
+#include <dlfcn.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+using namespace std;
+
+#ifndef BUILD_ID
+#define BUILD_ID "Unknown"
+#endif
+
+namespace {
+  // Entry points of the preloaded allocation counter, if any.
+  typedef void (*SetCountingFunc)(int);
+  typedef unsigned long (*GetCountFunc)();
+  SetCountingFunc gfSetCounting = NULL;
+  GetCountFunc gfGetCount = NULL;
+
+  void FindAllocationCounter()
+  {
+    static bool looked = false;
+    if(looked) return;
+    looked = true;
+    gfSetCounting = reinterpret_cast<SetCountingFunc>(
+      dlsym(RTLD_DEFAULT, "EXOAllocationCounter_SetEnabled"));
+    gfGetCount = reinterpret_cast<GetCountFunc>(
+      dlsym(RTLD_DEFAULT, "EXOAllocationCounter_GetCount"));
+    if(not gfSetCounting or not gfGetCount) {
+      gfSetCounting = NULL;
+      gfGetCount = NULL;
+    }
+  }
+
+  std::string JSONEscape(const std::string& str)
+  {
+    std::string out;
+    for(size_t i = 0; i < str.size(); i++) {
+      char c = str[i];
+      if(c == '"' or c == '\\') out += '\\';
+      out += c;
+    }
+    return out;
+  }
+}
+
+//______________________________________________________________________________
+EXOAnalysisProfiler::LatencyHistogram::LatencyHistogram() :
+  fCounts(kNumBins + 2, 0),
+  fEntries(0),
+  fSum(0.0),
+  fMin(0.0),
+  fMax(0.0)
+{}
+
+//______________________________________________________________________________
+double EXOAnalysisProfiler::LatencyHistogram::GetBinLowEdge(int bin)
+{
+  // Low edge (in seconds) of bin; bin 1 is the first regular bin.
+  return pow(10.0, kFirstDecade + double(bin - 1)/kBinsPerDecade);
+}
+
+//______________________________________________________________________________
+void EXOAnalysisProfiler::LatencyHistogram::Fill(double seconds)
+{
+  int bin;
+  if(seconds <= 0.0) bin = 0;
+  else {
+    double pos = (log10(seconds) - kFirstDecade)*kBinsPerDecade;
+    if(pos < 0.0) bin = 0;
+    else if(pos >= kNumBins) bin = kNumBins + 1;
+    else bin = int(pos) + 1;
+  }
+  fCounts[bin]++;
+  if(fEntries == 0 or seconds < fMin) fMin = seconds;
+  if(fEntries == 0 or seconds > fMax) fMax = seconds;
+  fEntries++;
+  fSum += seconds;
+}
+
+//______________________________________________________________________________
+double EXOAnalysisProfiler::LatencyHistogram::GetQuantile(double q) const
+{
+  // Estimate the q-quantile, interpolating logarithmically within the bin.
+  // The estimate is clamped to the observed minimum and maximum, so under-
+  // and overflows are handled sensibly.
+  if(fEntries == 0) return 0.0;
+  double target = q*fEntries;
+  double cumulative = 0.0;
+  for(int bin = 0; bin < kNumBins + 2; bin++) {
+    if(fCounts[bin] == 0) continue;
+    if(cumulative + fCounts[bin] < target) {
+      cumulative += fCounts[bin];
+      continue;
+    }
+    if(bin == 0) return fMin;
+    if(bin == kNumBins + 1) return fMax;
+    double frac = (target - cumulative)/fCounts[bin];
+    double low = log10(GetBinLowEdge(bin));
+    double high = log10(GetBinLowEdge(bin + 1));
+    double val = pow(10.0, low + frac*(high - low));
+    if(val < fMin) val = fMin;
+    if(val > fMax) val = fMax;
+    return val;
+  }
+  return fMax;
+}
+
+//______________________________________________________________________________
+void EXOAnalysisProfiler::SetEnabled(bool aval)
+{
+  fEnabled = aval;
+  FindAllocationCounter();
+  if(gfSetCounting) gfSetCounting(aval);
+}
+
+//______________________________________________________________________________
+bool EXOAnalysisProfiler::IsCountingAllocations()
+{
+  FindAllocationCounter();
+  return gfGetCount != NULL;
+}
+
+//______________________________________________________________________________
+unsigned long EXOAnalysisProfiler::GetAllocationCount()
+{
+  return gfGetCount ? gfGetCount() : 0;
+}
+
+//______________________________________________________________________________
+EXOAnalysisProfiler::Record&
+EXOAnalysisProfiler::GetOrCreateRecord(const std::string& name, bool isModule)
+{
+  std::string key = (isModule ? "m:" : "s:") + name;
+  std::map<std::string, size_t>::const_iterator iter = fIndex.find(key);
+  if(iter != fIndex.end()) return fRecords[iter->second];
+
+  fIndex[key] = fRecords.size();
+  fRecords.push_back(Record());
+  fRecords.back().fName = name;
+  fRecords.back().fIsModule = isModule;
+  return fRecords.back();
+}
+
+//______________________________________________________________________________
+void EXOAnalysisProfiler::RecordModuleCall(const std::string& module,
+  double seconds, unsigned long allocations)
+{
+  if(not fEnabled) return;
+  Record& rec = GetOrCreateRecord(module, true);
+  rec.fLatency.Fill(seconds);
+  rec.fAllocations += allocations;
+}
+
+//______________________________________________________________________________
+void EXOAnalysisProfiler::RecordStage(const std::string& stage, double seconds)
+{
+  if(not fEnabled) return;
+  GetOrCreateRecord(stage, false).fLatency.Fill(seconds);
+}
+
+//______________________________________________________________________________
+void EXOAnalysisProfiler::Reset()
+{
+  fRecords.clear();
+  fIndex.clear();
+}
+
+//______________________________________________________________________________
+void EXOAnalysisProfiler::PrintSummary() const
+{
+  if(fRecords.empty()) return;
+  cout << "Profile (times in ms):" << endl;
+  cout << setw(40) << left << "  name" << right
+       << setw(10) << "calls" << setw(11) << "mean"
+       << setw(11) << "p50" << setw(11) << "p95"
+       << setw(11) << "p99" << setw(11) << "max";
+  if(IsCountingAllocations()) cout << setw(12) << "allocs/call";
+  cout << endl;
+  for(size_t i = 0; i < fRecords.size(); i++) {
+    const Record& rec = fRecords[i];
+    const LatencyHistogram& lat = rec.fLatency;
+    cout << "  " << setw(38) << left
+         << (rec.fIsModule ? rec.fName : "  " + rec.fName) << right
+         << setw(10) << lat.fEntries
+         << fixed << setprecision(4)
+         << setw(11) << 1e3*lat.GetMean()
+         << setw(11) << 1e3*lat.GetQuantile(0.50)
+         << setw(11) << 1e3*lat.GetQuantile(0.95)
+         << setw(11) << 1e3*lat.GetQuantile(0.99)
+         << setw(11) << 1e3*lat.fMax;
+    if(rec.fIsModule and IsCountingAllocations()) {
+      cout << setprecision(1) << setw(12)
+           << (lat.fEntries ? double(rec.fAllocations)/lat.fEntries : 0.0);
+    }
+    cout << endl;
+  }
+  cout.unsetf(ios::fixed);
+  cout << setprecision(6);
+}
+
+//______________________________________________________________________________
+std::string EXOAnalysisProfiler::MakeJSON() const
+{
+  ostringstream os;
+  os << setprecision(6);
+  os << "{\n  \"build_id\": \"" << JSONEscape(BUILD_ID) << "\",\n";
+  os << "  \"bins_per_decade\": " << LatencyHistogram::kBinsPerDecade << ",\n";
+  os << "  \"first_decade\": " << LatencyHistogram::kFirstDecade << ",\n";
+  os << "  \"entries\": [";
+  for(size_t i = 0; i < fRecords.size(); i++) {
+    const Record& rec = fRecords[i];
+    const LatencyHistogram& lat = rec.fLatency;
+    os << (i ? ",\n" : "\n");
+    os << "    {\"name\": \"" << JSONEscape(rec.fName) << "\", "
+       << "\"type\": \"" << (rec.fIsModule ? "module" : "stage") << "\", "
+       << "\"calls\": " << lat.fEntries << ", "
+       << "\"total\": " << lat.fSum << ", "
+       << "\"mean\": " << lat.GetMean() << ", "
+       << "\"p50\": " << lat.GetQuantile(0.50) << ", "
+       << "\"p95\": " << lat.GetQuantile(0.95) << ", "
+       << "\"p99\": " << lat.GetQuantile(0.99) << ", "
+       << "\"min\": " << lat.fMin << ", "
+       << "\"max\": " << lat.fMax << ", ";
+    if(rec.fIsModule and IsCountingAllocations()) {
+      os << "\"allocations\": " << rec.fAllocations << ", "
+         << "\"allocations_per_call\": "
+         << (lat.fEntries ? double(rec.fAllocations)/lat.fEntries : 0.0) << ", ";
+    }
+    // Sparse histogram: [bin, count] pairs; bin 0 is underflow.
+    os << "\"bins\": [";
+    bool first = true;
+    for(size_t bin = 0; bin < lat.fCounts.size(); bin++) {
+      if(lat.fCounts[bin] == 0) continue;
+      os << (first ? "" : ", ") << "[" << bin << ", " << lat.fCounts[bin] << "]";
+      first = false;
+    }
+    os << "]}";
+  }
+  os << "\n  ]\n}\n";
+  return os.str();
+}
+
+//______________________________________________________________________________
+bool EXOAnalysisProfiler::WriteROOTFile(const std::string& filename) const
+{
+  TFile file(filename.c_str(), "RECREATE");
+  if(file.IsZombie()) return false;
+
+  std::vector<double> edges;
+  for(int bin = 1; bin <= LatencyHistogram::kNumBins + 1; bin++) {
+    edges.push_back(LatencyHistogram::GetBinLowEdge(bin));
+  }
+  for(size_t i = 0; i < fRecords.size(); i++) {
+    const Record& rec = fRecords[i];
+    std::string name = (rec.fIsModule ? "module_" : "stage_") + rec.fName;
+    TH1D hist(name.c_str(), (rec.fName + ";seconds;calls").c_str(),
+              LatencyHistogram::kNumBins, &edges[0]);
+    for(size_t bin = 0; bin < rec.fLatency.fCounts.size(); bin++) {
+      hist.SetBinContent(bin, rec.fLatency.fCounts[bin]);
+    }
+    hist.SetEntries(rec.fLatency.fEntries);
+    hist.Write();
+  }
+  TObjString json(MakeJSON().c_str());
+  json.Write("profile_json");
+  file.Close();
+  return true;
+}
+
+//______________________________________________________________________________
+bool EXOAnalysisProfiler::WriteReport(const std::string& filename) const
+{
+  // Write the report to filename; ROOT format if it ends in ".root", JSON
+  // otherwise.  Returns false if the file could not be written.
+  if(filename.empty()) return false;
+  const std::string rootSuffix = ".root";
+  bool ok;
+  if(filename.size() >= rootSuffix.size() and
+     filename.compare(filename.size() - rootSuffix.size(),
+                      rootSuffix.size(), rootSuffix) == 0) {
+    ok = WriteROOTFile(filename);
+  } else {
+    std::ofstream out(filename.c_str());
+    out << MakeJSON();
+    ok = out.good();
+  }
+  if(not ok) {
+    LogEXOMsg("Unable to write profile report to " + filename, EEError);
+  }
+  return ok;
+}
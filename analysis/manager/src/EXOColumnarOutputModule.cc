@@ -0,0 +1,175 @@
+//______________________________________________________________________________
+// EXOColumnarOutputModule
+//
+// Writes the event and cluster quantities used by most analyses to a
+// columnar file (see EXOColumnarFile) next to, or instead of, the ROOT
+// tree written by toutput.  The schema is fixed: one row per event, per
+// charge cluster and per scintillation cluster.  The clusters of event i
+// are rows first_cl[i] to first_cl[i] + ncl[i] - 1 of the charge cluster
+// columns (first_sc/nsc for scintillation clusters), and cl_isc gives the
+// index of a charge cluster's scintillation cluster within its event, or -1.
+//
+// The column names follow the short names used in the comments of
+// EXOEventData, EXOChargeCluster and EXOScintillationCluster.  Add new
+// columns at the end of the table below.
+//______________________________________________________________________________
+
+#include "EXOAnalysisManager/EXOColumnarOutputModule.hh"
+#include "EXOUtilities/EXOEventData.hh"
+#include "EXOUtilities/EXOTalkToManager.hh"
+#include "EXOUtilities/EXOErrorLogger.hh"
+#include <iostream>
+
+IMPLEMENT_EXO_ANALYSIS_MODULE( EXOColumnarOutputModule, "coutput" )
+
+namespace {
+  struct ColumnSpec {
+    const char* fName;
+    EXOColumnarFile::EType fType;
+    EXOColumnarFile::ELevel fLevel;
+  };
+  // In the order of EXOColumnarOutputModule::EColumn.
+  const ColumnSpec gfColumns[] = {
+    {"nr",             EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"ne",             EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"trigsec",        EXOColumnarFile::kLong64, EXOColumnarFile::kEvent},
+    {"trigsub",        EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"is_mc",          EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"sat_chan",       EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"muontag",        EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"noisetag",       EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"vetoed",         EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"ncl",            EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"first_cl",       EXOColumnarFile::kLong64, EXOColumnarFile::kEvent},
+    {"nsc",            EXOColumnarFile::kInt,    EXOColumnarFile::kEvent},
+    {"first_sc",       EXOColumnarFile::kLong64, EXOColumnarFile::kEvent},
+    {"cl_x",           EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_y",           EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_z",           EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_u",           EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_v",           EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_dt",          EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_t",           EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_eraw",        EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_ecorr",       EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_epurity",     EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_ev",          EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster},
+    {"cl_half",        EXOColumnarFile::kInt,    EXOColumnarFile::kChargeCluster},
+    {"cl_isc",         EXOColumnarFile::kInt,    EXOColumnarFile::kChargeCluster},
+    {"sc_x",           EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_y",           EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_z",           EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_t",           EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_e",           EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_eraw",        EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_eapd",        EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_edenoised",   EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_dnn_raw",     EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_dnn_recon",   EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster},
+    {"sc_dnn_echarge", EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster}
+  };
+}
+
+//______________________________________________________________________________
+EXOColumnarOutputModule::EXOColumnarOutputModule() :
+  fNumCharge(0),
+  fNumScint(0)
+{}
+
+//______________________________________________________________________________
+int EXOColumnarOutputModule::Initialize()
+{
+  if ( sizeof(gfColumns)/sizeof(gfColumns[0]) != size_t(kNumColumns) ) {
+    LogEXOMsg("Column table does not match the column list", EEAlert);
+  }
+  for ( size_t i = 0; i < size_t(kNumColumns); i++ ) {
+    fWriter.AddColumn(gfColumns[i].fName, gfColumns[i].fType, gfColumns[i].fLevel);
+  }
+  if ( not fWriter.Open(fOutputFilename) ) {
+    LogEXOMsg("Error opening: " + fOutputFilename, EEAlert); // terminates
+  }
+  fNumCharge = 0;
+  fNumScint = 0;
+  return 0;
+}
+
+//______________________________________________________________________________
+EXOAnalysisModule::EventStatus EXOColumnarOutputModule::ProcessEvent(EXOEventData *ED)
+{
+  const EXOEventHeader& header = ED->fEventHeader;
+  size_t numCharge = ED->GetNumChargeClusters();
+  size_t numScint = ED->GetNumScintillationClusters();
+
+  fWriter.Fill(kRun, Int_t(ED->fRunNumber));
+  fWriter.Fill(kEventNumber, Int_t(ED->fEventNumber));
+  fWriter.Fill(kTriggerSeconds, Long64_t(header.fTriggerSeconds));
+  fWriter.Fill(kTriggerMicroSeconds, Int_t(header.fTriggerMicroSeconds));
+  fWriter.Fill(kIsMC, Int_t(header.fIsMonteCarloEvent));
+  fWriter.Fill(kSaturated, Int_t(ED->fHasSaturatedChannel));
+  fWriter.Fill(kMuonTag, Int_t(header.fTaggedAsMuon));
+  fWriter.Fill(kNoiseTag, Int_t(ED->IsTaggedAsNoise()));
+  fWriter.Fill(kVetoed, Int_t(ED->IsVetoed()));
+  fWriter.Fill(kNumCharge, Int_t(numCharge));
+  fWriter.Fill(kFirstCharge, fNumCharge);
+  fWriter.Fill(kNumScint, Int_t(numScint));
+  fWriter.Fill(kFirstScint, fNumScint);
+
+  for ( size_t i = 0; i < numCharge; i++ ) {
+    const EXOChargeCluster& cc = *ED->GetChargeCluster(i);
+    Int_t scint = -1;
+    const EXOScintillationCluster* sc = cc.GetScintillationCluster();
+    for ( size_t j = 0; sc and j < numScint; j++ ) {
+      if ( ED->GetScintillationCluster(j) == sc ) scint = j;
+    }
+    fWriter.Fill(kChargeX, cc.fX);
+    fWriter.Fill(kChargeY, cc.fY);
+    fWriter.Fill(kChargeZ, cc.fZ);
+    fWriter.Fill(kChargeU, cc.fU);
+    fWriter.Fill(kChargeV, cc.fV);
+    fWriter.Fill(kChargeDriftTime, cc.fDriftTime);
+    fWriter.Fill(kChargeCollectionTime, cc.fCollectionTime);
+    fWriter.Fill(kChargeRawEnergy, cc.fRawEnergy);
+    fWriter.Fill(kChargeCorrectedEnergy, cc.fCorrectedEnergy);
+    fWriter.Fill(kChargePurityCorrectedEnergy, cc.fPurityCorrectedEnergy);
+    fWriter.Fill(kChargeEnergyInV, cc.fEnergyInVChannels);
+    fWriter.Fill(kChargeDetectorHalf, cc.fDetectorHalf);
+    fWriter.Fill(kChargeScint, scint);
+  }
+
+  for ( size_t i = 0; i < numScint; i++ ) {
+    const EXOScintillationCluster& sc = *ED->GetScintillationCluster(i);
+    fWriter.Fill(kScintX, sc.fX);
+    fWriter.Fill(kScintY, sc.fY);
+    fWriter.Fill(kScintZ, sc.fZ);
+    fWriter.Fill(kScintTime, sc.fTime);
+    fWriter.Fill(kScintEnergy, sc.fEnergy);
+    fWriter.Fill(kScintRawEnergy, sc.fRawEnergy);
+    fWriter.Fill(kScintWeightedAPDEnergy, sc.fWeightedAPDEnergy);
+    fWriter.Fill(kScintDenoisedEnergy, sc.fDenoisedEnergy);
+    fWriter.Fill(kScintDNNVarRaw, sc.fDNNVarRaw);
+    fWriter.Fill(kScintDNNVarRecon, sc.fDNNVarRecon);
+    fWriter.Fill(kScintDNNChargeEnergy, sc.fDNNChargeEnergy);
+  }
+
+  fNumCharge += numCharge;
+  fNumScint += numScint;
+  return kOk;
+}
+
+//______________________________________________________________________________
+int EXOColumnarOutputModule::TalkTo(EXOTalkToManager *talktoManager)
+{
+  talktoManager->CreateCommand("/coutput/file","name of columnar output file",this,
+                               "output.col", &EXOColumnarOutputModule::SetOutputFilename);
+  return 0;
+}
+
+//______________________________________________________________________________
+int EXOColumnarOutputModule::ShutDown()
+{
+  std::cout << "Writing columnar file " << fOutputFilename << "...." << std::endl;
+  if ( not fWriter.Close() ) {
+    LogEXOMsg("Failed to write " + fOutputFilename, EEAlert); // terminates
+  }
+  return 0;
+}
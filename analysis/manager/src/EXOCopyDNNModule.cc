@@ -7,6 +7,14 @@
 // It avoids re-running the DNN algorithm that is expensive (CPU and time).  Very similar to 
 // copy denoise module from Caio.
 //
+// The DNN info of a run is kept sorted by event number (then scintillation
+// time), so each event is found by binary search.  With /copy-dnn/indexDir
+// the sorted info of each run is also stored in a binary index file in that
+// directory, written the first time the run is read from the DNN trees and
+// read instead of them afterwards.  An index records the number, total size
+// and latest modification time of the trees it was built from, and is
+// rebuilt when they change.  The index files of a list of runs can be
+// built ahead of processing with analysis/main/build_dnn_index.py.
 //
 
 #include <iostream> 
@@ -18,10 +26,40 @@
 #include "EXOUtilities/EXOErrorLogger.hh"
 #include "EXOUtilities/EXOTalkToManager.hh"
 #include "EXOUtilities/EXOControlRecordList.hh"
+#include "EXOUtilities/EXOAtomicFile.hh"
 #include "TChain.h"
+#include "TSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 
 IMPLEMENT_EXO_ANALYSIS_MODULE(EXOCopyDNNModule, "copy-dnn")
 
+namespace {
+  const char gfDNNIndexMagic[8] = {'E','X','O','D','N','N','I','2'};
+  const double gfMaxTimeDifference = 1000.; // ns
+
+  struct DNNIndexHeader
+  {
+    char fMagic[8];
+    Int_t fRunNumber;
+    UInt_t fInfoSize;
+    ULong64_t fNumEntries;
+    EXOCopyDNNModule::EXODNNSource fSource;
+  };
+
+  // Order of the DNN info: by event number, then scintillation time.
+  bool CompareDNNInfo(const EXOCopyDNNModule::EXODNNInfo& a, const EXOCopyDNNModule::EXODNNInfo& b)
+  {
+    if(a.fEventNumber != b.fEventNumber) return a.fEventNumber < b.fEventNumber;
+    return a.fScintTime < b.fScintTime;
+  }
+  bool CompareDNNEvent(const EXOCopyDNNModule::EXODNNInfo& a, const EXOCopyDNNModule::EXODNNInfo& b)
+  {
+    return a.fEventNumber < b.fEventNumber;
+  }
+}
+
 EXOCopyDNNModule::EXOCopyDNNModule()
 : fRunFlavor(EXOBeginRecord::kUnknownFlavor)
 {
@@ -29,16 +67,16 @@ EXOCopyDNNModule::EXOCopyDNNModule()
 }
 
 
-std::string EXOCopyDNNModule::GetDNNFileName(int runNumber)
+std::string EXOCopyDNNModule::GetDNNFileName(int runNumber, EXOBeginRecord::RunFlavor flavor)
 {
     //Hardcodin paths.  Not ideal but trying to be quick.  
     std::string dnn_path;
     if (runNumber < 6400){
         //This is Phase-1
-        if (fRunFlavor == EXOBeginRecord::kDatPhysics){
+        if (flavor == EXOBeginRecord::kDatPhysics){
             dnn_path = "/nfs/slac/g/exo_data8/exo_data/data/WIPP/processedDNN_phase1/";
         }
-        else if (fRunFlavor == EXOBeginRecord::kDatSrcClb){
+        else if (flavor == EXOBeginRecord::kDatSrcClb){
             dnn_path = "/nfs/slac/g/exo_data8/exo_data/data/WIPP/processedDNN_phase1_source/";
         }
         else{
@@ -46,10 +84,10 @@ std::string EXOCopyDNNModule::GetDNNFileName(int runNumber)
         }
     }
     else {
-        if (fRunFlavor == EXOBeginRecord::kDatPhysics){
+        if (flavor == EXOBeginRecord::kDatPhysics){
             dnn_path = "/nfs/slac/g/exo_data8/exo_data/data/WIPP/processedDNN_phase2/";
         }
-        else if (fRunFlavor == EXOBeginRecord::kDatSrcClb){
+        else if (flavor == EXOBeginRecord::kDatSrcClb){
             dnn_path = "/nfs/slac/g/exo_data8/exo_data/data/WIPP/processedDNN/";
         }
         else{
@@ -95,8 +133,7 @@ EXOAnalysisModule::EventStatus EXOCopyDNNModule::BeginOfRun(EXOEventData *ED)
   int runNumber = ED->fRunNumber;
   fDNNInfo.clear();
 
-  std::string fileName = GetDNNFileName(runNumber);
-  LogEXOMsg(Form("Using file %s to copy dnn ",fileName.c_str()),EENotice);
+  std::string fileName = GetDNNFileName(runNumber, fRunFlavor);
 
   if (fileName==""){
 
@@ -105,33 +142,138 @@ EXOAnalysisModule::EventStatus EXOCopyDNNModule::BeginOfRun(EXOEventData *ED)
       return kOk;
   }
 
-  
-  TChain dnnTree("tree");
-  dnnTree.Add(fileName.c_str());
-  
-  if(dnnTree.GetEntries()<0.5)
+  std::string indexFile = GetDNNIndexFile(fIndexDirectory, runNumber);
+  EXODNNSource source;
+  if (indexFile != "") source = GetDNNSource(fileName);
+  if (indexFile != "" and ReadDNNIndex(indexFile, runNumber, source, fDNNInfo)){
+      LogEXOMsg(Form("Using index %s to copy dnn ",indexFile.c_str()),EENotice);
+      return kOk;
+  }
+
+  LogEXOMsg(Form("Using file %s to copy dnn ",fileName.c_str()),EENotice);
+  if (not LoadDNNTree(fileName, runNumber, fDNNInfo))
   { 
     if (runNumber<9681){
         LogEXOMsg("This isn't a CI/Laser run but no DNN file was loaded ... not ideal", EEAlert);
     }
-    else{
-        return kOk;
-    }
+    return kOk;
   }
 
+  if (indexFile != "" and not WriteDNNIndex(indexFile, runNumber, source, fDNNInfo)){
+      LogEXOMsg(Form("Could not write the dnn index %s",indexFile.c_str()),EEWarning);
+  }
+  return kOk;
+}
+
+bool EXOCopyDNNModule::LoadDNNTree(const std::string& treeFiles, int runNumber, std::vector<EXODNNInfo>& info)
+{
+  // Read the dnn variables of the single-cluster events in the trees, then
+  // sort them for GetDNNInfoIdx.  Returns false if there are no entries.
+  info.clear();
+  TChain dnnTree("tree");
+  dnnTree.Add(treeFiles.c_str());
+  if(dnnTree.GetEntries()<0.5) return false;
+
   //Got the file and tree now draw into arrays and save in struct
   dnnTree.SetEstimate(dnnTree.GetEntries()+1);
-  dnnTree.Draw("fEventNumber:fDNNVarRaw:fDNNVarRecon:fDNNChargeEnergy", "@fScintClusters.size()==1", "para goff");
+  dnnTree.Draw("fEventNumber:fScintClusters.fTime:fDNNVarRaw:fDNNVarRecon:fDNNChargeEnergy",
+               "@fScintClusters.size()==1", "para goff");
+  info.reserve(dnnTree.GetSelectedRows());
   for(int i = 0; i < dnnTree.GetSelectedRows(); i++)
   {
     int event                = (int)    dnnTree.GetVal(0)[i];
-    double fDNNVarRaw        = (double) dnnTree.GetVal(1)[i];
-    double fDNNVarRecon      = (double) dnnTree.GetVal(2)[i]; 
-    double fDNNChargeEnergy  = (double) dnnTree.GetVal(3)[i];
-    fDNNInfo.push_back(EXODNNInfo(runNumber,event,fDNNVarRaw, fDNNVarRecon, fDNNChargeEnergy));
+    double scintTime         = (double) dnnTree.GetVal(1)[i];
+    double fDNNVarRaw        = (double) dnnTree.GetVal(2)[i];
+    double fDNNVarRecon      = (double) dnnTree.GetVal(3)[i]; 
+    double fDNNChargeEnergy  = (double) dnnTree.GetVal(4)[i];
+    info.push_back(EXODNNInfo(runNumber,event,scintTime,fDNNVarRaw, fDNNVarRecon, fDNNChargeEnergy));
   }
-  //dnnFile->Close();  
-  return kOk;
+  // Stable, so that entries with equal keys keep the order of the trees.
+  std::stable_sort(info.begin(), info.end(), CompareDNNInfo);
+  return true;
+}
+
+EXOCopyDNNModule::EXODNNSource EXOCopyDNNModule::GetDNNSource(const std::string& treeFiles)
+{
+  // Describe the files matching treeFiles, without opening them.
+  EXODNNSource source;
+  TChain dnnTree("tree");
+  dnnTree.Add(treeFiles.c_str());
+  TObjArray* files = dnnTree.GetListOfFiles();
+  for(Int_t i = 0; files and i < files->GetEntriesFast(); i++) {
+    Long_t id, flags, modtime;
+    Long64_t size;
+    if(gSystem->GetPathInfo(files->At(i)->GetTitle(), &id, &size, &flags, &modtime) != 0) continue;
+    source.fNumFiles++;
+    source.fTotalSize += size;
+    source.fLastModified = std::max(source.fLastModified, (Long64_t) modtime);
+  }
+  return source;
+}
+
+std::string EXOCopyDNNModule::GetDNNIndexFile(const std::string& dir, int runNumber)
+{
+  if (dir == "") return "";
+  return dir + Form("/dnn_%i.dnnidx", runNumber);
+}
+
+bool EXOCopyDNNModule::ReadDNNIndex(const std::string& indexFile, int runNumber,
+                                    const EXODNNSource& source, std::vector<EXODNNInfo>& info)
+{
+  // Returns false, leaving info empty, if there is no valid index of the run
+  // built from the trees described by source.
+  info.clear();
+  FILE* file = fopen(indexFile.c_str(), "rb");
+  if(!file) return false;
+  DNNIndexHeader header;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1 and
+            std::equal(gfDNNIndexMagic, gfDNNIndexMagic + 8, header.fMagic) and
+            header.fRunNumber == runNumber and
+            header.fInfoSize == sizeof(EXODNNInfo) and
+            header.fNumEntries > 0 and
+            source.fNumFiles > 0 and
+            header.fSource.fNumFiles == source.fNumFiles and
+            header.fSource.fTotalSize == source.fTotalSize and
+            header.fSource.fLastModified == source.fLastModified;
+  if(ok) {
+    info.resize(header.fNumEntries);
+    ok = fread(&info[0], sizeof(EXODNNInfo), info.size(), file) == info.size();
+  }
+  fclose(file);
+  if(not ok) info.clear();
+  return ok;
+}
+
+bool EXOCopyDNNModule::WriteDNNIndex(const std::string& indexFile, int runNumber,
+                                     const EXODNNSource& source, const std::vector<EXODNNInfo>& info)
+{
+  // An index with no entries, or not built from any trees, could never be
+  // read back, so isn't written.
+  if(info.empty() or source.fNumFiles == 0) return false;
+  DNNIndexHeader header;
+  std::copy(gfDNNIndexMagic, gfDNNIndexMagic + 8, header.fMagic);
+  header.fRunNumber = runNumber;
+  header.fInfoSize = sizeof(EXODNNInfo);
+  header.fNumEntries = info.size();
+  header.fSource = source;
+
+  EXOAtomicFile out(indexFile);
+  FILE* file = out.GetFile();
+  if(!file) return false;
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  if(ok) ok = fwrite(&info[0], sizeof(EXODNNInfo), info.size(), file) == info.size();
+  return out.Commit(ok);
+}
+
+bool EXOCopyDNNModule::BuildDNNIndex(const std::string& dir, int runNumber, EXOBeginRecord::RunFlavor flavor)
+{
+  // Write the index file of a run, as BeginOfRun would, without processing it.
+  std::string fileName = GetDNNFileName(runNumber, flavor);
+  std::vector<EXODNNInfo> info;
+  if (fileName == "" or dir == "") return false;
+  EXODNNSource source = GetDNNSource(fileName);
+  if (not LoadDNNTree(fileName, runNumber, info)) return false;
+  return WriteDNNIndex(GetDNNIndexFile(dir, runNumber), runNumber, source, info);
 }
 
 
@@ -143,7 +285,7 @@ EXOAnalysisModule::EventStatus EXOCopyDNNModule::ProcessEvent(EXOEventData* ED)
   for (unsigned int i = 0; i < ED->GetNumScintillationClusters(); i++)
   {
      EXOScintillationCluster *sc = ED->GetScintillationCluster(i);
-     size_t idx = GetDNNInfoIdx(eventNumber);
+     size_t idx = GetDNNInfoIdx(eventNumber, sc->fTime);
      
      if(!idx)
      {
@@ -163,21 +305,29 @@ EXOAnalysisModule::EventStatus EXOCopyDNNModule::ProcessEvent(EXOEventData* ED)
   return kOk;
 }
 
-size_t EXOCopyDNNModule::GetDNNInfoIdx(int event)
+size_t EXOCopyDNNModule::GetDNNInfoIdx(int event, double scintTime) const
 {
   // Get the dnn info from vector of copies
-  // Determine scintillation cluster based on time difference < 1 us
+  // Binary search for the event; if it has several entries, take the one
+  // whose scintillation cluster is within 1 us of scintTime, or else the first.
   
-  for(size_t i = 0; i < fDNNInfo.size(); i++)
+  std::vector<EXODNNInfo>::const_iterator first, last;
+  EXODNNInfo key;
+  key.fEventNumber = event;
+  first = std::lower_bound(fDNNInfo.begin(), fDNNInfo.end(), key, CompareDNNEvent);
+  last = std::upper_bound(first, fDNNInfo.end(), key, CompareDNNEvent);
+  if(first == last) return 0;
+
+  for(std::vector<EXODNNInfo>::const_iterator it = first; it != last; it++)
   {
-    if(fDNNInfo[i].fEventNumber == event)
+    if(std::fabs(it->fScintTime - scintTime) < gfMaxTimeDifference)
     {
         //return i+1 so that only 0 when false
         //will pull off the extra +1 after
-        return i+1;
+        return (it - fDNNInfo.begin()) + 1;
     }
   }
-  return 0;
+  return (first - fDNNInfo.begin()) + 1;
 }
 
 /*
@@ -194,6 +344,12 @@ int EXOCopyDNNModule::TalkTo(EXOTalkToManager *talktoManager)
 {
   // TalkTo commands definition for this module
   
+  talktoManager->CreateCommand("/copy-dnn/indexDir",
+                               "Directory of the per-run dnn index files (none: read the dnn trees).",
+                               this,
+                               "",
+                               &EXOCopyDNNModule::SetDNNIndexDirectory);
+
   //talktoManager->CreateCommand("/copy-dnn/dnnFile",
   //                             "Give file for dnn variable copying.",
   //                             this,
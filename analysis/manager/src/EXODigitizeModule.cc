@@ -15,6 +15,16 @@
 // SetDigitizationTime (directly or via /digitizer/setDigitizationTime) was
 // called with to define the time. 
 //
+// Correlated noise: with /digitizer/correlatedNoiseFile set to a file holding
+// an EXONoiseCorrelations object, noise on all channels in that object is
+// drawn together with the measured channel-channel correlations (see
+// EXOCorrelatedNoiseGenerator) and added after digitization.  The
+// per-channel noise of /digitizer/wireNoise and /digitizer/APDNoise is then
+// not added; channels missing from the correlations get no noise.  Like the
+// per-channel noise, it is drawn once, /digitizer/correlatedNoiseCache times
+// the noise length, and each event gets a stretch of it from a random point;
+// a cache of 0 draws new noise for every event, which is much slower.
+//
 // Written September 2011, M. Marino
 //______________________________________________________________________________
 #include "EXOAnalysisManager/EXODigitizeModule.hh"
@@ -24,12 +34,15 @@
 #include "EXOUtilities/EXOTransferFunction.hh"
 #include "EXOUtilities/EXOTalkToManager.hh"
 #include "EXOUtilities/EXOWaveform.hh"
+#include "EXOUtilities/EXONoiseCorrelations.hh"
 #include "EXOCalibUtilities/EXOElectronicsShapers.hh"
 #include "EXOCalibUtilities/EXOMCChannelScaling.hh"
 #include "EXOCalibUtilities/EXOCalibManager.hh"
 #include "EXOCalibUtilities/EXOUWireGains.hh"
 #include "EXOCalibUtilities/EXOVWireGains.hh"
 #include "TRandom.h"
+#include "TFile.h"
+#include "TDirectory.h"
 #include <sstream>
 #include <cmath>
 using CLHEP::microsecond;
@@ -49,7 +62,9 @@ EXODigitizeModule::EXODigitizeModule() :
   fMCScalingDatabaseFlavor("vanilla"),
   fUWireDatabaseFlavor("source_calibration"),
   fVWireDatabaseFlavor("vanilla"),
-  fACSmearSigma(0.0)  
+  fACSmearSigma(0.0),
+  fCorrelatedNoiseFilename(""),
+  fCorrelatedNoiseCache(100)
 {
   fTimingInfo.SetName("DigitizerStatistics");
   RegisterSharedObject(fTimingInfo.GetName(), fTimingInfo);
@@ -74,6 +89,24 @@ int EXODigitizeModule::Initialize()
   // fDigAPDs.SetTimingStatisticInfo(&fTimingInfo); I haven't bothered to produce timing info within EXODigitizeAPDs.
   fDigWires.SetTimingStatisticInfo(&fTimingInfo);
   fTimingInfo.Clear();
+
+  fCorrelatedNoise.Clear();
+  fCorrelatedNoise.SetCacheLength(fCorrelatedNoiseCache);
+  if(fCorrelatedNoiseFilename != "") {
+    // Don't let the noise file become the current directory.
+    TDirectory* formerDir = gDirectory;
+    TFile* noiseFile = TFile::Open(fCorrelatedNoiseFilename.c_str());
+    EXONoiseCorrelations* noiseCorr = (noiseFile) ?
+      dynamic_cast<EXONoiseCorrelations*>(noiseFile->Get("EXONoiseCorrelations")) : NULL;
+    bool ok = noiseCorr and fCorrelatedNoise.SetNoiseCorrelations(*noiseCorr);
+    delete noiseCorr;
+    delete noiseFile;
+    if(formerDir) formerDir->cd();
+    if(not ok) {
+      LogEXOMsg("Unable to read noise correlations from " + fCorrelatedNoiseFilename, EEError);
+      return -1;
+    }
+  }
   return 0;
 }
 
@@ -186,7 +219,8 @@ EXOAnalysisModule::EventStatus EXODigitizeModule::ProcessEvent(EXOEventData *ED)
 
 
   if(fDoIDigitizeAPDs) {
-    electronicsShapers->SetNoiseAmplitudeForAPDs(fAPDNoiseMagnitude*ADC_BITS/APD_ADC_FULL_SCALE_ELECTRONS);
+    double apdNoise = fCorrelatedNoise.IsReady() ? 0.0 : fAPDNoiseMagnitude;
+    electronicsShapers->SetNoiseAmplitudeForAPDs(apdNoise*ADC_BITS/APD_ADC_FULL_SCALE_ELECTRONS);
     fDigAPDs.SetElectronics(electronicsShapers);
     fDigAPDs.SetScaling(ScalingFromDatabase->GetScalingChannelMap());
     fDigAPDs.SetACSmearFactor(ACSmearFactor*fACTanTheta);
@@ -196,7 +230,8 @@ EXOAnalysisModule::EventStatus EXODigitizeModule::ProcessEvent(EXOEventData *ED)
   }
 
   if(fDoIDigitizeWires) {
-    electronicsShapers->SetNoiseAmplitudeForWires(fWireNoiseMagnitude*W_VALUE_LXE_EV_PER_ELECTRON);
+    double wireNoise = fCorrelatedNoise.IsReady() ? 0.0 : fWireNoiseMagnitude;
+    electronicsShapers->SetNoiseAmplitudeForWires(wireNoise*W_VALUE_LXE_EV_PER_ELECTRON);
     fDigWires.SetElectronics(electronicsShapers);
     fDigWires.SetScaling(ScalingFromDatabase->GetScalingChannelMap());
     fDigWires.SetUGains(UGainsFromDatabase->GetGainsChannelMap());
@@ -207,6 +242,12 @@ EXOAnalysisModule::EventStatus EXODigitizeModule::ProcessEvent(EXOEventData *ED)
     fTimingInfo.StopTimerForTag("DigitizeWires");
   }
 
+  if(fCorrelatedNoise.IsReady()) {
+    fTimingInfo.StartTimerForTag("AddCorrelatedNoise");
+    fCorrelatedNoise.AddNoise(*ED->GetWaveformData(), *gRandom);
+    fTimingInfo.StopTimerForTag("AddCorrelatedNoise");
+  }
+
   // Trim any saturated waveforms.
   fTimingInfo.StartTimerForTag("TrimSaturatedSignals");
   fTrimWaveforms.TrimWaveforms(*ED->GetWaveformData());
@@ -371,6 +412,18 @@ int EXODigitizeModule::TalkTo(EXOTalkToManager *talktoManager)
          fVWireDatabaseFlavor,
          &EXODigitizeModule::SetVWireDatabaseFlavor);
 
+  talktoManager->CreateCommand("/digitizer/correlatedNoiseFile",
+         "File with an EXONoiseCorrelations object; if set, correlated noise from it replaces wireNoise and APDNoise",
+         this,
+         fCorrelatedNoiseFilename,
+         &EXODigitizeModule::SetCorrelatedNoiseFilename);
+
+  talktoManager->CreateCommand("/digitizer/correlatedNoiseCache",
+         "Length of the correlated noise drawn at once, in noise lengths; each event starts at a random point of it.  0 draws new noise for every event",
+         this,
+         fCorrelatedNoiseCache,
+         &EXODigitizeModule::SetCorrelatedNoiseCache);
+
   return 0;
 }
 
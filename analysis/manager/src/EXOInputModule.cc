@@ -152,6 +152,24 @@ EXOEventData* EXOInputModule::SearchEvent(int event_number)
   return NULL;
 }
 
+//______________________________________________________________________________
+bool EXOInputModule::SaveCheckpoint(TDirectory& /*dir*/)
+{
+  // Save the position in the input.  Input modules which support
+  // checkpointing overload this and RestoreCheckpoint; by default the
+  // position can not be saved, so no checkpoint can be written.
+  LogEXOMsg(GetName() + " can not save its position in the input", EEError);
+  return false;
+}
+
+//______________________________________________________________________________
+bool EXOInputModule::RestoreCheckpoint(TDirectory& /*dir*/)
+{
+  // Restore the position in the input, see SaveCheckpoint.
+  LogEXOMsg(GetName() + " can not resume from a checkpoint", EEError);
+  return false;
+}
+
 //______________________________________________________________________________
 void EXOInputModule::CloseCurrentFile()
 {
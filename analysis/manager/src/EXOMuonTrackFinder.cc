@@ -36,9 +36,14 @@
 //            the muons and possible muons in the event.
 // 2013-04-09 Now checks if a channel is good before printing that it can't
 //            find a waveform.
+// 2026-10-19 The Hough transform now votes into MuonHoughAccumulator, a flat
+//            integer array with tabulated cos/sin, instead of a TH2I, and the
+//            hot spots are kept in a list.  The histograms are only filled
+//            when saving individual events (/muontrack/indvhists).
 // -o_o-o_o- -o_o-o_o-
 
 #include <vector>
+#include <algorithm>
 #include "EXOAnalysisManager/EXOMuonTrackFinder.hh"
 #include "EXOUtilities/EXOEventData.hh"
 #include "EXOUtilities/EXOWaveform.hh"
@@ -249,6 +254,124 @@ void TrackParams::Reset() {
   final_t_on_track = -1;
 }
 
+// o-o_o-o_o-o_o-o_o-o_o-o
+//
+// MuonHoughAccumulator helper class
+// Holds the Hough transform of the hot spots on one wire plane
+//
+// o-o_o-o_o-o_o-o_o-o_o-o
+
+MuonHoughAccumulator::MuonHoughAccumulator(int n_angles, int n_x, double xmin, double xmax,
+                                           int n_y, double ymin, double ymax) :
+ nx(n_x),
+ ny(n_y),
+ x_min(xmin),
+ x_max(xmax),
+ y_min(ymin),
+ y_max(ymax),
+ cos_eta(n_angles),
+ sin_eta(n_angles),
+ row(n_angles),
+ vote_bin(n_angles),
+ cells(n_x*n_y, 0)
+{
+  for (int i = 0; i < n_angles; i++) {
+    double eta = i*(xmax - xmin)/(n_angles) + xmin;
+    cos_eta[i] = cos(eta);
+    sin_eta[i] = sin(eta);
+
+    // same bin as TAxis::FindBin
+    int binx = (eta < xmin) ? -1 : static_cast<int>(nx*(eta - xmin)/(xmax - xmin));
+    if (binx >= nx) binx = -1;
+    row[i] = (binx < 0) ? -1 : binx*ny;
+  }
+}
+
+
+
+void MuonHoughAccumulator::Reset() {
+  std::fill(cells.begin(), cells.end(), 0);
+}
+
+
+
+void MuonHoughAccumulator::Vote(double t, double w) {
+  int n = cos_eta.size();
+  const double *c = &cos_eta[0];
+  const double *s = &sin_eta[0];
+  const int *first = &row[0];
+  int *bin = &vote_bin[0];
+  double width = y_max - y_min;
+
+  // No branches and no dependence between angles, so this can be vectorised.
+  // Points outside of the y range (and angles outside of the x range) get -1.
+  // The y bin is computed exactly as TAxis::FindBin does, including the
+  // overflow when rounding puts a point just below y_max into bin ny.
+  for (int i = 0; i < n; i++) {
+    double r = t*c[i] + w*s[i];
+    int y = static_cast<int>(ny*(r - y_min)/width);
+    int in_range = (r >= y_min) & (r < y_max) & (y < ny) & (first[i] >= 0);
+    bin[i] = in_range ? first[i] + y : -1;
+  }
+
+  int *h = &cells[0];
+  for (int i = 0; i < n; i++) {
+    if (bin[i] >= 0) h[bin[i]]++;
+  }
+}
+
+
+
+int MuonHoughAccumulator::FindPeak(double &x, double &y, int &n_at_max) const {
+  int max = 0;
+  int n = 0;
+  for (size_t i = 0; i < cells.size(); i++) {
+    if (cells[i] > max) {
+      max = cells[i];
+      n = 1;
+    } else if (cells[i] == max) {
+      ++n;
+    }
+  }
+  n_at_max = n;
+
+  // take the median, the (n/2)th cell at the maximum (and the one before it
+  // for an even count)
+  int want = (n % 2 == 1) ? n/2 : n/2 - 1;
+  int found = 0;
+  double sum_x = 0;
+  double sum_y = 0;
+  double dx = (x_max - x_min)/nx;
+  double dy = (y_max - y_min)/ny;
+  for (size_t i = 0; i < cells.size() && found <= n/2; i++) {
+    if (cells[i] != max) continue;
+    if (found >= want) {
+      sum_x += x_min + (i/ny)*dx;
+      sum_y += y_min + (i%ny)*dy + 0.5*dy;
+    }
+    ++found;
+  }
+  if (n % 2 == 1) {
+    x = sum_x;
+    y = sum_y;
+  } else {
+    x = 0.5*sum_x;
+    y = 0.5*sum_y;
+  }
+  return max;
+}
+
+
+
+void MuonHoughAccumulator::FillHistogram(TH2I *h) const {
+  h->Reset();
+  for (size_t i = 0; i < cells.size(); i++) {
+    if (cells[i] != 0) {
+      h->SetBinContent(i/ny + 1, i%ny + 1, cells[i]);
+    }
+  }
+}
+
 // o-o_o-o_o-o_o-o_o-o_o-o
 //
 // EXOMuonTrackFinder class
@@ -349,31 +472,35 @@ void EXOMuonTrackFinder::AddToRawHist(TH2I *h, MuonTrackChannelHelper *chan) {
     }
     return;
   }
-  for (size_t t = 0; t < wf->GetLength(); t++) {
-    h->Fill(t, chan->GetNum(), wf->At(t) - chan->GetAvg());
+  // each sample has its own bin, so set the contents rather than fill
+  int biny = h->GetYaxis()->FindFixBin(chan->GetNum());
+  int n = std::min(static_cast<int>(wf->GetLength()), h->GetNbinsX());
+  for (int t = 0; t < n; t++) {
+    h->SetBinContent(t + 1, biny, wf->At(t) - chan->GetAvg());
   }
 }
 
 
 
-// Perform the hough transform on a single point and add the result to histogram h
-void EXOMuonTrackFinder::HoughTransformSinglePoint(TH2I *h, MuonTrackChannelHelper *chan, double t) {
+// Record a hot spot and add its Hough transform to hough
+void EXOMuonTrackFinder::AddSpot(MuonHoughAccumulator *hough, MuonTrackChannelHelper *chan, int t,
+                                 std::vector<MuonTrackSpot> *spots, TH2I *h_spot) {
 
   // rescale t so all our angles aren't really small
-  double scaled_t = t_scale_factor * t;
+  hough->Vote(t_scale_factor * t, chan->GetNum() % 38);
+  spots->push_back(MuonTrackSpot(t, chan->GetNum()));
 
-  for (int i = 0; i < (eta_bins); i++) {
-    double eta = i*(max_eta - min_eta)/(eta_bins) + min_eta;
-
-    h->Fill(eta, scaled_t*cos(eta) + (chan->GetNum() % 38)*sin(eta), 1);
+  if (h_spot != NULL) {
+    h_spot->Fill(t, chan->GetNum(), 1);
   }
 }
 
 
 
-// Do the actual Hough transform on channel chan and store the results in h_hough and track
+// Do the actual Hough transform on channel chan and store the results in hough, spots and track
 // If *h_spot is not null, add hot spots to this histogram, too
-void EXOMuonTrackFinder::DoHoughTransform(TH2I *h_hough, MuonTrackChannelHelper *chan, TrackParams *track, TH2I *h_spot, double max_allowed_t) {
+void EXOMuonTrackFinder::DoHoughTransform(MuonHoughAccumulator *hough, MuonTrackChannelHelper *chan, TrackParams *track,
+                                          std::vector<MuonTrackSpot> *spots, TH2I *h_spot, double max_allowed_t) {
   
   double threshold = GetWireThreshold(chan);
 
@@ -429,12 +556,8 @@ void EXOMuonTrackFinder::DoHoughTransform(TH2I *h_hough, MuonTrackChannelHelper
     } else if (spot_t >= 0) {
       // if we've come off of threshold without recording the point yet
       if (spot_t <= max_allowed_t) {
-	HoughTransformSinglePoint(h_hough, chan, spot_t);
+	AddSpot(hough, chan, spot_t, spots, h_spot);
 	track->total_spots += 1;
-
-	if (h_spot != NULL) {
-	  h_spot->Fill(spot_t, chan->GetNum(), 1);
-	}
       }
 
       spot_t = -1;
@@ -444,11 +567,8 @@ void EXOMuonTrackFinder::DoHoughTransform(TH2I *h_hough, MuonTrackChannelHelper
   
   if (above_threshold && spot_t <= max_allowed_t) {
     // if we were in a hot spot when we ran out of samples
-    HoughTransformSinglePoint(h_hough, chan, spot_t);
+    AddSpot(hough, chan, spot_t, spots, h_spot);
     track->total_spots += 1;
-    if (h_spot != NULL) {
-      h_spot->Fill(spot_t, chan->GetNum(), 1);
-    }
   }
 }
 
@@ -578,61 +698,50 @@ void EXOMuonTrackFinder::GetSphericalAngles(TrackParams *u_track, TrackParams *v
 
 
 
-// Get the track parameters from a hough transform histogram and store them in track
-void EXOMuonTrackFinder::FindTrackFromHough(TH2I *h, TrackParams *track) {
+// Get the track parameters from a hough transform and store them in track
+void EXOMuonTrackFinder::FindTrackFromHough(const MuonHoughAccumulator *hough, TrackParams *track) {
 
-  std::vector<double> etas(0);
-  std::vector<double> rs(0);
-
-  int max = static_cast<int>(floor(h->GetMaximum()));
+  // Take the median of the cells that have hits equal to the maximum.
+  // They are ordered by eta, and most tracks should be a line in
+  // the eta-r plane, so this isn't as nonsensical as it looks
   int n = 0;
+  int max = hough->FindPeak(track->eta, track->r, n);
 
-  // scan over eta and r and look for bins that have hits equal to the maximum
-  for (int binx = 1; binx <= h->GetNbinsX(); ++binx) {
-    for (int biny = 1; biny <= h->GetNbinsY(); ++biny) {
-
-      if (h->GetBinContent(binx, biny) == max) {
-	etas.push_back(h->GetXaxis()->GetBinLowEdge(binx));
-	rs.push_back(h->GetYaxis()->GetBinCenter(biny));
-	++n;
-      }
-    }
-  }
-
-  // take the median
-  // the arrays should already be sorted by eta, and most tracks should be a line in
-  // the eta-r plane, so this isn't as nonsensical as it looks
   if (n % 2 == 1) {
-    track->eta = etas[n/2];
-    track->r = rs[n/2];
     track->spots_contributing = max;
   } else {
-    track->eta = 0.5*(etas[n/2-1] + etas[n/2]);
-    track->r = 0.5*(rs[n/2-1] + rs[n/2]);
     track->spots_contributing = 2*max;
   }
 }
 
 
-// Get the track parameters from a hough transform histogram and store them in track
-int EXOMuonTrackFinder::GetTimeOfLastChargeOnTrack(TH2I *h_spots, TrackParams *track) {
+namespace {
+  // Latest sample first, then lowest channel
+  bool SpotIsBefore(const MuonTrackSpot& a, const MuonTrackSpot& b)
+  {
+    if (a.first != b.first) return a.first > b.first;
+    return a.second < b.second;
+  }
+}
+
+// Get the time of the last hot spot near the track and store it in track
+int EXOMuonTrackFinder::GetTimeOfLastChargeOnTrack(std::vector<MuonTrackSpot> *spots, TrackParams *track) {
 
   const double max_d = 1;
 
   double slope = -tan(track->eta)/t_scale_factor;
   double intercept = track->r/(cos(track->eta)*t_scale_factor);
+  int nsamples = ED->GetWaveformData()->fNumSamples;
 
-  for (int binx = h_spots->GetNbinsX(); binx > 0; --binx) {
-    for (int biny = 1; biny <= h_spots->GetNbinsY(); ++biny) {
-      if (h_spots->GetBinContent(binx, biny) > 0) {
-	int x = static_cast<int>(floor(h_spots->GetXaxis()->GetBinLowEdge(binx)));
-	int y = static_cast<int>(floor(h_spots->GetYaxis()->GetBinLowEdge(biny)));
+  std::sort(spots->begin(), spots->end(), SpotIsBefore);
+  for (size_t i = 0; i < spots->size(); i++) {
+    int x = (*spots)[i].first;
+    int y = (*spots)[i].second;
+    if (x < 0 || x >= nsamples) continue;
 
-	if (fabs((y%38) - (x-intercept)/slope) <= max_d) {
-	  track->final_t_on_track = x;
-	  return x;
-	}
-      }
+    if (fabs((y%38) - (x-intercept)/slope) <= max_d) {
+      track->final_t_on_track = x;
+      return x;
     }
   }
   return track->initial_t;
@@ -684,7 +793,9 @@ bool EXOMuonTrackFinder::isMuon(TrackParams *track1, TrackParams *track2, int li
 
 
 // For one set of wires on half of the chamber, look for muon tracks
-void EXOMuonTrackFinder::LookForTracks(int start_chan_num, TrackParams *track, TH2I *h, TH2I *hough, TH2I *spots, double max_allowed_t) {
+void EXOMuonTrackFinder::LookForTracks(int start_chan_num, TrackParams *track, TH2I *h,
+                                       MuonHoughAccumulator *hough, std::vector<MuonTrackSpot> *spots,
+                                       TH2I *h_spots, double max_allowed_t) {
 
     for (int chan_num = start_chan_num; chan_num < NCHANNEL_PER_WIREPLANE+start_chan_num; chan_num++) {
 
@@ -692,9 +803,9 @@ void EXOMuonTrackFinder::LookForTracks(int start_chan_num, TrackParams *track, T
       if (chan->isGoodChan()) {      
 	if (make_indv_hists) {
 	  AddToRawHist(h, chan);
-	  DoHoughTransform(hough, chan, track, spots, max_allowed_t);
+	  DoHoughTransform(hough, chan, track, spots, h_spots, max_allowed_t);
 	} else {
-	  DoHoughTransform(hough, chan, track, spots, max_allowed_t);
+	  DoHoughTransform(hough, chan, track, spots, NULL, max_allowed_t);
 	}
       }
 
@@ -703,12 +814,22 @@ void EXOMuonTrackFinder::LookForTracks(int start_chan_num, TrackParams *track, T
 }
 
 
-// Reset the histograms for the next event
+// Reset the hough transforms and histograms for the next event
 // Also set the channel numbers depending on the half of the tpc
 void EXOMuonTrackFinder::ResetHistogramsAndSetChannelNumbers(int tpc) {
   u_tracks[tpc]->Reset();
   v_tracks[tpc]->Reset();
 
+  u_hough->Reset();
+  u_spots.clear();
+  v_hough->Reset();
+  v_spots.clear();
+
+  // the histograms are only filled for individual muon candidates
+  if (not make_indv_hists) {
+    return;
+  }
+
   // reset the u wire histograms
   h_u->Reset();
   h_u_spots->Reset();
@@ -944,6 +1065,7 @@ int EXOMuonTrackFinder::Initialize()
   h_u = new TH2I("h_u","u wire signals", 2048, 0, 2048, 38, 0, 38);
   h_u_spots = new TH2I("h_u_spots","u wire hot spots", 2048, 0, 2048, 38, 0, 38);
   h_u_hough = new TH2I("h_u_hough","u wire hough transform", eta_bins + 1, -M_PI/2, M_PI/2, r_bins + 1, 0, 37);
+  u_hough = new MuonHoughAccumulator(eta_bins, eta_bins + 1, min_eta, max_eta, r_bins + 1, 0, 37);
   
   u_track_graph = new TGraph(2);
   u_track_graph->SetLineWidth(2);
@@ -952,6 +1074,7 @@ int EXOMuonTrackFinder::Initialize()
   h_v = new TH2I("h_v","v wire signals", 2048, 0, 2048, 38, 0, 38);
   h_v_spots = new TH2I("h_v_spots","v wire hot spots", 2048, 0, 2048, 38, 0, 38);
   h_v_hough = new TH2I("h_v_hough","v wire hough transform", eta_bins + 1, -M_PI_2, M_PI_2, r_bins + 1, 0, 37);
+  v_hough = new MuonHoughAccumulator(eta_bins, eta_bins + 1, min_eta, max_eta, r_bins + 1, 0, 37);
   
   v_track_graph = new TGraph(2);
   v_track_graph->SetLineWidth(2);
@@ -1060,7 +1183,7 @@ EXOAnalysisModule::EventStatus EXOMuonTrackFinder::ProcessEvent(EXOEventData *ev
 
     // first look for tracks in the u wires
     fTimingInfo.StartTimerForTag("look_for_u_tracks", false);
-    LookForTracks(76*tpc, u_tracks[tpc], h_u, h_u_hough, h_u_spots, max_allowed_t);
+    LookForTracks(76*tpc, u_tracks[tpc], h_u, u_hough, &u_spots, h_u_spots, max_allowed_t);
     fTimingInfo.StopTimerForTag("look_for_u_tracks");
     
     // two points will give you a line no matter what
@@ -1068,10 +1191,10 @@ EXOAnalysisModule::EventStatus EXOMuonTrackFinder::ProcessEvent(EXOEventData *ev
     // also dont look at events that are obviously noise
     if (u_tracks[tpc]->total_spots >= 3) {
       fTimingInfo.StartTimerForTag("hough_u_tracks", false);
-      FindTrackFromHough(h_u_hough, u_tracks[tpc]);
+      FindTrackFromHough(u_hough, u_tracks[tpc]);
       fTimingInfo.StopTimerForTag("hough_u_tracks");
       fTimingInfo.StartTimerForTag("last_charge_u_tracks", false);
-      GetTimeOfLastChargeOnTrack(h_u_spots, u_tracks[tpc]);
+      GetTimeOfLastChargeOnTrack(&u_spots, u_tracks[tpc]);
       fTimingInfo.StopTimerForTag("last_charge_u_tracks");
       if (make_indv_hists) {
 	MakeTrack(u_track_graph, u_tracks[tpc], 76*tpc);
@@ -1080,23 +1203,25 @@ EXOAnalysisModule::EventStatus EXOMuonTrackFinder::ProcessEvent(EXOEventData *ev
     }
       
     fTimingInfo.StartTimerForTag("look_for_v_tracks", false);
-    LookForTracks(76*tpc+38, v_tracks[tpc], h_v, h_v_hough, h_v_spots, max_allowed_t); 
+    LookForTracks(76*tpc+38, v_tracks[tpc], h_v, v_hough, &v_spots, h_v_spots, max_allowed_t); 
     fTimingInfo.StopTimerForTag("look_for_v_tracks");
       
     // two points will give you a line no matter what
     // so only look for a track if we have more than that
     if (v_tracks[tpc]->total_spots >= 3) {
       fTimingInfo.StartTimerForTag("hough_v_tracks", false);
-      FindTrackFromHough(h_v_hough, v_tracks[tpc]);
+      FindTrackFromHough(v_hough, v_tracks[tpc]);
       fTimingInfo.StopTimerForTag("hough_v_tracks");
       fTimingInfo.StartTimerForTag("last_charge_v_tracks", false);
-      GetTimeOfLastChargeOnTrack(h_v_spots, v_tracks[tpc]);
+      GetTimeOfLastChargeOnTrack(&v_spots, v_tracks[tpc]);
       fTimingInfo.StopTimerForTag("last_charge_v_tracks");
       if (make_indv_hists) {
 	MakeTrack(v_track_graph, v_tracks[tpc], 38 + 76*tpc);
       }
     }
     if (make_indv_hists && u_tracks[tpc]->total_spots + v_tracks[tpc]->total_spots > 0) {
+	u_hough->FillHistogram(h_u_hough);
+	v_hough->FillHistogram(h_v_hough);
 	SaveHistogramsToFile(tpc);
     }
     if (isMuon(u_tracks[tpc], v_tracks[tpc], light_t)) {
@@ -1190,11 +1315,13 @@ int EXOMuonTrackFinder::ShutDown()
   delete h_u;
   delete h_u_spots;
   delete h_u_hough;
+  delete u_hough;
   delete u_track_graph;
   
   delete h_v;
   delete h_v_spots;
   delete h_v_hough;
+  delete v_hough;
   delete v_track_graph;
   
   std::cout << "EXO Alpha Team Muon Track Finder finished running." << std::endl;
@@ -0,0 +1,277 @@
+//______________________________________________________________________________
+// EXONoiseBank
+//
+// A flat, memory-mapped copy of a noise file made by the realnoise module.
+// Reading a noise event from the ROOT file means deserializing it and
+// decompressing every waveform; for simulation the same few thousand noise
+// events are read over and over.  The bank stores them once, decompressed
+// and with the offset already removed, as 16-bit samples.  The noise file
+// holds each channel of each trace with its own baseline subtracted and the
+// offset added, so these are the baseline-subtracted noise samples:
+//
+//   header | channel numbers | samples [trace][channel][sample] | trigger seconds
+//
+// The samples start on a page boundary.  The bank is mapped read-only, so
+// all jobs on a node using the same bank share one copy in the page cache,
+// and adding noise to a waveform is a single pass over two arrays.
+//
+// Build writes the bank with EXOAtomicFile, so jobs starting together
+// never see a partial bank; at worst several of them do the conversion.
+//______________________________________________________________________________
+
+#include "EXOAnalysisManager/EXONoiseBank.hh"
+#include "EXOUtilities/EXOEventData.hh"
+#include "EXOUtilities/EXOWaveformData.hh"
+#include "EXOUtilities/EXOWaveform.hh"
+#include "EXOUtilities/EXOErrorLogger.hh"
+#include "EXOUtilities/EXOAtomicFile.hh"
+#include "EXOUtilities/EXOHash.hh"
+#include "TTree.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+namespace {
+  const char gfMagic[8] = {'E','X','O','N','B','A','N','K'};
+  const UInt_t gfVersion = 2;
+  const size_t gfPageSize = 4096;
+}
+
+//______________________________________________________________________________
+EXONoiseBank::EXONoiseBank()
+: fMapping(NULL),
+  fMappingSize(0),
+  fSamples(NULL),
+  fTriggerSeconds(NULL)
+{}
+
+//______________________________________________________________________________
+EXONoiseBank::~EXONoiseBank()
+{
+  Close();
+}
+
+//______________________________________________________________________________
+bool EXONoiseBank::Build(TTree& tree, const std::string& bankFile,
+                         Int_t offset, const Source& source)
+{
+  // Convert every entry of tree.  Entries which lack a channel of the first
+  // entry, or have a different length, are left out with a warning.
+  EXOEventData* noiseEventData = NULL;
+  tree.SetBranchAddress("EventBranch", &noiseEventData);
+  Long64_t numEntries = tree.GetEntries();
+  if(numEntries == 0 or tree.GetEntry(0) <= 0) {
+    LogEXOMsg("Noise tree is empty, cannot build noise bank", EEError);
+    tree.ResetBranchAddresses();
+    return false;
+  }
+
+  EXOWaveformData* wfData = noiseEventData->GetWaveformData();
+  wfData->Decompress();
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.fMagic, gfMagic, sizeof(gfMagic));
+  header.fVersion = gfVersion;
+  header.fNumChannels = wfData->GetNumWaveforms();
+  header.fNumSamples = wfData->fNumSamples;
+  header.fOffset = offset;
+  header.fSourceSize = source.fSize;
+  header.fSourceModified = source.fModified;
+  header.fSourcePathHash = EXOHash::FNV1a(EXOHash::FNV1aBasis(), source.fPath);
+  std::vector<Int_t> channels;
+  for(size_t i = 0; i < wfData->GetNumWaveforms(); i++) {
+    channels.push_back(wfData->GetWaveform(i)->fChannel);
+  }
+  size_t headerSize = sizeof(Header) + sizeof(Int_t)*channels.size();
+  header.fSamplesOffset = ((headerSize + gfPageSize - 1)/gfPageSize)*gfPageSize;
+
+  EXOAtomicFile out(bankFile);
+  FILE* file = out.GetFile();
+  if(not file) {
+    LogEXOMsg("Unable to open " + out.GetTemporaryName() + " to build noise bank", EEError);
+    tree.ResetBranchAddresses();
+    return false;
+  }
+
+  // Samples first; the header is written once the number of traces is known.
+  bool ok = fseek(file, header.fSamplesOffset, SEEK_SET) == 0;
+  std::vector<Short_t> trace(size_t(header.fNumChannels)*header.fNumSamples);
+  std::vector<UInt_t> triggerSeconds;
+  size_t numClipped = 0;
+  for(Long64_t entry = 0; entry < numEntries and ok; entry++) {
+    if(tree.GetEntry(entry) <= 0) continue;
+    wfData = noiseEventData->GetWaveformData();
+    wfData->Decompress();
+    if(wfData->fNumSamples != Int_t(header.fNumSamples)) {
+      LogEXOMsg("Noise event with a different waveform length left out of the bank", EEWarning);
+      continue;
+    }
+    bool complete = true;
+    for(size_t ch = 0; ch < channels.size() and complete; ch++) {
+      const EXOWaveform* wf = wfData->GetWaveformWithChannel(channels[ch]);
+      if(not wf or wf->GetLength() != header.fNumSamples) {
+        complete = false;
+        break;
+      }
+      Short_t* out = &trace[ch*header.fNumSamples];
+      for(size_t i = 0; i < header.fNumSamples; i++) {
+        Int_t val = (*wf)[i] - offset;
+        if(val > 32767) { val = 32767; numClipped++; }
+        if(val < -32768) { val = -32768; numClipped++; }
+        out[i] = Short_t(val);
+      }
+    }
+    if(not complete) {
+      LogEXOMsg("Noise event missing channels left out of the bank", EEWarning);
+      continue;
+    }
+    if(fwrite(&trace[0], sizeof(Short_t), trace.size(), file) != trace.size()) ok = false;
+    triggerSeconds.push_back(noiseEventData->fEventHeader.fTriggerSeconds);
+  }
+  tree.ResetBranchAddresses();
+  delete noiseEventData;
+
+  if(numClipped > 0) {
+    std::ostringstream os;
+    os << numClipped << " noise samples clipped to 16 bits";
+    LogEXOMsg(os.str(), EEWarning);
+  }
+
+  header.fNumTraces = triggerSeconds.size();
+  header.fTriggerOffset = header.fSamplesOffset +
+    sizeof(Short_t)*ULong64_t(header.fNumTraces)*header.fNumChannels*header.fNumSamples;
+  if(ok and not triggerSeconds.empty()) {
+    ok = fwrite(&triggerSeconds[0], sizeof(UInt_t), triggerSeconds.size(), file) == triggerSeconds.size();
+  }
+  if(ok) {
+    ok = fseek(file, 0, SEEK_SET) == 0 and
+         fwrite(&header, sizeof(header), 1, file) == 1 and
+         fwrite(&channels[0], sizeof(Int_t), channels.size(), file) == channels.size();
+  }
+  if(ok and header.fNumTraces == 0) {
+    LogEXOMsg("No usable noise events for the noise bank", EEError);
+    ok = false;
+  }
+  ok = out.Commit(ok);
+  if(not ok) LogEXOMsg("Failed to build noise bank " + bankFile, EEError);
+  return ok;
+}
+
+//______________________________________________________________________________
+bool EXONoiseBank::Open(const std::string& bankFile)
+{
+  // Map bankFile.  Returns false, without logging, if the file does not
+  // exist; other failures are logged.
+  Close();
+  int fd = open(bankFile.c_str(), O_RDONLY);
+  if(fd < 0) return false;
+  struct stat st;
+  if(fstat(fd, &st) != 0 or size_t(st.st_size) < sizeof(Header)) {
+    close(fd);
+    LogEXOMsg("Noise bank " + bankFile + " is truncated", EEWarning);
+    return false;
+  }
+  void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) {
+    LogEXOMsg("Unable to map noise bank " + bankFile, EEError);
+    return false;
+  }
+  fMapping = mapping;
+  fMappingSize = st.st_size;
+
+  const Header& header = GetHeader();
+  ULong64_t samplesSize = sizeof(Short_t)*ULong64_t(header.fNumTraces)*
+                          header.fNumChannels*header.fNumSamples;
+  if(memcmp(header.fMagic, gfMagic, sizeof(gfMagic)) != 0 or
+     header.fVersion != gfVersion or
+     sizeof(Header) + sizeof(Int_t)*header.fNumChannels > header.fSamplesOffset or
+     header.fTriggerOffset != header.fSamplesOffset + samplesSize or
+     header.fTriggerOffset + sizeof(UInt_t)*header.fNumTraces > fMappingSize) {
+    LogEXOMsg("Noise bank " + bankFile + " is invalid or from another version", EEWarning);
+    Close();
+    return false;
+  }
+
+  const char* base = static_cast<const char*>(fMapping);
+  fSamples = reinterpret_cast<const Short_t*>(base + header.fSamplesOffset);
+  fTriggerSeconds = reinterpret_cast<const UInt_t*>(base + header.fTriggerOffset);
+  const Int_t* channels = reinterpret_cast<const Int_t*>(base + sizeof(Header));
+  for(size_t i = 0; i < header.fNumChannels; i++) {
+    if(channels[i] < 0) continue;
+    if(size_t(channels[i]) >= fChannelIndex.size()) fChannelIndex.resize(channels[i] + 1, -1);
+    fChannelIndex[channels[i]] = i;
+  }
+
+  // Traces are read in random order.
+  madvise(fMapping, fMappingSize, MADV_RANDOM);
+  return true;
+}
+
+//______________________________________________________________________________
+void EXONoiseBank::Close()
+{
+  if(fMapping) munmap(fMapping, fMappingSize);
+  fMapping = NULL;
+  fMappingSize = 0;
+  fSamples = NULL;
+  fTriggerSeconds = NULL;
+  fChannelIndex.clear();
+}
+
+//______________________________________________________________________________
+bool EXONoiseBank::Matches(const Source& source, size_t numTraces, Int_t offset) const
+{
+  // The bank may hold fewer traces than the source if some were left out.
+  if(not IsOpen()) return false;
+  const Header& header = GetHeader();
+  return header.fSourceSize == source.fSize and
+         header.fSourceModified == source.fModified and
+         header.fSourcePathHash == EXOHash::FNV1a(EXOHash::FNV1aBasis(), source.fPath) and
+         header.fOffset == offset and
+         header.fNumTraces <= numTraces;
+}
+
+//______________________________________________________________________________
+size_t EXONoiseBank::GetNumTraces() const
+{
+  return IsOpen() ? GetHeader().fNumTraces : 0;
+}
+
+//______________________________________________________________________________
+size_t EXONoiseBank::GetNumChannels() const
+{
+  return IsOpen() ? GetHeader().fNumChannels : 0;
+}
+
+//______________________________________________________________________________
+size_t EXONoiseBank::GetNumSamples() const
+{
+  return IsOpen() ? GetHeader().fNumSamples : 0;
+}
+
+//______________________________________________________________________________
+Int_t EXONoiseBank::GetOffset() const
+{
+  return IsOpen() ? GetHeader().fOffset : 0;
+}
+
+//______________________________________________________________________________
+const Short_t* EXONoiseBank::GetTrace(size_t trace, Int_t channel) const
+{
+  if(channel < 0 or size_t(channel) >= fChannelIndex.size() or
+     fChannelIndex[channel] < 0 or trace >= GetNumTraces()) return NULL;
+  const Header& header = GetHeader();
+  return fSamples + (trace*header.fNumChannels + fChannelIndex[channel])*size_t(header.fNumSamples);
+}
+
+//______________________________________________________________________________
+UInt_t EXONoiseBank::GetTriggerSeconds(size_t trace) const
+{
+  if(trace >= GetNumTraces()) return 0;
+  return fTriggerSeconds[trace];
+}
@@ -5,6 +5,15 @@
  * The module saves the extracted information in a separate ROOT 
  * tree and file.
  * The base filename can be set via TalkTo command.
+ *
+ * The statistics are accumulated while the events are processed
+ * (EXORunningStatistics: mean, RMS, extremes and the 16%, 50% and 84%
+ * quantiles), per channel and for the per-event average of each plane, so
+ * memory and end-of-run time do not depend on the number of events.  At the
+ * end of the run the summary is written to the NoiseSummary tree (one entry
+ * per channel, and one per plane with fChannel = -1), together with graphs
+ * of mean and RMS against channel in the Noise/ and Baseline/ directories.
+ * The per-event NoiseTree can be switched off with /noisecalc/writeTree.
  */
 
 //______________________________________________________________________________
@@ -19,11 +28,10 @@
 #include "EXOCalibUtilities/EXOChannelMapManager.hh"
 #include "TFile.h"
 #include "TTree.h"
-#include "TGraph.h"
+#include "TGraphErrors.h"
 #include "TAxis.h"
 #include <iostream>
 #include <vector>
-#include <map>
 #include <string>
 #include <sstream>
 
@@ -32,6 +40,7 @@ using namespace std;
 IMPLEMENT_EXO_ANALYSIS_MODULE( EXONoiseCalculator, "noisecalc" )
 EXONoiseCalculator::EXONoiseCalculator()
 : fFilenameBase("NoiseOutput"),
+  fWriteTree(true),
   fFile(NULL),
   fTree(NULL),
   fNevents(0)
@@ -47,6 +56,28 @@ EXONoiseCalculator::~EXONoiseCalculator()
 }
 
 
+const char* EXONoiseCalculator::GetPlaneName(int plane)
+{
+  static const char* names[kNumPlanes] = {"U North", "U South", "V North", "V South",
+                                          "APD North", "APD South"};
+  return names[plane];
+}
+
+const char* EXONoiseCalculator::GetTypeName(int plane)
+{
+  // Name of the directory for the channel type of plane.
+  static const char* names[kNumPlanes] = {"U-wire", "U-wire", "V-wire", "V-wire", "APD", "APD"};
+  return names[plane];
+}
+
+void EXONoiseCalculator::InitStatistics(EXORunningStatistics& stats) const
+{
+  stats = EXORunningStatistics();
+  stats.AddQuantile(0.16);
+  stats.AddQuantile(0.5);
+  stats.AddQuantile(0.84);
+}
+
 EXOAnalysisModule::EventStatus EXONoiseCalculator::BeginOfRun(EXOEventData *ED)
 {
   if(!ED){
@@ -58,13 +89,47 @@ EXOAnalysisModule::EventStatus EXONoiseCalculator::BeginOfRun(EXOEventData *ED)
   }
   const EXOChannelMap& channelMap = GetChanMapForHeader(ED->fEventHeader);
   fNevents = 0;
+  fChannelIndex.clear();
   fChannels.clear();
+  fChannelPlane.clear();
   for(size_t i=0; i<ED->GetWaveformData()->GetNumWaveforms(); i++){
     int channel = ED->GetWaveformData()->GetWaveform(i)->fChannel;
-    if(channelMap.good_channel(channel)){
-      fChannels.insert(channel);
+    if(not channelMap.good_channel(channel)) continue;
+    if(channel >= int(fChannelIndex.size())) fChannelIndex.resize(channel+1, -1);
+    if(fChannelIndex[channel] >= 0) continue;
+
+    int plane = -1;
+    EXOMiscUtil::EChannelType type = EXOMiscUtil::TypeOfChannel(channel);
+    switch(type){
+      case EXOMiscUtil::kUWire:
+        plane = kUNorth;
+        break;
+      case EXOMiscUtil::kVWire:
+        plane = kVNorth;
+        break;
+      case EXOMiscUtil::kAPDGang:
+        plane = kAPDNorth;
+        break;
+      default:
+        LogEXOMsg("Unknown waveform type",EEWarning);
     }
+    if(plane >= 0 and EXOMiscUtil::GetTPCSide(channel) == EXOMiscUtil::kSouth) plane++;
+
+    fChannelIndex[channel] = fChannels.size();
+    fChannels.push_back(channel);
+    fChannelPlane.push_back(plane);
+  }
+  fBaselineStats.resize(fChannels.size());
+  fNoiseStats.resize(fChannels.size());
+  for(size_t i=0; i<fChannels.size(); i++){
+    InitStatistics(fBaselineStats[i]);
+    InitStatistics(fNoiseStats[i]);
+  }
+  for(int plane=0; plane<kNumPlanes; plane++){
+    InitStatistics(fPlaneBaselineStats[plane]);
+    InitStatistics(fPlaneNoiseStats[plane]);
   }
+
   stringstream filename; 
   filename << fFilenameBase << "_Run" << ED->fRunNumber << ".root";
   fFile = new TFile(filename.str().c_str(),"RECREATE");
@@ -75,9 +140,10 @@ EXOAnalysisModule::EventStatus EXONoiseCalculator::BeginOfRun(EXOEventData *ED)
     return kError;
   }
 
-  fTree = new TTree("NoiseTree","NoiseTree");
-
-  fTree->Branch("fEventInfo",&fEventInfo);
+  if(fWriteTree){
+    fTree = new TTree("NoiseTree","NoiseTree");
+    fTree->Branch("fEventInfo",&fEventInfo);
+  }
 
   return kOk;
 }
@@ -95,181 +161,158 @@ EXOAnalysisModule::EventStatus EXONoiseCalculator::ProcessEvent(EXOEventData *ED
   fEventInfo->Clear();
   fEventInfo->fRunNumber = ED->fRunNumber;
   fEventInfo->fEventNumber = ED->fEventNumber;
+
+  double planeBaseline[kNumPlanes] = {0};
+  double planeNoise[kNumPlanes] = {0};
+  int planeCount[kNumPlanes] = {0};
+
   EXOWaveformData* wfd = ED->GetWaveformData();
   wfd->Decompress();
   for(size_t i=0; i<wfd->GetNumWaveforms(); i++){
     const EXOWaveform *wf = wfd->GetWaveform(i);
-    EXOChannelInfo* info = fEventInfo->GetNewChannelInfo();
-    info->fChannel = wf->fChannel;
-    info->fLength = wf->GetLength();
-    EXOMiscUtil::ParameterMap params = fBaselineCalculator.ExtractAll(*wf);
-    info->fBaseline = params["Baseline"];
-    info->fNoiseCounts = params["Noisecounts"];
+    double params[EXOBaselineAndNoiseCalculator::kNumParameters];
+    fBaselineCalculator.ExtractAll(*wf, params);
+    double baseline = params[EXOBaselineAndNoiseCalculator::kBaseline];
+    double noise = params[EXOBaselineAndNoiseCalculator::kNoisecounts];
+
+    if(fTree){
+      EXOChannelInfo* info = fEventInfo->GetNewChannelInfo();
+      info->fChannel = wf->fChannel;
+      info->fLength = wf->GetLength();
+      info->fBaseline = baseline;
+      info->fNoiseCounts = noise;
+    }
+
+    int channel = wf->fChannel;
+    if(channel < 0 or channel >= int(fChannelIndex.size()) or fChannelIndex[channel] < 0) continue;
+    int index = fChannelIndex[channel];
+    fBaselineStats[index].Add(baseline);
+    fNoiseStats[index].Add(noise);
+    int plane = fChannelPlane[index];
+    if(plane < 0) continue;
+    planeBaseline[plane] += baseline;
+    planeNoise[plane] += noise;
+    planeCount[plane]++;
+  }
+
+  for(int plane=0; plane<kNumPlanes; plane++){
+    if(planeCount[plane] == 0) continue;
+    fPlaneBaselineStats[plane].Add(planeBaseline[plane]/planeCount[plane]);
+    fPlaneNoiseStats[plane].Add(planeNoise[plane]/planeCount[plane]);
   }
-  fTree->Fill();
+
+  if(fTree) fTree->Fill();
   return kOk;
 }
 
 EXOAnalysisModule::EventStatus EXONoiseCalculator::EndOfRun(EXOEventData* ED)
 {
-  fTree->SetEstimate(fTree->GetEntries());
-
-  map<string,TDirectory*> directories;
-
+  if(!fFile){
+    return kError;
+  }
   TDirectory* Noisedir = fFile->mkdir("Noise");
   TDirectory* Baselinedir = fFile->mkdir("Baseline");
-  directories.insert(make_pair(string("Baseline APD"),Baselinedir->mkdir("APD")));
-  directories.insert(make_pair(string("Baseline U"),Baselinedir->mkdir("U-wire")));
-  directories.insert(make_pair(string("Baseline V"),Baselinedir->mkdir("V-wire")));
-  directories.insert(make_pair(string("Noise APD"),Noisedir->mkdir("APD")));
-  directories.insert(make_pair(string("Noise U"),Noisedir->mkdir("U-wire")));
-  directories.insert(make_pair(string("Noise V"),Noisedir->mkdir("V-wire")));
-
-  map<string, vector<double> > averages;
-
-  averages.insert(make_pair(string("Baseline U North"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Baseline U South"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Baseline V North"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Baseline V South"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Baseline APD North"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Baseline APD South"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Noise U North"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Noise U South"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Noise V North"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Noise V South"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Noise APD North"),vector<double>(fNevents,0)));
-  averages.insert(make_pair(string("Noise APD South"),vector<double>(fNevents,0)));
-
-  map<string, int> sums;
-
-  sums.insert(make_pair(string("Baseline U North"),0));
-  sums.insert(make_pair(string("Baseline U South"),0));
-  sums.insert(make_pair(string("Baseline V North"),0));
-  sums.insert(make_pair(string("Baseline V South"),0));
-  sums.insert(make_pair(string("Baseline APD North"),0));
-  sums.insert(make_pair(string("Baseline APD South"),0));
-  sums.insert(make_pair(string("Noise U North"),0));
-  sums.insert(make_pair(string("Noise U South"),0));
-  sums.insert(make_pair(string("Noise V North"),0));
-  sums.insert(make_pair(string("Noise V South"),0));
-  sums.insert(make_pair(string("Noise APD North"),0));
-  sums.insert(make_pair(string("Noise APD South"),0));
-
-  for(set<int>::iterator channel = fChannels.begin(); channel != fChannels.end(); channel++){
-    EXOMiscUtil::EChannelType type = EXOMiscUtil::TypeOfChannel(*channel);
-    EXOMiscUtil::ETPCSide side = EXOMiscUtil::GetTPCSide(*channel);
-    string typestring = "";
-    string sidestring = "";
-    switch(type){
-      case EXOMiscUtil::kAPDGang:
-        typestring = "APD";
-        break;
-      case EXOMiscUtil::kUWire:
-        typestring = "U";
-        break;
-      case EXOMiscUtil::kVWire:
-        typestring = "V";
-        break;
-      default:
-        LogEXOMsg("Unknown waveform type",EEWarning);
-    }
-    switch(side){
-      case EXOMiscUtil::kNorth:
-        sidestring = "North";
-        break;
-      case EXOMiscUtil::kSouth:
-        sidestring = "South";
-        break;
-      default:
-        LogEXOMsg("Channel has undefined detector side",EEError);
-    }
+  WriteSummary(*Noisedir, *Baselinedir);
+  return kOk;
+}
+
+void EXONoiseCalculator::WriteSummary(TDirectory& noiseDir, TDirectory& baselineDir)
+{
+  // Write the NoiseSummary tree and, for each channel type, graphs of the
+  // mean (with the RMS as error) against channel number.  Everything here
+  // is O(channels).
+  const int nSummary = 7;
+  const char* summaryNames[nSummary] = {"Mean", "RMS", "Min", "Max", "Q16", "Median", "Q84"};
+  int channel = 0;
+  int plane = 0;
+  int entries = 0;
+  double baseline[nSummary];
+  double noise[nSummary];
+
+  fFile->cd();
+  TTree summary("NoiseSummary","Baseline and noise statistics per channel and plane");
+  summary.Branch("fChannel", &channel, "fChannel/I");
+  summary.Branch("fPlane", &plane, "fPlane/I");
+  summary.Branch("fEntries", &entries, "fEntries/I");
+  for(int k=0; k<nSummary; k++){
+    string name = string("fBaseline") + summaryNames[k];
+    summary.Branch(name.c_str(), &baseline[k], (name + "/D").c_str());
+  }
+  for(int k=0; k<nSummary; k++){
+    string name = string("fNoise") + summaryNames[k];
+    summary.Branch(name.c_str(), &noise[k], (name + "/D").c_str());
+  }
 
-    stringstream chan;
-    chan << *channel;
-    string cutstring = "fChannel == " + chan.str();
+  for(size_t i=0; i<fChannels.size() + kNumPlanes; i++){
+    bool isChannel = i < fChannels.size();
+    const EXORunningStatistics& baselineStats =
+      isChannel ? fBaselineStats[i] : fPlaneBaselineStats[i - fChannels.size()];
+    const EXORunningStatistics& noiseStats =
+      isChannel ? fNoiseStats[i] : fPlaneNoiseStats[i - fChannels.size()];
+    channel = isChannel ? fChannels[i] : -1;
+    plane = isChannel ? fChannelPlane[i] : int(i - fChannels.size());
+    entries = baselineStats.GetN();
+    const EXORunningStatistics* stats[2] = {&baselineStats, &noiseStats};
+    double* values[2] = {baseline, noise};
+    for(int j=0; j<2; j++){
+      values[j][0] = stats[j]->GetMean();
+      values[j][1] = stats[j]->GetRMS();
+      values[j][2] = stats[j]->GetMin();
+      values[j][3] = stats[j]->GetMax();
+      for(int k=0; k<3; k++) values[j][4+k] = stats[j]->GetQuantile(k);
+    }
+    summary.Fill();
+  }
+  summary.Write("",TObject::kOverwrite);
 
-    fTree->Draw("fNoiseCounts:fEventNumber",cutstring.c_str(),"goff");
-    double* array = fTree->GetV1();
-    if(fTree->GetSelectedRows() != fNevents){
-      LogEXOMsg("Number of selected rows not as expected",EEError);
-      return kDrop;
+  // Graphs per channel type, in the directory layout of the earlier
+  // per-event graphs.
+  for(int type=kUNorth; type<kNumPlanes; type+=2){
+    vector<double> x, baselineMean, baselineRMS, noiseMean, noiseRMS;
+    for(size_t i=0; i<fChannels.size(); i++){
+      if(fChannelPlane[i] != type and fChannelPlane[i] != type+1) continue;
+      x.push_back(fChannels[i]);
+      baselineMean.push_back(fBaselineStats[i].GetMean());
+      baselineRMS.push_back(fBaselineStats[i].GetRMS());
+      noiseMean.push_back(fNoiseStats[i].GetMean());
+      noiseRMS.push_back(fNoiseStats[i].GetRMS());
     }
-    directories["Noise "+typestring]->cd();
-    TGraph noiseGraph(fTree->GetSelectedRows(),fTree->GetV2(),array);
-    noiseGraph.SetName(("Noise_"+chan.str()).c_str());
-    noiseGraph.GetXaxis()->SetTitle("Event number");
+    if(x.empty()) continue;
+    string typestring = GetTypeName(type);
+
+    noiseDir.mkdir(typestring.c_str())->cd();
+    TGraphErrors noiseGraph(x.size(),&x[0],&noiseMean[0],NULL,&noiseRMS[0]);
+    noiseGraph.SetName("Noise");
+    noiseGraph.SetTitle(("Noise "+typestring).c_str());
+    noiseGraph.GetXaxis()->SetTitle("Channel");
     noiseGraph.GetYaxis()->SetTitle("Noisecount");
-    noiseGraph.SetTitle(("Noise "+sidestring+" "+typestring+", channel "+chan.str()).c_str());
     noiseGraph.Write("",TObject::kOverwrite);
-    string key = "Noise "+typestring+" "+sidestring;
-    vector<double>& noiseAverage = averages[key];
-    for(int j=0; j<fNevents; j++){
-      noiseAverage[j] += array[j];
-    }
-    sums[key]++;
 
-    fTree->Draw("fBaseline:fEventNumber",cutstring.c_str(),"goff");
-    array = fTree->GetV1();
-    if(fTree->GetSelectedRows() != fNevents){
-      LogEXOMsg("Number of selected rows not as expected",EEError);
-      return kDrop;
-    }
-    directories["Baseline "+typestring]->cd();
-    TGraph baselineGraph(fTree->GetSelectedRows(),fTree->GetV2(),fTree->GetV1());
-    baselineGraph.SetName(("Baseline_"+chan.str()).c_str());
-    baselineGraph.GetXaxis()->SetTitle("Event number");
+    baselineDir.mkdir(typestring.c_str())->cd();
+    TGraphErrors baselineGraph(x.size(),&x[0],&baselineMean[0],NULL,&baselineRMS[0]);
+    baselineGraph.SetName("Baseline");
+    baselineGraph.SetTitle(("Baseline "+typestring).c_str());
+    baselineGraph.GetXaxis()->SetTitle("Channel");
     baselineGraph.GetYaxis()->SetTitle("Baseline");
-    baselineGraph.SetTitle(("Baseline "+sidestring+" "+typestring+", channel "+chan.str()).c_str());
     baselineGraph.Write("",TObject::kOverwrite);
-    key = "Baseline "+typestring+" "+sidestring;
-    vector<double>& baselineAverage = averages[key];
-    for(int j=0; j<fNevents; j++){
-      baselineAverage[j] += array[j];
-    }
-    sums[key]++;
   }
 
-  fTree->Draw("fEventNumber","","goff");
-
-  for(map<string, vector<double> >::iterator iter=averages.begin(); iter != averages.end(); iter++){
-    for(size_t j=0; j<iter->second.size(); j++){
-      (iter->second)[j] /= sums[iter->first];
-    }
-    TGraph averageGraph(fNevents,fTree->GetV1(),&((iter->second)[0]));
-    averageGraph.SetName(iter->first.c_str());
-    averageGraph.SetTitle(iter->first.c_str());
-    averageGraph.GetXaxis()->SetTitle("Event number");
-    if(iter->first.find("Baseline") != string::npos){
-      averageGraph.GetYaxis()->SetTitle("Baseline");
-      Baselinedir->cd();
-      averageGraph.Write("",TObject::kOverwrite);
-    }
-    else if(iter->first.find("Noise") != string::npos){
-      averageGraph.GetYaxis()->SetTitle("Noisecount");
-      Noisedir->cd();
-      averageGraph.Write("",TObject::kOverwrite);
-    }
-    else{
-      cout << "should not be here!" << endl;
-    }
+  for(int i=0; i<kNumPlanes; i++){
+    cout << "Noise " << GetPlaneName(i) << ": " << fPlaneNoiseStats[i].GetMean()
+         << " +- " << fPlaneNoiseStats[i].GetRMS() << "; baseline "
+         << fPlaneBaselineStats[i].GetMean() << " +- " << fPlaneBaselineStats[i].GetRMS() << endl;
   }
-
-  return kOk;
 }
 
 int EXONoiseCalculator::ShutDown()
 {
-  if(!fTree){
-    cout << "Error in EXONoiseCalculator::ShutDown(): No tree!" << endl;
-    return -1;
-  }
   if(!fFile){
     cout << "Error in EXONoiseCalculator::ShutDown(): No file!" << endl;
     return -1;
   }
 
   fFile->cd();
-  fTree->Write("",TObject::kOverwrite);
+  if(fTree) fTree->Write("",TObject::kOverwrite);
   fFile->Close();
   fTree = NULL;  //closing the file deletes the tree.
   delete fFile;
@@ -282,6 +325,9 @@ int EXONoiseCalculator::TalkTo(EXOTalkToManager *talktoManager)
   talktoManager->CreateCommand("/noisecalc/file","Base name of the output file", 
            this, fFilenameBase, &EXONoiseCalculator::SetFilenameBase);
 
+  talktoManager->CreateCommand("/noisecalc/writeTree","Write the per-event NoiseTree as well as the summary", 
+           this, fWriteTree, &EXONoiseCalculator::SetWriteTree);
+
   return 0;
 }
 
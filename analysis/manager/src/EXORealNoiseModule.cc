@@ -9,6 +9,15 @@
 // 2014/3/27 DCM: Fix to use TFile::Open to allow accessing remote files
 // 2015/4/14 DCM: Add option to skip adding noise for APDs, U-wires, or V-wires
 //
+// Noise bank: with /realnoise/noiseBank set, the noise file is converted
+// once into a flat file of decompressed, offset-subtracted samples (see
+// EXONoiseBank), which is memory-mapped and shared by all jobs on a node.
+// Adding noise then costs one pass over the waveform instead of reading and
+// decompressing a ROOT event.  The bank is rebuilt if it was made from a
+// different noise file (path, size or modification date).  /realnoise/randomTraces draws the noise trace for
+// each event at random (seeded by the run number) instead of using them in
+// turn.
+//
 // Purpose: Allows to generate root files composed of only noise traces 
 // (solicited triggeres) and then use this noise file as the source of
 // noise, to be added to simulation.  The generation occurs using the filter
@@ -30,6 +39,7 @@
 #include "TFile.h"
 #include "TTree.h"
 #include "TRandom3.h"
+#include "TParameter.h"
 using namespace std;
 
 IMPLEMENT_EXO_ANALYSIS_MODULE( EXORealNoiseModule, "realnoise" )
@@ -46,9 +56,11 @@ EXORealNoiseModule::EXORealNoiseModule()
   fSkipAPDs(false),
   fSkipVWires(false),
   fSkipUWires(false),
+  fRandomNoiseTraces(false),
   fNoiseFile(NULL),
   fNoiseTree(NULL),
-  fNoiseEventData(NULL)
+  fNoiseEventData(NULL),
+  fRandom(NULL)
 {
 
 }
@@ -59,6 +71,7 @@ EXORealNoiseModule::~EXORealNoiseModule()
     fNoiseFile->Close();
     delete fNoiseFile;
   }
+  delete fRandom;
 }
 
 EXOAnalysisModule::EventStatus EXORealNoiseModule::BeginOfRun(EXOEventData *ED)
@@ -79,14 +92,19 @@ EXOAnalysisModule::EventStatus EXORealNoiseModule::BeginOfRun(EXOEventData *ED)
     if(not fNoiseTree){
       LogEXOMsg("Could not find tree with name \"tree\" in file "+fNoiseFilenameParam,EEAlert);
     }
-    fNoiseTree->SetBranchAddress("EventBranch", &fNoiseEventData);
     fNumNoiseTraces = fNoiseTree->GetEntries();
+    if(not fNoiseBankFilename.empty() and OpenNoiseBank()) {
+      fNumNoiseTraces = fNoiseBank.GetNumTraces();
+    } else {
+      fNoiseTree->SetBranchAddress("EventBranch", &fNoiseEventData);
+    }
     cout << "Number of triggers in noise file to be used: " << fNumNoiseTraces << endl;
 
     // initialize noise index to start reading from random index
     // in file, to ensure we fully sample all traces
-    TRandom3 *r = new TRandom3(ED->fRunNumber);
-    fNoiseIndex = (int)(r->Rndm() * fNumNoiseTraces);
+    delete fRandom;
+    fRandom = new TRandom3(ED->fRunNumber);
+    fNoiseIndex = (int)(fRandom->Rndm() * fNumNoiseTraces);
   }
   
   return kOk;
@@ -125,14 +143,11 @@ EXOAnalysisModule::EventStatus EXORealNoiseModule::ProcessEvent(EXOEventData *ED
   }
 
   if (fUseNoiseFile){
+    int trace = NextNoiseTrace();
+    if (fNoiseBank.IsOpen()) return AddNoiseFromBank(ED->GetWaveformData(), trace);
+
     //Get the right event from the noise file
-    fNoiseTree->GetEntry(fNoiseIndex);
-    //Increment fNoiseIndex, modulo the total number of triggers in the file.
-    //Thus we loop around back to the beginning.
-    fNoiseIndex++;
-    if (fNoiseIndex >= fNumNoiseTraces){
-      fNoiseIndex = 0;
-    }
+    fNoiseTree->GetEntry(trace);
     
     //Get the waveform data object
     EXOWaveformData* noise_wf_data = fNoiseEventData->GetWaveformData();
@@ -149,9 +164,7 @@ EXOAnalysisModule::EventStatus EXORealNoiseModule::ProcessEvent(EXOEventData *ED
 
       // Allow user to skip APDs or wire channels individually (in case noise
       // has already been added in the digitizer for a given channel type)
-      if( fSkipAPDs && EXOMiscUtil::TypeOfChannel(wf.fChannel)==EXOMiscUtil::kAPDGang ) continue;
-      if( fSkipVWires && EXOMiscUtil::TypeOfChannel(wf.fChannel)==EXOMiscUtil::kVWire ) continue;
-      if( fSkipUWires && EXOMiscUtil::TypeOfChannel(wf.fChannel)==EXOMiscUtil::kUWire ) continue;
+      if( SkipChannel(wf.fChannel) ) continue;
 
       // must index by channel -- cannot assume indices the same between noise file and data
       const EXOWaveform& noise_wf = *noise_wf_data->GetWaveformWithChannel(wf.fChannel);
@@ -172,6 +185,79 @@ EXOAnalysisModule::EventStatus EXORealNoiseModule::ProcessEvent(EXOEventData *ED
   return kOk;
 }
 
+bool EXORealNoiseModule::SkipChannel(int channel) const
+{
+  EXOMiscUtil::EChannelType type = EXOMiscUtil::TypeOfChannel(channel);
+  return (fSkipAPDs && type==EXOMiscUtil::kAPDGang) or
+         (fSkipVWires && type==EXOMiscUtil::kVWire) or
+         (fSkipUWires && type==EXOMiscUtil::kUWire);
+}
+
+int EXORealNoiseModule::NextNoiseTrace()
+{
+  // Index of the noise trace for this event.  With fRandomNoiseTraces it is
+  // drawn at random; otherwise increment fNoiseIndex, modulo the total
+  // number of triggers in the file, so we loop around back to the beginning.
+  if (fRandomNoiseTraces) return fRandom->Integer(fNumNoiseTraces);
+  int trace = fNoiseIndex;
+  fNoiseIndex++;
+  if (fNoiseIndex >= fNumNoiseTraces){
+    fNoiseIndex = 0;
+  }
+  return trace;
+}
+
+bool EXORealNoiseModule::OpenNoiseBank()
+{
+  // Map the noise bank, building it first if it does not exist or was made
+  // from another noise file or offset.  Returns false if no bank could be
+  // used, in which case noise is read from the noise file.
+  EXONoiseBank::Source source(fNoiseFilenameParam, fNoiseFile->GetSize(),
+                              fNoiseFile->GetModificationDate().Convert());
+  if (fNoiseBank.Open(fNoiseBankFilename) and
+      fNoiseBank.Matches(source, fNoiseTree->GetEntries(), fOffset)) {
+    return true;
+  }
+  fNoiseBank.Close();
+  cout << "Building noise bank " << fNoiseBankFilename << " from " << fNoiseFilenameParam << endl;
+  if (not EXONoiseBank::Build(*fNoiseTree, fNoiseBankFilename, fOffset, source) or
+      not fNoiseBank.Open(fNoiseBankFilename)) {
+    LogEXOMsg("Reading noise from "+fNoiseFilenameParam+" instead of the noise bank",EEWarning);
+    return false;
+  }
+  return true;
+}
+
+EXOAnalysisModule::EventStatus EXORealNoiseModule::AddNoiseFromBank(EXOWaveformData* wf_data, int trace)
+{
+  // Add noise trace from the bank.  The bank samples already have fOffset
+  // subtracted, so this matches adding the noise waveform and removing the
+  // offset in ProcessEvent.
+  size_t length = wf_data->fNumSamples;
+  if ((wf_data->GetNumWaveforms() != fNoiseBank.GetNumChannels()) or (length != fNoiseBank.GetNumSamples())){
+    LogEXOMsg("noise file and simulation incompatible for this event",EEWarning);
+    return kDrop;
+  }
+  bool lostVCh119 = fNoiseBank.GetTriggerSeconds(trace) > 1516115373;
+  for (unsigned i=0; i < wf_data->GetNumWaveforms(); i++){
+    EXOWaveform& wf = *wf_data->GetWaveformToEdit(i);
+    if( SkipChannel(wf.fChannel) ) continue;
+
+    const Short_t* noise = fNoiseBank.GetTrace(trace, wf.fChannel);
+    if (not noise or wf.GetLength() != length){
+      LogEXOMsg("noise file and simulation incompatible for this event",EEWarning);
+      return kDrop;
+    }
+    if (lostVCh119 and wf.fChannel==119){
+      // See ProcessEvent: the signal is replaced by the noise.
+      for (size_t j=0; j < length; j++) wf[j] = noise[j] + fOffset;
+      continue;
+    }
+    EXONoiseBank::AddTo(wf.GetData(), noise, length);
+  }
+  return kOk;
+}
+
 EXOAnalysisModule::EventStatus EXORealNoiseModule::EndOfRun(EXOEventData *ED)
 {
   cout << "At EndOfRun for " << GetName() << endl;
@@ -182,6 +268,39 @@ EXOAnalysisModule::EventStatus EXORealNoiseModule::EndOfRun(EXOEventData *ED)
   return kOk;
 }
 
+bool EXORealNoiseModule::SaveCheckpoint(TDirectory& dir)
+{
+  // The position in the noise file is all the state carried between events.
+  // With random traces, the generator state is saved as well.
+  TParameter<Int_t> noiseIndex("noiseIndex", fNoiseIndex);
+  dir.WriteTObject(&noiseIndex);
+  if(fRandomNoiseTraces and fRandom) dir.WriteTObject(fRandom, "noiseRandom");
+  return true;
+}
+
+bool EXORealNoiseModule::RestoreCheckpoint(TDirectory& dir)
+{
+  // Continue with the noise trace following the one used last.  This is
+  // called after BeginOfRun, so it overrides the random starting index.
+  TParameter<Int_t>* noiseIndex = dynamic_cast<TParameter<Int_t>*>(dir.Get("noiseIndex"));
+  if(not noiseIndex) {
+    LogEXOMsg("Checkpoint does not contain the noise index", EEError);
+    return false;
+  }
+  fNoiseIndex = noiseIndex->GetVal();
+  delete noiseIndex;
+  if(fRandomNoiseTraces) {
+    TRandom3* random = dynamic_cast<TRandom3*>(dir.Get("noiseRandom"));
+    if(not random) {
+      LogEXOMsg("Checkpoint does not contain the noise trace generator", EEError);
+      return false;
+    }
+    delete fRandom;
+    fRandom = random;
+  }
+  return true;
+}
+
 int EXORealNoiseModule::TalkTo(EXOTalkToManager *talktoManager)
 {
 
@@ -206,6 +325,13 @@ int EXORealNoiseModule::TalkTo(EXOTalkToManager *talktoManager)
   talktoManager->CreateCommand("/realnoise/skipUWires","Skip U-wire channels when adding noise", 
            this, fSkipUWires, &EXORealNoiseModule::SetSkipUWires );
 
+  talktoManager->CreateCommand("/realnoise/noiseBank",
+           "noise bank file made from the noise file (built if missing); empty to read the noise file",
+           this, fNoiseBankFilename, &EXORealNoiseModule::SetNoiseBankFilename);
+
+  talktoManager->CreateCommand("/realnoise/randomTraces","Draw noise traces at random instead of in turn", 
+           this, fRandomNoiseTraces, &EXORealNoiseModule::SetRandomNoiseTraces );
+
   return 0;
 }
 
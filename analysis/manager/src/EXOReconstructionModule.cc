@@ -1,4 +1,5 @@
 #include "EXOAnalysisManager/EXOReconstructionModule.hh"
+#include "EXOAnalysisManager/EXOAnalysisProfiler.hh"
 #include "EXOReconstruction/EXOReconProcessList.hh"
 #include "EXOReconstruction/EXOUWireSignalModelBuilder.hh"
 #include "EXOReconstruction/EXOUWireIndSignalModelBuilder.hh"
@@ -11,12 +12,14 @@
 #include "EXOUtilities/EXOChannelMap.hh"
 #include "EXOUtilities/EXOTalkToManager.hh"
 #include "EXOUtilities/EXOControlRecordList.hh"
+#include "EXOUtilities/EXOHash.hh"
 #include "EXOCalibUtilities/EXOElectronicsShapers.hh"
 #include "EXOCalibUtilities/EXOVWireThresholds.hh"
 #include "EXOCalibUtilities/EXOChannelMapManager.hh"
 #include "EXOCalibUtilities/EXODriftVelocityCalib.hh"
 #include "EXOCalibUtilities/EXOCalibManager.hh"
 #include <iostream>
+#include <sstream>
 
 using EXOMiscUtil::TypeOfChannel;
 using EXOMiscUtil::ChannelIsUWire;
@@ -39,7 +42,11 @@ EXOReconstructionModule::EXOReconstructionModule()
   fCollectionVelocityTPC1(0), // per event
   fCollectionVelocityTPC2(0), // per event
   fZ_Separation(0.0*CLHEP::mm),
+  fReuseUnchangedSignals(false),
+  fHaveConfigurationHash(false),
+  fConfigurationHash(0),
   fRunFlavor(EXOBeginRecord::kUnknownFlavor),
+  fChannelMap(NULL),
   fSumBothAPDPlanes(false),
   fUWireScalingFactor(ADC_FULL_SCALE_ELECTRONS_WIRE * W_VALUE_LXE_EV_PER_ELECTRON /(CLHEP::keV * ADC_BITS)),
   fVWireScalingFactor(1.),
@@ -72,6 +79,10 @@ EXOReconstructionModule::EXOReconstructionModule()
   //fSignalExtractors.push_back(std::make_pair(&fVExtractor, 
    // RecProc(true, "v_wire_extractor"))); 
 
+  // The stages in the order of fStageHashes, see EReconStage.
+  fStageNames.push_back("signal_finding");
+  fStageNames.push_back("induction_signal_finding");
+  fStageNames.push_back("parameter_extraction");
 
   fTimingInfo.SetName("ReconStatistics");
   RegisterSharedObject(fTimingInfo.GetName(), fTimingInfo); 
@@ -103,6 +114,10 @@ int EXOReconstructionModule::Initialize()
   // Tell the parameter extractor(s) about the signal model manager
   INIT_RECONLIST(fSignalExtractors)
 
+  // The manager registers the commands of the job only after Initialize, so
+  // the configuration is hashed on the first event.
+  fHaveConfigurationHash = false;
+
   fTimingInfo.Clear();
   return 0;
 }
@@ -160,8 +175,9 @@ EXOAnalysisModule::EventStatus EXOReconstructionModule::ProcessEvent(EXOEventDat
   // Process event.
 
   ////////////////////////////////////////////////////////////
-  //Reset the EXOEventData object
-  ED->ResetForReconstruction();
+  //Reset the EXOEventData object, unless its signals may be reused
+  bool haveStoredSignals = fReuseUnchangedSignals and not ED->fReconProvenance.empty();
+  if (not haveStoredSignals) ED->ResetForReconstruction();
   ////////////////////////////////////////////////////////////
 
   fTimingInfo.Reset();
@@ -171,21 +187,21 @@ EXOAnalysisModule::EventStatus EXOReconstructionModule::ProcessEvent(EXOEventDat
   // TRIGGER_TIME
   int trig_offset = ED->fEventHeader.fTriggerOffset;
   if ( trig_offset > ED->GetWaveformData()->fNumSamples ) { 
-    LogEXOMsg("trigger time lies outside of trace", EEDebug);
-    return kDrop;
+    LogEXOMsgF(EEDebug, "trigger time lies outside of trace");
+    return DropEvent(ED, haveStoredSignals);
   }
   if (trig_offset > 0) {
     fUandAPDExtractor.SetTriggerSample( trig_offset );
   }
 
   if ( ED->GetWaveformData()->GetNumWaveforms() == 0 ) {
-    LogEXOMsg("no digitized data for this event", EEDebug);
-    return kDrop;
+    LogEXOMsgF(EEDebug, "no digitized data for this event");
+    return DropEvent(ED, haveStoredSignals);
   }
   // Do not skip events with saturated traces.  Allows reconstruction
   // to find additional interactions in traces containing TPC muons
   if ( ED->fHasSaturatedChannel ) { // Set by the noise tagger.
-    LogEXOMsg("ADC saturated by at least one channel", EEDebug);
+    LogEXOMsgF(EEDebug, "ADC saturated by at least one channel");
   }
   if ( ED->IsTaggedAsNoise() ) {
     if(fRunFlavor == EXOBeginRecord::kClbInt or
@@ -195,19 +211,19 @@ EXOAnalysisModule::EventStatus EXOReconstructionModule::ProcessEvent(EXOEventDat
       // So we want to ignore that flag in calibration runs.
       if(ED->IsTaggedAsNoise_Excluding(EXOEventData::kSummedWiresWentNegative)) {
         // OK, it's tagged as noise for a legitimate reason.
-        LogEXOMsg("Skipping event tagged as noise", EEDebug);
-        return kDrop;
+        LogEXOMsgF(EEDebug, "Skipping event tagged as noise");
+        return DropEvent(ED, haveStoredSignals);
       }
     }
     else {
       // Skip all data events with any noise tag.  (If you don't, you can get rogue events that cause problems.)
-      LogEXOMsg("Skipping event tagged as noise", EEDebug);
-      return kDrop;
+      LogEXOMsgF(EEDebug, "Skipping event tagged as noise");
+      return DropEvent(ED, haveStoredSignals);
     }
   } // End check of noise tags.
   if ( ED->fEventHeader.fSirenActiveInCR ) {
-    LogEXOMsg("Skipping event that occurred during clean room alarm", EEDebug);
-    return kDrop;
+    LogEXOMsgF(EEDebug, "Skipping event that occurred during clean room alarm");
+    return DropEvent(ED, haveStoredSignals);
   }
   if ( fSkipTruncatedData ) {
     if ( ED->fEventHeader.fIsMonteCarloEvent ) {
@@ -215,8 +231,8 @@ EXOAnalysisModule::EventStatus EXOReconstructionModule::ProcessEvent(EXOEventDat
     }
     else {
       if ( ED->GetWaveformData()->fNumSamples != 2048 ) {
-        LogEXOMsg("Skipping truncated event", EEDebug);
-        return kDrop;
+        LogEXOMsgF(EEDebug, "Skipping truncated event");
+        return DropEvent(ED, haveStoredSignals);
       }
     }
   } // end if ( fSkipTruncatedData )
@@ -271,46 +287,82 @@ EXOAnalysisModule::EventStatus EXOReconstructionModule::ProcessEvent(EXOEventDat
   SetDriftVelocity(ED);
   SetCollectionVelocity(ED);
 
-  processList.ResetIterator();
-  const EXOReconProcessList::WaveformWithType* wfWithType = NULL;
-  while ( (wfWithType = processList.GetNextWaveformAndType()) != NULL ) {
-    const EXOWaveform* wf = wfWithType->fWf;
-    int channel = wf->fChannel;
-    const EXOTransferFunction& tf = 
-      electronicsShapers->GetTransferFunctionForChannel(channel);
-
-    //std::cout << "Transfer function ch " << channel << " : D1 " << tf.GetDiffTime(0) << std::endl;
-
-    switch (wfWithType->fType) {
-      case EXOReconUtil::kUWire: 
-        fSignalModelManager.BuildSignalModelForChannelOrTag(
-          channel, EXOUWireSignalModelBuilder(tf));
-
-	// Also build a signal model for U Wire induction signals, denoted by negative channel
-        fSignalModelManager.BuildSignalModelForChannelOrTag(
-	  EXOReconUtil::kUWireIndOffset - channel, EXOUWireIndSignalModelBuilder(tf));
-        break;
-      case EXOReconUtil::kVWire:
-        if(EXOMiscUtil::GetTPCSide(channel) == EXOMiscUtil::kNorth) {
+  ////////////////////////////////////////////////////////////
+  // If the stored signals were made from the same inputs, keep them;
+  // otherwise reconstruct again from the first stage whose inputs changed,
+  // starting from the signals the stages before it stored.
+  if (not fHaveConfigurationHash) ComputeConfigurationHash();
+  ComputeStageHashes(*ED, processList, *electronicsShapers);
+  size_t firstStage = kSignalFinding;
+  EXOSignalCollection refinedSignals;
+  EXOSignalCollection refinedIndSignals;
+  if (haveStoredSignals) {
+    while (firstStage < kNumStages and firstStage < ED->fReconProvenance.size() and
+           ED->fReconProvenance[firstStage] == fStageHashes[firstStage]) firstStage++;
+    if (firstStage == kNumStages) {
+      // The clusters are rebuilt downstream from the signals.
+      ED->ResetClusters();
+      return kOk;
+    }
+    size_t pos = 0;
+    if (firstStage > kSignalFinding and
+        not (RestoreStageSignals(*ED, pos, refinedSignals) and
+             (firstStage == kInductionSignalFinding or
+              RestoreStageSignals(*ED, pos, refinedIndSignals)))) {
+      LogEXOMsg("The signals stored between stages are missing; reconstructing the whole event", EEWarning);
+      firstStage = kSignalFinding;
+      refinedSignals.Clear();
+      refinedIndSignals.Clear();
+    }
+    LogEXOMsgF(EEDebug, "Reconstructing again from stage %s", fStageNames[firstStage].c_str());
+    ED->ResetForReconstruction();
+  }
+  ////////////////////////////////////////////////////////////
+
+  if (firstStage <= kInductionSignalFinding) {
+    fTimingInfo.StartTimerForTag("signal_model_building");
+    processList.ResetIterator();
+    const EXOReconProcessList::WaveformWithType* wfWithType = NULL;
+    while ( (wfWithType = processList.GetNextWaveformAndType()) != NULL ) {
+      const EXOWaveform* wf = wfWithType->fWf;
+      int channel = wf->fChannel;
+      const EXOTransferFunction& tf = 
+        electronicsShapers->GetTransferFunctionForChannel(channel);
+
+      //std::cout << "Transfer function ch " << channel << " : D1 " << tf.GetDiffTime(0) << std::endl;
+
+      switch (wfWithType->fType) {
+        case EXOReconUtil::kUWire: 
           fSignalModelManager.BuildSignalModelForChannelOrTag(
-            channel, EXOVWireSignalModelBuilder(tf, fDriftVelocityTPC1, fCollectionVelocityTPC1, fZ_Separation));
-        }
-        else /* it's in the south */ {
+            channel, EXOUWireSignalModelBuilder(tf));
+
+	  // Also build a signal model for U Wire induction signals, denoted by negative channel
           fSignalModelManager.BuildSignalModelForChannelOrTag(
-            channel, EXOVWireSignalModelBuilder(tf, fDriftVelocityTPC2, fCollectionVelocityTPC2, fZ_Separation));
-        }
-        break;
-      case EXOReconUtil::kAPD: 
-        fSignalModelManager.BuildSignalModelForChannelOrTag(
-          channel, EXOAPDSignalModelBuilder(tf));
-        break;
-      case EXOReconUtil::kChargeInjection:
-        // Charge injection signals look like APD signals (or at least, treat them that way for now).
-        fSignalModelManager.BuildSignalModelForChannelOrTag(
-          channel, EXOChargeInjSignalModelBuilder(tf));
-        break;
-      default: break;
+	    EXOReconUtil::kUWireIndOffset - channel, EXOUWireIndSignalModelBuilder(tf));
+          break;
+        case EXOReconUtil::kVWire:
+          if(EXOMiscUtil::GetTPCSide(channel) == EXOMiscUtil::kNorth) {
+            fSignalModelManager.BuildSignalModelForChannelOrTag(
+              channel, EXOVWireSignalModelBuilder(tf, fDriftVelocityTPC1, fCollectionVelocityTPC1, fZ_Separation));
+          }
+          else /* it's in the south */ {
+            fSignalModelManager.BuildSignalModelForChannelOrTag(
+              channel, EXOVWireSignalModelBuilder(tf, fDriftVelocityTPC2, fCollectionVelocityTPC2, fZ_Separation));
+          }
+          break;
+        case EXOReconUtil::kAPD: 
+          fSignalModelManager.BuildSignalModelForChannelOrTag(
+            channel, EXOAPDSignalModelBuilder(tf));
+          break;
+        case EXOReconUtil::kChargeInjection:
+          // Charge injection signals look like APD signals (or at least, treat them that way for now).
+          fSignalModelManager.BuildSignalModelForChannelOrTag(
+            channel, EXOChargeInjSignalModelBuilder(tf));
+          break;
+        default: break;
+      }
     }
+    fTimingInfo.StopTimerForTag("signal_model_building");
   }
   ////////////////////////////////////////////////////////////
   
@@ -329,52 +381,56 @@ EXOAnalysisModule::EventStatus EXOReconstructionModule::ProcessEvent(EXOEventDat
   }
 
 
-  // Loop over the process lists, process if necessary
-  BEGIN_PROCESS_RECONLIST(fProcLists)
-    processList.Add(fProcLists[i].first->GetProcessList(processList));
-  END_PROCESS_RECONLIST(fProcLists)
+  if (firstStage == kSignalFinding) {
+    // Loop over the process lists, process if necessary
+    BEGIN_PROCESS_RECONLIST(fProcLists)
+      processList.Add(fProcLists[i].first->GetProcessList(processList));
+    END_PROCESS_RECONLIST(fProcLists)
 
-  ////////////////////////////////////////////////////////////
+    ////////////////////////////////////////////////////////////
 
-  ////////////////////////////////////////////////////////////
-  // Find signals
-  EXOSignalCollection foundSignals;
+    ////////////////////////////////////////////////////////////
+    // Find signals
+    EXOSignalCollection foundSignals;
 
-  BEGIN_PROCESS_RECONLIST(fSignalFinders)
-    foundSignals.Add(fSignalFinders[i].first->FindSignals(processList, foundSignals));
-  END_PROCESS_RECONLIST(fSignalFinders)
-  ////////////////////////////////////////////////////////////
+    BEGIN_PROCESS_RECONLIST(fSignalFinders)
+      foundSignals.Add(fSignalFinders[i].first->FindSignals(processList, foundSignals));
+    END_PROCESS_RECONLIST(fSignalFinders)
+    ////////////////////////////////////////////////////////////
   
-  ////////////////////////////////////////////////////////////
-  // Extract (refine) parameters from the found signals
-  EXOSignalCollection refinedSignals;
-  
-  const EXOSignalCollection* sigColl = &foundSignals;
-  BEGIN_PROCESS_RECONLIST(fSignalExtractors)
-    // Use found signals on the first run through.
-    refinedSignals.Add(fSignalExtractors[i].first->Extract(processList, *sigColl));
-    //sigColl = &refinedSignals;
-  END_PROCESS_RECONLIST(fSignalExtractors)
+    ////////////////////////////////////////////////////////////
+    // Extract (refine) parameters from the found signals
+    const EXOSignalCollection* sigColl = &foundSignals;
+    BEGIN_PROCESS_RECONLIST(fSignalExtractors)
+      // Use found signals on the first run through.
+      refinedSignals.Add(fSignalExtractors[i].first->Extract(processList, *sigColl));
+      //sigColl = &refinedSignals;
+    END_PROCESS_RECONLIST(fSignalExtractors)
+  } // end if (firstStage == kSignalFinding)
   ////////////////////////////////////////////////////////////
 
   // Now that we've found all the U-wire signals we can, go back and look for U-wire
   // induction signals on neighboring channels that are close in time
 
   //The following also fills EXODefineUWireIndProcessList::fCandidateSignalList
-  EXOSignalCollection refinedIndSignals;
-  if(fUWireAdjacentIndSigFindingEnabled){//then we should look for u-wire induction signals of some sort
-    EXOReconProcessList indProcessList=CompileUWireIndProcessList(processList,refinedSignals);
+  if (firstStage <= kInductionSignalFinding) {
+    fTimingInfo.StartTimerForTag("induction_signal_finding");
+    if(fUWireAdjacentIndSigFindingEnabled){//then we should look for u-wire induction signals of some sort
+      EXOReconProcessList indProcessList=CompileUWireIndProcessList(processList,refinedSignals);
 
-    //Find signals for the induction channels.
-    EXOSignalCollection foundIndSignals;
-    foundIndSignals.Add((&fMatchedFilterFinder)->FindSignals(indProcessList,foundIndSignals));
+      //Find signals for the induction channels.
+      EXOSignalCollection foundIndSignals;
+      foundIndSignals.Add((&fMatchedFilterFinder)->FindSignals(indProcessList,foundIndSignals));
 
-    const EXOSignalCollection *indSignalCollection=&foundIndSignals;
-    refinedIndSignals.Add((&fUandAPDExtractor)->Extract(indProcessList,*indSignalCollection));
+      const EXOSignalCollection *indSignalCollection=&foundIndSignals;
+      refinedIndSignals.Add((&fUandAPDExtractor)->Extract(indProcessList,*indSignalCollection));
+    }
+    fTimingInfo.StopTimerForTag("induction_signal_finding");
   }
 
   ////////////////////////////////////////////////////////////
   //Add all found signals to EXOEventData
+  fTimingInfo.StartTimerForTag("parameter_extraction");
   EXOAPDSignal::EXOAPDSignal_type apdSignalType = EXOAPDSignal::kPlaneFit;
   std::string apdTypeString = "plane_fit";
   if(fSumBothAPDPlanes){
@@ -526,11 +582,209 @@ EXOAnalysisModule::EventStatus EXOReconstructionModule::ProcessEvent(EXOEventDat
       }
     }
   }
+  fTimingInfo.StopTimerForTag("parameter_extraction");
+  ED->fReconProvenance = fStageHashes;
+  if (fReuseUnchangedSignals) {
+    StoreStageSignals(refinedSignals, *ED);
+    StoreStageSignals(refinedIndSignals, *ED);
+  }
 
   ////////////////////////////////////////////////////////////
+  RecordStageTimes();
   return kOk;
 }
 
+//______________________________________________________________________________
+void EXOReconstructionModule::ComputeConfigurationHash()
+{
+  // Hash the /rec/ commands of this job, in the order they were called.
+  // Which command belongs to which stage isn't known, so they all go into
+  // the first stage, and through it into the others.  Commands that don't
+  // change the signals are left out, and so are the scaling factors, which
+  // the later stages hash by value.  Called on the first event, once
+  // EXOAnalysisManager has registered "CommandsCalled".
+  fConfigurationHash = EXOHash::FNV1aBasis();
+  fHaveConfigurationHash = true;
+  const TObject* allCmds = FindObject("CommandsCalled");
+  if (not allCmds) return;
+  std::istringstream commands(allCmds->GetName());
+  std::string command;
+  while (std::getline(commands, command)) {
+    if (command.compare(0, 5, "/rec/") != 0) continue;
+    if (command.find("/rec/ReuseUnchangedSignals") == 0 or
+        command.find("/rec/show_stage_status") == 0 or
+        command.find("/rec/UWireScaling") == 0 or
+        command.find("/rec/VWireScaling") == 0 or
+        command.find("/rec/APDScaling") == 0) continue;
+    fConfigurationHash = EXOHash::FNV1a(fConfigurationHash, command);
+  }
+}
+
+//______________________________________________________________________________
+void EXOReconstructionModule::ComputeStageHashes(const EXOEventData& ED,
+  const EXOReconProcessList& processList, const EXOElectronicsShapers& electronicsShapers)
+{
+  // Compute the provenance hash of every stage for this event.  Each stage
+  // hashes the one before it, whose signals it starts from, and its own
+  // inputs:
+  //   signal_finding: the waveforms to be reconstructed, the /rec/ commands,
+  //     the calibrations (flavor and database serial number of the
+  //     electronics shapers, drift and collection velocities) and those
+  //     read by each process list, finder and extractor (HashInputs);
+  //   induction_signal_finding: its settings, the u-wire scaling it
+  //     bundles signals with, and the inputs of the finder and fitter;
+  //   parameter_extraction: the scaling factors.
+  // Signals stored with the same hashes came from the same inputs and
+  // configuration -- but not necessarily the same reconstruction code.
+  fStageHashes.assign(kNumStages, 0);
+  ULong64_t hash = EXOHash::FNV1aBasis();
+  hash = EXOHash::FNV1a(hash, &fConfigurationHash, sizeof(fConfigurationHash));
+  int runFlavor = fRunFlavor;
+  hash = EXOHash::FNV1a(hash, &runFlavor, sizeof(runFlavor));
+  hash = EXOHash::FNV1a(hash, &ED.fEventHeader.fTriggerOffset, sizeof(ED.fEventHeader.fTriggerOffset));
+
+  processList.ResetIterator();
+  const EXOReconProcessList::WaveformWithType* wfWithType = NULL;
+  while ( (wfWithType = processList.GetNextWaveformAndType()) != NULL ) {
+    const EXOWaveform& wf = *wfWithType->fWf;
+    int type = wfWithType->fType;
+    size_t length = wf.GetLength();
+    hash = EXOHash::FNV1a(hash, &wf.fChannel, sizeof(wf.fChannel));
+    hash = EXOHash::FNV1a(hash, &type, sizeof(type));
+    hash = EXOHash::FNV1a(hash, &length, sizeof(length));
+    hash = EXOHash::FNV1a(hash, wf.GetData(), length*sizeof(*wf.GetData()));
+  }
+
+  hash = EXOHash::FNV1a(hash, fElectronicsDatabaseFlavor);
+  unsigned int serial = electronicsShapers.getSerNo();
+  hash = EXOHash::FNV1a(hash, &serial, sizeof(serial));
+  serial = (fDriftStatus == kDatabase and fDriftVelocityCalib) ? fDriftVelocityCalib->getSerNo() : 0;
+  hash = EXOHash::FNV1a(hash, &serial, sizeof(serial));
+  double velocities[4] = {fDriftVelocityTPC1, fDriftVelocityTPC2,
+                          fCollectionVelocityTPC1, fCollectionVelocityTPC2};
+  hash = EXOHash::FNV1a(hash, velocities, sizeof(velocities));
+
+#define HASH_RECONLIST(alist)                                                 \
+  for (size_t i=0;i<alist.size();i++) {                                       \
+    hash = EXOHash::FNV1a(hash, alist[i].second.fName);                       \
+    hash = EXOHash::FNV1a(hash, &alist[i].second.fDoProcess, sizeof(bool));   \
+    hash = alist[i].first->HashInputs(hash);                                  \
+  }
+  HASH_RECONLIST(fProcLists)
+  HASH_RECONLIST(fSignalFinders)
+  HASH_RECONLIST(fSignalExtractors)
+  fStageHashes[kSignalFinding] = hash;
+
+  hash = EXOHash::FNV1a(hash, fStageNames[kInductionSignalFinding]);
+  hash = EXOHash::FNV1a(hash, &fUWireAdjacentIndSigFindingEnabled, sizeof(fUWireAdjacentIndSigFindingEnabled));
+  double induction[3] = {fInductionThresh, fUMatchTime, fUWireScalingFactor};
+  hash = EXOHash::FNV1a(hash, induction, sizeof(induction));
+  hash = fMatchedFilterFinder.HashInputs(hash);
+  hash = fUandAPDExtractor.HashInputs(hash);
+  fStageHashes[kInductionSignalFinding] = hash;
+
+  hash = EXOHash::FNV1a(hash, fStageNames[kParameterExtraction]);
+  double scaling[3] = {fUWireScalingFactor, fVWireScalingFactor, fAPDScalingFactor};
+  hash = EXOHash::FNV1a(hash, scaling, sizeof(scaling));
+  hash = EXOHash::FNV1a(hash, &fSumBothAPDPlanes, sizeof(fSumBothAPDPlanes));
+  fStageHashes[kParameterExtraction] = hash;
+}
+
+//______________________________________________________________________________
+void EXOReconstructionModule::StoreStageSignals(const EXOSignalCollection& signals,
+                                                EXOEventData& ED) const
+{
+  // Append signals, as passed from one stage to the next, to
+  // ED.fReconStageSignals, so that a later job can rerun only the stages
+  // after it.  Only what parameter extraction and induction signal finding
+  // read is kept: per channel the channel, behavior type, baseline and
+  // chi-square from the cache, and the time, magnitude and their errors of
+  // each signal.
+  std::vector<Double_t>& out = ED.fReconStageSignals;
+  out.push_back(signals.GetNumChannelSignals());
+  signals.ResetIterator();
+  const EXOChannelSignals* chanSig = NULL;
+  while ((chanSig = signals.Next()) != NULL) {
+    out.push_back(chanSig->GetChannel());
+    out.push_back(chanSig->GetBehaviorType());
+    out.push_back(chanSig->GetCacheInformationFor("Baseline"));
+    out.push_back(chanSig->GetCacheInformationFor("BaselineError"));
+    out.push_back(chanSig->GetCacheInformationFor("ChiSquare"));
+    out.push_back(chanSig->GetCacheInformationFor("ChiSquareRestr"));
+    out.push_back(chanSig->GetNumSignals());
+    chanSig->ResetIterator();
+    const EXOSignal* sig = NULL;
+    while ((sig = chanSig->Next()) != NULL) {
+      out.push_back(sig->fTime);
+      out.push_back(sig->fTimeError);
+      out.push_back(sig->fMagnitude);
+      out.push_back(sig->fMagnitudeError);
+    }
+  }
+}
+
+//______________________________________________________________________________
+bool EXOReconstructionModule::RestoreStageSignals(const EXOEventData& ED, size_t& pos,
+                                                  EXOSignalCollection& signals) const
+{
+  // Read back, from position pos of ED.fReconStageSignals, signals written
+  // by StoreStageSignals, and advance pos past them.  Returns false if they
+  // are missing or cut short.
+  const std::vector<Double_t>& in = ED.fReconStageSignals;
+  if (pos >= in.size()) return false;
+  size_t numChannels = size_t(in[pos++]);
+  for (size_t i=0;i<numChannels;i++) {
+    if (pos + 7 > in.size()) return false;
+    EXOChannelSignals chanSig;
+    chanSig.SetChannel(int(in[pos]));
+    chanSig.SetBehaviorType(EXOReconUtil::ESignalBehaviorType(int(in[pos+1])));
+    chanSig.SetCacheInformationFor("Baseline", in[pos+2]);
+    chanSig.SetCacheInformationFor("BaselineError", in[pos+3]);
+    chanSig.SetCacheInformationFor("ChiSquare", in[pos+4]);
+    chanSig.SetCacheInformationFor("ChiSquareRestr", in[pos+5]);
+    size_t numSignals = size_t(in[pos+6]);
+    pos += 7;
+    if (pos + 4*numSignals > in.size()) return false;
+    for (size_t j=0;j<numSignals;j++) {
+      EXOSignal sig;
+      sig.fTime = in[pos++];
+      sig.fTimeError = in[pos++];
+      sig.fMagnitude = in[pos++];
+      sig.fMagnitudeError = in[pos++];
+      chanSig.AddSignal(sig);
+    }
+    signals.AddChannelSignal(chanSig);
+  }
+  return true;
+}
+
+//______________________________________________________________________________
+EXOAnalysisModule::EventStatus EXOReconstructionModule::DropEvent(EXOEventData *ED,
+                                                                  bool haveStoredSignals)
+{
+  // Drop an event before reconstructing it.  If its stored signals were kept
+  // for reuse, clear them (and their provenance) now, so that the modules
+  // after this one do not see, or write out, the previous reconstruction.
+  if (haveStoredSignals) ED->ResetForReconstruction();
+  return kDrop;
+}
+
+//______________________________________________________________________________
+void EXOReconstructionModule::RecordStageTimes()
+{
+  // Pass the stage timers of this event (the stages themselves as well as
+  // the timers set inside them, e.g. "u_and_apd_fitter.FitAndGetChiSquare")
+  // on to the profiler.  Timers of stages that did not run this event are
+  // left out, rather than counted as taking no time.
+  EXOAnalysisProfiler& profiler = EXOAnalysisProfiler::GetProfiler();
+  if(not profiler.IsEnabled()) return;
+  for(size_t i = 0; i < fTimingInfo.GetNumberOfTimers(); i++) {
+    EXOStopwatch* watch = fTimingInfo.GetTimerAt(i);
+    if(not watch->WasStartedSinceReset()) continue;
+    profiler.RecordStage(std::string("rec.") + watch->GetName(), watch->RealTime());
+  }
+}
+
 //______________________________________________________________________________
 int EXOReconstructionModule::TalkTo(EXOTalkToManager *talktoManager)
 {
@@ -682,6 +936,18 @@ int EXOReconstructionModule::TalkTo(EXOTalkToManager *talktoManager)
                                fZ_Separation,
                                &EXOReconstructionModule::SetZ_Separation);
 
+  talktoManager->CreateCommand("/rec/UseSignalModelTables",
+                               "Tabulate the signal models with band-limited interpolation and use the tables in the signal fits",
+                               &fSignalModelManager,
+                               false,
+                               &EXOSignalModelManager::SetBuildModelTables);
+
+  talktoManager->CreateCommand("/rec/ReuseUnchangedSignals",
+                               "Keep the signals of input events whose stored provenance hashes match, instead of reconstructing them again",
+                               this,
+                               fReuseUnchangedSignals,
+                               &EXOReconstructionModule::SetReuseUnchangedSignals);
+
   return 0;
 }
 
@@ -14,7 +14,6 @@
 #include "EXOUtilities/EXOUWireSignal.hh"
 #include "EXOReconstruction/EXOReconUtil.hh"
 
-using EXOMiscUtil::ParameterMap;
 
 IMPLEMENT_EXO_ANALYSIS_MODULE(EXORisetimeModule, "risetime")
 
@@ -82,8 +81,7 @@ EXOAnalysisModule::EventStatus EXORisetimeModule::ProcessEvent(EXOEventData* ED)
     }
    
     // subtract baseline
-    ParameterMap noiseAndBaseline = fBaselineCalculator.ExtractAll(DoubleWF);
-    DoubleWF -= noiseAndBaseline["Baseline"];
+    DoubleWF -= fBaselineCalculator.Extract(DoubleWF, EXOBaselineAndNoiseCalculator::kBaseline);
     
     fExtremumFinder.Transform(&DoubleWF);
 
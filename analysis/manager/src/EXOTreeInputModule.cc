@@ -34,6 +34,19 @@
 // For more information on how to access the record list, see the
 // EXOControlRecordList documentation.
 //
+// Only the parts of EXOEventData declared by the modules in the chain (see
+// EXOAnalysisModule::GetEventDataReads) are read from the tree; the analysis
+// manager passes their union to SetEventDataUsage.  If a later module
+// declares a part that was not read, EnsureEventDataLoaded reads just those
+// branches for the current entry before that module is called.  To read
+// every branch regardless, do:
+//
+//   /tinput/selectiveReading false
+//
+// The position in the input (current file, entry and the files still to
+// process) is saved in checkpoints of the analysis manager, so a job can be
+// resumed from where the checkpoint was written.  Control records of files
+// that were finished before the checkpoint are not read again.
 //
 // See also EXOInputModule for more information.
 //______________________________________________________________________________
@@ -47,6 +60,9 @@
 #include "TH1.h"
 #include "TFile.h"
 #include "TTree.h"
+#include "TBranch.h"
+#include "TObjString.h"
+#include "TParameter.h"
 
 #if defined(STATIC) && defined(LINKXROOTD)
 #include "TXNetFile.h"
@@ -56,10 +72,35 @@ using namespace std;
 
 IMPLEMENT_EXO_ANALYSIS_MODULE( EXOTreeInputModule, "tinput" )
 
+namespace {
+  // Name of the sub-branch of the event branch holding a given part of
+  // EXOEventData.
+  std::string GetBranchNameOfPart(unsigned int part)
+  {
+    switch(part) {
+      case EXOAnalysisModule::kEventHeader: return "fEventHeader";
+      case EXOAnalysisModule::kMonteCarloData: return "fMonteCarloData";
+      case EXOAnalysisModule::kMCPixelatedCharge: return "fMonteCarloData.fPixelatedChargeDeposits";
+      case EXOAnalysisModule::kWaveformData: return EXOMiscUtil::GetWaveformBranchName();
+      case EXOAnalysisModule::kUWireSignals: return "fUWires";
+      case EXOAnalysisModule::kUWireInductionSignals: return "fUWiresInduction";
+      case EXOAnalysisModule::kVWireSignals: return "fVWires";
+      case EXOAnalysisModule::kAPDSignals: return "fAPDs";
+      case EXOAnalysisModule::kChargeInjectionSignals: return "fChargeInjectionSignals";
+      case EXOAnalysisModule::kChargeClusters: return "fChargeClusters";
+      case EXOAnalysisModule::kScintClusters: return "fScintClusters";
+      default: return "";
+    }
+  }
+}
+
 EXOTreeInputModule::EXOTreeInputModule() : 
   fRootFile(NULL),
   fRootTree(NULL),
-  fCurrentEventID(-1)
+  fCurrentEventID(-1),
+  fSelectiveReading(true),
+  fEventDataUsage(kAllEventData),
+  fLoadedParts(kAllEventData)
 {
   TH1::AddDirectory(kFALSE);
   fEventData = new EXOEventData();
@@ -145,6 +186,9 @@ void EXOTreeInputModule::OpenFile(const std::string& filename)
   // out of order data access intialization
   fCurrentEventID = -1; // no data available yet
 
+  // Only read the branches that are used.
+  ApplyBranchStatus();
+
   // Also get the glitch tree
   RetractObject(EXOMiscUtil::GetGlitchTreeName());
   TTree *aTree = dynamic_cast<TTree*>(fRootFile->Get(EXOMiscUtil::GetGlitchTreeName().c_str()));
@@ -223,7 +267,7 @@ EXOEventData* EXOTreeInputModule::GetEvent(unsigned int event)
   }
 
   // Decompress waveforms
-  fEventData->GetWaveformData()->Decompress();
+  if (fLoadedParts & kWaveformData) fEventData->GetWaveformData()->Decompress();
   fCurrentEventID = event;
   return fEventData;
 
@@ -299,6 +343,12 @@ int EXOTreeInputModule::TalkTo(EXOTalkToManager* tm)
                     this, 
                     "", 
                     &EXOTreeInputModule::AddFilesToProcess);
+
+  tm->CreateCommand("/tinput/selectiveReading",
+                    "Only read the parts of the event declared by the used modules",
+                    this, 
+                    fSelectiveReading, 
+                    &EXOTreeInputModule::SetSelectiveReading);
   return 0;
 
 }
@@ -319,3 +369,150 @@ bool EXOTreeInputModule::FileIsOpen() const
   // Return true if this module currently has a file opened, false otherwise.
   return (fRootFile and fRootFile->IsOpen());
 }
+
+//______________________________________________________________________________
+void EXOTreeInputModule::SetSelectiveReading(bool aval)
+{
+  // Turn selective reading of the event branch on or off.  When off, every
+  // branch is read regardless of what the modules declare.
+  fSelectiveReading = aval;
+  ApplyBranchStatus();
+}
+
+//______________________________________________________________________________
+void EXOTreeInputModule::SetEventDataUsage(unsigned int parts)
+{
+  // Set the parts of EXOEventData (mask of EXOAnalysisModule::EventDataPart)
+  // to read for every event.  This is called by EXOAnalysisManager with the
+  // union of the parts declared by all modules.
+  fEventDataUsage = (parts & kAllEventData);
+  ApplyBranchStatus();
+}
+
+//______________________________________________________________________________
+void EXOTreeInputModule::SetPartStatus(unsigned int part, bool status)
+{
+  // Enable or disable the branches holding one part of EXOEventData.
+  // Branches missing from (older) files are skipped.
+  std::string name = GetBranchNameOfPart(part);
+  if (name == "" or fRootTree->GetBranch(name.c_str()) == NULL) return;
+  // Don't use "name*", fUWires* would also match fUWiresInduction.
+  fRootTree->SetBranchStatus(name.c_str(), status);
+  fRootTree->SetBranchStatus((name + ".*").c_str(), status);
+}
+
+//______________________________________________________________________________
+void EXOTreeInputModule::ApplyBranchStatus()
+{
+  // Enable only the branches of the parts in use.  Everything else in the
+  // event branch (run and event numbers, flags, noise tags) is always read.
+  unsigned int parts = (fSelectiveReading ? fEventDataUsage : kAllEventData);
+  fLoadedParts = parts;
+  if (fRootTree == NULL) return;
+  fRootTree->SetBranchStatus("*", 1);
+  if (parts == kAllEventData) return;
+
+  // The parts are ordered so that the pixelated charge deposits are handled
+  // after the rest of the MC data, which contains them.
+  for (unsigned int part = 1; part < kAllEventData; part <<= 1) {
+    SetPartStatus(part, parts & part);
+  }
+}
+
+//______________________________________________________________________________
+void EXOTreeInputModule::EnsureEventDataLoaded(unsigned int parts)
+{
+  // Read those of parts which were not read for the current entry.  Only the
+  // missing branches are read, so changes made to the event by previous
+  // modules are left untouched.  The branches then stay enabled, so the
+  // parts are read directly for the following entries.
+  unsigned int missing = parts & kAllEventData & ~fLoadedParts;
+  if (missing == 0 or fRootTree == NULL or fCurrentEventID < 0) return;
+
+  for (unsigned int part = 1; part < kAllEventData; part <<= 1) {
+    if (not (missing & part)) continue;
+    SetPartStatus(part, true);
+    TBranch* branch = fRootTree->GetBranch(GetBranchNameOfPart(part).c_str());
+    if (branch == NULL) continue;
+
+    // Reading the MC data reads the pixelated charge deposits too; don't
+    // overwrite them if they are already there.
+    bool protectPCDs = (part == kMonteCarloData and (fLoadedParts & kMCPixelatedCharge));
+    if (protectPCDs) SetPartStatus(kMCPixelatedCharge, false);
+    if (branch->GetEntry(fCurrentEventID) < 0) {
+      LogEXOMsg("incomplete data fetching of branch " + GetBranchNameOfPart(part), EEAlert);
+    }
+    if (protectPCDs) SetPartStatus(kMCPixelatedCharge, true);
+    if (part == kWaveformData) fEventData->GetWaveformData()->Decompress();
+    fLoadedParts |= part;
+  }
+}
+
+//______________________________________________________________________________
+bool EXOTreeInputModule::SaveCheckpoint(TDirectory& dir)
+{
+  // Save the current file, the current entry and the files still to be
+  // processed.
+  if (not FileIsOpen()) {
+    LogEXOMsg("No file open, can not save the input position", EEError);
+    return false;
+  }
+  TObjString file(fRootFile->GetName());
+  dir.WriteTObject(&file, "file");
+  TParameter<Long64_t> entry("entry", fCurrentEventID);
+  dir.WriteTObject(&entry);
+  TObjArray remaining;
+  remaining.SetOwner(kTRUE);
+  for (std::list<std::string>::const_iterator iter = fFiles.begin(); 
+       iter != fFiles.end(); iter++) {
+    remaining.Add(new TObjString(iter->c_str()));
+  }
+  dir.WriteTObject(&remaining, "remaining", "SingleKey");
+  return true;
+}
+
+//______________________________________________________________________________
+bool EXOTreeInputModule::RestoreCheckpoint(TDirectory& dir)
+{
+  // Open the file that was being read when the checkpoint was written and
+  // continue after the last entry processed.
+  TObjString* file = dynamic_cast<TObjString*>(dir.Get("file"));
+  TParameter<Long64_t>* entry = dynamic_cast<TParameter<Long64_t>*>(dir.Get("entry"));
+  TObjArray* remaining = dynamic_cast<TObjArray*>(dir.Get("remaining"));
+  if (not file or not entry or not remaining) {
+    LogEXOMsg("Checkpoint does not contain an input position", EEError);
+    return false;
+  }
+
+  bool ok = true;
+  if (not FileIsOpen() or file->GetString() != fRootFile->GetName()) {
+    try {
+      SetFilename(file->GetString().Data());
+    }
+    catch (EXOMiscUtil::EXOBadCommand& badCommand) {
+      LogEXOMsg(badCommand.what(), EEError);
+      ok = false;
+    }
+  }
+  if (ok and entry->GetVal() >= fRootTree->GetEntriesFast()) {
+    LogEXOMsg(Form("Checkpoint entry %lld is beyond the end of %s", 
+              entry->GetVal(), fRootFile->GetName()), EEError);
+    ok = false;
+  }
+  if (ok) {
+    fFiles.clear();
+    for (Int_t i=0; i<remaining->GetEntriesFast(); i++) {
+      fFiles.push_back(remaining->At(i)->GetName());
+    }
+    // The next call to GetNextEvent reads the entry after the saved one.
+    fCurrentEventID = entry->GetVal();
+    cout << "Resuming " << fRootFile->GetName() << " after entry " 
+         << fCurrentEventID << endl;
+  }
+
+  remaining->Delete();
+  delete remaining;
+  delete entry;
+  delete file;
+  return ok;
+}
@@ -12,6 +12,7 @@
 #include "TTree.h"
 #include "TFile.h"
 #include "TH1.h"
+#include "TParameter.h"
 // These are normally set by the build file
 #ifndef BUILD_ID
 #define BUILD_ID "Unknown";
@@ -35,7 +36,8 @@ EXOTreeOutputModule::EXOTreeOutputModule() :
   fRootTree(NULL),
   fStatisticsTree(NULL),
   fRootFile(NULL),
-  fLastEvent(NULL)
+  fLastEvent(NULL),
+  fCheckpointing(false)
 {
 
   TH1::AddDirectory(kFALSE);
@@ -43,6 +45,8 @@ EXOTreeOutputModule::EXOTreeOutputModule() :
   
 int EXOTreeOutputModule::Initialize()
 {
+  if ( FindObject("ResumeCheckpoint") ) return InitializeForResume();
+
   fRootFile = new TFile(fOutputFilename.c_str(),"RECREATE");
   if ( fRootFile == NULL or fRootFile->IsZombie() ) {
       LogEXOMsg("Error opening: " + fOutputFilename, EEAlert); // terminates
@@ -86,6 +90,89 @@ int EXOTreeOutputModule::Initialize()
   return 0;
 }
 
+int EXOTreeOutputModule::InitializeForResume()
+{
+  // The analysis manager resumes from a checkpoint, continue the trees of the
+  // existing output file.  Their entries are checked against the checkpoint
+  // in RestoreCheckpoint.
+  if ( fMaxFileSize > 0 ) {
+    LogEXOMsg("Resuming is not supported for output split by /toutput/maxFileSize", EEAlert);
+  }
+  fRootFile = new TFile(fOutputFilename.c_str(),"UPDATE");
+  if ( fRootFile == NULL or fRootFile->IsZombie() ) {
+      LogEXOMsg("Error opening: " + fOutputFilename, EEAlert); // terminates
+  }
+  fRootTree = dynamic_cast<TTree*>(fRootFile->Get(EXOMiscUtil::GetEventTreeName().c_str()));
+  fStatisticsTree = dynamic_cast<TTree*>(fRootFile->Get(EXOMiscUtil::GetStatisticsTreeName().c_str()));
+  if ( fRootTree == NULL or fStatisticsTree == NULL ) {
+    LogEXOMsg("No trees to continue in " + fOutputFilename, EEAlert);
+  }
+  fLastEvent = NULL;
+
+  TObjArray statInfo = FindSharedObjectsOfType(EXOTimingStatisticInfo::Class());
+  TIter iter(&statInfo);
+  EXOTimingStatisticInfo* stat;
+  while ((stat = (EXOTimingStatisticInfo*)iter.Next())) {
+    if ( fStatisticsTree->SetBranchAddress(stat->GetName(), stat) < 0 ) {
+      LogEXOMsg(std::string("No statistics branch ") + stat->GetName() + " to continue", EEAlert);
+    }
+  }
+  fRootFile->SetCompressionLevel(EXOMiscUtil::GetTreeCompressionLevel());
+  fCheckpointing = true;
+  return 0;
+}
+
+bool EXOTreeOutputModule::SaveCheckpoint(TDirectory& dir)
+{
+  // Write the headers of the trees to the file, so the entries filled so far
+  // can be recovered, and save the number of entries.  The trees are not
+  // saved automatically in between, so after a crash the file is left
+  // exactly as it was at the last checkpoint.
+  if ( not fCheckpointing ) {
+    fRootTree->SetAutoSave(0);
+    fStatisticsTree->SetAutoSave(0);
+    fCheckpointing = true;
+  }
+  TDirectory* oldDir = gDirectory;
+  fRootTree->AutoSave("SaveSelf");
+  fStatisticsTree->AutoSave("SaveSelf");
+  fRootFile->Flush();
+  oldDir->cd();
+
+  TParameter<Long64_t> entries("entries", fRootTree->GetEntries());
+  dir.WriteTObject(&entries);
+  TParameter<Long64_t> statEntries("statEntries", fStatisticsTree->GetEntries());
+  dir.WriteTObject(&statEntries);
+  return true;
+}
+
+bool EXOTreeOutputModule::RestoreCheckpoint(TDirectory& dir)
+{
+  // Check that the trees continued in InitializeForResume hold what was
+  // written up to the checkpoint.
+  TParameter<Long64_t>* entries = dynamic_cast<TParameter<Long64_t>*>(dir.Get("entries"));
+  TParameter<Long64_t>* statEntries = dynamic_cast<TParameter<Long64_t>*>(dir.Get("statEntries"));
+  bool ok = (entries and statEntries);
+  if ( not ok ) {
+    LogEXOMsg("Checkpoint does not contain the output tree entries", EEError);
+  }
+  else if ( fRootTree->GetEntries() != entries->GetVal() or
+            fStatisticsTree->GetEntries() != statEntries->GetVal() ) {
+    LogEXOMsg(Form("%s holds %lld entries, the checkpoint expects %lld",
+              fOutputFilename.c_str(), fRootTree->GetEntries(), entries->GetVal()), EEError);
+    ok = false;
+  }
+  if ( ok ) {
+    fRootTree->SetAutoSave(0);
+    fStatisticsTree->SetAutoSave(0);
+    std::cout << "Continuing " << fOutputFilename << " after entry " 
+              << fRootTree->GetEntries() << std::endl;
+  }
+  delete entries;
+  delete statEntries;
+  return ok;
+}
+
 EXOAnalysisModule::EventStatus EXOTreeOutputModule::ProcessEvent(EXOEventData *ED)
 {
 
@@ -166,6 +253,16 @@ EXOAnalysisModule::EventStatus EXOTreeOutputModule::ProcessEvent(EXOEventData *E
   return kOk;
 }
 
+unsigned int EXOTreeOutputModule::GetEventDataReads() const
+{
+  // Everything that gets written must be read; waveforms and MC charge
+  // deposits are only needed if they will be written.
+  unsigned int parts = kAllEventData;
+  if (not fWriteSignals) parts &= ~kWaveformData;
+  if (not fWriteMCCharge) parts &= ~kMCPixelatedCharge;
+  return parts;
+}
+
 int EXOTreeOutputModule::TalkTo(EXOTalkToManager *talktoManager)
 {
 
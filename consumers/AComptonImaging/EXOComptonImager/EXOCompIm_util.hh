@@ -27,6 +27,24 @@ namespace ComptonIm
   Double_t Zcoord(Double_t x, Double_t y, Double_t z);
 
   void ReportError(const char * funcName, int code);
+
+  //Counter-based random numbers: the n-th number of the stream (seed, id) 
+  //is a hash of the seed, the id and n, so any number of streams can be 
+  //used in parallel and each gives the same numbers wherever it is used.
+  class StreamRandom
+  {
+    public:
+      StreamRandom(UInt_t seed, ULong64_t id);
+      Double_t Rndm();   //uniform in (0, 1]
+      Double_t Uniform(Double_t max) { return max*Rndm(); }
+      Double_t Gaus(Double_t mean, Double_t sigma);
+
+    private:
+      ULong64_t fKey;
+      ULong64_t fCounter;
+      Double_t fNextGaus;
+      bool fHaveNextGaus;
+  };
 }
 
 #endif
@@ -28,6 +28,7 @@ class EXOComptonInfo;
 #include "Rtypes.h"
 #include "EXOComptonImager/EXOCompIm_util.hh"
 #include <string>
+#include <vector>
 
 class EXOComptonImager
 {
@@ -75,12 +76,21 @@ class EXOComptonImager
     void SetExcludeTPC(bool exclude);
     void SetSpatialCut(const char * cut);
 
+    //Back-project the cones of GetFilled3DHist with several threads (when 
+    //built with threads). Every event draws its cones from its own random 
+    //stream, determined by the seed and its entry number, so the image 
+    //does not depend on the number of threads.
+    void SetNumThreads(int num);
+    void SetSeed(UInt_t seed);
+
     //Get various parameters
     Double_t     GetBinWidth()    const;
     unsigned int GetNumToAccept() const;
     bool         GetExcludeTPC()  const;
     TString      GetSpatialCut()  const;
     TString      GetTreeCut()     const;
+    int          GetNumThreads()  const;
+    UInt_t       GetSeed()        const;
 
     //Return the distance that a cone must have to a point to qualify as 
     //"passing through" the given point.
@@ -94,6 +104,30 @@ class EXOComptonImager
     int CalcNumCones(Double_t length);
     void MakeCirclesForEndcaps(Double_t radius);
 
+    //An accepted event of Fill3DHistMC
+    struct ConeEvent
+    {
+      Long64_t fEntry;
+      Double_t fMean[7];   //ordering: x1, y1, z1, x2, y2, z2, phi
+      Double_t fErr[7];
+      int fNumCones;
+    };
+
+    //The events fFirst, fFirst + fStep, ... of Fill3DHistMC, back-projected 
+    //into a private voxel grid. The weights are summed in fixed point, so 
+    //that adding the grids of all threads gives the same image in any order.
+    struct BackProjection
+    {
+      size_t fFirst;
+      size_t fStep;
+      TFormula * fSpatialCut;
+      std::vector<Long64_t> fSumW;
+      std::vector<Long64_t> fSumW2;
+      Long64_t fNumFills;
+    };
+    void BackProject(const std::vector<ConeEvent> & events, Double_t size, 
+                     Int_t nBins, BackProjection & part) const;
+
     EXOComptonImager(const EXOComptonImager &);
     EXOComptonImager & operator=(const EXOComptonImager &);
 
@@ -153,6 +187,9 @@ class EXOComptonImager
     unsigned int fNumToAccept;
     unsigned int fPtsPerBin;
 
+    int fNumThreads;
+    UInt_t fSeed;
+
     bool fExcludeTPC;
 
     bool fDoPlusZEndcap;
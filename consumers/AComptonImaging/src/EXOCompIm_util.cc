@@ -7,6 +7,19 @@
 
 #include <iostream>
 
+namespace
+{
+  const ULong64_t gfGolden = 0x9E3779B97F4A7C15ULL;
+
+  //Finalizer of SplitMix64
+  ULong64_t Mix(ULong64_t z)
+  {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+}
+
 namespace ComptonIm
 {
 
@@ -84,4 +97,34 @@ namespace ComptonIm
     std::endl(std::cout);
     return;
   }
+
+  StreamRandom::StreamRandom(UInt_t seed, ULong64_t id) :
+  fKey(Mix(Mix(seed + gfGolden) ^ id)),
+  fCounter(0),
+  fNextGaus(0.),
+  fHaveNextGaus(false)
+  {}
+
+  Double_t StreamRandom::Rndm()
+  {
+    ++fCounter;
+    //53 random bits
+    return static_cast<Double_t>((Mix(fKey + fCounter*gfGolden) >> 11) + 1)
+           /9007199254740992.;
+  }
+
+  Double_t StreamRandom::Gaus(Double_t mean, Double_t sigma)
+  {
+    //Box-Muller; the second number is kept for the next call.
+    if (fHaveNextGaus)
+    {
+      fHaveNextGaus = false;
+      return mean + sigma*fNextGaus;
+    }
+    const Double_t r = sqrt(-2.*log(Rndm()));
+    const Double_t phi = twoPi*Rndm();
+    fNextGaus = r*sin(phi);
+    fHaveNextGaus = true;
+    return mean + sigma*r*cos(phi);
+  }
 }
@@ -7,11 +7,18 @@
 #include "TGraph.h"
 #include "TH2D.h"
 #include "TH3D.h"
+#include "TArrayD.h"
 #include "TMath.h"
 #include "TRandom3.h"
 #include "TTree.h"
 #include "TTreeFormula.h"
 
+#ifdef USE_THREADS
+#include "boost/thread/thread.hpp"
+#include "boost/bind.hpp"
+#endif
+
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
@@ -36,6 +43,16 @@ const Double_t EXOComptonImager::fTPCLENGTH = 408.814;
 const Double_t EXOComptonImager::fMINBINWIDTH = 1.;
 const int EXOComptonImager::fMAXCONES = 1000;
 
+namespace
+{
+  //Fixed-point units of the weights (and squared weights) summed by 
+  //EXOComptonImager::BackProject. Integer sums do not depend on the order 
+  //of the additions; the weights are at least 0.1, so the rounding is below
+  //1e-7 of a weight, and a voxel can hold some 1e10 (1e12) of them.
+  const Double_t gfWeightScale = 268435456.;   //2^28
+  const Double_t gfWeight2Scale = 1048576.;    //2^20
+}
+
 EXOComptonImager::ComptonCone::ComptonCone(const EXOComptonImager & imager) : 
 fImager(imager),
 fIsSet(false)
@@ -228,6 +245,8 @@ void EXOComptonImager::Init()
   fBinWidth = 15.;
   fNumToAccept = 0;
   fPtsPerBin = 4;
+  fNumThreads = 1;
+  fSeed = 4357;
   fExcludeTPC = true;
   fDoPlusZEndcap = true;
   fDoMinusZEndcap = true;
@@ -551,6 +570,12 @@ void EXOComptonImager::SetBinWidth(Double_t binWidth)
 void EXOComptonImager::SetNumToAccept(unsigned int num)
 { fNumToAccept = num; return; }
 
+void EXOComptonImager::SetNumThreads(int num)
+{ fNumThreads = (num < 1) ? 1 : num; return; }
+
+void EXOComptonImager::SetSeed(UInt_t seed)
+{ fSeed = seed; return; }
+
 void EXOComptonImager::SetExcludeTPC(bool exclude)
 {
   if (exclude == fExcludeTPC) return;
@@ -587,6 +612,12 @@ TString EXOComptonImager::GetSpatialCut() const
 TString EXOComptonImager::GetTreeCut() const
 { return fTreeCutForm->GetExpFormula(); }
 
+int EXOComptonImager::GetNumThreads() const
+{ return fNumThreads; }
+
+UInt_t EXOComptonImager::GetSeed() const
+{ return fSeed; }
+
 Double_t EXOComptonImager::Close() const
 { return fBinWidth*fPROXFACTOR; }
 
@@ -618,20 +649,10 @@ int EXOComptonImager::Fill3DHistMC(Double_t size)
   
   const unsigned int numEvents 
     = static_cast<unsigned int>(fEvents->GetEntries());
-  //ordering: x1, y1, z1, x2, y2, z2, phi
-  Double_t cone[7];
 
-  TRandom3 * random = new TRandom3();
-
-  //len and theta are the parameters for the cones. len is distance 
-  //along the cone's side and theta is the azimuthal angle.
-  Double_t len, theta, lenMax, x, y, z, w;
-  //The parameter width determines how closely the point-mesh 
-  //generating algorithm places points on the cone. As can be 
-  //seen, width is determined by the bin widths of fSpace.
-  const Double_t width = fBinWidth;
-  int numCones, numPoints, numTheta;
-  bool allOut, allIn; 
+  //Reading the tree is serial: collect the accepted events first.
+  std::vector<ConeEvent> events;
+  int numCones;
   const Double_t ptsPerUnitArea = 5.;
   const Double_t length = 2.*Sqrt(xmax*xmax + ymax*ymax + zmax*zmax);;
   const unsigned int numToAccept 
@@ -647,20 +668,133 @@ int EXOComptonImager::Fill3DHistMC(Double_t size)
     numAccepted++;
     if (numAccepted%10 == 0) std::cout << std::setw(5) << numAccepted 
                                        << " events accepted." << std::endl;
-    w = fCONENORM/static_cast<Double_t>(numCones);
+
+    ConeEvent event;
+    event.fEntry = i;
+    event.fNumCones = numCones;
+    event.fMean[0] = fComptonInfo->fX1;  event.fErr[0] = fComptonInfo->fX1Err;
+    event.fMean[1] = fComptonInfo->fY1;  event.fErr[1] = fComptonInfo->fY1Err;
+    event.fMean[2] = fComptonInfo->fZ1;  event.fErr[2] = fComptonInfo->fZ1Err;
+    event.fMean[3] = fComptonInfo->fX2;  event.fErr[3] = fComptonInfo->fX2Err;
+    event.fMean[4] = fComptonInfo->fY2;  event.fErr[4] = fComptonInfo->fY2Err;
+    event.fMean[5] = fComptonInfo->fZ2;  event.fErr[5] = fComptonInfo->fZ2Err;
+    event.fMean[6] = fComptonInfo->fHalfAnglePhi;
+    event.fErr[6] = fComptonInfo->fHalfAnglePhiErr;
+    events.push_back(event);
+  }
+
+  //Each thread gets its own grid and copy of the spatial cut; the calling 
+  //thread does the first share.
+  size_t numThreads = 1;
+#ifdef USE_THREADS
+  numThreads = std::max(size_t(1), std::min(size_t(std::max(fNumThreads, 1)), 
+                                            events.size()));
+#endif
+  std::vector<BackProjection> parts(numThreads);
+  for (size_t t = 0; t < numThreads; t++)
+  {
+    parts[t].fFirst = t;
+    parts[t].fStep = numThreads;
+    parts[t].fSpatialCut = (t == 0) ? fSpatialCutForm 
+                                    : new TFormula(*fSpatialCutForm);
+  }
+#ifdef USE_THREADS
+  boost::thread_group threads;
+  for (size_t t = 1; t < numThreads; t++)
+    threads.create_thread(boost::bind(&EXOComptonImager::BackProject, this, 
+                                      boost::cref(events), size, nBins, 
+                                      boost::ref(parts[t])));
+#endif
+  BackProject(events, size, nBins, parts[0]);
+#ifdef USE_THREADS
+  threads.join_all();
+#endif
+
+  //Reduce the grids and convert back from fixed point
+  Long64_t numFills = 0;
+  std::vector<Long64_t> & sumW = parts[0].fSumW;
+  std::vector<Long64_t> & sumW2 = parts[0].fSumW2;
+  for (size_t t = 0; t < numThreads; t++)
+  {
+    numFills += parts[t].fNumFills;
+    if (t == 0) continue;
+    for (size_t v = 0; v < sumW.size(); v++)
+    {
+      sumW[v] += parts[t].fSumW[v];
+      sumW2[v] += parts[t].fSumW2[v];
+    }
+    delete parts[t].fSpatialCut;
+  }
+
+  fSpace->Sumw2();
+  TArrayD & spaceSumw2 = *fSpace->GetSumw2();
+  for (Int_t iz = 0; iz < zbins; iz++)
+  {
+    for (Int_t iy = 0; iy < ybins; iy++)
+    {
+      for (Int_t ix = 0; ix < xbins; ix++)
+      {
+        const size_t v = (static_cast<size_t>(iz)*ybins + iy)*xbins + ix;
+        if (sumW2[v] == 0) continue;
+        const Int_t bin = fSpace->GetBin(ix+1, iy+1, iz+1);
+        fSpace->SetBinContent(bin, sumW[v]/gfWeightScale);
+        spaceSumw2[bin] = sumW2[v]/gfWeight2Scale;
+      }
+    }
+  }
+  fSpace->ResetStats();
+  fSpace->SetEntries(numFills);
+
+  fSpace->Scale(1./ptsPerUnitArea);
+  return 0;
+}
+
+void EXOComptonImager::BackProject(const std::vector<ConeEvent> & events, 
+                                   Double_t size, Int_t nBins, 
+                                   BackProjection & part) const
+{
+  const Double_t xmax = static_cast<Double_t>(nBins)*fBinWidth;
+  const Double_t xmin = -1.*xmax;
+  const Double_t ymax = xmax;
+  const Double_t ymin = xmin;
+  const Double_t zmax = xmax;
+  const Double_t zmin = xmin;
+  const Double_t binsPerUnit = nBins/(xmax - xmin);
+
+  part.fSumW.assign(static_cast<size_t>(nBins)*nBins*nBins, 0);
+  part.fSumW2.assign(part.fSumW.size(), 0);
+  part.fNumFills = 0;
+
+  ComptonCone compCone(*this);
+  //ordering: x1, y1, z1, x2, y2, z2, phi
+  Double_t cone[7];
+
+  //len and theta are the parameters for the cones. len is distance 
+  //along the cone's side and theta is the azimuthal angle.
+  Double_t len, theta, lenMax, x, y, z, w, utility;
+  Long64_t fixedW, fixedW2;
+  //The parameter width determines how closely the point-mesh 
+  //generating algorithm places points on the cone. As can be 
+  //seen, width is determined by the bin widths of fSpace.
+  const Double_t width = fBinWidth;
+  int numPoints, numTheta;
+  bool allOut, allIn; 
+  const Double_t ptsPerUnitArea = 5.;
+  for (size_t i = part.fFirst; i < events.size(); i += part.fStep)
+  {
+    const ConeEvent & event = events[i];
+    StreamRandom random(fSeed, event.fEntry);
+    w = fCONENORM/static_cast<Double_t>(event.fNumCones);
+    fixedW = static_cast<Long64_t>(w*gfWeightScale + 0.5);
+    fixedW2 = static_cast<Long64_t>(w*w*gfWeight2Scale + 0.5);
 
     //Loop over randomly generated cones
-    for (int j = 0; j < numCones; j++)
+    for (int j = 0; j < event.fNumCones; j++)
     {
       //Randomize cone variables.
-      cone[0] = random->Gaus(fComptonInfo->fX1, fComptonInfo->fX1Err);
-      cone[1] = random->Gaus(fComptonInfo->fY1, fComptonInfo->fY1Err);
-      cone[2] = random->Gaus(fComptonInfo->fZ1, fComptonInfo->fZ1Err);
-      cone[3] = random->Gaus(fComptonInfo->fX2, fComptonInfo->fX2Err);
-      cone[4] = random->Gaus(fComptonInfo->fY2, fComptonInfo->fY2Err);
-      cone[5] = random->Gaus(fComptonInfo->fZ2, fComptonInfo->fZ2Err);
-      cone[6] = random->Gaus(fComptonInfo->fHalfAnglePhi, fComptonInfo->fHalfAnglePhiErr);
-      fCompCone.SetCone(cone);
+      for (int k = 0; k < 7; k++) 
+        cone[k] = random.Gaus(event.fMean[k], event.fErr[k]);
+      compCone.SetCone(cone);
 
       //Determine lenMax -- very important
       lenMax = 4.*Sqrt(xmax*xmax + ymax*ymax + zmax*zmax);
@@ -669,7 +803,7 @@ int EXOComptonImager::Fill3DHistMC(Double_t size)
       {
         allIn = true;
         lenMax /= 1.5;
-        utility = 1.1*lenMax*Sin(fCompCone.GetParam(6))*twoPi;
+        utility = 1.1*lenMax*Sin(compCone.GetParam(6))*twoPi;
         utility /= width;
         numTheta = static_cast<int>(Abs(utility));
         ++numTheta;
@@ -677,7 +811,7 @@ int EXOComptonImager::Fill3DHistMC(Double_t size)
         {
           theta = twoPi*static_cast<Double_t>(k);
           theta /= static_cast<Double_t>(numTheta);
-          fCompCone.Evaluate(lenMax,theta,x,y,z);
+          compCone.Evaluate(lenMax,theta,x,y,z);
           if (x > xmax || x < xmin || y > ymax || y < ymin 
               || z > zmax || z < zmin)
           {
@@ -691,7 +825,7 @@ int EXOComptonImager::Fill3DHistMC(Double_t size)
       {
         allOut = true;
         lenMax *= 1.05;
-        utility = 1.1*lenMax*Sin(fCompCone.GetParam(6))*twoPi;
+        utility = 1.1*lenMax*Sin(compCone.GetParam(6))*twoPi;
         utility /= width;
         numTheta = static_cast<int>(Abs(utility));
         ++numTheta;
@@ -699,7 +833,7 @@ int EXOComptonImager::Fill3DHistMC(Double_t size)
         {
           theta = twoPi*static_cast<Double_t>(k);
           theta /= static_cast<Double_t>(numTheta);
-          fCompCone.Evaluate(lenMax,theta,x,y,z);
+          compCone.Evaluate(lenMax,theta,x,y,z);
           if (x < xmax && x > xmin && y < ymax && y > ymin 
               && z < zmax && z > zmin)
           {
@@ -710,32 +844,36 @@ int EXOComptonImager::Fill3DHistMC(Double_t size)
       }
 
       //constant #/unit surface area
-      utility = Abs(pi*lenMax*lenMax*Sin(fCompCone.GetParam(6)));
+      utility = Abs(pi*lenMax*lenMax*Sin(compCone.GetParam(6)));
       utility /= width*width;
       utility *= ptsPerUnitArea;
       numPoints = static_cast<int>(utility);
 
       for (int k = 0; k < numPoints; k++)
       {
-        len = random->Uniform(lenMax*lenMax);
+        len = random.Uniform(lenMax*lenMax);
         len = Sqrt(len);
-        theta = random->Uniform(twoPi);
+        theta = random.Uniform(twoPi);
 
-        fCompCone.Evaluate(len,theta,x,y,z);
+        compCone.Evaluate(len,theta,x,y,z);
 
-        if (fSpatialCutForm->Eval(x,y,z) < 0.5) continue;
+        if (part.fSpatialCut->Eval(x,y,z) < 0.5) continue;
         if (x > xmax || x < xmin || y > ymax || y < ymin 
             || z > zmax || z < zmin)
         { continue; }
 
-        fSpace->Fill(x,y,z,w);
+        //Same bins as TAxis::FindBin; the upper edges are overflow.
+        const Int_t ix = static_cast<Int_t>((x - xmin)*binsPerUnit);
+        const Int_t iy = static_cast<Int_t>((y - ymin)*binsPerUnit);
+        const Int_t iz = static_cast<Int_t>((z - zmin)*binsPerUnit);
+        part.fNumFills++;
+        if (ix >= nBins || iy >= nBins || iz >= nBins) continue;
+        const size_t v = (static_cast<size_t>(iz)*nBins + iy)*nBins + ix;
+        part.fSumW[v] += fixedW;
+        part.fSumW2[v] += fixedW2;
       }
     }
   }
-
-  fSpace->Scale(1./ptsPerUnitArea);
-  delete random;
-  return 0;
 }
 
 int EXOComptonImager::DoCylinder(Double_t length, Double_t radius)
@@ -4,6 +4,7 @@
 #include "EXOReconstruction/EXOVDefineReconProcessList.hh"
 #include "EXOUtilities/EXOWaveform.hh"
 #include "EXOUtilities/EXOFrequencyPeakFilter.hh"
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
 #include <map>
 #include <string>
 
@@ -13,6 +14,7 @@ class EXODefineCrossProductProcessList: public EXOVDefineReconProcessList
     EXODefineCrossProductProcessList();
     typedef std::map<int,EXOWaveform> WFMap;
     typedef std::map<int,EXOFrequencyPeakFilter> FilterMap;
+    typedef std::map<std::string,FilterMap> FilterCache;
     virtual EXOReconProcessList GetProcessList(const EXOReconProcessList& inputList) const;
     void SetFile(const std::string filename);
     void SetNSigma(double nsigma);
@@ -23,8 +25,13 @@ class EXODefineCrossProductProcessList: public EXOVDefineReconProcessList
     void ProcessVerbosity(const EXOWaveform& raw, const EXOWaveform& filtered) const;
 
   protected:
+    std::string GetFilterKey() const;
+    bool BuildFilters(FilterMap& filters) const;
+
     mutable WFMap fWFMap;
-    mutable FilterMap fFilterMap;
+    mutable FilterCache fFilterCache;    // Filters for each correlation file and settings
+    mutable std::string fFilterKey;      // Key of the current filters in fFilterCache
+    mutable EXOWaveformWorkspace fWorkspace;
     std::string fFilename;
     double fNSigma;
     int fNBins;
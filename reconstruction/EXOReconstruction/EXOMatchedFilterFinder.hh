@@ -8,6 +8,7 @@
 #include "EXOUtilities/EXOWaveformData.hh"
 #include "EXOUtilities/EXOMatchedFilter.hh"
 #include "EXOUtilities/EXOSavitzkyGolaySmoother.hh"
+#include "EXOUtilities/EXOHash.hh"
 #include "TH1D.h"
 #include "TF1.h"
 #include "TFile.h"
@@ -51,6 +52,8 @@ class EXOMatchedFilterFinder : public EXOVSignalFinder
     void SetWireNoiseFilename(std::string val);
     void SetAPDNoiseFilename(std::string val);
     void SetDataTakingPhase(std::string val);
+
+    ULong64_t HashInputs(ULong64_t hash) const;
    
   
 
@@ -116,7 +119,9 @@ class EXOMatchedFilterFinder : public EXOVSignalFinder
     EXOWaveformData* fWireNoiseWfd;
     EXOWaveformData* fAPDNoiseWfd;
     std::string fDataTakingPhase;
+    ULong64_t fNoiseHash; // Hash of the loaded noise spectra
     void LoadNoiseFiles();
+    static ULong64_t HashNoise(ULong64_t hash, const EXOWaveformData& wfd);
     void ReplaceAll(std::string &str, std::string target, std::string sub);
 
     bool SkipChannel(const EXOReconProcessList::WaveformWithType* wfWithType) const {
@@ -274,6 +279,7 @@ inline void EXOMatchedFilterFinder::ReplaceAll(std::string &str, std::string tar
 
 inline void EXOMatchedFilterFinder::LoadNoiseFiles()
 {
+  fNoiseHash = EXOHash::FNV1aBasis();
   if (fAPDNoiseFilenameParam != "") {
     ReplaceAll(fAPDNoiseFilenameParam,"*",fDataTakingPhase);
     /*
@@ -293,6 +299,7 @@ inline void EXOMatchedFilterFinder::LoadNoiseFiles()
    
     fAPDNoiseWfd = (EXOWaveformData *) fAPDNoiseFile->Get("EXOWaveformData");
     fAPDNoiseWfd->Decompress();    
+    fNoiseHash = HashNoise(fNoiseHash, *fAPDNoiseWfd);
   }
 
   if (fWireNoiseFilenameParam != "") {
@@ -314,6 +321,7 @@ inline void EXOMatchedFilterFinder::LoadNoiseFiles()
    
     fWireNoiseWfd = (EXOWaveformData *) fWireNoiseFile->Get("EXOWaveformData");
     fWireNoiseWfd->Decompress();
+    fNoiseHash = HashNoise(fNoiseHash, *fWireNoiseWfd);
   }
 }
 
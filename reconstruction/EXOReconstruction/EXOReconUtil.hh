@@ -10,9 +10,12 @@
 //   EDerivedTypes : derived signal type, i.e. signals derived from other
 //   signals
 //
+// and the peak search shared by the signal finders, FindLocalMaxima.
+//
 // For new derived types, users should add a new named enum to EDerivedTypes. 
 //______________________________________________________________________________
 #include <string>
+#include <vector>
 #include <cstddef> //for size_t
 #include "EXOUtilities/EXOVWaveformExtractor.hh"
 
@@ -42,6 +45,12 @@ namespace EXOReconUtil
     kMaxBaselineCalculationIterations = 20
   };
 
+  // Fill maxima with the indices, in increasing order, of the local maxima
+  // of data[0, length) above threshold; with useAbsoluteValue, of |data|.
+  // Returns the number found.
+  size_t FindLocalMaxima(const double* data, size_t length, double threshold,
+                         std::vector<size_t>& maxima, bool useAbsoluteValue = false);
+
 } 
 
 #endif /* EXOReconUtil_hh */
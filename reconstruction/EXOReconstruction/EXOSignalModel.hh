@@ -4,6 +4,7 @@
 #include "EXOUtilities/EXOWaveform.hh"
 #include "EXOReconstruction/EXOReconUtil.hh"
 #include "EXOUtilities/EXOTransferFunction.hh"
+#include "EXOReconstruction/EXOSignalModelTable.hh"
 
 #include <cstddef> //for size_t
 
@@ -17,6 +18,8 @@ private:
   // should be allowed to Initialize this class.  The public interface is
   // entirely const.
   friend class EXOVSignalModelBuilder;
+  // EXOSignalModelManager builds the model table, if asked to.
+  friend class EXOSignalModelManager;
 
   Int_t fChannelOrTag;
   EXOReconUtil::ESignalBehaviorType fBehaviorType;
@@ -24,6 +27,7 @@ private:
   // Transform applied by this channel
   EXOTransferFunction fTransferFunction;
   EXODoubleWaveform fShapedModel;
+  EXOSignalModelTable fModelTable;
 
   mutable TF1* fSignalModelFunction;
 
@@ -57,6 +61,9 @@ public:
     { return fTransferFunction; }
   const EXODoubleWaveform& GetModelWaveform() const 
     { return fShapedModel; }
+  // Empty unless EXOSignalModelManager::SetBuildModelTables was called.
+  const EXOSignalModelTable& GetModelTable() const
+    { return fModelTable; }
 };
 
 //______________________________________________________________________________
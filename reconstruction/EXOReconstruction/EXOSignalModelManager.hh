@@ -9,8 +9,12 @@ class EXOVSignalModelBuilder;
 class EXOSignalModelManager
 {
   public:
+    EXOSignalModelManager() : fBuildModelTables(false) {}
     ~EXOSignalModelManager();
 
+    // Build an EXOSignalModelTable for every signal model.
+    void SetBuildModelTables(bool build) { fBuildModelTables = build; }
+
     void BuildSignalModelForChannelOrTag(
       int channelOrTag, 
       const EXOVSignalModelBuilder& signalBuilder);
@@ -27,6 +31,7 @@ class EXOSignalModelManager
 
     SignalModelMap        fSignalModelMap; // Map of the held signal models
     RegObjList            fRegisteredObjs; // list of registered objects
+    bool                  fBuildModelTables;
     mutable std::set<int> fDerivedChannelNumbers; // cache which tracks which
 						  // channels/tags are set
 						  // using
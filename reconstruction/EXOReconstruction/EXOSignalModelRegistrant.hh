@@ -1,6 +1,7 @@
 #ifndef EXOSignalModelRegistrant_hh
 #define EXOSignalModelRegistrant_hh
 #include "EXOReconstruction/EXORecVerbose.hh"
+#include "Rtypes.h"
 #include <string>
 
 class EXOSignalModelManager;
@@ -21,6 +22,12 @@ class EXOSignalModelRegistrant
     void SetPrefixName(const std::string& aname) 
       { fPrefix = aname; }
 
+    // Continue hash (see EXOHash) with the inputs other than the waveforms
+    // and the /rec/ commands -- calibrations, noise spectra -- that this
+    // stage reads.  Used for the provenance of the reconstructed signals.
+    // Default is to add nothing.
+    virtual ULong64_t HashInputs(ULong64_t hash) const { return hash; }
+
   protected:
 
     friend class EXOSignalModelManager;
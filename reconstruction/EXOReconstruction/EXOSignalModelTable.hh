@@ -0,0 +1,43 @@
+#ifndef EXOSignalModelTable_hh
+#define EXOSignalModelTable_hh
+
+#include "EXOUtilities/EXOTemplWaveform.hh"
+#include <vector>
+#include <cstddef> //for size_t
+
+class EXOSignalModelTable
+{
+  public:
+    EXOSignalModelTable();
+
+    // Tabulate model at oversampling phases between its samples, with
+    // windowed-sinc interpolation using halfWidth samples on either side.
+    void Build(const EXODoubleWaveform& model, size_t oversampling = 16,
+               size_t halfWidth = 4);
+    void Clear();
+    bool IsBuilt() const { return not fRows.empty(); }
+
+    // The model at time, for a signal at time 0 with magnitude 1.
+    double Evaluate(double time) const;
+
+    // Add numSignals signals to array[0, length), whose samples are at
+    // arrayStartTime + k*arrayPeriod.  parameters holds the magnitude and
+    // time of each signal in turn, as in EXOSignalModel::SignalSum.  Returns
+    // false, adding nothing, unless arrayPeriod is a multiple of the period
+    // of the model.
+    bool AddSignalsToArray(double* array, size_t length,
+                           double arrayStartTime, double arrayPeriod,
+                           const double* parameters, size_t numSignals) const;
+
+  private:
+    void AddSignalToArray(double* array, size_t length, double startIndex,
+                          size_t stride, double magnitude) const;
+
+    std::vector<double> fRows;   // Row r holds the model at index j + r/fOversampling
+    size_t fLength;              // Length of a row, that of the model
+    size_t fOversampling;
+    double fTOffset;             // Timing of the model
+    double fSamplingFreq;
+};
+
+#endif /* EXOSignalModelTable_hh */
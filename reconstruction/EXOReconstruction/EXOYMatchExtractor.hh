@@ -19,6 +19,7 @@ class EXOYMatchExtractor: public EXOVSignalParameterExtractor
     void SetThresholdFactor(double val){fThresholdFactor = val;}
     void SetThreshold(double val){fThreshold = val;}
     void SetThresholds(const EXOVWireThresholds* val){fThresholds = val;}
+    ULong64_t HashInputs(ULong64_t hash) const;
 
   protected:
     void SetupTalkTo(const std::string& prefix, EXOTalkToManager* talkTo);
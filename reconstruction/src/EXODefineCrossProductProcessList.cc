@@ -1,14 +1,31 @@
+//______________________________________________________________________________
+// EXODefineCrossProductProcessList
+//
+// Removes noise peaks from the APD waveforms: for each APD channel, the
+// frequencies at which the channel is strongly correlated with the other
+// APD channels (from an EXOCorrelationCollection) are cut with an
+// EXOFrequencyPeakFilter.
+//
+// The filters only depend on the correlation file and the filter settings;
+// they are built once for each combination and kept, so switching between
+// correlation files (e.g. from run to run) does not rebuild them.  The APD
+// waveforms of an event are filtered together: all forward transforms, then
+// the masks, then all inverse transforms, sharing one FFT plan.
+//______________________________________________________________________________
+
 #include "EXOReconstruction/EXODefineCrossProductProcessList.hh"
 #include "EXOReconstruction/EXOReconProcessList.hh"
 #include "EXOUtilities/EXODimensions.hh"
 #include "EXOUtilities/EXOMiscUtil.hh"
 #include "EXOUtilities/EXOCorrelationCollection.hh"
 #include "EXOUtilities/EXOTalkToManager.hh"
+#include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
 #include "TFile.h"
 #include "TObject.h"
 #include "TH1D.h"
 #include <sstream>
 #include <vector>
+#include <complex>
 
 using namespace std;
 
@@ -66,6 +83,11 @@ EXOReconProcessList EXODefineCrossProductProcessList::GetProcessList(const EXORe
     return retList;
   }
   
+  // Collect the APD waveforms and their filters.
+  FilterCache::const_iterator cached = fFilterCache.find(fFilterKey);
+  const FilterMap* filters = (cached == fFilterCache.end()) ? NULL : &cached->second;
+  vector<const EXOWaveform*> apds;
+  vector<const EXODoubleWaveform*> masks;
   inputList.ResetIterator();
   const EXOReconProcessList::WaveformWithType* wfWithType = NULL;
   while((wfWithType = inputList.GetNextWaveformAndType()) != NULL){
@@ -77,21 +99,56 @@ EXOReconProcessList EXODefineCrossProductProcessList::GetProcessList(const EXORe
     if(wfWithType->fType != EXOReconUtil::kAPD) continue;
 
     int channel = wf->fChannel;
-    EXODoubleWaveform doubleWf = wf->Convert<Double_t>();
-    FilterMap::const_iterator filter = fFilterMap.find(channel);
-    if(filter == fFilterMap.end()){
+    FilterMap::const_iterator filter;
+    if(not filters or (filter = filters->find(channel)) == filters->end()){
       stringstream str;
       str << "Filter for channel " << channel << " was not created";
       LogEXOMsg(str.str(),EEAlert);
+      continue;
+    }
+    const EXODoubleWaveform& mask = filter->second.GetFilter();
+    if(wf->GetLength()/2 + 1 != mask.GetLength()){
+      LogEXOMsg("Waveform length incompatible to filter!",EEError);
+      masks.push_back(NULL);
     }
-    filter->second.Transform(&doubleWf);
-    EXOWaveform& filteredWf = fWFMap[channel];
-    filteredWf.MakeSimilarTo(*wf);
-    filteredWf.fChannel = wf->fChannel;
+    else masks.push_back(&mask);
+    apds.push_back(wf);
+  }
+
+  // Forward transforms of all channels.
+  EXOWaveformWorkspace::Frame frame(fWorkspace);
+  vector<double*> arrays(apds.size(), (double*)NULL);
+  for(size_t i=0; i<apds.size(); i++){
+    if(not masks[i]) continue;
+    const EXOWaveform& wf = *apds[i];
+    arrays[i] = static_cast<double*>(fWorkspace.GetFFTArray(wf.GetLength()));
+    for(size_t j=0; j<wf.GetLength(); j++) arrays[i][j] = wf[j];
+    EXOFastFourierTransformFFTW::GetFFT(wf.GetLength()).PerformFFT_inplace(arrays[i]);
+  }
+
+  // Cut the masked frequencies.
+  for(size_t i=0; i<apds.size(); i++){
+    if(not masks[i]) continue;
+    const EXODoubleWaveform& mask = *masks[i];
+    complex<double>* spectrum = reinterpret_cast<complex<double>*>(arrays[i]);
+    for(size_t f=0; f<mask.GetLength(); f++) spectrum[f] *= mask[f];
+  }
+
+  // Inverse transforms, normalized as in EXOFrequencyPeakFilter.
+  for(size_t i=0; i<apds.size(); i++){
+    const EXOWaveform& wf = *apds[i];
+    EXOWaveform& filteredWf = fWFMap[wf.fChannel];
+    filteredWf.MakeSimilarTo(wf);
+    filteredWf.fChannel = wf.fChannel;
     filteredWf.Zero();
-    filteredWf.SetData(doubleWf.GetData(),doubleWf.GetLength());
+    if(masks[i]){
+      EXOFastFourierTransformFFTW::GetFFT(wf.GetLength()).PerformInverseFFT_inplace(arrays[i]);
+      double scale = 1.0/double(wf.GetLength());
+      for(size_t j=0; j<wf.GetLength(); j++) filteredWf[j] = Int_t(arrays[i][j]*scale);
+    }
+    else filteredWf.SetData(wf.GetData(), wf.GetLength());
     retList.Add(filteredWf,EXOReconUtil::kAPD);
-    ProcessVerbosity(*wf,filteredWf);
+    ProcessVerbosity(wf,filteredWf);
   }
   return retList;
 }
@@ -123,17 +180,37 @@ void EXODefineCrossProductProcessList::ProcessVerbosity(const EXOWaveform& raw,
   }
 }
 
+std::string EXODefineCrossProductProcessList::GetFilterKey() const
+{
+  // Identifies the correlation file and settings the filters depend on.
+  stringstream key;
+  key << fFilename << '\n' << fCollectionName << '\n' << fNSigma << '\n' << fNBins;
+  return key.str();
+}
+
 void EXODefineCrossProductProcessList::UpdateFilters() const
+{
+  // Select the filters for the current correlation file and settings,
+  // building them the first time this combination is used.
+  fFilterKey = GetFilterKey();
+  if(fFilterCache.count(fFilterKey) > 0) return;
+  FilterCache::iterator cached = fFilterCache.insert(make_pair(fFilterKey, FilterMap())).first;
+  if(not BuildFilters(cached->second)){
+    fFilterCache.erase(cached);
+  }
+}
+
+bool EXODefineCrossProductProcessList::BuildFilters(FilterMap& filters) const
 {
   TFile file(fFilename.c_str(),"READ");
   if(file.IsZombie()){
     LogEXOMsg("Could not open file \"" + fFilename + "\". You must explicitely specify a filename via the corresponding command",EEAlert);
-    return;
+    return false;
   }
   EXOCorrelationCollection* correlations = static_cast<EXOCorrelationCollection*>(file.Get(fCollectionName.c_str()));
   if(not correlations){
     LogEXOMsg("Could not find collection with name \"" + fCollectionName + "\" in file " + fFilename,EEAlert);
-    return;
+    return false;
   }
   const int minchannel = NCHANNEL_PER_WIREPLANE*NWIREPLANE;
   const int maxchannel = minchannel + NAPDPLANE*NUMBER_APD_CHANNELS_PER_PLANE;
@@ -141,7 +218,7 @@ void EXODefineCrossProductProcessList::UpdateFilters() const
   //cout << "maxchannel = " << maxchannel-1 << endl;
   if(minchannel < correlations->GetMinChannel() || correlations->GetMaxChannel() >= maxchannel){
     LogEXOMsg("Correlation collection does not contain all channels",EEError);
-    return;
+    return false;
   }
 
   for(int channel = minchannel; channel < maxchannel; channel++){
@@ -160,9 +237,10 @@ void EXODefineCrossProductProcessList::UpdateFilters() const
     cout << "fNBins = " << fNBins << endl;
     cout << "fNSigma = " << fNSigma << endl;
     */
-    fFilterMap[channel].SetSpectrum(spectrum,fNSigma,fNBins);
+    filters[channel].SetSpectrum(spectrum,fNSigma,fNBins);
     //cout << "created filter for channel " << channel << endl;
   }
+  return true;
 }
 
 void EXODefineCrossProductProcessList::SetupTalkTo(const std::string& prefix, EXOTalkToManager* talkTo)
@@ -21,6 +21,7 @@
 #include <string>
 #include <cstring>
 #include <sstream>
+#include <limits>
 #ifdef USE_THREADS
 #include "boost/thread/thread.hpp"
 #include <boost/asio/io_service.hpp>
@@ -50,7 +51,8 @@ EXOMatchedFilterFinder::EXOMatchedFilterFinder()
   fDivideNoise(true),
   fNumThreads(24),
   fUseAPDRealNoise(false),   // Default not using the apd real noise power spectrum
-  fUseWireRealNoise(false) // Default not using the wire real noise power spectrum
+  fUseWireRealNoise(false), // Default not using the wire real noise power spectrum
+  fNoiseHash(EXOHash::FNV1aBasis())
   
 {
   
@@ -216,75 +218,61 @@ void EXOMatchedFilterFinder::ApplyMatchFilter(
   chanHelper.fChannelSignals.SetWaveform(&wf);
 
   size_t nsample = wf.GetLength();
-  size_t i0 = 0;
-  size_t i1 = wf.GetLength() - 1;
-
   std::vector<std::pair<EXOSignal,double> > FoundSignals;
 
-  for(size_t i=i0+1; i<i1-1; i++) {
-    if(wfWithType.fType == EXOReconUtil::kChargeInjection) {
-      // We need to be able to find negative signals too.
-      while(std::fabs(chanHelper.fFilteredWF[i+1]) > std::fabs(chanHelper.fFilteredWF[i]) and i+1<i1) i++;
-    }
-    else {
-      while(chanHelper.fFilteredWF[i+1] > chanHelper.fFilteredWF[i] and i+1<i1) i++;
-    }
-
-    // now matched_filter_magnitude[i] is a local maximum.
-    if(fAPDSearchWindowBegin <= 0){  // if APD search window is disabled...
-      if((wfWithType.fType == EXOReconUtil::kChargeInjection ?
-          std::fabs(chanHelper.fFilteredWF[i]) :
-          chanHelper.fFilteredWF[i]) > chanHelper.fThreshold) {
-        EXOSignal signal;
-        signal.fTime = chanHelper.fFilteredWF.GetTimeAtIndex(i);
-        signal.fTimeError = 0.0;
-        signal.fMagnitudeError = 0.0;
-  
-        // Set the magnitude to the peak value of the raw waveform
-        if(wfWithType.fType == EXOReconUtil::kVWire){
-          //V-wire amplitude seems to be the peak to peak value
-          size_t pos1 = (i-2>0) ? i-2 : 0;
-          size_t pos2 = (i+7<nsample) ? i+7 : nsample-1;
-          size_t posZeroTransition = (i+1<nsample) ? i+1 : nsample-1;
-          signal.fMagnitude = wf[pos1] - wf[pos2] + wf[posZeroTransition];
-        }
-        else{
-          // U-wire and APD Signal peaks roughly 5 microseconds after charge deposit;
-          // this is a rough estimate.  I'm leaning on the fitter to correct the energy.
-          // FIXME is this still correct?
-          size_t en_est = (i+5<nsample) ? i+5 : nsample - 1;
-  
-          // This avoids issues of normalization from ecs =
-          // matched_filter_magnitude.
-          signal.fMagnitude = wf[en_est];
-        }
-        FoundSignals.push_back(std::make_pair(signal, chanHelper.fFilteredWF[i]));
+  // Find the local maxima of the filtered waveform above threshold; charge
+  // injection signals can be negative, so for them use the absolute value.
+  // With the APD search window enabled, all maxima of APD signals are
+  // candidates and nothing else is searched.
+  bool searchWindow = (fAPDSearchWindowBegin > 0);
+  if(searchWindow and wfWithType.fType != EXOReconUtil::kAPD) return;
+  double threshold = searchWindow ? -std::numeric_limits<double>::infinity() : chanHelper.fThreshold;
+  std::vector<size_t> maxima;
+  EXOReconUtil::FindLocalMaxima(chanHelper.fFilteredWF.GetData(), nsample, threshold, maxima,
+                                wfWithType.fType == EXOReconUtil::kChargeInjection);
+
+  for(size_t j = 0; j < maxima.size(); j++) {
+    size_t i = maxima[j];
+    if(not searchWindow){
+      EXOSignal signal;
+      signal.fTime = chanHelper.fFilteredWF.GetTimeAtIndex(i);
+      signal.fTimeError = 0.0;
+      signal.fMagnitudeError = 0.0;
+
+      // Set the magnitude to the peak value of the raw waveform
+      if(wfWithType.fType == EXOReconUtil::kVWire){
+        //V-wire amplitude seems to be the peak to peak value
+        size_t pos1 = (i>2) ? i-2 : 0;
+        size_t pos2 = (i+7<nsample) ? i+7 : nsample-1;
+        size_t posZeroTransition = (i+1<nsample) ? i+1 : nsample-1;
+        signal.fMagnitude = wf[pos1] - wf[pos2] + wf[posZeroTransition];
       }
-
-    }else{ // if APD search window is enabled...
-      //cout << "New!\n";
-      if(wfWithType.fType == EXOReconUtil::kAPD){
-        EXOSignal signal;
-        signal.fTime = chanHelper.fFilteredWF.GetTimeAtIndex(i);
-        signal.fTimeError = 0.0;
-        signal.fMagnitudeError = 0.0;
+      else{
+        // U-wire and APD Signal peaks roughly 5 microseconds after charge deposit;
+        // this is a rough estimate.  I'm leaning on the fitter to correct the energy.
+        // FIXME is this still correct?
         size_t en_est = (i+5<nsample) ? i+5 : nsample - 1;
+
+        // This avoids issues of normalization from ecs =
+        // matched_filter_magnitude.
         signal.fMagnitude = wf[en_est];
-        if((signal.fTime <= fChargeClusterTime + fAPDSearchWindowEnd) and (signal.fTime >= fChargeClusterTime - fAPDSearchWindowBegin)){
-          // if the signal is within the window.
-          signal.fFilteredWFPeakMagnitude = chanHelper.fFilteredWF[i]; // "max-threshold"
-          signal.fFilteredWFPeakTime = chanHelper.fFilteredWF.GetTimeAtIndex(i); // "z-candidate" 
-          chanHelper.fChannelSignals.SetCacheInformationFor("Threshold",chanHelper.fThreshold);
-          FoundSignals.push_back(std::make_pair(signal, chanHelper.fFilteredWF[i]));
-        }
       }
-    }
+      FoundSignals.push_back(std::make_pair(signal, chanHelper.fFilteredWF[i]));
 
-    if(wfWithType.fType == EXOReconUtil::kChargeInjection) {
-      while(i<i1-1 and std::fabs(chanHelper.fFilteredWF[i]) > std::fabs(chanHelper.fFilteredWF[i+1])) i++;
-    }
-    else {
-      while(i<i1-1 && chanHelper.fFilteredWF[i] > chanHelper.fFilteredWF[i+1]) i++;
+    }else{ // if APD search window is enabled...
+      EXOSignal signal;
+      signal.fTime = chanHelper.fFilteredWF.GetTimeAtIndex(i);
+      signal.fTimeError = 0.0;
+      signal.fMagnitudeError = 0.0;
+      size_t en_est = (i+5<nsample) ? i+5 : nsample - 1;
+      signal.fMagnitude = wf[en_est];
+      if((signal.fTime <= fChargeClusterTime + fAPDSearchWindowEnd) and (signal.fTime >= fChargeClusterTime - fAPDSearchWindowBegin)){
+        // if the signal is within the window.
+        signal.fFilteredWFPeakMagnitude = chanHelper.fFilteredWF[i]; // "max-threshold"
+        signal.fFilteredWFPeakTime = chanHelper.fFilteredWF.GetTimeAtIndex(i); // "z-candidate" 
+        chanHelper.fChannelSignals.SetCacheInformationFor("Threshold",chanHelper.fThreshold);
+        FoundSignals.push_back(std::make_pair(signal, chanHelper.fFilteredWF[i]));
+      }
     }
   }
 
@@ -577,6 +565,29 @@ void EXOMatchedFilterFinder::ProcessVerbosity(const EXOChannelSignals& sigs,
   
 }
 
+//______________________________________________________________________________
+ULong64_t EXOMatchedFilterFinder::HashInputs(ULong64_t hash) const
+{
+  // The data taking phase selects the noise spectra the filters are built
+  // with; hash it and the spectra that were loaded for it.
+  hash = EXOHash::FNV1a(hash, fDataTakingPhase);
+  return EXOHash::FNV1a(hash, &fNoiseHash, sizeof(fNoiseHash));
+}
+
+//______________________________________________________________________________
+ULong64_t EXOMatchedFilterFinder::HashNoise(ULong64_t hash, const EXOWaveformData& wfd)
+{
+  // Continue hash with the channels and samples of the noise spectra in wfd.
+  for(size_t i = 0; i < wfd.GetNumWaveforms(); i++) {
+    const EXOWaveform& wf = *wfd.GetWaveform(i);
+    size_t length = wf.GetLength();
+    hash = EXOHash::FNV1a(hash, &wf.fChannel, sizeof(wf.fChannel));
+    hash = EXOHash::FNV1a(hash, &length, sizeof(length));
+    hash = EXOHash::FNV1a(hash, wf.GetData(), length*sizeof(*wf.GetData()));
+  }
+  return hash;
+}
+
 //______________________________________________________________________________
 void EXOMatchedFilterFinder::NotifySignalModelHasChanged(int chanOrTag, 
   const EXOSignalModel& /*mod*/)
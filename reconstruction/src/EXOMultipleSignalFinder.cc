@@ -14,6 +14,7 @@
 #include "TH1D.h"
 #include <algorithm>
 #include <set>
+#include <vector>
 #include <iostream>
 
 using namespace std;
@@ -41,52 +42,54 @@ void EXOMultipleSignalFinder::FindSignals(EXOChannelSignals& returnChannelSignal
   // Test a couple of things first, though.  If the tests fail, there is a usage error.
   if(Begin > End or End > Waveform.GetLength()) LogEXOMsg("Begin and End indices are bad", EEAlert);
 
-  // Filter the snippet of the waveform
+  // Filter the snippet of the waveform.  The filter works in place, so the
+  // snippet is copied -- only the snippet, with the timing of Waveform.
   EXODoubleWaveform filtered_signal;
-  filtered_signal.MakeSimilarTo(Waveform);
-  filtered_signal.SetData(&Waveform[Begin], End - Begin);
+  filtered_signal.SetSamplingFreq(Waveform.GetSamplingFreq());
   filtered_signal.SetTOffset(Waveform.GetTimeAtIndex(Begin));
+  filtered_signal.SetData(&Waveform[Begin], End - Begin);
   Filter(filtered_signal, inputChannelSignals.GetChannel());
 
   // Now look for signals in the filtered waveform.
   double threshold = fSigmaThreshold * CalculateNoiseCounts(filtered_signal);
-  for(size_t i = 1; i < filtered_signal.GetLength() - 2; i++) {
-    while(i+2 < filtered_signal.GetLength() and filtered_signal[i+1] > filtered_signal[i]) i++;
-
-    // now filtered_signal[i] is a local maximum.
-    if(filtered_signal[i] > threshold) {
-      // Keep it OR show that this signal is already found.
-      // Note that it could be already-found in the returnChannelSignals too, since that's not necessarily empty.
-      if(inputChannelSignals.GetNumSignals() > 0 and
-        inputChannelSignals.GetTimeToSignal(filtered_signal.GetTimeAtIndex(i)) <=
-          0.5*filtered_signal.GetSamplingPeriod()) {
-        // A signal within 0.5us had already been found, so don't add this one.
-      }
-      else if(returnChannelSignals.GetNumSignals() > 0 and
-        returnChannelSignals.GetTimeToSignal(filtered_signal.GetTimeAtIndex(i)) <=
-          0.5*filtered_signal.GetSamplingPeriod()) {
-        // The multiple-signal finder has already added this one (or close enough).
-      }
-      else {
-        // This is a signal we didn't know about; add it.
-        EXOSignal signal;
-        signal.fTime = filtered_signal.GetTimeAtIndex(i);
-        signal.fTimeError = 0.0;
-        signal.fMagnitudeError = 0.0;
-        // Signals tend to peak a little after the found time; we're leaning on the fitter to make this precise.
-        signal.fMagnitude = Waveform.InterpolateAtPoint(signal.fTime + 5.0*CLHEP::microsecond) + aBaseline;
-        returnChannelSignals.AddSignal(signal);
-      }
+  std::vector<size_t> maxima;
+  EXOReconUtil::FindLocalMaxima(filtered_signal.GetData(), filtered_signal.GetLength(), threshold, maxima);
+
+  // Skip the maxima within half a sample of a signal that is already known,
+  // either from inputChannelSignals or from earlier snippets.  Both the
+  // maxima and the known times are sorted, so one merge pass does it.  The
+  // maxima are a sample apart, so adding one doesn't affect the others.
+  std::vector<double> knownTimes;
+  const EXOSignal* sig = NULL;
+  inputChannelSignals.ResetIterator();
+  while((sig = inputChannelSignals.Next()) != NULL) knownTimes.push_back(sig->fTime);
+  returnChannelSignals.ResetIterator();
+  while((sig = returnChannelSignals.Next()) != NULL) knownTimes.push_back(sig->fTime);
+  std::sort(knownTimes.begin(), knownTimes.end());
+
+  double window = 0.5*filtered_signal.GetSamplingPeriod();
+  size_t nextKnown = 0;
+  for(size_t j = 0; j < maxima.size(); j++) {
+    double time = filtered_signal.GetTimeAtIndex(maxima[j]);
+    while(nextKnown < knownTimes.size() and knownTimes[nextKnown] < time - window) nextKnown++;
+    if(nextKnown < knownTimes.size() and knownTimes[nextKnown] <= time + window) {
+      // A signal within half a sample had already been found, so don't add this one.
+      continue;
     }
-
-    // Now skip ahead to a local minimum
-    while(i+1 < filtered_signal.GetLength() and filtered_signal[i] > filtered_signal[i+1]) i++;
+    // This is a signal we didn't know about; add it.
+    EXOSignal signal;
+    signal.fTime = time;
+    signal.fTimeError = 0.0;
+    signal.fMagnitudeError = 0.0;
+    // Signals tend to peak a little after the found time; we're leaning on the fitter to make this precise.
+    signal.fMagnitude = Waveform.InterpolateAtPoint(signal.fTime + 5.0*CLHEP::microsecond) + aBaseline;
+    returnChannelSignals.AddSignal(signal);
   } // End looking for peaks in the filtered waveform.
   if(fVerbose.ShouldPrintTextForChannel(returnChannelSignals.GetChannel())){
     cout << "*********************************************" << endl;
     cout << "Multiple signal finder found " << returnChannelSignals.GetNumSignals() << " additional signals on channel " << returnChannelSignals.GetChannel() << ":" << endl;
     returnChannelSignals.ResetIterator();
-    const EXOSignal* sig = returnChannelSignals.Next();
+    sig = returnChannelSignals.Next();
     while(sig){
       cout << "Signal at time " << sig->fTime << " with magnitude " << sig->fMagnitude << endl;
       sig = returnChannelSignals.Next();
@@ -226,8 +229,6 @@ void EXOMultipleSignalFinder::GetShapedModel(EXODoubleWaveform &fShapedModel, do
   const size_t init_length = 100000;
   EXODoubleWaveform unshaped_model_initializer;
 
-  double initializer[init_length];
-
   unshaped_model_initializer.SetLength(init_length);
   unshaped_model_initializer.SetSamplingPeriod(0.1);
 
@@ -296,10 +297,6 @@ double EXOMultipleSignalFinder::CalculateNoiseCounts(const EXODoubleWaveform& wf
 void EXOMultipleSignalFinder::Filter (EXODoubleWaveform& filtered_signal, int Channel) const
 {
 
-  EXODoubleWaveform fShapedModel;
-
-  GetShapedModel(fShapedModel,fFilterTimeConstant);
-
   const int pulseLength=256;
 
   const EXOSignalModel* sigmod;
@@ -370,6 +367,9 @@ void EXOMultipleSignalFinder::Filter (EXODoubleWaveform& filtered_signal, int Ch
   }
 
   if (fUseMatchedTriangleFilter) {
+    // The shaped model is only needed here, and is expensive to build.
+    EXODoubleWaveform fShapedModel;
+    GetShapedModel(fShapedModel,fFilterTimeConstant);
     EXOMatchedFilter Filter;
     Filter.SetTemplateToMatch(fShapedModel,pulseLength,0);
     Filter.SetNoisePowerSqrMag(EXOMiscUtil::noise_sq_mag_wire());
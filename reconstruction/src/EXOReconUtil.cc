@@ -0,0 +1,67 @@
+//______________________________________________________________________________
+//
+// EXOReconUtil
+//
+// FindLocalMaxima is the peak search of the signal finders.  They used to
+// walk each filtered waveform: climb to a local maximum, test it against the
+// threshold, descend to the next local minimum, and so on.  The maxima this
+// walk stops at are exactly the samples i in [1, length-2) with
+//
+//   data[i-1] <= data[i] >= data[i+1]
+//
+// except at the ends of the range: sample 1 has no condition on its left,
+// and sample length-2 is reached only by a climb from sample length-3.
+// Plateaus therefore give one maximum per sample, as before.
+//
+// The test is done for all samples in one branch-free pass, which the
+// compiler can vectorize (for x86 it needs SSE4.1 for the 64-bit compares),
+// and the indices passing it are then compacted in place.
+//______________________________________________________________________________
+#include "EXOReconstruction/EXOReconUtil.hh"
+#include <cmath>
+
+namespace {
+  struct Value {
+    double operator()(double x) const { return x; }
+  };
+  struct AbsoluteValue {
+    double operator()(double x) const { return std::fabs(x); }
+  };
+
+  template<class V>
+  size_t FindMaxima(const double* data, size_t length, double threshold,
+                    std::vector<size_t>& maxima, V value)
+  {
+    maxima.resize(length);
+    if(length < 4) {
+      maxima.clear();
+      return 0;
+    }
+    size_t* flags = &maxima[0];
+    flags[0] = 0;
+    flags[1] = value(data[1]) >= value(data[2]) and value(data[1]) > threshold;
+    for(size_t i = 2; i + 2 < length; i++) {
+      double x = value(data[i]);
+      flags[i] = (value(data[i-1]) <= x) & (x >= value(data[i+1])) & (x > threshold);
+    }
+    size_t last = length - 2;
+    flags[last] = value(data[last]) > value(data[last-1]) and
+                  (last == 2 or value(data[last-2]) <= value(data[last-1])) and
+                  value(data[last]) > threshold;
+
+    size_t numMaxima = 0;
+    for(size_t i = 1; i <= last; i++) {
+      if(flags[i]) maxima[numMaxima++] = i;
+    }
+    maxima.resize(numMaxima);
+    return numMaxima;
+  }
+}
+
+//______________________________________________________________________________
+size_t EXOReconUtil::FindLocalMaxima(const double* data, size_t length, double threshold,
+                                     std::vector<size_t>& maxima, bool useAbsoluteValue)
+{
+  if(useAbsoluteValue) return FindMaxima(data, length, threshold, maxima, AbsoluteValue());
+  return FindMaxima(data, length, threshold, maxima, Value());
+}
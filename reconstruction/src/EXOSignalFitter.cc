@@ -429,9 +429,12 @@ double EXOSignalFitter::GetOrCalculateNoise(const EXOWaveform& wf) const
   }
 
   // Insert and return the results.
-  ParameterMap noiseAndBaseline = fBaselineCalculator.ExtractAll(wf);
-  fChannelInfoCache[wf.fChannel].insert(noiseAndBaseline.begin(),noiseAndBaseline.end());
-  return noiseAndBaseline["Noisecounts"];
+  double values[EXOBaselineAndNoiseCalculator::kNumParameters];
+  fBaselineCalculator.ExtractAll(wf, values);
+  ParameterMap& cache = fChannelInfoCache[wf.fChannel];
+  cache["Baseline"] = values[EXOBaselineAndNoiseCalculator::kBaseline];
+  cache["Noisecounts"] = values[EXOBaselineAndNoiseCalculator::kNoisecounts];
+  return values[EXOBaselineAndNoiseCalculator::kNoisecounts];
 }
 
 //______________________________________________________________________________
@@ -450,9 +453,12 @@ double EXOSignalFitter::GetOrCalculateBaseline(const EXOWaveform& wf) const
   }
 
   // Insert and return the results.
-  ParameterMap noiseAndBaseline = fBaselineCalculator.ExtractAll(wf);
-  fChannelInfoCache[wf.fChannel].insert(noiseAndBaseline.begin(),noiseAndBaseline.end());
-  return noiseAndBaseline["Baseline"];
+  double values[EXOBaselineAndNoiseCalculator::kNumParameters];
+  fBaselineCalculator.ExtractAll(wf, values);
+  ParameterMap& cache = fChannelInfoCache[wf.fChannel];
+  cache["Baseline"] = values[EXOBaselineAndNoiseCalculator::kBaseline];
+  cache["Noisecounts"] = values[EXOBaselineAndNoiseCalculator::kNoisecounts];
+  return values[EXOBaselineAndNoiseCalculator::kBaseline];
 }
 
 
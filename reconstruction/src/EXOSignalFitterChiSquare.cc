@@ -261,11 +261,15 @@ double EXOSignalFitterChiSquare::CalculateChiSquare(const double *x) const
 
       fTmp.assign(end - start + 1, 0);
       const Int_t nstep = (Int_t)par[0];
-      for(Int_t isig = 0; isig < nstep; isig++) {
-        // For each signal, add it to tmp to build a model for this range.
-        model->AddSignalToArray(fTmp.begin(), fTmp.end(),
-                                time, period,
-                                par[1 + 2*isig], par[2 + 2*isig]);
+      // Use the model table if there is one; it adds all signals at once.
+      if(not model->GetModelTable().AddSignalsToArray(&fTmp[0], fTmp.size(), time, period,
+                                                      par + 1, nstep)) {
+        for(Int_t isig = 0; isig < nstep; isig++) {
+          // For each signal, add it to tmp to build a model for this range.
+          model->AddSignalToArray(fTmp.begin(), fTmp.end(),
+                                  time, period,
+                                  par[1 + 2*isig], par[2 + 2*isig]);
+        }
       }
 
       // Loop through the range and increment chi-square appropriately.
@@ -5,6 +5,9 @@
 // classes which must update cached values dependent on the signal model to do
 // so.  For this notification functionality, see
 // BuildSignalModelForChannelOrTag and NotifySignalModelHasChanged.
+//
+// With SetBuildModelTables, the manager also tabulates each model it builds
+// (EXOSignalModelTable), for fits that evaluate the models many times.
 //______________________________________________________________________________
 #include "EXOReconstruction/EXOSignalModelManager.hh"
 #include "EXOReconstruction/EXOSignalModelRegistrant.hh"
@@ -22,7 +25,14 @@ void EXOSignalModelManager::BuildSignalModelForChannelOrTag(int channel,
   // the EXOVSignalModelBuilder class.
 
   EXOSignalModel& mod = fSignalModelMap[channel];
-  if (builder.InitializeSignalModelIfNeeded(mod, channel)) {
+  bool changed = builder.InitializeSignalModelIfNeeded(mod, channel);
+  if (fBuildModelTables and not mod.fModelTable.IsBuilt()) {
+    // The table was cleared if the model changed; it is part of the model
+    // registrants see, so build it before notifying them.
+    mod.fModelTable.Build(mod.fShapedModel);
+    changed = true;
+  }
+  if (changed) {
     // This means that the initialization has been run, so we must notify our
     // registrants that this signal model has changed.
     NotifyRegistrantsOfChange(channel, mod);
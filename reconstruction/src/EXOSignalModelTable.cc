@@ -0,0 +1,185 @@
+//______________________________________________________________________________
+//
+// EXOSignalModelTable holds the model waveform of an EXOSignalModel
+// evaluated at a fine grid of fractional sample positions, so that signals
+// can be added to a waveform at any time without interpolating the model
+// sample by sample.
+//
+// The model is sampled at the digitization period; fits evaluate it at
+// arbitrary signal times, which EXOSignalModel::AddSignalToArray does by
+// linear interpolation between model samples.  The table instead stores
+// rows r = 0, ..., N (N = the oversampling factor) of the model at index
+// j + r/N, computed once with Lanczos-windowed sinc interpolation.  The
+// model is a shaped, so nearly band-limited, signal, which this
+// interpolates more faithfully than straight lines between samples.  For a
+// signal whose time falls between phases r/N and (r+1)/N, the two rows are
+// mixed linearly.
+//
+// When the waveform period is a multiple of the model period, every sample
+// of the waveform has the same phase relative to the model.  Adding a
+// signal then reduces to a scaled sum of two rows, a contiguous loop which
+// the compiler vectorizes.  AddSignalsToArray adds all signals of a fit
+// hypothesis in one call.
+//
+// As in EXOSignalModel::AddSignalToArray, the model is taken to be constant
+// before its first sample and after its last one.
+//
+// Tables are built by EXOSignalModelManager when it is asked to (see
+// EXOSignalModelManager::SetBuildModelTables), so that the registrants it
+// notifies of a changed model see the new table.
+//______________________________________________________________________________
+#include "EXOReconstruction/EXOSignalModelTable.hh"
+#include "TMath.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  double Lanczos(double x, double halfWidth)
+  {
+    // The Lanczos kernel sinc(x) sinc(x/halfWidth) on |x| < halfWidth.
+    if(std::fabs(x) < 1e-12) return 1.0;
+    if(std::fabs(x) >= halfWidth) return 0.0;
+    double px = TMath::Pi()*x;
+    return halfWidth*std::sin(px)*std::sin(px/halfWidth)/(px*px);
+  }
+}
+
+//______________________________________________________________________________
+EXOSignalModelTable::EXOSignalModelTable()
+: fLength(0),
+  fOversampling(0),
+  fTOffset(0.0),
+  fSamplingFreq(0.0)
+{}
+
+//______________________________________________________________________________
+void EXOSignalModelTable::Clear()
+{
+  fRows.clear();
+  fLength = 0;
+  fOversampling = 0;
+}
+
+//______________________________________________________________________________
+void EXOSignalModelTable::Build(const EXODoubleWaveform& model, size_t oversampling,
+                                size_t halfWidth)
+{
+  // Fill the oversampling+1 rows; row 0 is the model itself and row
+  // oversampling the model shifted by one sample.  The weights are
+  // normalized to sum to one, so that flat parts of the model stay flat.
+  Clear();
+  if(model.GetLength() == 0 or oversampling == 0 or halfWidth == 0) return;
+  fLength = model.GetLength();
+  fOversampling = oversampling;
+  fTOffset = model.GetTOffset();
+  fSamplingFreq = model.GetSamplingFreq();
+  fRows.resize((oversampling+1)*fLength);
+
+  int last = int(fLength) - 1;
+  int width = int(halfWidth);
+  std::vector<double> weights(2*halfWidth);
+  for(size_t r = 0; r <= oversampling; r++) {
+    double* row = &fRows[r*fLength];
+    if(r == 0 or r == oversampling) {
+      for(size_t j = 0; j < fLength; j++) row[j] = model[std::min(j + r/oversampling, fLength - 1)];
+      continue;
+    }
+    double phase = double(r)/oversampling;
+    double sum = 0.0;
+    for(int m = 0; m < 2*width; m++) {
+      weights[m] = Lanczos(phase - (m - width + 1), width);
+      sum += weights[m];
+    }
+    for(int m = 0; m < 2*width; m++) weights[m] /= sum;
+
+    for(int j = 0; j <= last; j++) {
+      double value = 0.0;
+      for(int m = 0; m < 2*width; m++) {
+        int k = j + m - width + 1;
+        value += weights[m]*model[k < 0 ? 0 : (k > last ? last : k)];
+      }
+      row[j] = value;
+    }
+  }
+}
+
+//______________________________________________________________________________
+double EXOSignalModelTable::Evaluate(double time) const
+{
+  double value = 0.0;
+  AddSignalToArray(&value, 1, (time - fTOffset)*fSamplingFreq, 1, 1.0);
+  return value;
+}
+
+//______________________________________________________________________________
+bool EXOSignalModelTable::AddSignalsToArray(double* array, size_t length,
+  double arrayStartTime, double arrayPeriod, const double* parameters,
+  size_t numSignals) const
+{
+  if(not IsBuilt()) return false;
+  double step = arrayPeriod*fSamplingFreq;
+  size_t stride = size_t(step + 0.5);
+  // As in EXOSignalModel::AddSignalToArray: over the whole array, the drift
+  // from an integer step must stay below 1% of a sample.
+  if(stride == 0 or std::fabs(step - stride)*length >= 0.01) return false;
+
+  for(size_t i = 0; i < numSignals; i++) {
+    double magnitude = parameters[2*i];
+    double time = parameters[2*i+1];
+    AddSignalToArray(array, length, (arrayStartTime - time - fTOffset)*fSamplingFreq,
+                     stride, magnitude);
+  }
+  return true;
+}
+
+//______________________________________________________________________________
+void EXOSignalModelTable::AddSignalToArray(double* array, size_t length,
+  double startIndex, size_t stride, double magnitude) const
+{
+  // Add magnitude times the model at fractional model indices startIndex +
+  // k*stride to array[k].  The array splits into the samples before the
+  // model, those within it, and those after it.
+  const double first = fRows[0];
+  const double lastValue = fRows[fLength-1];
+
+  // Samples before the model: startIndex + k*stride < 0.
+  size_t k = 0;
+  if(startIndex < 0.0) {
+    double numBefore = std::ceil(-startIndex/stride);
+    k = (numBefore < length) ? size_t(numBefore) : length;
+    for(size_t i = 0; i < k; i++) array[i] += magnitude*first;
+    if(k == length) return;
+  }
+
+  // Samples within the model, up to index fLength-2 so that the
+  // interpolation stays within the rows.
+  double index = startIndex + double(k)*stride;
+  size_t entry = size_t(index);
+  double phase = (index - entry)*fOversampling;
+  size_t row = size_t(phase);
+  if(row >= fOversampling) row = fOversampling - 1;
+  double mix = phase - row;
+
+  size_t numWithin = 0;
+  if(entry + 1 < fLength) {
+    numWithin = (fLength - 2 - entry)/stride + 1;
+    if(numWithin > length - k) numWithin = length - k;
+  }
+  const double* lower = &fRows[row*fLength + entry];
+  const double* upper = lower + fLength;
+  double lowerWeight = magnitude*(1.0 - mix);
+  double upperWeight = magnitude*mix;
+  double* out = array + k;
+  if(stride == 1) {
+    for(size_t i = 0; i < numWithin; i++) out[i] += lowerWeight*lower[i] + upperWeight*upper[i];
+  }
+  else {
+    for(size_t i = 0; i < numWithin; i++) {
+      out[i] += lowerWeight*lower[i*stride] + upperWeight*upper[i*stride];
+    }
+  }
+  k += numWithin;
+
+  // Samples after the model.
+  for(; k < length; k++) array[k] += magnitude*lastValue;
+}
@@ -57,6 +57,7 @@ bool EXOVSignalModelBuilder::InitializeSignalModelIfNeeded(
   model.fBehaviorType = GetBehaviorType();
 
   InitializeSignalModel(model.fShapedModel, model.fTransferFunction);
+  model.fModelTable.Clear();
   return true;
 }
 
@@ -7,6 +7,7 @@
 #include "EXOUtilities/EXOMiscUtil.hh"
 #include "EXOUtilities/EXODimensions.hh"
 #include "EXOUtilities/EXOTalkToManager.hh"
+#include "EXOUtilities/EXOHash.hh"
 #include "EXOCalibUtilities/EXOVWireThresholds.hh"
 #include "TH1D.h"
 #include "Rtypes.h"
@@ -23,6 +24,14 @@ EXOYMatchExtractor::EXOYMatchExtractor()
   fThresholds(NULL)
 {}
 
+//_______________________________________________________________________________________________
+ULong64_t EXOYMatchExtractor::HashInputs(ULong64_t hash) const
+{
+  // The v-wire thresholds come from the database; hash their serial number.
+  unsigned int serial = fThresholds ? fThresholds->getSerNo() : 0;
+  return EXOHash::FNV1a(hash, &serial, sizeof(serial));
+}
+
 //_______________________________________________________________________________________________
 vector< pair<int,double> > EXOYMatchExtractor::FakeCluster(const EXOSignalCollection& inputSignals) const
 {
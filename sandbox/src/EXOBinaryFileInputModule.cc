@@ -28,6 +28,27 @@
 //
 // For more information on how to access the record list, see the
 // EXOControlRecordList documentation.
+//
+// With /binput/readahead, the kernel is asked (posix_fadvise) to read each
+// file of the run into the page cache as soon as the reader moves to it, so
+// that reading is bounded by the disk rather than by waiting on individual
+// reads.  At ShutDown, the module prints how many frames it read and the
+// total size of the files it opened, with the rates (frames/s, MB/s of file)
+// over the time spent in GetNextEvent, which excludes the other modules.  The
+// binary package does not report how much of a file its reader consumed, so
+// the size is that of the files, not of the records read.
+//
+// With /binput/decodethreads N (and a build with threads), TPC frames are
+// decoded on N threads.  The calling thread reads the records, keeps the
+// control and veto records, copies the requested channels of each TPC frame
+// out of the reader's buffer (the Waveform::Event, which must be built before
+// the reader moves on) and checks that none of its waveforms is truncated;
+// the threads then map the channels and convert the samples into
+// EXOWaveforms.  Each TPC event is queued as before and only handed out by
+// FlushEventDataDeque once its frame is done, so the events, and their veto
+// information, are exactly those of the serial path (test/binput_threads
+// compares the two).  At most fMaxPendingFrames frames are decoded ahead; the
+// reader waits beyond that.
 
 #include "EXOBinaryFileInputModule.hh"
 
@@ -60,6 +81,17 @@
 #include "TTree.h"
 #include <iostream>
 #include <sstream>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#ifdef USE_THREADS
+#include "boost/thread/thread.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include <boost/asio/io_service.hpp>
+#include <boost/bind.hpp>
+#endif
 using namespace std;
 
 //___________________________________
@@ -70,12 +102,154 @@ namespace Exo { namespace File {
 class EXOAnalysisReader : public Reader
 {
 public:
-  EXOAnalysisReader(const std::string file, int& status);
+  EXOAnalysisReader(const std::string file, int& status, bool readAhead, Long64_t& fileBytes);
   void notify (NotifyReason reason);
   void notify (const Segment& segment, NotifyReason reason);
+
+  // Count (and, with readAhead, prefetch) the file being read, if not done yet.
+  void StartFile();
+
+private:
+  bool        fReadAhead;
+  Long64_t&   fFileBytes;
+  std::string fCurrentFile;
 };
 
 } } // end namespaces
+
+//______________________________________________________________________________
+// A TPC frame being converted into its event.
+struct EXOBinaryFileInputModule::TPCFrame
+{
+  TPCFrame() : fEvent(NULL), fNumSamples(0), fDecoded(false) {}
+  bool IsTruncated() const;
+  void Decode();
+
+  EXOEventData* fEvent;
+  std::vector<uint32_t> fBuffer;          // Holds the Waveform::Event, i.e. the requested channels
+  std::vector<EXOWaveform*> fWaveforms;   // Waveform i of the Waveform::Event
+  int fPhysicalChannel[18][16];           // Channel map of the frame, by card and card channel
+  unsigned int fNumSamples;
+  bool fDecoded;
+};
+
+bool EXOBinaryFileInputModule::TPCFrame::IsTruncated() const
+{
+  // Whether a waveform of the frame was truncated, which makes the event no good.  Only reads the descriptors,
+  // so the reading thread checks every frame before its event is queued, whether or not it is decoded on threads.
+  const Exo::Frame::Tpc::Waveform::Event *event =
+    reinterpret_cast<const Exo::Frame::Tpc::Waveform::Event*>(&fBuffer[0]);
+  for(int i = 0; i < event->nwaveforms(); i++) {
+
+    // Get the descriptor corresponding to waveform i (not ordered in any way).
+    // Note that this is a copy; could probably be changed to a return by reference in binary package, but the
+    // performance hit should be negligible.
+    Exo::Frame::Tpc::Waveform::Descriptor waveformDescriptor = event->descriptor( i );
+
+    /*_____________________________________________________________________________________
+
+    In principle, if waveforms were compressed, then eg. the following could be an example situation:
+               nsamples could be 2048, indicating that data was taken for 2048 samples.
+               We might decide we only wish to store samples 500-1500 in memory.
+               Thus, waveformDescriptor.first() would return 500.
+               waveformDescriptor.last() would return 1500.
+               waveformDescriptor.nadcs() would return last-first+1 = 1001.  (This is always redundant.)
+               waveformDescriptors.adcs()[500] through waveformDescriptors.adcs()[1500] would contain the portion
+                 of the waveform which was stored.  I'm unsure whether the rest would store junk or zeroes.
+
+    For now, we assume that nadcs != nsample, first != 0, last != nadcs-1 are all errors.
+    _________________________________________________________________________________________*/
+
+    if ( (unsigned int)waveformDescriptor.nadcs() != fNumSamples or
+         waveformDescriptor.first() != 0 or waveformDescriptor.last() != waveformDescriptor.nadcs()-1 ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void EXOBinaryFileInputModule::TPCFrame::Decode()
+{
+  // Set the channels of the waveforms and load their traces.  Only touches this frame and its event, so it can
+  // run on any thread.  The frame has been checked with IsTruncated.
+  const Exo::Frame::Tpc::Waveform::Event *event =
+    reinterpret_cast<const Exo::Frame::Tpc::Waveform::Event*>(&fBuffer[0]);
+  for(size_t i = 0; i < fWaveforms.size(); i++) {
+    Exo::Frame::Tpc::Waveform::Descriptor waveformDescriptor = event->descriptor( i );
+
+    // Convert electronics channel number to physical channel number; only store physical channel number.
+    int DAQcard = Exo::Frame::Tpc::Channel::card( waveformDescriptor.channel_number() );
+    int card_channel = Exo::Frame::Tpc::Channel::card_channel( waveformDescriptor.channel_number() );
+    fWaveforms[i]->fChannel = fPhysicalChannel[DAQcard][card_channel];
+
+    // Load waveform trace into the waveform.
+    fWaveforms[i]->SetData( waveformDescriptor.adcs(), waveformDescriptor.nadcs() );
+  }
+}
+
+#ifdef USE_THREADS
+//______________________________________________________________________________
+// Threads decoding the posted frames, in any order.
+class EXOBinaryFileInputModule::DecodePool
+{
+public:
+  DecodePool(size_t numThreads) : fWork(new boost::asio::io_service::work(fService))
+  {
+    for(size_t i = 0; i < numThreads; i++) {
+      fThreads.create_thread(boost::bind(&boost::asio::io_service::run, &fService));
+    }
+  }
+  ~DecodePool()
+  {
+    // Finish what was posted, then stop.
+    delete fWork;
+    fThreads.join_all();
+  }
+  void Post(TPCFrame* frame)
+  {
+    fService.post(boost::bind(&DecodePool::Decode, this, frame));
+  }
+  void Wait(TPCFrame* frame)
+  {
+    boost::mutex::scoped_lock lock(fMutex);
+    while(not frame->fDecoded) fDone.wait(lock);
+  }
+private:
+  void Decode(TPCFrame* frame)
+  {
+    frame->Decode();
+    boost::mutex::scoped_lock lock(fMutex);
+    frame->fDecoded = true;
+    fDone.notify_all();
+  }
+
+  boost::asio::io_service fService;
+  boost::asio::io_service::work* fWork;
+  boost::thread_group fThreads;
+  boost::mutex fMutex;
+  boost::condition_variable fDone;
+};
+#else
+// Without threads there is no pool (see SetDecodeThreads).
+class EXOBinaryFileInputModule::DecodePool
+{
+public:
+  void Post(TPCFrame* frame) { frame->Decode(); frame->fDecoded = true; }
+  void Wait(TPCFrame*) {}
+};
+#endif
+
+namespace {
+  // Adds the time spent in its scope to a stopwatch.
+  class ReadTimerGuard
+  {
+  public:
+    ReadTimerGuard(TStopwatch& watch) : fWatch(watch) { fWatch.Start(kFALSE); }
+    ~ReadTimerGuard() { fWatch.Stop(); }
+  private:
+    TStopwatch& fWatch;
+  };
+}
 //______________________________________________________________________________
 EXOBinaryFileInputModule::EXOBinaryFileInputModule() :
   fLastControlRecord(kNoFile),
@@ -85,7 +259,14 @@ EXOBinaryFileInputModule::EXOBinaryFileInputModule() :
   fSkipEvents(0),
   binaryFile(NULL),
   fCurrentRunType(Exo::Run::Type::DatPhysics),
-  fRunTypeKnown(false)
+  fRunTypeKnown(false),
+  fReadAhead(false),
+  fFileBytes(0),
+  fTPCFramesRead(0),
+  fVetoFramesRead(0),
+  fOtherFramesRead(0),
+  fNumDecodeThreads(0),
+  fDecodePool(NULL)
 {
 
   // If this platform defines fundamental data types differently from the one that wrote the binary files,
@@ -103,11 +284,21 @@ EXOBinaryFileInputModule::EXOBinaryFileInputModule() :
   // Share control records
   RegisterSharedObject("ControlRecords", fRecords); 
 
+  fReadTimer.Reset();
 }
 
 //______________________________________________________________________________
 EXOBinaryFileInputModule::~EXOBinaryFileInputModule()
 {
+  // Let the decoding threads finish before deleting what they write to.
+  delete fDecodePool;
+  for(size_t i = 0; i < fPendingFrames.size(); i++) {
+    delete fPendingFrames[i];
+  }
+  for(size_t i = 0; i < fTPCFramePool.size(); i++) {
+    delete fTPCFramePool[i];
+  }
+
   // Delete memory in memory pools
   for(size_t i = 0; i < fEventDataMemoryPool.size(); i++) {
     delete fEventDataMemoryPool[i];
@@ -188,7 +379,7 @@ void EXOBinaryFileInputModule::OpenFile(const std::string& filename)
   Exo::File::EXOAnalysisReader* oldFile = binaryFile;
 
   int status;
-  binaryFile = new Exo::File::EXOAnalysisReader(filename.c_str(), status);
+  binaryFile = new Exo::File::EXOAnalysisReader(filename.c_str(), status, fReadAhead, fFileBytes);
   if(status != 0 or binaryFile == NULL or not binaryFile->is_open()) {
     // Opening failed -- restore the original file and throw.
     if(binaryFile) delete binaryFile;
@@ -198,6 +389,7 @@ void EXOBinaryFileInputModule::OpenFile(const std::string& filename)
     throw EXOMiscUtil::EXOBadCommand(ostream.str());
   }
   if(oldFile) delete oldFile; // We've successfully opened the new file, so delete the old one.
+  binaryFile->StartFile();
 
   fCurrentEventNumber = -1;
   fEventsProcessed = 0;
@@ -217,11 +409,38 @@ int EXOBinaryFileInputModule::TalkTo(EXOTalkToManager* tm)
   // Set up talk to commands
   tm->CreateCommand("/binput/skip","number of events to skip",
                     this, fSkipEvents, &EXOBinaryFileInputModule::SetSkipEvents);
+  tm->CreateCommand("/binput/readahead","ask the kernel to read each binary file into the page cache when it is opened",
+                    this, fReadAhead, &EXOBinaryFileInputModule::SetReadAhead);
+  tm->CreateCommand("/binput/decodethreads","number of threads converting tpc samples into waveforms (0: none)",
+                    this, fNumDecodeThreads, &EXOBinaryFileInputModule::SetDecodeThreads);
   return 0;
 }
+//______________________________________________________________________________
+void EXOBinaryFileInputModule::SetDecodeThreads(int aval)
+{
+  // Set the number of threads decoding tpc frames; 0 decodes them as they are read.
+  if(not fPendingFrames.empty()) {
+    LogEXOMsg("Cannot change the number of decoding threads while frames are being decoded", EEError);
+    return;
+  }
+#ifndef USE_THREADS
+  if(aval > 0) {
+    LogEXOMsg("Not built with threads; tpc frames will be decoded as they are read", EEWarning);
+    aval = 0;
+  }
+#endif
+  fNumDecodeThreads = (aval > 0) ? aval : 0;
+  delete fDecodePool;
+  fDecodePool = NULL;
+#ifdef USE_THREADS
+  if(fNumDecodeThreads > 0) fDecodePool = new DecodePool(fNumDecodeThreads);
+#endif
+}
+
 //______________________________________________________________________________
 EXOEventData* EXOBinaryFileInputModule::GetNextEvent()
 {
+  ReadTimerGuard timerGuard(fReadTimer);
 
   if (!binaryFile->is_open()) { 
       LogEXOMsg("No file opened", EEAlert);
@@ -358,6 +577,7 @@ EXOEventData* EXOBinaryFileInputModule::GetNextEvent()
 
     Exo::File::Frame::Descriptor& frameDescriptor = recordDescriptor;
     if ( frameDescriptor.type() == Exo::File::Frame::Type::TpcData ) {
+      fTPCFramesRead++;
       if (fSkipEvents>0) {
           fSkipEvents--;
           continue; // we're skipping this TPC event
@@ -367,11 +587,13 @@ EXOEventData* EXOBinaryFileInputModule::GetNextEvent()
       continue;
     }
     else if ( frameDescriptor.type() == Exo::File::Frame::Type::VetoData ) {
+      fVetoFramesRead++;
       handle_frame_vetodata(frameDescriptor);
       continue;
     }
     else {
       // the frame was damaged, etc.
+      fOtherFramesRead++;
       handle_frame_ignored(frameDescriptor);
       LogEXOMsg("Frame record returned by binary package was Damaged, Empty, or of Unknown type", EECritical);
       continue;
@@ -483,54 +705,47 @@ void EXOBinaryFileInputModule::handle_frame_tpcdata( Exo::File::Frame::TpcData::
   fill_map_data(channelMap);
   const Exo::Frame::Tpc::Channel::Map18 MyMap(map_data);
 
-  // Create an Event object, allocating (on stack) just enough space to hold the requested hardware channel waveforms.
+  // Copy the requested hardware channel waveforms out of the reader's buffer, into an Event object in the frame's
+  // buffer, which is grown to hold them.  (It used to be allocated on the stack, which costs a page fault per page
+  // for every frame.)  The Event holds its own copy of the waveforms, so the rest of the frame can be decoded after
+  // the reader has moved on.
+  TPCFrame* frame = GetCleanTPCFrame();
+  frame->fEvent = NewEventData;
+  frame->fNumSamples = tpcHeader.nsamples();
+  for ( int card = 0; card < 18; card++ ) {
+    for ( int channel = 0; channel < 16; channel++ ) {
+      frame->fPhysicalChannel[card][channel] = channelMap.get_physical_channel(card, channel);
+    }
+  }
   size_t size32 = Exo::Frame::Tpc::Waveform::Event::size32(TpcDataDescriptor, MyMap);
-  uint32_t buffer[size32];
-  const Exo::Frame::Tpc::Waveform::Event *event = new (buffer) Exo::Frame::Tpc::Waveform::Event(TpcDataDescriptor, MyMap);
+  if(frame->fBuffer.size() < size32) frame->fBuffer.resize(size32);
+  const Exo::Frame::Tpc::Waveform::Event *event = new (&frame->fBuffer[0]) Exo::Frame::Tpc::Waveform::Event(TpcDataDescriptor, MyMap);
+
+  // Drop an event with a truncated waveform here, before it is queued or moves the event number and the veto
+  // stream on, so that decoding on threads stops at the same frame as decoding here.
+  if(frame->IsTruncated()) {
+    LogEXOMsg("A waveform has been inappropriately truncated.", EEAlert);
+    fTPCFramePool.push_back(frame);
+    fEventDataMemoryPool.push_back(NewEventData); // The event is no good; recycle the memory.
+    return;
+  }
 
-  // How many waveforms have been fetched in this event?
+  // Create the event data waveforms to hold the data.  The waveforms of pooled events keep their storage,
+  // so the traces are decoded straight into memory that is already allocated.
   int nwaveforms = event->nwaveforms();
-
   for ( int i = 0; i < nwaveforms; i++ ) {
+    frame->fWaveforms.push_back(NewEventData->GetWaveformData()->GetNewWaveform());
+  }
 
-    // Get the descriptor corresponding to waveform i (not ordered in any way).
-    // Note that this is a copy; could probably be changed to a return by reference in binary package, but the
-    // performance hit should be negligible.
-    Exo::Frame::Tpc::Waveform::Descriptor waveformDescriptor = event->descriptor( i );
-
-    /*_____________________________________________________________________________________
-
-    In principle, if waveforms were compressed, then eg. the following could be an example situation:
-               nsamples could be 2048, indicating that data was taken for 2048 samples.
-               We might decide we only wish to store samples 500-1500 in memory.
-               Thus, waveformDescriptor.first() would return 500.
-               waveformDescriptor.last() would return 1500.
-               waveformDescriptor.nadcs() would return last-first+1 = 1001.  (This is always redundant.)
-               waveformDescriptors.adcs()[500] through waveformDescriptors.adcs()[1500] would contain the portion
-                 of the waveform which was stored.  I'm unsure whether the rest would store junk or zeroes.
-
-    For now, we assume that nadcs != nsample, first != 0, last != nadcs-1 are all errors.
-    _________________________________________________________________________________________*/
-
-    if ( (unsigned int)waveformDescriptor.nadcs() !=  tpcHeader.nsamples() or 
-         waveformDescriptor.first() != 0 or waveformDescriptor.last() != waveformDescriptor.nadcs()-1 ) {
-      LogEXOMsg("A waveform has been inappropriately truncated.", EEAlert);
-      fEventDataMemoryPool.push_back(NewEventData); // The event is no good; recycle the memory.
-      return;
-    }
-
-    // Create new event data waveform to hold data.
-    EXOWaveform* dataWaveform = NewEventData->GetWaveformData()->GetNewWaveform(); 
-
-    // Load waveform trace into dataWaveform.
-    dataWaveform->SetData( waveformDescriptor.adcs(), waveformDescriptor.nadcs() ); 
-
-    // Convert electronics channel number to physical channel number; only store physical channel number.
-    int DAQcard = Exo::Frame::Tpc::Channel::card( waveformDescriptor.channel_number() );
-    int card_channel = Exo::Frame::Tpc::Channel::card_channel( waveformDescriptor.channel_number() );
-    dataWaveform->fChannel = channelMap.get_physical_channel( DAQcard, card_channel) ;
-
-  } // end loop over waveforms
+  // Decode the frame, here or on the decoding threads.
+  if(fDecodePool) {
+    if(fPendingFrames.size() >= fMaxPendingFrames) RetireFrontFrame(); // back-pressure
+    fPendingFrames.push_back(frame);
+    fDecodePool->Post(frame);
+  } else {
+    frame->Decode();
+    fTPCFramePool.push_back(frame);
+  }
 
   // increment event counters
   fCurrentEventNumber = NewEventData->fEventNumber;
@@ -1019,6 +1234,34 @@ EXOEventData* EXOBinaryFileInputModule::GetCleanEventData()
   }
 }
 //______________________________________________________________________________
+EXOBinaryFileInputModule::TPCFrame* EXOBinaryFileInputModule::GetCleanTPCFrame()
+{
+  // Retrieve a TPCFrame from the memory pool, keeping its buffer; create one if there are none.
+  if(fTPCFramePool.empty()) return new TPCFrame;
+  TPCFrame* frame = fTPCFramePool.back();
+  fTPCFramePool.pop_back();
+  frame->fEvent = NULL;
+  frame->fWaveforms.clear();
+  frame->fDecoded = false;
+  return frame;
+}
+//______________________________________________________________________________
+void EXOBinaryFileInputModule::RetireFrontFrame()
+{
+  // Wait for the oldest pending frame to be decoded and return it to the pool.
+  TPCFrame* frame = fPendingFrames.front();
+  fDecodePool->Wait(frame);
+  fPendingFrames.pop_front();
+  fTPCFramePool.push_back(frame);
+}
+//______________________________________________________________________________
+void EXOBinaryFileInputModule::FinishDecoding(const EXOEventData* event)
+{
+  // Make sure the waveforms of event are loaded.  Pending frames are in the order of fEventDataDeque,
+  // so the frame of event is either the oldest one or already retired.
+  if(not fPendingFrames.empty() and fPendingFrames.front()->fEvent == event) RetireFrontFrame();
+}
+//______________________________________________________________________________
 EXOBinaryFileInputModule::VetoSummary* EXOBinaryFileInputModule::GetCleanVetoSummary()
 {
   // Retrieve a VetoSummary object from the memory pool -- it will be cleaned up here.
@@ -1080,6 +1323,9 @@ EXOEventData* EXOBinaryFileInputModule::FlushEventDataDeque(bool force /* = fals
     }
   }
 
+  // The waveforms may still be loading on the decoding threads.
+  FinishDecoding(fEventDataDeque.front());
+
   // Put the tpc event in the memory pool without clearing it -- that way, when we return, it'll be ready to go.
   fEventDataMemoryPool.push_back(fEventDataDeque.front());
   fEventDataDeque.pop_front();
@@ -1121,8 +1367,25 @@ void EXOBinaryFileInputModule::UpdateControlStatus(const EControlStatus NewStatu
   fLastControlRecord = NewStatus;
 }
 //______________________________________________________________________________
+void EXOBinaryFileInputModule::PrintReadStatistics()
+{
+  // Print the frames read, the size of the files opened, and the rates over the time spent in GetNextEvent.
+  double seconds = GetReadSeconds();
+  double megabytes = fFileBytes/1.e6;
+  cout << "EXOBinaryFileInputModule: read "
+       << GetFramesRead() << " frames (" << fTPCFramesRead << " tpc, "
+       << fVetoFramesRead << " veto, " << fOtherFramesRead << " ignored) in "
+       << seconds << " s from files of " << megabytes << " MB";
+  if(seconds > 0) {
+    cout << ": " << GetFramesRead()/seconds << " frames/s, " << megabytes/seconds << " MB/s of file";
+  }
+  cout << endl;
+}
+//______________________________________________________________________________
 int EXOBinaryFileInputModule::ShutDown()
 {
+  PrintReadStatistics();
+
   // Build a veto and glitch tree index (by time), before the file gets written to disk.
   TTree* vetoTree = dynamic_cast<TTree*>(FindSharedObject(EXOMiscUtil::GetVetoTreeName()));
   if(vetoTree and vetoTree->GetEntries()) {
@@ -1154,10 +1417,34 @@ namespace Exo {
 namespace File {
 
 // Necessary because of rules for inheritance of constructors.
-EXOAnalysisReader::EXOAnalysisReader(const std::string file, int& status)
-: Reader(file.c_str(), status)
+EXOAnalysisReader::EXOAnalysisReader(const std::string file, int& status, bool readAhead, Long64_t& fileBytes)
+: Reader(file.c_str(), status),
+  fReadAhead(readAhead),
+  fFileBytes(fileBytes)
 {}
 
+void EXOAnalysisReader::StartFile()
+{
+  // Called whenever the reader may have moved to another file of the run.
+  if(not is_open() or file_name() == fCurrentFile) return;
+  fCurrentFile = file_name();
+
+  int fd = open(fCurrentFile.c_str(), O_RDONLY);
+  if(fd < 0) return; // The reader has its own handle; only the statistics are lost.
+  struct stat info;
+  if(fstat(fd, &info) == 0 and info.st_size > 0) {
+    fFileBytes += info.st_size;
+    if(fReadAhead) {
+      // The reader's handle is not ours, so the sequential hint only widens the read-ahead of this one;
+      // WILLNEED starts reading the whole file into the page cache, where the reader then finds it.
+      int err = posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      if(err == 0) err = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+      if(err != 0) LogEXOMsg("Could not read ahead " + fCurrentFile + "; reading it without", EEWarning);
+    }
+  }
+  close(fd);
+}
+
 // Replace the virtual function in the binary package with one that outputs notifications to the screen.
 void EXOAnalysisReader::notify(NotifyReason reason)
 {
@@ -1173,6 +1460,8 @@ void EXOAnalysisReader::notify(NotifyReason reason)
   if (reason == ReadReverse) {
     cout<<"EXOBinaryFileInputModule: Reading back to file "<<file_name()<<endl;
   }
+  if (reason == Close) fCurrentFile = "";
+  else StartFile();
 }
 
 // Replace the virtual function in the binary package with one that outputs notifications to the screen.
@@ -7,8 +7,10 @@
 #include "EXOBinaryPackage/Run/Type.hh"
 #include "EXOUtilities/EXOControlRecordList.hh"
 #include "TBits.h"
+#include "TStopwatch.h"
 
 #include <deque>
+#include <vector>
 
 class EXOEventData;
 
@@ -89,6 +91,27 @@ class EXOBinaryFileInputModule: public EXOInputModule
 
     EXOControlRecordList fRecords;
 
+    // Input statistics, printed at ShutDown.
+    bool          fReadAhead;        // Prefetch each file into the page cache (/binput/readahead)
+    Long64_t      fFileBytes;        // Total size of the files opened, not the bytes consumed
+    Long64_t      fTPCFramesRead;
+    Long64_t      fVetoFramesRead;
+    Long64_t      fOtherFramesRead;  // Ignored (damaged, empty, ...) frames
+    TStopwatch    fReadTimer;        // Time spent in GetNextEvent
+
+    // TPC frames whose waveforms are still being converted into their events, in the order of
+    // fEventDataDeque, and a pool of spent frames.  Defined in the .cc, as is the thread pool.
+    struct TPCFrame;
+    class DecodePool;
+    const static size_t fMaxPendingFrames = 64; // Frames decoded ahead of the events returned.
+    int                    fNumDecodeThreads;
+    DecodePool*            fDecodePool;
+    std::deque<TPCFrame*>  fPendingFrames;
+    std::vector<TPCFrame*> fTPCFramePool;
+    TPCFrame* GetCleanTPCFrame();
+    void RetireFrontFrame();
+    void FinishDecoding(const EXOEventData* event);
+
     void replace_cleared_data(EXOEventData* event);
     void handle_frame_tpcdata( Exo::File::Frame::TpcData::Descriptor& frameDescriptor );
     void handle_frame_vetodata( Exo::File::Frame::VetoData::Descriptor& vetoDescriptor );
@@ -152,6 +175,13 @@ class EXOBinaryFileInputModule: public EXOInputModule
   
     void print_map_data();
     void SetSkipEvents(int aval) { fSkipEvents = aval; }
+    void SetReadAhead(bool aval) { fReadAhead = aval; }
+    void SetDecodeThreads(int aval);
+
+    Long64_t GetFileBytes() const { return fFileBytes; }
+    Long64_t GetFramesRead() const { return fTPCFramesRead + fVetoFramesRead + fOtherFramesRead; }
+    double GetReadSeconds() { return fReadTimer.RealTime(); }
+    void PrintReadStatistics();
     
   
     DEFINE_EXO_ANALYSIS_MODULE( EXOBinaryFileInputModule )
@@ -0,0 +1,215 @@
+//______________________________________________________________________________
+// binput_threads
+//
+// Checks that decoding TPC frames on threads (/binput/decodethreads) gives
+// the same events as decoding them as they are read.  The binary file is
+// processed twice with EXOAnalysis, into a ROOT file each time: once with no
+// decoding threads and once with the given number.  The two trees must hold
+// the same events, in the same order, with the same headers, veto summaries
+// and waveforms, otherwise the program exits with 1.  Needs a build with the
+// binary package (the binput plugin) and threads.
+//
+// If a second binary file, holding a frame with a truncated waveform, is
+// given, it is processed both ways too.  Such a frame stops the job with an
+// alert as it is read, so both runs must fail on the alert after handing out
+// the same number of events.
+//
+// Usage: ./binput_threads binary_file [threads] [maxevents] [truncated_file]
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOEventData.hh"
+#include "EXOUtilities/EXOWaveformData.hh"
+#include "EXOUtilities/EXOTPCVetoSummary.hh"
+#include "TFile.h"
+#include "TTree.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// Process binaryFile with EXOAnalysis into outputFile, with its output in
+// outputFile.log.  Returns the exit status of EXOAnalysis.
+int Run(const std::string& binaryFile, int threads, int maxEvents, const std::string& outputFile)
+{
+  std::ostringstream script;
+  script << "binput_threads_" << getpid() << "_" << threads << ".exo";
+  {
+    std::ofstream out(script.str().c_str());
+    out << "load $EXOLIB/plugins/EXOBinaryFileInputModule.so\n"
+        << "use binput toutput\n"
+        << "/input/file " << binaryFile << "\n"
+        << "/binput/decodethreads " << threads << "\n"
+        << "/toutput/file " << outputFile << "\n"
+        << "printmodulo 1\n";
+    if(maxEvents > 0) out << "maxevents " << maxEvents << "\n";
+    out << "begin\nexit\n";
+  }
+  std::string command = "EXOAnalysis " + script.str() + " > " + outputFile + ".log 2>&1";
+  int status = system(command.c_str());
+  remove(script.str().c_str());
+  return status;
+}
+
+bool Process(const std::string& binaryFile, int threads, int maxEvents, const std::string& outputFile)
+{
+  if(Run(binaryFile, threads, maxEvents, outputFile) != 0) {
+    std::cout << "EXOAnalysis failed with " << threads << " threads, see " << outputFile << ".log" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool SameWaveforms(EXOWaveformData& a, EXOWaveformData& b)
+{
+  a.Decompress();
+  b.Decompress();
+  if(a.fNumSamples != b.fNumSamples or a.GetNumWaveforms() != b.GetNumWaveforms()) return false;
+  for(size_t i = 0; i < a.GetNumWaveforms(); i++) {
+    const EXOWaveform& wfa = *a.GetWaveform(i);
+    const EXOWaveform& wfb = *b.GetWaveform(i);
+    if(wfa.fChannel != wfb.fChannel or wfa.GetLength() != wfb.GetLength()) return false;
+    for(size_t j = 0; j < wfa.GetLength(); j++) {
+      if(wfa[j] != wfb[j]) return false;
+    }
+  }
+  return true;
+}
+
+bool SameVetoes(const EXOEventHeader& a, const EXOEventHeader& b)
+{
+  if(a.GetNumVetoSummaries() != b.GetNumVetoSummaries()) return false;
+  for(size_t i = 0; i < a.GetNumVetoSummaries(); i++) {
+    const EXOTPCVetoSummary& va = *a.GetVetoSummary(i);
+    const EXOTPCVetoSummary& vb = *b.GetVetoSummary(i);
+    if(va.fChannel != vb.fChannel or
+       va.fMicroSecondsBeforeTPCTrigger != vb.fMicroSecondsBeforeTPCTrigger or
+       not (va.fMask == vb.fMask)) return false;
+  }
+  return true;
+}
+
+// Compare the trees of the two output files, event by event.
+bool Compare(const std::string& serialFile, const std::string& threadedFile)
+{
+  TFile serial(serialFile.c_str());
+  TFile threaded(threadedFile.c_str());
+  TTree* serialTree = dynamic_cast<TTree*>(serial.Get("tree"));
+  TTree* threadedTree = dynamic_cast<TTree*>(threaded.Get("tree"));
+  if(not serialTree or not threadedTree) {
+    std::cout << "An output file has no tree" << std::endl;
+    return false;
+  }
+  if(serialTree->GetEntries() != threadedTree->GetEntries()) {
+    std::cout << "Serial: " << serialTree->GetEntries() << " events, threaded: "
+              << threadedTree->GetEntries() << std::endl;
+    return false;
+  }
+  if(serialTree->GetEntries() == 0) {
+    std::cout << "No events were read" << std::endl;
+    return false;
+  }
+
+  EXOEventData* a = NULL;
+  EXOEventData* b = NULL;
+  serialTree->SetBranchAddress("EventBranch", &a);
+  threadedTree->SetBranchAddress("EventBranch", &b);
+  bool ok = true;
+  for(Long64_t i = 0; i < serialTree->GetEntries() and ok; i++) {
+    serialTree->GetEntry(i);
+    threadedTree->GetEntry(i);
+    const EXOEventHeader& ha = a->fEventHeader;
+    const EXOEventHeader& hb = b->fEventHeader;
+    ok = a->fRunNumber == b->fRunNumber and
+         a->fEventNumber == b->fEventNumber and
+         ha.fTriggerSeconds == hb.fTriggerSeconds and
+         ha.fTriggerMicroSeconds == hb.fTriggerMicroSeconds and
+         ha.fTriggerDrift == hb.fTriggerDrift and
+         ha.fTriggerOffset == hb.fTriggerOffset and
+         ha.fSampleCount == hb.fSampleCount and
+         SameVetoes(ha, hb) and
+         SameWaveforms(*a->GetWaveformData(), *b->GetWaveformData());
+    if(not ok) std::cout << "Entry " << i << " (event " << a->fEventNumber << ") differs" << std::endl;
+  }
+  serialTree->ResetBranchAddresses();
+  threadedTree->ResetBranchAddresses();
+  delete a;
+  delete b;
+  if(ok) std::cout << serialTree->GetEntries() << " events identical" << std::endl;
+  return ok;
+}
+
+// Read the log of outputFile: the number of events handed out (printmodulo)
+// and whether a truncated waveform was reported.
+void ReadLog(const std::string& outputFile, long& events, bool& truncated)
+{
+  std::ifstream log((outputFile + ".log").c_str());
+  std::string line;
+  events = 0;
+  truncated = false;
+  while(std::getline(log, line)) {
+    if(line.find(" events processed") != std::string::npos) events = atol(line.c_str());
+    if(line.find("inappropriately truncated") != std::string::npos) truncated = true;
+  }
+}
+
+// A truncated waveform must stop both runs at the same frame, so no events
+// after it reach the output with threads either.
+bool CheckTruncated(const std::string& truncatedFile, int threads, const std::string& prefix)
+{
+  std::string serialFile = prefix + "_truncated_serial.root";
+  std::string threadedFile = prefix + "_truncated_threaded.root";
+  long serialEvents, threadedEvents;
+  bool serialTruncated, threadedTruncated;
+  bool failed = Run(truncatedFile, 0, 0, serialFile) != 0 and
+                Run(truncatedFile, threads, 0, threadedFile) != 0;
+  ReadLog(serialFile, serialEvents, serialTruncated);
+  ReadLog(threadedFile, threadedEvents, threadedTruncated);
+  bool ok = failed and serialTruncated and threadedTruncated and serialEvents == threadedEvents;
+  std::cout << "Truncated frame: serial stopped after " << serialEvents << " events, threaded after "
+            << threadedEvents << (ok ? "" : " -- FAILED") << std::endl;
+  if(not serialTruncated or not threadedTruncated) {
+    std::cout << "No truncated waveform reported; see the logs" << std::endl;
+  }
+  if(ok) {
+    remove(serialFile.c_str());
+    remove(threadedFile.c_str());
+    remove((serialFile + ".log").c_str());
+    remove((threadedFile + ".log").c_str());
+  }
+  return ok;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  if(argc < 2) {
+    std::cout << "Usage: " << argv[0] << " binary_file [threads] [maxevents] [truncated_file]" << std::endl;
+    return 1;
+  }
+  std::string binaryFile = argv[1];
+  int threads = (argc > 2) ? atoi(argv[2]) : 4;
+  int maxEvents = (argc > 3) ? atoi(argv[3]) : 0;
+
+  std::ostringstream prefix;
+  prefix << "binput_threads_" << getpid();
+  std::string serialFile = prefix.str() + "_serial.root";
+  std::string threadedFile = prefix.str() + "_threaded.root";
+
+  bool ok = Process(binaryFile, 0, maxEvents, serialFile) and
+            Process(binaryFile, threads, maxEvents, threadedFile) and
+            Compare(serialFile, threadedFile);
+  if(ok) {
+    remove(serialFile.c_str());
+    remove(threadedFile.c_str());
+    remove((serialFile + ".log").c_str());
+    remove((threadedFile + ".log").c_str());
+  }
+  if(argc > 4) ok = CheckTruncated(argv[4], threads, prefix.str()) and ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+//______________________________________________________________________________
+// columnar_roundtrip
+//
+// Writes a columnar file with EXOColumnarFileWriter and reads it back with
+// EXOColumnarFile.  The file has Int_t, Long64_t and Double_t columns at the
+// event and charge cluster levels, with enough values to be spooled in
+// several chunks and row counts which are not multiples of 64 bytes, and an
+// empty scintillation cluster column.  Every column must come back with its
+// name, type, level and values, starting on a 64-byte boundary.  Then the
+// rejection paths are checked: a writer whose columns of one level have
+// different lengths must not leave a file, and truncated or corrupted copies
+// of the file (magic, version, directory, names, types, levels, offsets, row
+// counts) must not open.  Any failure makes the program exit with 1.
+//
+// Usage: ./columnar_roundtrip
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOColumnarFile.hh"
+#include "EXOUtilities/EXOColumnarFileWriter.hh"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const Long64_t gfNumEvents = 20011;     // More than a spool buffer of Long64_t
+const Long64_t gfNumClusters = 45007;
+
+// Deterministic values, different for each column and row.
+Int_t IntValue(Long64_t row) { return Int_t(row*7 - 3); }
+Long64_t Long64Value(Long64_t row) { return (Long64_t(1) << 40) + row*1000003; }
+Double_t DoubleValue(Long64_t row) { return 0.5 + row/3.; }
+
+std::string TempName(const char* what)
+{
+  std::ostringstream name;
+  name << "columnar_roundtrip_" << getpid() << "_" << what << ".col";
+  return name.str();
+}
+
+bool Exists(const std::string& filename)
+{
+  std::ifstream in(filename.c_str());
+  return in.good();
+}
+
+bool Write(const std::string& filename)
+{
+  EXOColumnarFileWriter writer;
+  size_t run = writer.AddColumn("run", EXOColumnarFile::kInt, EXOColumnarFile::kEvent);
+  size_t time = writer.AddColumn("time", EXOColumnarFile::kLong64, EXOColumnarFile::kEvent);
+  size_t energy = writer.AddColumn("energy", EXOColumnarFile::kDouble, EXOColumnarFile::kEvent);
+  size_t channel = writer.AddColumn("cl_channel", EXOColumnarFile::kInt, EXOColumnarFile::kChargeCluster);
+  size_t id = writer.AddColumn("cl_id", EXOColumnarFile::kLong64, EXOColumnarFile::kChargeCluster);
+  size_t charge = writer.AddColumn("cl_charge", EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster);
+  writer.AddColumn("sc_counts", EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster);
+  if(not writer.Open(filename)) return false;
+  // Interleave the levels, as the coutput module does.
+  Long64_t cluster = 0;
+  for(Long64_t i = 0; i < gfNumEvents; i++) {
+    writer.Fill(run, IntValue(i));
+    writer.Fill(time, Long64Value(i));
+    writer.Fill(energy, DoubleValue(i));
+    Long64_t last = (i + 1)*gfNumClusters/gfNumEvents;
+    for(; cluster < last; cluster++) {
+      writer.Fill(channel, IntValue(cluster));
+      writer.Fill(id, Long64Value(cluster));
+      writer.Fill(charge, DoubleValue(cluster));
+    }
+  }
+  return writer.Close();
+}
+
+template<class T>
+bool CheckColumn(const EXOColumnarFile& file, const std::string& name, const T* values,
+                 EXOColumnarFile::EType type, EXOColumnarFile::ELevel level, T (*expected)(Long64_t))
+{
+  int column = file.FindColumn(name);
+  bool ok = values != NULL and column >= 0 and
+            file.GetColumnType(column) == type and file.GetColumnLevel(column) == level and
+            reinterpret_cast<size_t>(values) % 64 == 0;
+  for(Long64_t i = 0; ok and i < file.GetNumRows(level); i++) ok = values[i] == expected(i);
+  if(not ok) std::cout << "Column " << name << " did not come back as written" << std::endl;
+  return ok;
+}
+
+bool Read(const std::string& filename)
+{
+  EXOColumnarFile file;
+  if(not file.Open(filename)) {
+    std::cout << "Unable to open the file just written" << std::endl;
+    return false;
+  }
+  bool ok = file.GetNumEvents() == gfNumEvents and
+            file.GetNumRows(EXOColumnarFile::kChargeCluster) == gfNumClusters and
+            file.GetNumRows(EXOColumnarFile::kScintillationCluster) == 0 and
+            file.GetNumColumns() == 7 and file.GetColumnName(0) == "run" and
+            file.FindColumn("sc_counts") == 6 and file.FindColumn("none") == -1;
+  if(not ok) std::cout << "Wrong numbers of rows or columns" << std::endl;
+
+  ok = CheckColumn(file, "run", file.GetIntColumn("run"),
+                   EXOColumnarFile::kInt, EXOColumnarFile::kEvent, IntValue) and ok;
+  ok = CheckColumn(file, "time", file.GetLong64Column("time"),
+                   EXOColumnarFile::kLong64, EXOColumnarFile::kEvent, Long64Value) and ok;
+  ok = CheckColumn(file, "energy", file.GetDoubleColumn("energy"),
+                   EXOColumnarFile::kDouble, EXOColumnarFile::kEvent, DoubleValue) and ok;
+  ok = CheckColumn(file, "cl_channel", file.GetIntColumn("cl_channel"),
+                   EXOColumnarFile::kInt, EXOColumnarFile::kChargeCluster, IntValue) and ok;
+  ok = CheckColumn(file, "cl_id", file.GetLong64Column("cl_id"),
+                   EXOColumnarFile::kLong64, EXOColumnarFile::kChargeCluster, Long64Value) and ok;
+  ok = CheckColumn(file, "cl_charge", file.GetDoubleColumn("cl_charge"),
+                   EXOColumnarFile::kDouble, EXOColumnarFile::kChargeCluster, DoubleValue) and ok;
+  ok = CheckColumn(file, "sc_counts", file.GetDoubleColumn("sc_counts"),
+                   EXOColumnarFile::kDouble, EXOColumnarFile::kScintillationCluster, DoubleValue) and ok;
+
+  if(file.GetIntColumn("energy") or file.GetDoubleColumn("none")) {
+    std::cout << "A column of another type or name was returned" << std::endl;
+    ok = false;
+  }
+  file.Close();
+  if(file.IsOpen() or file.GetNumEvents() != 0) {
+    std::cout << "The file is still open after Close" << std::endl;
+    ok = false;
+  }
+  return ok;
+}
+
+// A writer whose event columns have different lengths must fail, and leave
+// neither the file nor its spool behind.
+bool CheckUnevenColumns(const std::string& filename)
+{
+  bool closed;
+  {
+    EXOColumnarFileWriter writer;
+    size_t a = writer.AddColumn("a", EXOColumnarFile::kInt, EXOColumnarFile::kEvent);
+    size_t b = writer.AddColumn("b", EXOColumnarFile::kDouble, EXOColumnarFile::kEvent);
+    if(not writer.Open(filename)) return false;
+    writer.Fill(a, Int_t(1));
+    writer.Fill(a, Int_t(2));
+    writer.Fill(b, Double_t(1.));
+    closed = writer.Close();
+  }
+  std::ostringstream spool;
+  spool << filename << ".spool." << getpid();
+  bool ok = not closed and not Exists(filename) and not Exists(spool.str());
+  if(not ok) std::cout << "Columns of different lengths were written" << std::endl;
+  remove(filename.c_str());
+  return ok;
+}
+
+typedef void (*Corruption)(std::vector<char>& bytes);
+
+EXOColumnarFile::Header& HeaderOf(std::vector<char>& bytes)
+{
+  return *reinterpret_cast<EXOColumnarFile::Header*>(&bytes[0]);
+}
+
+EXOColumnarFile::Column& ColumnOf(std::vector<char>& bytes, size_t column)
+{
+  return reinterpret_cast<EXOColumnarFile::Column*>(&bytes[sizeof(EXOColumnarFile::Header)])[column];
+}
+
+void ShorterThanHeader(std::vector<char>& bytes) { bytes.resize(sizeof(EXOColumnarFile::Header) - 1); }
+void CutInLastColumn(std::vector<char>& bytes)
+{
+  // sc_counts is empty; the last values are those of cl_charge.
+  bytes.resize(ColumnOf(bytes, 5).fOffset + (gfNumClusters - 1)*sizeof(Double_t));
+}
+void BadMagic(std::vector<char>& bytes) { HeaderOf(bytes).fMagic[0] = 'X'; }
+void OtherVersion(std::vector<char>& bytes) { HeaderOf(bytes).fVersion++; }
+void DirectoryPastEnd(std::vector<char>& bytes) { HeaderOf(bytes).fNumColumns = 0x10000000; }
+void NegativeRows(std::vector<char>& bytes) { HeaderOf(bytes).fNumRows[EXOColumnarFile::kEvent] = -1; }
+void TooManyRows(std::vector<char>& bytes) { HeaderOf(bytes).fNumRows[EXOColumnarFile::kChargeCluster] += 100; }
+void UnterminatedName(std::vector<char>& bytes)
+{
+  memset(ColumnOf(bytes, 2).fName, 'x', sizeof(ColumnOf(bytes, 2).fName));
+}
+void BadType(std::vector<char>& bytes) { ColumnOf(bytes, 1).fType = EXOColumnarFile::kDouble + 1; }
+void BadLevel(std::vector<char>& bytes) { ColumnOf(bytes, 1).fLevel = EXOColumnarFile::kNumLevels; }
+void Misaligned(std::vector<char>& bytes) { ColumnOf(bytes, 0).fOffset += 8; }
+void OffsetPastEnd(std::vector<char>& bytes) { ColumnOf(bytes, 6).fOffset = (bytes.size()/64 + 1)*64; }
+
+bool CheckRejected(const std::vector<char>& good, const char* what, Corruption corrupt)
+{
+  std::vector<char> bytes(good);
+  corrupt(bytes);
+  std::string filename = TempName("damaged");
+  {
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    if(not bytes.empty()) out.write(&bytes[0], bytes.size());
+  }
+  EXOColumnarFile file;
+  bool opened = file.Open(filename);
+  bool ok = not opened and not file.IsOpen();
+  if(not ok) std::cout << "A file with " << what << " was opened" << std::endl;
+  file.Close();
+  remove(filename.c_str());
+  return ok;
+}
+
+bool CheckRejections(const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  std::vector<char> good((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if(good.size() < sizeof(EXOColumnarFile::Header) + 7*sizeof(EXOColumnarFile::Column)) {
+    std::cout << "The file is too short" << std::endl;
+    return false;
+  }
+  bool ok = true;
+  ok = CheckRejected(good, "no header", ShorterThanHeader) and ok;
+  ok = CheckRejected(good, "a truncated column", CutInLastColumn) and ok;
+  ok = CheckRejected(good, "a bad magic", BadMagic) and ok;
+  ok = CheckRejected(good, "another version", OtherVersion) and ok;
+  ok = CheckRejected(good, "a directory past the end", DirectoryPastEnd) and ok;
+  ok = CheckRejected(good, "a negative row count", NegativeRows) and ok;
+  ok = CheckRejected(good, "too many rows", TooManyRows) and ok;
+  ok = CheckRejected(good, "an unterminated name", UnterminatedName) and ok;
+  ok = CheckRejected(good, "a bad type", BadType) and ok;
+  ok = CheckRejected(good, "a bad level", BadLevel) and ok;
+  ok = CheckRejected(good, "a misaligned column", Misaligned) and ok;
+  ok = CheckRejected(good, "a column past the end", OffsetPastEnd) and ok;
+  return ok;
+}
+
+}
+
+int main()
+{
+  std::string filename = TempName("good");
+  bool ok = Write(filename);
+  if(not ok) std::cout << "Unable to write " << filename << std::endl;
+  ok = ok and Read(filename);
+  ok = ok and CheckRejections(filename);
+  remove(filename.c_str());
+  ok = CheckUnevenColumns(TempName("uneven")) and ok;
+
+  std::cout << (ok ? "Round trip and rejections OK" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+//______________________________________________________________________________
+// gradient_check
+//
+// Compares the analytic NLL gradient of the MC-based energy fits
+// (SetAnalyticGradient, FitFunctionGradient) with central differences of the
+// NLL, for EXOEnergyMCBasedFit1D and EXOEnergyMCBasedFitEL, each without and
+// with the prescale trigger efficiency model.  BuildFitter tells Minuit to
+// trust the gradient ("SET GRAdient 1"), so this is where it is checked.
+// The data are smeared from the MC with a slightly different calibration
+// and resolution than the starting parameters of the fit.  Every derivative
+// must agree with the central difference within tolerance (relative),
+// otherwise the program exits with 1.
+//
+// Usage: ./gradient_check [tolerance]
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOEnergyMCBasedFit1D.hh"
+#include "EXOUtilities/EXOEnergyMCBasedFitEL.hh"
+#include "TF1.h"
+#include "TF2.h"
+#include "TString.h"
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+// FitFunction and FitFunctionGradient are protected; the NLL needs fFitType 1.
+template<class Fit>
+class GradientFit : public Fit
+{
+  public:
+    GradientFit() { this->fFitType = 1; this->SetVerboseLevel(-1); }
+    double Value(const std::vector<double>& x) { return this->FitFunction(&x[0]); }
+    double Gradient(const std::vector<double>& x, std::vector<double>& grad)
+      { grad.assign(x.size(), 0.); return this->FitFunctionGradient(&x[0], &grad[0]); }
+    std::vector<Double_t> Parameters() { return this->GetFittedParameters(); }
+};
+
+// From a simple LCG so that the input does not depend on gRandom.
+unsigned long gState = 12345;
+
+double Uniform()
+{
+  gState = (1103515245*gState + 12345) % 2147483648UL;
+  return (gState + 0.5)/2147483648.;
+}
+
+double Gaus()
+{
+  return std::sqrt(-2.*std::log(Uniform()))*std::cos(2.*M_PI*Uniform());
+}
+
+struct Sample
+{
+  std::vector<Double_t> fMCEnergy, fMCPdf, fMCZ;
+  std::vector<Double_t> fDataEnergy, fDataZ;
+};
+
+// A falling continuum with three lines, and data drawn from it with a gain
+// of 0.99, an offset of 3 keV and a resolution of about 2% at 2615 keV.
+// z is uniform in [-200, 300) mm, so that every z bin of the EL fit,
+// including the one above the last edge, gets MC and data.
+void MakeSample(Sample& sample)
+{
+  for(size_t i = 0; i < 3000; i++) {
+    sample.fMCEnergy.push_back(300. + 0.9*i);
+    sample.fMCPdf.push_back(40.*std::exp(-i/800.)*(0.5 + 0.5*Uniform()));
+    sample.fMCZ.push_back(-200. + 500.*Uniform());
+  }
+  const double lines[3] = {1173.2, 1332.5, 2614.5};
+  for(size_t i = 0; i < 300; i++) {
+    sample.fMCEnergy.push_back(lines[i%3]);
+    sample.fMCPdf.push_back(40.);
+    sample.fMCZ.push_back(-200. + 500.*Uniform());
+  }
+
+  while(sample.fDataEnergy.size() < 20000) {
+    size_t i = size_t(Uniform()*sample.fMCEnergy.size());
+    if(40.*Uniform() > sample.fMCPdf[i]) continue;
+    double energy = sample.fMCEnergy[i];
+    double sigma = std::sqrt(0.5*0.5*energy + 15.*15. + 0.012*0.012*energy*energy);
+    sample.fDataEnergy.push_back((energy + sigma*Gaus() - 3.)/0.99);
+    sample.fDataZ.push_back(-200. + 500.*Uniform());
+  }
+}
+
+// The 1D fit's data set is Th228 (prescale model) or Cs137 (no model).
+void SetFunctions(EXOEnergyMCBasedFit1D& fit, TF1& calib, TF1& resol, TF1& trigEff, bool prescale)
+{
+  resol.SetParameters(0.6, 20., 0.01);
+  fit.SetFunction("calib", &calib);
+  fit.SetFunction("resol", &resol);
+  if(prescale) {
+    // The cut (parameter 0) is in the middle of a 20 keV bin, so that the
+    // central differences do not move it to another bin.
+    trigEff.SetParameters(810., 40.);
+    fit.SetFunction("trigeff", &trigEff);
+  }
+}
+
+bool Setup1D(GradientFit<EXOEnergyMCBasedFit1D>& fit, Sample& sample, bool prescale)
+{
+  TF1 calib("calib1D", "[0] + [1]*x", 0., 5000.);
+  calib.SetParameters(5., 1.02);
+  TF1 resol("resol1D", "sqrt([0]*[0]*x + [1]*[1] + [2]*[2]*x*x)", 0., 5000.);
+  TF1 trigEff("trigEff1D", "0.5*(1 + TMath::Erf((x - [0])/[1]))", 0., 5000.);
+  SetFunctions(fit, calib, resol, trigEff, prescale);
+
+  int Z = prescale ? 90 : 55;
+  int A = prescale ? 228 : 137;
+  std::vector<TString> dataIds(1, "data");
+  return fit.AddMC("mc", Z, A, 0., 0., 0., &sample.fMCEnergy[0], &sample.fMCPdf[0], sample.fMCEnergy.size()) and
+         fit.AddData("data", "mc", Z, A, 0., 0., 0., prescale ? 1 : 0, &sample.fDataEnergy[0], sample.fDataEnergy.size()) and
+         fit.SetDataHisto("histo", "1D", dataIds, 125, 500., 3000.) and
+         fit.BuildFitter();
+}
+
+bool SetupEL(GradientFit<EXOEnergyMCBasedFitEL>& fit, Sample& sample, bool prescale)
+{
+  TF2 calib("calibEL", "[0] + [1]*x*(1 + [2]*y*1e-4)", 0., 5000., -1000., 1000.);
+  calib.SetParameters(5., 1.02, 0.5);
+  TF1 resol("resolEL", "sqrt([0]*[0]*x + [1]*[1] + [2]*[2]*x*x)", 0., 5000.);
+  TF1 trigEff("trigEffEL", "0.5*(1 + TMath::Erf((x - [0])/[1]))", 0., 5000.);
+  SetFunctions(fit, calib, resol, trigEff, prescale);
+
+  int Z = prescale ? 90 : 55;
+  int A = prescale ? 228 : 137;
+  Double_t zBins[3] = {-200., 0., 200.};
+  std::vector<TString> dataIds(1, "data");
+  return fit.AddMC("mc", Z, A, 0., 0., 0., &sample.fMCEnergy[0], &sample.fMCPdf[0], &sample.fMCZ[0], sample.fMCEnergy.size()) and
+         fit.AddData("data", "mc", Z, A, 0., 0., 0., prescale ? 1 : 0, &sample.fDataEnergy[0], &sample.fDataZ[0], sample.fDataEnergy.size()) and
+         fit.SplitZbins(zBins, 2) and
+         fit.SetDataHisto("histo", "EL", dataIds, 125, 500., 3000.) and
+         fit.BuildFitter();
+}
+
+template<class Fit>
+bool Check(const char* name, Fit& fit, double tolerance)
+{
+  std::vector<double> x = fit.Parameters();
+  if(x.empty()) {
+    std::cout << name << ": no free parameters -- FAILED" << std::endl;
+    return false;
+  }
+  std::vector<double> grad;
+  double value = fit.Gradient(x, grad);
+  double plain = fit.Value(x);
+  bool ok = std::fabs(value - plain) <= 1e-9*std::fabs(plain);
+  if(not ok)
+    std::cout << name << ": NLL " << value << " with the gradient, " << plain << " without -- FAILED" << std::endl;
+
+  double worst = 0.;
+  for(size_t p = 0; p < x.size(); p++) {
+    double h = 1e-5*std::max(std::fabs(x[p]), 1.);
+    std::vector<double> xp(x), xm(x);
+    xp[p] += h;
+    xm[p] -= h;
+    double numeric = (fit.Value(xp) - fit.Value(xm))/(2.*h);
+    // Rounding of the NLL limits how well the central difference is known.
+    double slack = 1e-10*std::fabs(plain)/h;
+    double diff = std::fabs(grad[p] - numeric);
+    double scale = std::max(std::fabs(grad[p]), std::fabs(numeric));
+    bool parOk = diff <= tolerance*scale + slack;
+    if(scale > 0 and diff/scale > worst) worst = diff/scale;
+    if(not parOk)
+      std::cout << name << ": parameter " << p << " analytic " << grad[p]
+                << ", central difference " << numeric << " -- FAILED" << std::endl;
+    ok = parOk and ok;
+  }
+  std::cout << name << ": " << x.size() << " parameters, largest relative deviation "
+            << worst << (ok ? "" : " -- FAILED") << std::endl;
+  return ok;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  double tolerance = (argc > 1) ? atof(argv[1]) : 1e-4;
+
+  Sample sample;
+  MakeSample(sample);
+  bool ok = true;
+
+  for(int prescale = 0; prescale <= 1; prescale++) {
+    {
+      GradientFit<EXOEnergyMCBasedFit1D> fit;
+      const char* name = prescale ? "1D with prescale model" : "1D";
+      if(Setup1D(fit, sample, prescale)) ok = Check(name, fit, tolerance) and ok;
+      else {
+        std::cout << name << ": setting up the fit -- FAILED" << std::endl;
+        ok = false;
+      }
+    }
+    {
+      GradientFit<EXOEnergyMCBasedFitEL> fit;
+      const char* name = prescale ? "EL with prescale model" : "EL";
+      if(SetupEL(fit, sample, prescale)) ok = Check(name, fit, tolerance) and ok;
+      else {
+        std::cout << name << ": setting up the fit -- FAILED" << std::endl;
+        ok = false;
+      }
+    }
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+//______________________________________________________________________________
+// mc_cache_roundtrip
+//
+// Saves the binned MC of an EXOEnergyMCBasedFit1D in a cache directory
+// (SetMCCacheDirectory, SetMCCacheKey, BinMCEnergy) and reads it back, both
+// with AddCachedMC and with BinMCEnergy on an entry holding the same MC
+// energies; the binning must come back as it was made without a cache.  An
+// entry whose energies differ from those the cache was made from (another
+// weight, one point less) must be binned again, and the cache replaced.
+// AddCachedMC must refuse another key, granularity, cutoff or dimension,
+// also when the file of the right binning is copied to their names, and
+// truncated or corrupted files.  Any failure makes the program exit with 1.
+//
+// Usage: ./mc_cache_roundtrip
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOEnergyMCBasedFit1D.hh"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const Int_t gfGran = 2;
+const char* gfKey = "run_4000-4100/ss";
+
+// The cache helpers are protected.
+class Fit : public EXOEnergyMCBasedFit1D
+{
+  public:
+    Fit(const std::string& dir) { SetMCCacheDirectory(dir.c_str()); }
+    bool Add(const char* id, std::vector<Double_t>& energy, std::vector<Double_t>& pdf)
+      { return AddMC(id, 60, 27, 0., 0., 0., &energy[0], &pdf[0], energy.size()); }
+    bool AddCached(const char* id, const char* key, bool is2D, Int_t gran, Double_t cutoff)
+      { return AddCachedMC(id, key, 60, 27, 0., 0., 0., is2D, gran, cutoff); }
+    MCEntry& GetMC(const char* id) { return fMCList[id]; }
+    std::string CacheFile(const char* key, bool is2D, Int_t gran, Double_t cutoff) const
+      { return GetMCCacheFile(key, is2D, gran, cutoff); }
+    bool Save(const char* id, ULong64_t numRawPoints, Double_t rawWeightSum) const
+      { return WriteBinnedMC(fMCList.find(id)->second, numRawPoints, rawWeightSum); }
+};
+
+void MakeSpectrum(std::vector<Double_t>& energy, std::vector<Double_t>& pdf)
+{
+  // From a simple LCG so that the input does not depend on gRandom.
+  unsigned long state = 12345;
+  for(size_t i = 0; i < 20000; i++) {
+    state = (1103515245*state + 12345) % 2147483648UL;
+    energy.push_back(3000.*double(state)/2147483648.);
+    state = (1103515245*state + 12345) % 2147483648UL;
+    pdf.push_back(0.5 + double(state)/2147483648.);
+  }
+}
+
+std::string TempDir()
+{
+  std::ostringstream name;
+  name << "mc_cache_roundtrip_" << getpid();
+  return name.str();
+}
+
+void RemoveDir(const std::string& dir)
+{
+  DIR* d = opendir(dir.c_str());
+  if(not d) return;
+  for(dirent* entry = readdir(d); entry; entry = readdir(d)) {
+    std::string name = entry->d_name;
+    if(name != "." and name != "..") remove((dir + "/" + name).c_str());
+  }
+  closedir(d);
+  rmdir(dir.c_str());
+}
+
+std::vector<char> ReadBytes(const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  return std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+void WriteBytes(const std::string& filename, const std::vector<char>& bytes)
+{
+  std::ofstream out(filename.c_str(), std::ios::binary);
+  if(not bytes.empty()) out.write(&bytes[0], bytes.size());
+}
+
+bool SameBinning(const MCEntry& a, const MCEntry& b)
+{
+  return a.BinnedGran == b.BinnedGran and a.BinnedCutoff == b.BinnedCutoff and
+         a.MCEnergyPoints == b.MCEnergyPoints and a.MCEnergyPDF == b.MCEnergyPDF;
+}
+
+// The binning of energy and pdf without a cache.
+MCEntry Reference(std::vector<Double_t> energy, std::vector<Double_t> pdf)
+{
+  Fit fit("");
+  fit.Add("mc", energy, pdf);
+  fit.BinMCEnergy(gfGran);
+  return fit.GetMC("mc");
+}
+
+// Bin energy and pdf with the cache; the result must be expected.
+bool CheckBinned(const std::string& dir, const char* what, std::vector<Double_t> energy,
+                 std::vector<Double_t> pdf, const MCEntry& expected)
+{
+  Fit fit(dir);
+  fit.Add("mc", energy, pdf);
+  fit.SetMCCacheKey("mc", gfKey);
+  fit.BinMCEnergy(gfGran);
+  bool ok = SameBinning(fit.GetMC("mc"), expected);
+  if(not ok) std::cout << "Binning " << what << " did not give the expected MC" << std::endl;
+  return ok;
+}
+
+// AddCachedMC of gfKey at gfGran must give expected.
+bool CheckCached(const std::string& dir, const char* what, const MCEntry& expected)
+{
+  Fit fit(dir);
+  bool ok = fit.AddCached("mc", gfKey, false, gfGran, 0) and SameBinning(fit.GetMC("mc"), expected);
+  if(not ok) std::cout << "The cache " << what << " did not read back as written" << std::endl;
+  return ok;
+}
+
+bool CheckRefused(const std::string& dir, const char* what, const char* key, bool is2D, Int_t gran, Double_t cutoff)
+{
+  Fit fit(dir);
+  bool ok = not fit.AddCached("mc", key, is2D, gran, cutoff);
+  if(not ok) std::cout << "The cache was read for " << what << std::endl;
+  return ok;
+}
+
+// The file of the right binning, copied to the name of another one, must be
+// refused by its header.
+bool CheckCopyRefused(const std::string& dir, const std::vector<char>& good, const char* what,
+                      const char* key, bool is2D, Int_t gran, Double_t cutoff)
+{
+  Fit fit(dir);
+  std::string filename = fit.CacheFile(key, is2D, gran, cutoff);
+  WriteBytes(filename, good);
+  bool ok = CheckRefused(dir, what, key, is2D, gran, cutoff);
+  remove(filename.c_str());
+  return ok;
+}
+
+bool CheckDamagedRefused(const std::string& dir, const std::vector<char>& damaged, const char* what)
+{
+  Fit fit(dir);
+  std::string filename = fit.CacheFile(gfKey, false, gfGran, 0);
+  std::vector<char> good = ReadBytes(filename);
+  WriteBytes(filename, damaged);
+  bool ok = CheckRefused(dir, what, gfKey, false, gfGran, 0);
+  WriteBytes(filename, good);
+  return ok;
+}
+
+}
+
+int main()
+{
+  std::string dir = TempDir();
+  if(mkdir(dir.c_str(), 0755) != 0) {
+    std::cout << "Unable to create " << dir << std::endl;
+    return 1;
+  }
+
+  std::vector<Double_t> energy, pdf;
+  MakeSpectrum(energy, pdf);
+  MCEntry reference = Reference(energy, pdf);
+  bool ok = reference.BinnedGran == gfGran and not reference.MCEnergyPDF.empty();
+
+  // Write, then read back in both ways.
+  ok = CheckBinned(dir, "without a cache file", energy, pdf, reference) and ok;
+  std::string filename = Fit(dir).CacheFile(gfKey, false, gfGran, 0);
+  std::vector<char> good = ReadBytes(filename);
+  if(good.empty()) {
+    std::cout << "No cache file was written" << std::endl;
+    RemoveDir(dir);
+    return 1;
+  }
+  ok = CheckCached(dir, "with AddCachedMC", reference) and ok;
+
+  // A matching entry takes the binning from the cache: save a doubled one
+  // in the name of these energies, and it must be what comes back.
+  {
+    Fit fit(dir);
+    fit.AddCached("mc", gfKey, false, gfGran, 0);
+    MCEntry& doubled = fit.GetMC("mc");
+    for(size_t i = 0; i < doubled.MCEnergyPDF.size(); i++) doubled.MCEnergyPDF[i] *= 2;
+    Double_t weightSum = 0;
+    for(size_t i = 0; i < pdf.size(); i++) weightSum += pdf[i];
+    ok = fit.Save("mc", pdf.size(), weightSum) and ok;
+    ok = CheckBinned(dir, "the same MC", energy, pdf, doubled) and ok;
+    WriteBytes(filename, good);
+  }
+
+  // Entries made from other MC energies are binned again, and replace the
+  // cache.
+  std::vector<Double_t> otherPdf(pdf);
+  otherPdf[100] += 1.;
+  MCEntry otherReference = Reference(energy, otherPdf);
+  ok = CheckBinned(dir, "with another weight", energy, otherPdf, otherReference) and ok;
+  ok = CheckCached(dir, "replaced for another weight", otherReference) and ok;
+
+  std::vector<Double_t> fewerEnergy(energy.begin(), energy.end() - 1);
+  std::vector<Double_t> fewerPdf(pdf.begin(), pdf.end() - 1);
+  MCEntry fewerReference = Reference(fewerEnergy, fewerPdf);
+  ok = CheckBinned(dir, "with one point less", fewerEnergy, fewerPdf, fewerReference) and ok;
+  ok = CheckCached(dir, "replaced for one point less", fewerReference) and ok;
+
+  ok = CheckBinned(dir, "with the first MC again", energy, pdf, reference) and ok;
+  good = ReadBytes(filename);
+
+  // Other keys and binnings.
+  ok = CheckRefused(dir, "another key", "run_4000-4100/ms", false, gfGran, 0) and ok;
+  ok = CheckRefused(dir, "another granularity", gfKey, false, gfGran + 1, 0) and ok;
+  ok = CheckRefused(dir, "another cutoff", gfKey, false, gfGran, 0.5) and ok;
+  ok = CheckRefused(dir, "2D", gfKey, true, gfGran, 0) and ok;
+  ok = CheckCopyRefused(dir, good, "another key in the file name", "run_4000-4100/ms", false, gfGran, 0) and ok;
+  ok = CheckCopyRefused(dir, good, "another key of the same length in the file name", "run_4000-4100/xx", false, gfGran, 0) and ok;
+  ok = CheckCopyRefused(dir, good, "another granularity in the file name", gfKey, false, gfGran + 1, 0) and ok;
+  ok = CheckCopyRefused(dir, good, "another cutoff in the file name", gfKey, false, gfGran, 0.5) and ok;
+  ok = CheckCopyRefused(dir, good, "2D in the file name", gfKey, true, gfGran, 0) and ok;
+
+  // Damaged files.
+  std::vector<char> damaged(good.begin(), good.begin() + 16);
+  ok = CheckDamagedRefused(dir, damaged, "a truncated header") and ok;
+  damaged.assign(good.begin(), good.end() - sizeof(Double_t));
+  ok = CheckDamagedRefused(dir, damaged, "truncated weights") and ok;
+  damaged = good;
+  damaged[0] = 'X';
+  ok = CheckDamagedRefused(dir, damaged, "a bad magic") and ok;
+  damaged.clear();
+  ok = CheckDamagedRefused(dir, damaged, "an empty file") and ok;
+  ok = CheckCached(dir, "restored after the damaged copies", reference) and ok;
+
+  RemoveDir(dir);
+  std::cout << (ok ? "Round trip and rejections OK" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python
+#
+# Compares two outputs of microbench: prints, for every case in both, the
+# median time per iteration of each and their ratio, and flags cases whose
+# checksums differ (that is, whose results changed, not only their speed).
+#
+# Usage: python compare_results.py baseline.tsv new.tsv [threshold]
+#
+# The exit status is 1 if any case is slower than baseline by more than
+# threshold (default 0.1, i.e. 10%) or changed its checksum.
+
+from __future__ import print_function
+import sys
+
+def read_results(filename):
+    results = {}
+    order = []
+    columns = None
+    for line in open(filename):
+        line = line.rstrip('\n')
+        if not line or line.startswith('#'):
+            continue
+        fields = line.split('\t')
+        if columns is None:
+            columns = fields
+            continue
+        row = dict(zip(columns, fields))
+        results[row['case']] = row
+        order.append(row['case'])
+    return order, results
+
+def same_checksum(a, b):
+    a, b = float(a), float(b)
+    return abs(a - b) <= 1e-9*max(abs(a), abs(b), 1.)
+
+def main(argv):
+    if len(argv) < 3:
+        sys.exit('Usage: python compare_results.py baseline.tsv new.tsv [threshold]')
+    threshold = float(argv[3]) if len(argv) > 3 else 0.1
+    order, baseline = read_results(argv[1])
+    _, new = read_results(argv[2])
+
+    failed = False
+    print('%-20s %14s %14s %8s' % ('case', 'baseline_us', 'new_us', 'ratio'))
+    for case in order:
+        if case not in new:
+            continue
+        old_time = float(baseline[case]['median_us'])
+        new_time = float(new[case]['median_us'])
+        ratio = new_time/old_time if old_time > 0 else float('inf')
+        notes = []
+        if ratio > 1. + threshold:
+            notes.append('SLOWER')
+            failed = True
+        if not same_checksum(baseline[case]['checksum'], new[case]['checksum']):
+            notes.append('CHECKSUM CHANGED')
+            failed = True
+        print('%-20s %14.3f %14.3f %8.3f %s' % (case, old_time, new_time, ratio, ' '.join(notes)))
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
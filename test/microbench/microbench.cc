@@ -0,0 +1,840 @@
+//______________________________________________________________________________
+// microbench
+//
+// Timed, repeatable cases for the hot paths of the reconstruction:
+//
+//   waveform_compress     EXOWaveform::Compress then Decompress
+//   fft_forward           EXOFastFourierTransformFFTW::PerformFFT
+//   fft_inverse           EXOFastFourierTransformFFTW::PerformInverseFFT
+//   matched_filter        EXOMatchedFilterFinder::FindSignals
+//   signal_fit            EXOSignalFitter::Extract on the matched filter signals
+//   clustering            EXOClusteringModule::ProcessEvent (u/v/apd association)
+//   refit_apds_solve      BiCGSTAB iterations of EXORefitAPDs
+//   calib_lookup          EXOCalibManager::getCalib for cached calibrations
+//   noise_per_channel     EXOAddNoise on every channel, as the digitizer does
+//   noise_correlated      EXOCorrelatedNoiseGenerator::AddNoise on every channel
+//
+// The noise cases also run without their caches (noise_*_nocache), drawing
+// new noise for every event.
+//
+// The event is synthetic by default: u-wire and apd waveforms made from the
+// signal models of the default ("vanilla") electronics, with a few charge
+// deposits, a scintillation signal and gaussian noise, all from a fixed
+// seed.  With -f, the waveforms are those of the first event of an EXO tree
+// (for instance ../test_root_file.root) that has any.  The clustering and
+// refit cases always use synthetic inputs.
+//
+// Every case runs its inner loop once to warm up, then the given number of
+// repetitions.  The output has one line per case with the time per
+// iteration (minimum, median and mean over repetitions) and a checksum of
+// the results, so that a change of speed can be told from a change of
+// output.  Lines starting with # are comments.  compare_results.py compares
+// two such files.
+//
+// Usage: ./microbench [-r repetitions] [-s scale] [-t threads] [-f file.root]
+//                     [-o output] [case ...]
+//
+// -s multiplies the iterations of every case; -t sets the threads of the
+// matched filter (which only uses them when built with USE_THREADS).
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOEventData.hh"
+#include "EXOUtilities/EXOWaveformData.hh"
+#include "EXOUtilities/EXOWaveformFT.hh"
+#include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
+#include "EXOUtilities/EXOMiscUtil.hh"
+#include "EXOUtilities/EXODimensions.hh"
+#include "EXOUtilities/EXOAddNoise.hh"
+#include "EXOUtilities/EXOCorrelatedNoiseGenerator.hh"
+#include "EXOUtilities/EXONoiseCorrelations.hh"
+#include "EXOUtilities/SystemOfUnits.hh"
+#include "EXOCalibUtilities/EXOCalibManager.hh"
+#include "EXOCalibUtilities/EXOElectronicsShapers.hh"
+#include "EXOCalibUtilities/EXOUWireGains.hh"
+#include "EXOCalibUtilities/EXOAPDGains.hh"
+#include "EXOCalibUtilities/EXOLifetimeCalib.hh"
+#include "EXOReconstruction/EXOSignalModelManager.hh"
+#include "EXOReconstruction/EXOSignalModel.hh"
+#include "EXOReconstruction/EXOUWireSignalModelBuilder.hh"
+#include "EXOReconstruction/EXOAPDSignalModelBuilder.hh"
+#include "EXOReconstruction/EXODefineAPDSumProcessList.hh"
+#include "EXOReconstruction/EXOMatchedFilterFinder.hh"
+#include "EXOReconstruction/EXOSignalFitter.hh"
+#include "EXOReconstruction/EXOReconProcessList.hh"
+#include "EXOReconstruction/EXOSignalCollection.hh"
+#include "EXOReconstruction/EXOChannelSignals.hh"
+#include "EXOAnalysisManager/EXOClusteringModule.hh"
+#include "EXOAnalysisManager/EXORefitAPDs.hh"
+#include "TStopwatch.h"
+#include "TSystem.h"
+#include "TDatime.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TGraph.h"
+#include "TRandom3.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t kNumSamples = 2048;
+const double kBaseline = 1600.;
+
+struct Options {
+  Options() : fRepetitions(10), fScale(1.), fThreads(1) {}
+  size_t fRepetitions;
+  double fScale;
+  int fThreads;
+  std::string fInput;
+  std::string fOutput;
+  std::vector<std::string> fCases;
+};
+
+// A simple LCG, so that the inputs do not depend on gRandom.
+class Random
+{
+  public:
+    Random(unsigned long seed) : fState(seed) {}
+    double Uniform()
+    {
+      fState = (1103515245*fState + 12345) % 2147483648UL;
+      return (double(fState) + 0.5)/2147483648.;
+    }
+    double Gaus(double sigma)
+    {
+      return sigma*std::sqrt(-2.*std::log(Uniform()))*std::cos(2.*M_PI*Uniform());
+    }
+  private:
+    unsigned long fState;
+};
+
+double Checksum(const EXOSignalCollection& signals)
+{
+  double sum = 0.;
+  signals.ResetIterator();
+  const EXOChannelSignals* chanSignals;
+  while((chanSignals = signals.Next()) != NULL) {
+    chanSignals->ResetIterator();
+    const EXOSignal* signal;
+    while((signal = chanSignals->Next()) != NULL) {
+      sum += 1. + signal->fMagnitude + signal->fTime/CLHEP::microsecond;
+    }
+  }
+  return sum;
+}
+
+//______________________________________________________________________________
+// The reconstruction inputs: event, signal models and process list, set up
+// as in EXOReconstructionModule.
+class ReconFixture
+{
+  public:
+    ReconFixture() : fFileEvent(NULL), fFile(NULL) {}
+    ~ReconFixture() { delete fFile; }
+
+    bool Setup(const Options& options);
+    const EXOEventData& GetEvent() const { return fFileEvent ? *fFileEvent : fEvent; }
+
+    EXOEventHeader fHeader;
+    EXOSignalModelManager fModels;
+    EXODefineAPDSumProcessList fAPDSums;
+    EXOMatchedFilterFinder fFinder;
+    EXOSignalFitter fFitter;
+    EXOReconProcessList fProcessList;
+    EXOSignalCollection fFoundSignals;
+
+  private:
+    bool ReadEvent(const std::string& filename);
+    void MakeEvent();
+    void BuildModel(int channel, const EXOElectronicsShapers& shapers);
+
+    EXOEventData fEvent;
+    EXOEventData* fFileEvent;
+    TFile* fFile;
+};
+
+bool ReconFixture::Setup(const Options& options)
+{
+  fHeader.fIsMonteCarloEvent = true;
+  fHeader.fSampleCount = kNumSamples - 1;
+  fHeader.fTriggerSeconds = 1355409118;
+
+  fModels.AddRegisteredObject(&fAPDSums);
+  fModels.AddRegisteredObject(&fFinder);
+  fModels.AddRegisteredObject(&fFitter);
+  fFinder.SetNumThreads(options.fThreads);
+
+  const EXOElectronicsShapers* shapers = GetCalibrationFor(
+    EXOElectronicsShapers, EXOElectronicsShapersHandler, "vanilla", fHeader);
+  if(not shapers) return false;
+
+  if(options.fInput != "") {
+    if(not ReadEvent(options.fInput)) return false;
+  }
+  else {
+    for(int channel = 0; channel < NUMBER_READOUT_CHANNELS; channel++) BuildModel(channel, *shapers);
+    MakeEvent();
+  }
+
+  // The process list, as EXOReconstructionModule makes it.
+  const EXOWaveformData& wfd = *GetEvent().GetWaveformData();
+  for(size_t i = 0; i < wfd.GetNumWaveforms(); i++) {
+    const EXOWaveform& wf = *wfd.GetWaveform(i);
+    switch(EXOMiscUtil::TypeOfChannel(wf.fChannel)) {
+      case EXOMiscUtil::kUWire:
+        BuildModel(wf.fChannel, *shapers);
+        fProcessList.Add(wf, EXOReconUtil::kUWire);
+        break;
+      case EXOMiscUtil::kAPDGang:
+        BuildModel(wf.fChannel, *shapers);
+        fProcessList.Add(wf, EXOReconUtil::kAPD);
+        break;
+      default: break; // v-wire models need drift velocities; leave them out.
+    }
+  }
+  fProcessList.Add(fAPDSums.GetProcessList(fProcessList));
+  fFoundSignals = fFinder.FindSignals(fProcessList, EXOSignalCollection());
+  return true;
+}
+
+void ReconFixture::BuildModel(int channel, const EXOElectronicsShapers& shapers)
+{
+  const EXOTransferFunction& tf = shapers.GetTransferFunctionForChannel(channel);
+  switch(EXOMiscUtil::TypeOfChannel(channel)) {
+    case EXOMiscUtil::kUWire:
+      fModels.BuildSignalModelForChannelOrTag(channel, EXOUWireSignalModelBuilder(tf));
+      break;
+    case EXOMiscUtil::kAPDGang:
+      fModels.BuildSignalModelForChannelOrTag(channel, EXOAPDSignalModelBuilder(tf));
+      break;
+    default: break;
+  }
+}
+
+bool ReconFixture::ReadEvent(const std::string& filename)
+{
+  fFile = TFile::Open(filename.c_str());
+  if(not fFile or fFile->IsZombie()) {
+    std::cerr << "Could not open " << filename << std::endl;
+    return false;
+  }
+  TTree* tree = dynamic_cast<TTree*>(fFile->Get(EXOMiscUtil::GetEventTreeName().c_str()));
+  if(not tree or tree->SetBranchAddress(EXOMiscUtil::GetEventBranchName().c_str(), &fFileEvent) != 0) {
+    std::cerr << "No event tree in " << filename << std::endl;
+    return false;
+  }
+  for(Long64_t entry = 0; entry < tree->GetEntries(); entry++) {
+    tree->GetEntry(entry);
+    if(fFileEvent and fFileEvent->GetWaveformData()->GetNumWaveforms() > 0) {
+      fFileEvent->GetWaveformData()->Decompress();
+      fHeader = fFileEvent->fEventHeader;
+      return true;
+    }
+  }
+  std::cerr << "No event with waveforms in " << filename << std::endl;
+  return false;
+}
+
+void ReconFixture::MakeEvent()
+{
+  // Charge deposits on a few u-wires of either TPC, a scintillation signal
+  // on all apd gangs, and white noise.
+  struct Deposit { int fChannel; double fTime; double fAmplitude; };
+  const Deposit deposits[] = {
+    {  5, 1080., 420.}, {  6, 1080., 160.}, { 21, 1250., 900.},
+    { 90, 1130., 300.}, { 91, 1131., 280.}, {105, 1400., 650.}
+  };
+  const size_t numDeposits = sizeof(deposits)/sizeof(deposits[0]);
+  const double scintTime = 1024.;
+
+  Random random(4357);
+  fEvent.fEventHeader = fHeader;
+  EXOWaveformData& wfd = *fEvent.GetWaveformData();
+  wfd.fNumSamples = kNumSamples;
+  std::vector<double> trace(kNumSamples);
+  for(int channel = 0; channel < NUMBER_READOUT_CHANNELS; channel++) {
+    EXOMiscUtil::EChannelType type = EXOMiscUtil::TypeOfChannel(channel);
+    if(type != EXOMiscUtil::kUWire and type != EXOMiscUtil::kAPDGang) continue;
+    const EXOSignalModel* model = fModels.GetSignalModelForChannelOrTag(channel);
+    if(not model) continue;
+
+    trace.assign(kNumSamples, kBaseline);
+    if(type == EXOMiscUtil::kUWire) {
+      for(size_t i = 0; i < numDeposits; i++) {
+        if(deposits[i].fChannel != channel) continue;
+        model->AddSignalToArray(trace.begin(), trace.end(), 0., CLHEP::microsecond,
+                                deposits[i].fAmplitude, deposits[i].fTime*CLHEP::microsecond);
+      }
+    }
+    else {
+      model->AddSignalToArray(trace.begin(), trace.end(), 0., CLHEP::microsecond,
+                              150. + 100.*random.Uniform(), scintTime*CLHEP::microsecond);
+    }
+
+    EXOWaveform& wf = *wfd.GetNewWaveform();
+    wf.fChannel = channel;
+    wf.SetLength(kNumSamples);
+    wf.SetSamplingFreq(1.*CLHEP::megahertz);
+    double noise = (type == EXOMiscUtil::kUWire) ? 15. : 25.;
+    for(size_t i = 0; i < kNumSamples; i++) {
+      double value = std::floor(trace[i] + random.Gaus(noise) + 0.5);
+      wf[i] = Int_t(std::min(4095., std::max(0., value)));
+    }
+  }
+}
+
+//______________________________________________________________________________
+class Case
+{
+  public:
+    Case(const std::string& name, size_t iterations) : fName(name), fIterations(iterations) {}
+    virtual ~Case() {}
+    const std::string& GetName() const { return fName; }
+    size_t GetIterations() const { return fIterations; }
+
+    // Return false if the case cannot run here.
+    virtual bool Setup() { return true; }
+    // Run the inner loop and return a checksum of its results.
+    virtual double Run(size_t iterations) = 0;
+
+  private:
+    std::string fName;
+    size_t fIterations;
+};
+
+class CompressCase : public Case
+{
+  public:
+    CompressCase(const ReconFixture& fixture) : Case("waveform_compress", 20), fFixture(fixture) {}
+    bool Setup()
+    {
+      const EXOWaveformData& wfd = *fFixture.GetEvent().GetWaveformData();
+      for(size_t i = 0; i < wfd.GetNumWaveforms(); i++) fWaveforms.push_back(*wfd.GetWaveform(i));
+      return not fWaveforms.empty();
+    }
+    double Run(size_t iterations)
+    {
+      double sum = 0.;
+      for(size_t n = 0; n < iterations; n++) {
+        for(size_t i = 0; i < fWaveforms.size(); i++) {
+          EXOWaveform& wf = fWaveforms[i];
+          wf.Compress();
+          sum += wf.GetCompressedLength();
+          wf.Decompress();
+          sum += wf[wf.GetLength()/2];
+        }
+      }
+      return sum/iterations;
+    }
+  private:
+    const ReconFixture& fFixture;
+    std::vector<EXOWaveform> fWaveforms;
+};
+
+class FFTCase : public Case
+{
+  public:
+    FFTCase(const ReconFixture& fixture, bool inverse)
+      : Case(inverse ? "fft_inverse" : "fft_forward", 20), fFixture(fixture), fInverse(inverse) {}
+    bool Setup()
+    {
+      if(not EXOFastFourierTransformFFTW::IsAvailable()) return false;
+      const EXOWaveformData& wfd = *fFixture.GetEvent().GetWaveformData();
+      for(size_t i = 0; i < wfd.GetNumWaveforms(); i++) {
+        fInputs.push_back(EXODoubleWaveform());
+        fInputs.back() = *wfd.GetWaveform(i);
+      }
+      if(fInputs.empty()) return false;
+      fTransforms.resize(fInputs.size());
+      fOutputs.resize(fInputs.size());
+      EXOFastFourierTransformFFTW& fft = EXOFastFourierTransformFFTW::GetFFT(fInputs[0].GetLength());
+      for(size_t i = 0; i < fInputs.size(); i++) fft.PerformFFT(fInputs[i], fTransforms[i]);
+      return true;
+    }
+    double Run(size_t iterations)
+    {
+      EXOFastFourierTransformFFTW& fft = EXOFastFourierTransformFFTW::GetFFT(fInputs[0].GetLength());
+      double sum = 0.;
+      for(size_t n = 0; n < iterations; n++) {
+        for(size_t i = 0; i < fInputs.size(); i++) {
+          if(fInverse) {
+            fft.PerformInverseFFT(fOutputs[i], fTransforms[i]);
+            sum += fOutputs[i][0];
+          }
+          else {
+            fft.PerformFFT(fInputs[i], fTransforms[i]);
+            sum += fTransforms[i][1].real();
+          }
+        }
+      }
+      return sum/iterations;
+    }
+  private:
+    const ReconFixture& fFixture;
+    bool fInverse;
+    std::vector<EXODoubleWaveform> fInputs;
+    std::vector<EXOWaveformFT> fTransforms;
+    std::vector<EXODoubleWaveform> fOutputs;
+};
+
+class MatchedFilterCase : public Case
+{
+  public:
+    MatchedFilterCase(const ReconFixture& fixture) : Case("matched_filter", 5), fFixture(fixture) {}
+    double Run(size_t iterations)
+    {
+      double sum = 0.;
+      for(size_t n = 0; n < iterations; n++) {
+        sum += Checksum(fFixture.fFinder.FindSignals(fFixture.fProcessList, EXOSignalCollection()));
+      }
+      return sum/iterations;
+    }
+  private:
+    const ReconFixture& fFixture;
+};
+
+class SignalFitCase : public Case
+{
+  public:
+    SignalFitCase(const ReconFixture& fixture) : Case("signal_fit", 2), fFixture(fixture) {}
+    bool Setup() { return fFixture.fFoundSignals.GetNumChannelSignals() > 0; }
+    double Run(size_t iterations)
+    {
+      double sum = 0.;
+      for(size_t n = 0; n < iterations; n++) {
+        sum += Checksum(fFixture.fFitter.Extract(fFixture.fProcessList, fFixture.fFoundSignals));
+      }
+      return sum/iterations;
+    }
+  private:
+    const ReconFixture& fFixture;
+};
+
+class ClusteringCase : public Case
+{
+  public:
+    ClusteringCase() : Case("clustering", 200) {}
+    bool Setup();
+    double Run(size_t iterations)
+    {
+      double sum = 0.;
+      for(size_t n = 0; n < iterations; n++) {
+        fModule.ProcessEvent(&fEvent);
+        for(size_t i = 0; i < fEvent.GetNumChargeClusters(); i++) {
+          const EXOChargeCluster& cc = *fEvent.GetChargeCluster(i);
+          sum += 1. + cc.fRawEnergy + cc.fU + cc.fV;
+        }
+        sum += fEvent.GetNumScintillationClusters();
+      }
+      return sum/iterations;
+    }
+  private:
+    EXOClusteringModule fModule;
+    EXOEventData fEvent;
+};
+
+bool ClusteringCase::Setup()
+{
+  // Signals of eight deposits spread over both TPCs, some sharing wires
+  // or times, and one scintillation signal per apd plane.
+  fEvent.fEventHeader.fIsMonteCarloEvent = true;
+  fEvent.fEventHeader.fSampleCount = kNumSamples - 1;
+  Random random(65539);
+  const double scintTime = 1024.*CLHEP::microsecond;
+  for(int dep = 0; dep < 8; dep++) {
+    int tpc = dep % 2;
+    int uChannel = tpc*2*NCHANNEL_PER_WIREPLANE + (3 + 5*dep) % NCHANNEL_PER_WIREPLANE;
+    int vChannel = tpc*2*NCHANNEL_PER_WIREPLANE + NCHANNEL_PER_WIREPLANE + (7 + 3*dep) % NCHANNEL_PER_WIREPLANE;
+    double time = scintTime + (20. + 10.*(dep/3))*CLHEP::microsecond;
+    double energy = 300. + 1500.*random.Uniform();
+
+    EXOUWireSignal* usig = fEvent.GetNewUWireSignal();
+    usig->fChannel = uChannel;
+    usig->fTime = time;
+    usig->fTimeError = 0.2*CLHEP::microsecond;
+    usig->fRawEnergy = usig->fCorrectedEnergy = energy;
+    usig->fRawEnergyError = usig->fCorrectedEnergyError = 30.;
+
+    EXOVWireSignal* vsig = fEvent.GetNewVWireSignal();
+    vsig->fChannel = vChannel;
+    vsig->fTime = time - 2.*CLHEP::microsecond + random.Gaus(0.5*CLHEP::microsecond);
+    vsig->fTimeError = 0.5*CLHEP::microsecond;
+    vsig->fMagnitude = vsig->fCorrectedMagnitude = 0.1*energy;
+    vsig->fMagnitudeError = vsig->fCorrectedMagnitudeError = 10.;
+  }
+  for(int plane = 1; plane <= 2; plane++) {
+    EXOAPDSignal* asig = fEvent.GetNewAPDSignal();
+    asig->fType = EXOAPDSignal::kPlaneFit;
+    asig->fChannel = plane;
+    asig->fTime = scintTime;
+    asig->fRawCounts = asig->fCounts = asig->fCorrectedCounts = 2000.;
+    asig->fCountsError = 100.;
+  }
+  return fModule.BeginOfRun(&fEvent) == EXOAnalysisModule::kOk;
+}
+
+// The solver of EXORefitAPDs is protected; set up its noise and yield
+// model directly.
+class RefitSolver : public EXORefitAPDs
+{
+  public:
+    ~RefitSolver();
+    void Setup();
+    double Iterate(size_t iterations);
+  private:
+    BiCGSTAB_iter fStart;
+    std::vector<double> fR0hat;
+};
+
+RefitSolver::~RefitSolver()
+{
+  for(std::map<unsigned char, TGraph*>::iterator it = fGainMaps.begin(); it != fGainMaps.end(); it++) {
+    delete it->second;
+  }
+}
+
+void RefitSolver::Setup()
+{
+  // All gangs, with correlated noise between neighbors and a smooth pulse
+  // model; the initial guess is the one of ProcessEvent.
+  const size_t n = 2*1024 - 1;
+  Random random(2147);
+  fUnixTimeOfEvent = 1355409118.;
+  fExpectedEnergy_keV = 2000.;
+  for(unsigned char gang = 152; gang < 226; gang++) {
+    fAPDs.push_back(gang);
+    fChannelsToUse.push_back(gang);
+    fExpectedYieldPerGang[gang] = 50. + 100.*random.Uniform();
+    double times[2] = {1.e9, 2.e9};
+    double gains[2] = {1., 1.};
+    fGainMaps[gang] = new TGraph(2, times, gains);
+  }
+  for(size_t i = 0; i < fChannelsToUse.size(); i++) {
+    for(size_t j = 0; j < fChannelsToUse.size(); j++) {
+      unsigned char ci = fChannelsToUse[i], cj = fChannelsToUse[j];
+      double correlation = (i == j) ? 1. : 0.2/(1. + std::fabs(double(i) - double(j)));
+      if(i <= j) {
+        std::vector<double>& rrii = fNoiseRRandII[std::make_pair(ci, cj)];
+        rrii.resize(n);
+        for(size_t f = 0; f < n; f++) rrii[f] = correlation*(1. + 1./(1. + f/50.));
+      }
+      std::vector<double>& ri = fNoiseRI[std::make_pair(ci, cj)];
+      ri.resize(1024);
+      for(size_t f = 0; f < ri.size(); f++) ri[f] = (i == j) ? 0. : 0.1*correlation*std::sin(0.01*f);
+    }
+  }
+  fmodel_realimag.resize(n);
+  for(size_t f = 0; f < n; f++) fmodel_realimag[f] = std::exp(-f/300.)*std::cos(0.02*f);
+
+  size_t nrows = fChannelsToUse.size()*n + 1;
+  double normModel = 0., sumSqYield = 0.;
+  for(size_t f = 0; f < n; f++) normModel += fmodel_realimag[f]*fmodel_realimag[f];
+  for(size_t i = 0; i < fChannelsToUse.size(); i++) sumSqYield += std::pow(fExpectedYieldPerGang[fChannelsToUse[i]], 2);
+  fStart.x.assign(nrows, 0.);
+  for(size_t i = 0; i < fChannelsToUse.size(); i++) {
+    double factor = fExpectedYieldPerGang[fChannelsToUse[i]]/(sumSqYield*normModel);
+    for(size_t f = 0; f < n; f++) fStart.x[n*i + f] = factor*fmodel_realimag[f];
+  }
+  fStart.r = MatrixTimesVector(fStart.x);
+  fStart.r.back() -= 1;
+  for(size_t i = 0; i < nrows; i++) fStart.r[i] = -fStart.r[i];
+  fR0hat = fStart.r;
+  fStart.rho = fStart.alpha = fStart.omega = 1;
+  fStart.v.assign(nrows, 0.);
+  fStart.p.assign(nrows, 0.);
+}
+
+double RefitSolver::Iterate(size_t iterations)
+{
+  BiCGSTAB_iter step = fStart;
+  for(size_t i = 0; i < iterations; i++) step = BiCGSTAB_iteration(step, fR0hat);
+  double norm = 0.;
+  for(size_t i = 0; i < step.r.size(); i++) norm += step.r[i]*step.r[i];
+  return std::sqrt(norm) + step.x.back();
+}
+
+class RefitCase : public Case
+{
+  public:
+    RefitCase() : Case("refit_apds_solve", 1) {}
+    bool Setup() { fSolver.Setup(); return true; }
+    double Run(size_t iterations) { return fSolver.Iterate(10*iterations); }
+  private:
+    RefitSolver fSolver;
+};
+
+class CalibLookupCase : public Case
+{
+  public:
+    CalibLookupCase() : Case("calib_lookup", 2000) {}
+    bool Setup()
+    {
+      // Event headers over four years; the first pass creates the calibrations.
+      for(size_t i = 0; i < 64; i++) {
+        EXOEventHeader header;
+        header.fTriggerSeconds = 1300000000 + i*2000000;
+        header.fTriggerMicroSeconds = (i*7919) % 1000000;
+        fHeaders.push_back(header);
+      }
+      return Run(1) > 0.;
+    }
+    double Run(size_t iterations)
+    {
+      double sum = 0.;
+      for(size_t n = 0; n < iterations; n++) {
+        for(size_t i = 0; i < fHeaders.size(); i++) {
+          const EXOElectronicsShapers* shapers =
+            GetCalibrationFor(EXOElectronicsShapers, EXOElectronicsShapersHandler, "vanilla", fHeaders[i]);
+          const EXOUWireGains* uGains =
+            GetCalibrationFor(EXOUWireGains, EXOUWireGainsHandler, "vanilla", fHeaders[i]);
+          const EXOAPDGains* apdGains =
+            GetCalibrationFor(EXOAPDGains, EXOAPDGainsHandler, "vanilla", fHeaders[i]);
+          const EXOLifetimeCalib* lifetime =
+            GetCalibrationFor(EXOLifetimeCalib, EXOLifetimeCalibHandler, "vanilla", fHeaders[i]);
+          if(shapers) {
+            const EXOTransferFunction& tf = shapers->GetTransferFunctionForChannel(i);
+            sum += tf.GetNumDiffStages() + tf.GetNumIntegStages();
+          }
+          sum += (uGains != NULL) + (apdGains != NULL) + (lifetime != NULL);
+        }
+      }
+      return sum/iterations;
+    }
+  private:
+    std::vector<EXOEventHeader> fHeaders;
+};
+
+class NoiseCase : public Case
+{
+  public:
+    NoiseCase(bool correlated, bool cached)
+      : Case(std::string(correlated ? "noise_correlated" : "noise_per_channel") + (cached ? "" : "_nocache"),
+             cached ? 200 : 5),
+        fCorrelated(correlated), fCached(cached), fRandom(4357) {}
+    bool Setup();
+    double Run(size_t iterations);
+  private:
+    bool fCorrelated;
+    bool fCached;
+    TRandom3 fRandom;
+    std::vector<EXOAddNoise> fNoise;
+    std::vector<EXODoubleWaveform> fInputs;
+    EXOCorrelatedNoiseGenerator fGenerator;
+    EXOWaveformData fWaveforms;
+};
+
+bool NoiseCase::Setup()
+{
+  // 20 ADC counts of noise on every readout channel.  The caches are
+  // shorter than the default of 100 waveforms to save memory; the time per
+  // event does not depend on their length.
+  const size_t cache = fCached ? 10 : 0;
+  const double sigma = 20.;
+  if(not fCorrelated) {
+    fNoise.resize(NUMBER_READOUT_CHANNELS);
+    fInputs.resize(NUMBER_READOUT_CHANNELS);
+    for(size_t ch = 0; ch < fNoise.size(); ch++) {
+      fNoise[ch].AddIntegStageWithTime(3.*CLHEP::microsecond);
+      fNoise[ch].AddIntegStageWithTime(3.*CLHEP::microsecond);
+      fNoise[ch].AddDiffStageWithTime(10.*CLHEP::microsecond);
+      fNoise[ch].AddDiffStageWithTime(10.*CLHEP::microsecond);
+      fNoise[ch].SetNoiseMagnitude(sigma);
+      fNoise[ch].SetCacheLength(cache);
+      fInputs[ch].SetLength(kNumSamples);
+      fInputs[ch].SetSamplingFreq(1.*CLHEP::megahertz);
+      // Fill the cache now, so that every run only reads from it.
+      if(fCached) fNoise[ch].Transform(&fInputs[ch]);
+    }
+    return true;
+  }
+
+  // White noise, correlated between neighbors of the same wire plane or
+  // among the APD gangs, in the blocks the generator factors.
+  EXONoiseCorrelations correlations;
+  for(size_t ch = 0; ch < NUMBER_READOUT_CHANNELS; ch++) correlations.AddChannelToMap(ch);
+  const size_t numFrequencies = kNumSamples/2 + 1;
+  correlations.SetNumFrequencies(numFrequencies);
+  for(size_t f = 0; f < numFrequencies; f++) {
+    bool real = (f == 0 or f == numFrequencies - 1);
+    double variance = kNumSamples*sigma*sigma*(real ? 1. : 0.5);
+    EXONoiseCorrelations::SymmetricMatrix& rr = correlations.GetRR(f);
+    EXONoiseCorrelations::SymmetricMatrix& ii = correlations.GetII(f);
+    for(size_t i = 0; i < NUMBER_READOUT_CHANNELS; i++) {
+      for(size_t j = (i < 2 ? 0 : i - 2); j <= i; j++) {
+        int blockI = (i < 4*NCHANNEL_PER_WIREPLANE) ? i/NCHANNEL_PER_WIREPLANE : 4;
+        int blockJ = (j < 4*NCHANNEL_PER_WIREPLANE) ? j/NCHANNEL_PER_WIREPLANE : 4;
+        double correlation = (i == j) ? 1. : (blockI == blockJ ? 0.3/(i - j) : 0.);
+        rr[i][j] = correlation*variance;
+        ii[i][j] = real ? 0. : correlation*variance;
+      }
+    }
+  }
+  fGenerator.SetCacheLength(cache);
+  if(not fGenerator.SetNoiseCorrelations(correlations)) return false;
+  if(fCached) fGenerator.Generate(fRandom);
+  for(size_t ch = 0; ch < NUMBER_READOUT_CHANNELS; ch++) {
+    EXOWaveform& wf = *fWaveforms.GetNewWaveform();
+    wf.fChannel = ch;
+    wf.SetLength(kNumSamples);
+    wf.SetSamplingFreq(1.*CLHEP::megahertz);
+  }
+  return true;
+}
+
+double NoiseCase::Run(size_t iterations)
+{
+  // Both kinds of noise start from the same random numbers on every run.
+  fRandom.SetSeed(4357);
+  gRandom->SetSeed(4357);
+  for(size_t ch = 0; ch < fInputs.size(); ch++) {
+    for(size_t i = 0; i < kNumSamples; i++) fInputs[ch][i] = kBaseline;
+  }
+  for(size_t ch = 0; ch < fWaveforms.GetNumWaveforms(); ch++) {
+    EXOWaveform& wf = *fWaveforms.GetWaveformToEdit(ch);
+    for(size_t i = 0; i < kNumSamples; i++) wf[i] = Int_t(kBaseline);
+  }
+
+  double sum = 0.;
+  for(size_t n = 0; n < iterations; n++) {
+    if(fCorrelated) {
+      fGenerator.AddNoise(fWaveforms, fRandom);
+      for(size_t ch = 0; ch < fWaveforms.GetNumWaveforms(); ch++) sum += (*fWaveforms.GetWaveform(ch))[n % kNumSamples];
+    }
+    else {
+      for(size_t ch = 0; ch < fInputs.size(); ch++) {
+        fNoise[ch].Transform(&fInputs[ch]);
+        sum += fInputs[ch][n % kNumSamples];
+      }
+    }
+  }
+  return sum/iterations;
+}
+
+//______________________________________________________________________________
+struct Result {
+  std::string fName;
+  size_t fIterations;
+  std::vector<double> fTimes;   // Seconds per iteration, one per repetition
+  double fChecksum;
+};
+
+bool RunCase(Case& aCase, const Options& options, Result& result)
+{
+  if(not aCase.Setup()) return false;
+  result.fName = aCase.GetName();
+  result.fIterations = std::max(size_t(1), size_t(aCase.GetIterations()*options.fScale + 0.5));
+  result.fChecksum = aCase.Run(result.fIterations); // warm-up
+  TStopwatch watch;
+  for(size_t rep = 0; rep < options.fRepetitions; rep++) {
+    watch.Start(true);
+    double checksum = aCase.Run(result.fIterations);
+    watch.Stop();
+    result.fTimes.push_back(watch.RealTime()/result.fIterations);
+    if(checksum != result.fChecksum) {
+      std::cerr << aCase.GetName() << ": checksum changed between repetitions" << std::endl;
+    }
+  }
+  return true;
+}
+
+void WriteResults(std::ostream& out, const Options& options, const std::vector<Result>& results)
+{
+  TDatime now;
+  out << "# microbench " << now.AsSQLString() << " on " << gSystem->HostName()
+      << ", threads " << options.fThreads
+      << ", input " << (options.fInput == "" ? std::string("synthetic") : options.fInput) << std::endl;
+  out << "case\titerations\trepetitions\tmin_us\tmedian_us\tmean_us\tchecksum" << std::endl;
+  for(size_t i = 0; i < results.size(); i++) {
+    std::vector<double> times = results[i].fTimes;
+    std::sort(times.begin(), times.end());
+    double mean = 0.;
+    for(size_t j = 0; j < times.size(); j++) mean += times[j]/times.size();
+    double median = (times.size() % 2) ? times[times.size()/2]
+                                       : 0.5*(times[times.size()/2 - 1] + times[times.size()/2]);
+    out.precision(6);
+    out << results[i].fName << '\t' << results[i].fIterations << '\t' << times.size() << '\t'
+        << 1.e6*times.front() << '\t' << 1.e6*median << '\t' << 1.e6*mean << '\t';
+    out.precision(12);
+    out << results[i].fChecksum << std::endl;
+  }
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+  for(int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = (i + 1 < argc);
+    if(arg == "-r" and hasValue) options.fRepetitions = std::max(1, atoi(argv[++i]));
+    else if(arg == "-s" and hasValue) options.fScale = atof(argv[++i]);
+    else if(arg == "-t" and hasValue) options.fThreads = std::max(1, atoi(argv[++i]));
+    else if(arg == "-f" and hasValue) options.fInput = argv[++i];
+    else if(arg == "-o" and hasValue) options.fOutput = argv[++i];
+    else if(arg.size() > 0 and arg[0] == '-') return false;
+    else options.fCases.push_back(arg);
+  }
+  return options.fScale > 0.;
+}
+
+bool Selected(const Options& options, const std::string& name)
+{
+  return options.fCases.empty() or
+         std::find(options.fCases.begin(), options.fCases.end(), name) != options.fCases.end();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if(not ParseOptions(argc, argv, options)) {
+    std::cerr << "Usage: " << argv[0] << " [-r repetitions] [-s scale] [-t threads] [-f file.root]"
+              << " [-o output] [case ...]" << std::endl;
+    return 1;
+  }
+
+  ReconFixture fixture;
+  if(not fixture.Setup(options)) {
+    std::cerr << "Could not set up the reconstruction inputs" << std::endl;
+    return 1;
+  }
+
+  std::vector<Case*> cases;
+  cases.push_back(new CompressCase(fixture));
+  cases.push_back(new FFTCase(fixture, false));
+  cases.push_back(new FFTCase(fixture, true));
+  cases.push_back(new MatchedFilterCase(fixture));
+  cases.push_back(new SignalFitCase(fixture));
+  cases.push_back(new ClusteringCase);
+  cases.push_back(new RefitCase);
+  cases.push_back(new CalibLookupCase);
+  cases.push_back(new NoiseCase(false, true));
+  cases.push_back(new NoiseCase(true, true));
+  cases.push_back(new NoiseCase(false, false));
+  cases.push_back(new NoiseCase(true, false));
+
+  std::vector<Result> results;
+  for(size_t i = 0; i < cases.size(); i++) {
+    if(not Selected(options, cases[i]->GetName())) continue;
+    Result result;
+    if(RunCase(*cases[i], options, result)) results.push_back(result);
+    else std::cerr << cases[i]->GetName() << ": skipped" << std::endl;
+  }
+  for(size_t i = 0; i < cases.size(); i++) delete cases[i];
+
+  if(options.fOutput != "") {
+    std::ofstream out(options.fOutput.c_str());
+    WriteResults(out, options, results);
+    if(not out) {
+      std::cerr << "Could not write " << options.fOutput << std::endl;
+      return 1;
+    }
+  }
+  WriteResults(std::cout, options, results);
+  return 0;
+}
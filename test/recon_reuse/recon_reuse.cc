@@ -0,0 +1,359 @@
+//______________________________________________________________________________
+// recon_reuse
+//
+// Checks EXOReconstructionModule with /rec/ReuseUnchangedSignals.  A
+// synthetic Monte Carlo event (charge deposits on a few u-wires and a
+// scintillation signal on the apd gangs, made with the vanilla electronics,
+// plus white noise) is reconstructed, and copies of the result, with a
+// marker on one of their stored signals, are reprocessed:
+//   - with the same inputs, the stored signals must be kept and no stage
+//     may run;
+//   - with another apd (u-wire) scaling, only parameter extraction (and
+//     induction signal finding) may run, and the signals must be identical
+//     to those of a full reconstruction with that scaling;
+//   - with a changed waveform, another drift velocity, or another /rec/
+//     command -- registered after Initialize, as EXOAnalysisManager does --
+//     the signals must be found again.
+//
+// Then events carrying signals, clusters and a provenance from an earlier
+// pass which the module drops before reconstructing them -- one tagged as
+// noise, one taken while the clean room siren was sounding, one without
+// waveforms and one with the trigger outside of the trace -- must be left
+// with no signals, clusters or provenance.
+//
+// Any failure makes the program exit with 1.
+//
+// Usage: ./recon_reuse
+//______________________________________________________________________________
+
+#include "EXOAnalysisManager/EXOReconstructionModule.hh"
+#include "EXOReconstruction/EXOSignalModelManager.hh"
+#include "EXOReconstruction/EXOSignalModel.hh"
+#include "EXOReconstruction/EXOUWireSignalModelBuilder.hh"
+#include "EXOReconstruction/EXOAPDSignalModelBuilder.hh"
+#include "EXOCalibUtilities/EXOCalibManager.hh"
+#include "EXOCalibUtilities/EXOElectronicsShapers.hh"
+#include "EXOUtilities/EXOEventData.hh"
+#include "EXOUtilities/EXOWaveformData.hh"
+#include "EXOUtilities/EXOMiscUtil.hh"
+#include "EXOUtilities/EXODimensions.hh"
+#include "EXOUtilities/SystemOfUnits.hh"
+#include "TObjString.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t kNumSamples = 2048;
+const double kBaseline = 1600.;
+const double kMarker = -12345.;   // Put on a stored signal to see if it is kept
+
+// The reconstruction module, set up for reuse, with access to the commands
+// of the job.
+class ReconModule : public EXOReconstructionModule
+{
+  public:
+    ReconModule() { SetReuseUnchangedSignals(true); Initialize(); }
+
+    // Whether the stage (or step) with this timer tag ran on the last event.
+    bool Ran(const std::string& tag) const
+    {
+      for(size_t i = 0; i < fTimingInfo.GetNumberOfTimers(); i++) {
+        const EXOStopwatch* watch = fTimingInfo.GetTimerAt(i);
+        if(watch->GetName() == tag) return watch->WasStartedSinceReset();
+      }
+      return false;
+    }
+
+    // Register the commands of the job, as EXOAnalysisManager::InitAnalysis
+    // does after initializing the modules.
+    static void SetCommandsCalled(const std::string& commands)
+    {
+      RetractObject("CommandsCalled");
+      RegisterObject("CommandsCalled", TObjString(commands.c_str()));
+    }
+};
+
+// A simple LCG, so that the event does not depend on gRandom.
+unsigned long gState = 4357;
+
+double Uniform()
+{
+  gState = (1103515245*gState + 12345) % 2147483648UL;
+  return (gState + 0.5)/2147483648.;
+}
+
+double Gaus()
+{
+  return std::sqrt(-2.*std::log(Uniform()))*std::cos(2.*M_PI*Uniform());
+}
+
+bool MakeEvent(EXOEventData& ED)
+{
+  ED.Clear("C");
+  EXOEventHeader& header = ED.fEventHeader;
+  header.fIsMonteCarloEvent = true;
+  header.fSampleCount = kNumSamples - 1;
+  header.fTriggerSeconds = 1355409118;
+  const EXOElectronicsShapers* shapers = GetCalibrationFor(
+    EXOElectronicsShapers, EXOElectronicsShapersHandler, "vanilla", header);
+  if(not shapers) return false;
+
+  struct Deposit { int fChannel; double fTime; double fAmplitude; };
+  const Deposit deposits[] = { {5, 1080., 420.}, {21, 1250., 900.}, {90, 1130., 300.} };
+  const size_t numDeposits = sizeof(deposits)/sizeof(deposits[0]);
+
+  EXOSignalModelManager models;
+  EXOWaveformData& wfd = *ED.GetWaveformData();
+  wfd.fNumSamples = kNumSamples;
+  std::vector<double> trace(kNumSamples);
+  for(int channel = 0; channel < NUMBER_READOUT_CHANNELS; channel++) {
+    EXOMiscUtil::EChannelType type = EXOMiscUtil::TypeOfChannel(channel);
+    const EXOTransferFunction& tf = shapers->GetTransferFunctionForChannel(channel);
+    if(type == EXOMiscUtil::kUWire) models.BuildSignalModelForChannelOrTag(channel, EXOUWireSignalModelBuilder(tf));
+    else if(type == EXOMiscUtil::kAPDGang) models.BuildSignalModelForChannelOrTag(channel, EXOAPDSignalModelBuilder(tf));
+    else continue;
+    const EXOSignalModel* model = models.GetSignalModelForChannelOrTag(channel);
+    if(not model) return false;
+
+    trace.assign(kNumSamples, kBaseline);
+    for(size_t i = 0; i < numDeposits; i++) {
+      if(deposits[i].fChannel != channel) continue;
+      model->AddSignalToArray(trace.begin(), trace.end(), 0., CLHEP::microsecond,
+                              deposits[i].fAmplitude, deposits[i].fTime*CLHEP::microsecond);
+    }
+    if(type == EXOMiscUtil::kAPDGang) {
+      model->AddSignalToArray(trace.begin(), trace.end(), 0., CLHEP::microsecond,
+                              150. + 100.*Uniform(), 1024.*CLHEP::microsecond);
+    }
+
+    EXOWaveform& wf = *wfd.GetNewWaveform();
+    wf.fChannel = channel;
+    wf.SetLength(kNumSamples);
+    wf.SetSamplingFreq(1.*CLHEP::megahertz);
+    double noise = (type == EXOMiscUtil::kUWire) ? 15. : 25.;
+    for(size_t i = 0; i < kNumSamples; i++) {
+      double value = std::floor(trace[i] + noise*Gaus() + 0.5);
+      wf[i] = Int_t(std::min(4095., std::max(0., value)));
+    }
+  }
+  return true;
+}
+
+// A copy of reconstructed, with the marker on its first u-wire signal.
+void CopyWithMarker(const EXOEventData& reconstructed, EXOEventData& ED)
+{
+  ED = reconstructed;
+  ED.GetUWireSignal(0)->fRawEnergy = kMarker;
+}
+
+bool Reprocess(EXOReconstructionModule& recon, const EXOEventData& reconstructed, EXOEventData& ED)
+{
+  CopyWithMarker(reconstructed, ED);
+  return recon.ProcessEvent(&ED) == EXOAnalysisModule::kOk;
+}
+
+bool Kept(const EXOEventData& ED)
+{
+  return ED.GetNumUWireSignals() > 0 and ED.GetUWireSignal(0)->fRawEnergy == kMarker;
+}
+
+// Whether the signals found again from the first stage.
+bool FoundAgain(const ReconModule& recon, const EXOEventData& ED, const EXOEventData& reconstructed)
+{
+  return recon.Ran("matched_filter_finder") and not Kept(ED) and
+         ED.fReconProvenance.size() == reconstructed.fReconProvenance.size() and
+         ED.fReconProvenance[0] != reconstructed.fReconProvenance[0];
+}
+
+// Whether the signals of a and b are bit for bit the same.
+bool SameSignals(const EXOEventData& a, const EXOEventData& b)
+{
+  if(a.GetNumUWireSignals() != b.GetNumUWireSignals() or
+     a.GetNumUWireInductionSignals() != b.GetNumUWireInductionSignals() or
+     a.GetNumAPDSignals() != b.GetNumAPDSignals() or
+     a.fReconProvenance != b.fReconProvenance) return false;
+  for(size_t i = 0; i < a.GetNumUWireSignals(); i++) {
+    const EXOUWireSignal& x = *a.GetUWireSignal(i);
+    const EXOUWireSignal& y = *b.GetUWireSignal(i);
+    if(x.fChannel != y.fChannel or x.fTime != y.fTime or x.fRawEnergy != y.fRawEnergy or
+       x.fRawEnergyError != y.fRawEnergyError or x.fChiSquare != y.fChiSquare or
+       x.fChiSquareInd != y.fChiSquareInd) return false;
+  }
+  for(size_t i = 0; i < a.GetNumUWireInductionSignals(); i++) {
+    const EXOUWireInductionSignal& x = *a.GetUWireInductionSignal(i);
+    const EXOUWireInductionSignal& y = *b.GetUWireInductionSignal(i);
+    if(x.fChannel != y.fChannel or x.fTime != y.fTime or x.fMagnitude != y.fMagnitude) return false;
+  }
+  for(size_t i = 0; i < a.GetNumAPDSignals(); i++) {
+    const EXOAPDSignal& x = *a.GetAPDSignal(i);
+    const EXOAPDSignal& y = *b.GetAPDSignal(i);
+    if(x.fChannel != y.fChannel or x.fType != y.fType or x.fTime != y.fTime or
+       x.fRawCounts != y.fRawCounts or x.fCountsError != y.fCountsError) return false;
+  }
+  return true;
+}
+
+// Rescale with a module set up by setScaling, and compare with a full
+// reconstruction of raw by another one; only the stages from expectedStage
+// on may run.
+bool CheckRescaled(void (EXOReconstructionModule::*setScaling)(double), double scaling,
+                   const char* expectedStage,
+                   const EXOEventData& raw, const EXOEventData& reconstructed)
+{
+  EXOEventData ED;
+  bool ok;
+  {
+    ReconModule recon;
+    (recon.*setScaling)(scaling);
+    ok = Reprocess(recon, reconstructed, ED) and
+         recon.Ran(expectedStage) and recon.Ran("parameter_extraction") and
+         not recon.Ran("matched_filter_finder") and not recon.Ran("u_and_apd_fitter") and
+         ED.fReconProvenance[0] == reconstructed.fReconProvenance[0];
+  }
+  EXOEventData fresh = raw;
+  {
+    ReconModule recon;
+    (recon.*setScaling)(scaling);
+    ok = recon.ProcessEvent(&fresh) == EXOAnalysisModule::kOk and ok;
+  }
+  return ok and SameSignals(ED, fresh);
+}
+
+bool Report(const char* name, bool ok, const char* failure)
+{
+  std::cout << name << ": " << (ok ? "ok" : failure) << std::endl;
+  return ok;
+}
+
+// An event as left by an earlier reconstruction pass.
+void FillStoredReconstruction(EXOEventData& ED, bool withWaveform)
+{
+  ED.Clear("C");
+  if(withWaveform) {
+    EXOWaveform& wf = *ED.GetWaveformData()->GetNewWaveform();
+    wf.fChannel = 10;
+    wf.SetLength(2048);
+    ED.GetWaveformData()->fNumSamples = 2048;
+  }
+  ED.fEventHeader.fSampleCount = 2047;
+
+  EXOUWireSignal* usig = ED.GetNewUWireSignal();
+  usig->fChannel = 10;
+  usig->fRawEnergy = 1000.;
+  EXOAPDSignal* asig = ED.GetNewAPDSignal();
+  asig->fType = EXOAPDSignal::kPlaneFit;
+  asig->fChannel = 1;
+  EXOChargeCluster* cc = ED.GetNewChargeCluster();
+  cc->fRawEnergy = 1000.;
+  ED.fReconProvenance.push_back(0x1234);
+  ED.fReconProvenance.push_back(0x5678);
+}
+
+bool CheckDropped(const char* name, EXOReconstructionModule& recon, EXOEventData& ED)
+{
+  int status = recon.ProcessEvent(&ED);
+  bool ok = (status == EXOAnalysisModule::kDrop and
+             ED.GetNumUWireSignals() == 0 and
+             ED.GetNumAPDSignals() == 0 and
+             ED.GetNumChargeClusters() == 0 and
+             ED.fReconProvenance.empty());
+  return Report(name, ok, "FAILED, the stored reconstruction was kept");
+}
+
+}
+
+int main()
+{
+  bool ok = true;
+  EXOEventData raw;
+  if(not MakeEvent(raw)) {
+    std::cout << "Unable to make the event -- FAILED" << std::endl;
+    return 1;
+  }
+  EXOEventData reconstructed = raw;
+  ReconModule::SetCommandsCalled("/rec/ReuseUnchangedSignals true\n");
+  {
+    ReconModule recon;
+    if(recon.ProcessEvent(&reconstructed) != EXOAnalysisModule::kOk or
+       reconstructed.GetNumUWireSignals() == 0 or reconstructed.fReconProvenance.empty()) {
+      std::cout << "The event was not reconstructed -- FAILED" << std::endl;
+      return 1;
+    }
+  }
+
+  {
+    ReconModule recon;
+    EXOEventData ED;
+    bool kept = Reprocess(recon, reconstructed, ED) and Kept(ED) and
+                ED.fReconProvenance == reconstructed.fReconProvenance and
+                not recon.Ran("signal_model_building") and
+                not recon.Ran("induction_signal_finding") and
+                not recon.Ran("parameter_extraction");
+    ok = Report("identical inputs", kept, "FAILED, the stored signals were not reused") and ok;
+  }
+
+  ok = Report("changed apd scaling",
+              CheckRescaled(&EXOReconstructionModule::SetAPDScalingFactor,
+                            2.*APD_ADC_FULL_SCALE_ELECTRONS/(ADC_BITS*APD_GAIN),
+                            "parameter_extraction", raw, reconstructed),
+              "FAILED, the signals were not only rescaled") and ok;
+
+  ok = Report("changed u-wire scaling",
+              CheckRescaled(&EXOReconstructionModule::SetUWireScalingFactor,
+                            1.5*ADC_FULL_SCALE_ELECTRONS_WIRE*W_VALUE_LXE_EV_PER_ELECTRON/(CLHEP::keV*ADC_BITS),
+                            "induction_signal_finding", raw, reconstructed),
+              "FAILED, the signals were not only rescaled") and ok;
+
+  {
+    ReconModule recon;
+    EXOEventData ED;
+    CopyWithMarker(reconstructed, ED);
+    (*ED.GetWaveformData()->GetWaveformWithChannelToEdit(21))[500] += 1;
+    bool found = recon.ProcessEvent(&ED) == EXOAnalysisModule::kOk and FoundAgain(recon, ED, reconstructed);
+    ok = Report("changed waveform", found, "FAILED, the stored signals were kept") and ok;
+  }
+
+  {
+    ReconModule recon;
+    recon.SetUserDriftVelocity(1.1*DRIFT_VELOCITY);
+    EXOEventData ED;
+    bool found = Reprocess(recon, reconstructed, ED) and FoundAgain(recon, ED, reconstructed);
+    ok = Report("changed drift velocity", found, "FAILED, the stored signals were kept") and ok;
+  }
+
+  {
+    ReconModule recon;
+    ReconModule::SetCommandsCalled("/rec/ReuseUnchangedSignals true\n"
+                                   "/rec/matched_filter_finder/WireThresholdFactor 6\n");
+    EXOEventData ED;
+    bool found = Reprocess(recon, reconstructed, ED) and FoundAgain(recon, ED, reconstructed);
+    ok = Report("changed /rec/ command", found, "FAILED, the stored signals were kept") and ok;
+    ReconModule::SetCommandsCalled("/rec/ReuseUnchangedSignals true\n");
+  }
+
+  {
+    ReconModule recon;
+    EXOEventData ED;
+
+    FillStoredReconstruction(ED, true);
+    ED.SetNoiseTag(EXOEventData::kAPDRingingNoise);
+    ok = CheckDropped("noise-tagged event", recon, ED) and ok;
+
+    FillStoredReconstruction(ED, true);
+    ED.fEventHeader.fSirenActiveInCR = true;
+    ok = CheckDropped("event during the siren", recon, ED) and ok;
+
+    FillStoredReconstruction(ED, false);
+    ok = CheckDropped("event without waveforms", recon, ED) and ok;
+
+    FillStoredReconstruction(ED, true);
+    ED.fEventHeader.fTriggerOffset = 4096;
+    ok = CheckDropped("trigger outside of the trace", recon, ED) and ok;
+  }
+
+  return ok ? 0 : 1;
+}
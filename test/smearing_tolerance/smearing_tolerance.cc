@@ -0,0 +1,125 @@
+//______________________________________________________________________________
+// smearing_tolerance
+//
+// Compares the FFT smearing of the MC-based energy fits (SetFFTSmearing) with
+// the direct sum over MC energies, for EXOEnergyMCBasedFit1D and for the
+// line MC of EXOEnergyMCBasedFit2D.  The MC spectrum is a falling continuum
+// with two lines, smeared with energy-dependent resolutions (and correlation
+// in 2D) and a slightly non-trivial calibration.  Every bin of the FFT
+// histogram must agree with the direct one within tolerance times the
+// largest bin, otherwise the program exits with 1.
+//
+// Usage: ./smearing_tolerance [tolerance]
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOEnergyMCBasedFit1D.hh"
+#include "EXOUtilities/EXOEnergyMCBasedFit2D.hh"
+#include "TF1.h"
+#include "TH1D.h"
+#include "TH2F.h"
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+// The 2D smearing of line MC is protected.
+class Fit2D : public EXOEnergyMCBasedFit2D
+{
+  public:
+    void Smear(TH2F& histo, const std::vector<Double_t>& energy, const std::vector<Double_t>& pdf)
+      { FillSmearedMCHistogram(NULL, histo, energy, pdf); }
+};
+
+void MakeSpectrum(std::vector<Double_t>& energy, std::vector<Double_t>& pdf)
+{
+  // From a simple LCG so that the input does not depend on gRandom.
+  unsigned long state = 12345;
+  for(size_t i = 0; i < 3000; i++) {
+    state = (1103515245*state + 12345) % 2147483648UL;
+    energy.push_back(300. + 0.9*i);
+    pdf.push_back(1000.*exp(-i/800.)*double(state)/2147483648.);
+  }
+  for(size_t i = 0; i < 100; i++) {
+    energy.push_back(1173.2);
+    pdf.push_back(30.);
+    energy.push_back(2614.5);
+    pdf.push_back(50.);
+  }
+}
+
+template<class Histo>
+bool Compare(const char* name, const Histo& direct, const Histo& fft, double tolerance)
+{
+  double peak = direct.GetMaximum();
+  double deviation = 0.;
+  for(int i = 1; i <= direct.GetNbinsX(); i++) {
+    for(int j = 1; j <= direct.GetNbinsY(); j++) {
+      double diff = std::fabs(direct.GetBinContent(i,j) - fft.GetBinContent(i,j));
+      if(diff > deviation) deviation = diff;
+    }
+  }
+  bool ok = (peak > 0 and deviation <= tolerance*peak);
+  std::cout << name << ": largest deviation " << deviation/peak
+            << " of the largest bin" << (ok ? "" : " -- FAILED") << std::endl;
+  return ok;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  double tolerance = (argc > 1) ? atof(argv[1]) : 0.01;
+
+  std::vector<Double_t> energy, pdf;
+  MakeSpectrum(energy, pdf);
+  bool ok = true;
+
+  // 1D
+  {
+    EXOEnergyMCBasedFit1D fit;
+    TF1 calib("calib", "[0]*x", 0., 5000.);
+    calib.SetParameter(0, 1.02);
+    TF1 resol("resol", "sqrt([0]*[0]*x + [1]*[1] + [2]*[2]*x*x)", 0., 5000.);
+    resol.SetParameters(0.6, 20., 0.01);
+    fit.SetFunction("calib", &calib);
+    fit.SetFunction("resol", &resol);
+
+    TH1D direct("direct1D", "", 300, 250., 3250.);
+    TH1D fft("fft1D", "", 300, 250., 3250.);
+    fit.FillSmearedMCHistogram(NULL, direct, energy, pdf);
+    fit.SetFFTSmearing(true, tolerance);
+    fit.FillSmearedMCHistogram(NULL, fft, energy, pdf);
+    ok = Compare("1D", direct, fft, tolerance) and ok;
+  }
+
+  // 2D; the fit owns its functions.
+  {
+    Fit2D fit;
+    TF1* calibCC = new TF1("calibCC", "[0]*x", 0., 5000.);
+    calibCC->SetParameter(0, 1.02);
+    TF1* calibSC = new TF1("calibSC", "[0]*x", 0., 5000.);
+    calibSC->SetParameter(0, 0.98);
+    TF1* resolCC = new TF1("resolCC", "sqrt([0]*x + [1])", 0., 5000.);
+    resolCC->SetParameters(1.2, 400.);
+    TF1* resolSC = new TF1("resolSC", "sqrt([0]*x + [1] + [2]*x*x)", 0., 5000.);
+    resolSC->SetParameters(2.5, 900., 0.0004);
+    TF1* corr = new TF1("corr", "[0] + [1]*x", 0., 5000.);
+    corr->SetParameters(-0.2, -0.4/3000.);
+    fit.SetFunction("calib", "ioniz", calibCC);
+    fit.SetFunction("calib", "scint", calibSC);
+    fit.SetFunction("resol", "ioniz", resolCC);
+    fit.SetFunction("resol", "scint", resolSC);
+    fit.SetFunction("corr", "", corr);
+
+    TH2F direct("direct2D", "", 120, 200., 3200., 120, 200., 3200.);
+    TH2F fft("fft2D", "", 120, 200., 3200., 120, 200., 3200.);
+    fit.Smear(direct, energy, pdf);
+    fit.SetFFTSmearing(true, tolerance);
+    fit.Smear(fft, energy, pdf);
+    ok = Compare("2D", direct, fft, tolerance) and ok;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,339 @@
+//______________________________________________________________________________
+// transformer_stress
+//
+// Stress test for the thread-safe interfaces of EXOVWaveformTransformer and
+// EXOVWaveformExtractor.  One instance of each transformer is shared by all
+// threads; every thread transforms the same set of waveforms with its own
+// EXOWaveformWorkspace, and the results are compared bit by bit with those of
+// the plain (single-threaded) Transform.  Any difference, or a transformer
+// reporting itself as not thread-safe, makes the program exit with 1.
+//
+// Before that, the fused EXOWaveformPipeline is checked against the same
+// pipeline with SetFuseStages(false) and against its stages applied one by
+// one, for a run of recursive stages (which must agree bit by bit), runs of
+// spectral stages with and without a delay, and a mixed pipeline (which must
+// agree to within rounding).  A pipeline of pole-zero corrections must pass
+// a waveform of length one through, as EXOPoleZeroCorrection does.
+//
+// Usage: ./transformer_stress [threads] [passes]
+//
+// Without USE_THREADS the workers are run one after the other, which still
+// checks that the workspace interface reproduces the plain one.
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
+#include "EXOUtilities/EXOWaveformPipeline.hh"
+#include "EXOUtilities/EXOTransferFunction.hh"
+#include "EXOUtilities/EXORCIntegrator.hh"
+#include "EXOUtilities/EXORCDifferentiator.hh"
+#include "EXOUtilities/EXOPoleZeroCorrection.hh"
+#include "EXOUtilities/EXOBaselineRemover.hh"
+#include "EXOUtilities/EXOTrapezoidalFilter.hh"
+#include "EXOUtilities/EXOFiniteCuspFilter.hh"
+#include "EXOUtilities/EXOSavitzkyGolaySmoother.hh"
+#include "EXOUtilities/EXOBandpassFilter.hh"
+#include "EXOUtilities/EXOMatchedFilter.hh"
+#include "EXOUtilities/EXOBaselineAndNoiseCalculator.hh"
+#include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
+#include "EXOUtilities/SystemOfUnits.hh"
+#ifdef USE_THREADS
+#include "boost/thread/thread.hpp"
+#include "boost/bind.hpp"
+#endif
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+const size_t kLength = 2048;
+const size_t kNumWaveforms = 64;
+
+typedef std::vector<EXODoubleWaveform> WaveformVec;
+
+struct Case {
+  const EXOVWaveformTransformer* fTransformer;
+  bool fOutOfPlace;
+  WaveformVec fReference;
+};
+
+EXODoubleWaveform MakeWaveform(size_t index)
+{
+  // A noisy step at a random time, from a simple LCG so that the input does
+  // not depend on gRandom.
+  unsigned long state = 12345 + 7919*index;
+  EXODoubleWaveform wf;
+  wf.SetLength(kLength);
+  wf.SetSamplingFreq(1.*CLHEP::megahertz);
+  size_t step = 200 + (7*index) % 1500;
+  for(size_t i = 0; i < kLength; i++) {
+    state = (1103515245*state + 12345) % 2147483648UL;
+    wf[i] = 1600. + 20.*(double(state)/2147483648. - 0.5) + (i >= step ? 300. : 0.);
+  }
+  return wf;
+}
+
+bool Identical(const EXODoubleWaveform& a, const EXODoubleWaveform& b)
+{
+  if(a.GetLength() != b.GetLength()) return false;
+  if(a.GetLength() == 0) return true;
+  return memcmp(&a[0], &b[0], sizeof(double)*a.GetLength()) == 0;
+}
+
+bool Close(const EXODoubleWaveform& a, const EXODoubleWaveform& b)
+{
+  // Agreement to within rounding, relative to the largest sample of b.
+  if(a.GetLength() != b.GetLength()) return false;
+  double scale = 1.0;
+  for(size_t i = 0; i < b.GetLength(); i++) scale = std::max(scale, std::fabs(b[i]));
+  for(size_t i = 0; i < a.GetLength(); i++) {
+    if(not (std::fabs(a[i] - b[i]) <= 1e-9*scale)) return false;
+  }
+  return true;
+}
+
+size_t CheckFusing(const char* name, const EXOWaveformPipeline& pipeline,
+                   const WaveformVec& inputs, bool exact)
+{
+  // Compare the fused pipeline with the unfused one and with its stages
+  // applied one by one; return the number of mismatches.
+  EXOWaveformPipeline unfused;
+  for(size_t s = 0; s < pipeline.GetNumStages(); s++) unfused.AddStage(pipeline.GetStage(s));
+  unfused.SetFuseStages(false);
+
+  size_t failures = 0;
+  for(size_t i = 0; i < inputs.size(); i++) {
+    EXODoubleWaveform fused = inputs[i];
+    pipeline.Transform(&fused);
+    EXODoubleWaveform plain = inputs[i];
+    unfused.Transform(&plain);
+    EXODoubleWaveform byStage = inputs[i];
+    for(size_t s = 0; s < pipeline.GetNumStages(); s++) pipeline.GetStage(s).Transform(&byStage);
+
+    if(not Identical(plain, byStage)) failures++;
+    if(exact ? not Identical(fused, plain) : not Close(fused, plain)) failures++;
+  }
+  std::cout << name << ": fused against unfused and by stage: "
+            << failures << " mismatches" << std::endl;
+  return failures;
+}
+
+class Worker
+{
+  public:
+    Worker(const WaveformVec& inputs, const std::vector<Case>& cases,
+           const EXOBaselineAndNoiseCalculator& extractor,
+           const std::vector<double>& extracted, size_t passes)
+    : fInputs(inputs), fCases(cases), fExtractor(extractor),
+      fExtracted(extracted), fPasses(passes), fFailures(0) {}
+
+    void Run()
+    {
+      EXOWaveformWorkspace workspace;
+      EXODoubleWaveform wf, out;
+      for(size_t pass = 0; pass < fPasses; pass++) {
+        for(size_t c = 0; c < fCases.size(); c++) {
+          const Case& test = fCases[c];
+          for(size_t i = 0; i < fInputs.size(); i++) {
+            wf = fInputs[i];
+            if(test.fOutOfPlace) {
+              test.fTransformer->Transform(&wf, &out, workspace);
+              if(not Identical(out, test.fReference[i])) fFailures++;
+            } else {
+              test.fTransformer->Transform(&wf, NULL, workspace);
+              if(not Identical(wf, test.fReference[i])) fFailures++;
+            }
+          }
+        }
+        double values[EXOBaselineAndNoiseCalculator::kNumParameters];
+        for(size_t i = 0; i < fInputs.size(); i++) {
+          fExtractor.ExtractAll(fInputs[i], values);
+          for(size_t k = 0; k < EXOBaselineAndNoiseCalculator::kNumParameters; k++) {
+            if(values[k] != fExtracted[i*EXOBaselineAndNoiseCalculator::kNumParameters + k]) {
+              fFailures++;
+            }
+          }
+        }
+      }
+    }
+
+    size_t GetFailures() const { return fFailures; }
+
+  private:
+    const WaveformVec& fInputs;
+    const std::vector<Case>& fCases;
+    const EXOBaselineAndNoiseCalculator& fExtractor;
+    const std::vector<double>& fExtracted;
+    size_t fPasses;
+    size_t fFailures;
+};
+
+}
+
+int main(int argc, char** argv)
+{
+  size_t nthreads = (argc > 1) ? atoi(argv[1]) : 8;
+  size_t passes = (argc > 2) ? atoi(argv[2]) : 20;
+  if(nthreads == 0) nthreads = 1;
+
+  WaveformVec inputs;
+  for(size_t i = 0; i < kNumWaveforms; i++) inputs.push_back(MakeWaveform(i));
+
+  // The transformers under test.
+  EXOTransferFunction transfer;
+  transfer.AddIntegStageWithTime(3.*CLHEP::microsecond);
+  transfer.AddIntegStageWithTime(3.*CLHEP::microsecond);
+  transfer.AddDiffStageWithTime(40.*CLHEP::microsecond);
+  transfer.AddDiffStageWithTime(300.*CLHEP::microsecond);
+
+  EXORCIntegrator integrator;
+  integrator.SetTimeConstant(2.*CLHEP::microsecond);
+  EXORCDifferentiator differentiator;
+  differentiator.SetTimeConstant(50.*CLHEP::microsecond);
+
+  EXOPoleZeroCorrection poleZero;
+  poleZero.SetDecayConstant(300.*CLHEP::microsecond);
+  poleZero.SetRestingBaselineValue(0.0);
+
+  EXOBaselineRemover baselineRemover;
+  baselineRemover.SetBaselineSamples(150);
+
+  EXOTrapezoidalFilter trapezoid;
+  trapezoid.SetRampTime(10.*CLHEP::microsecond);
+  trapezoid.SetFlatTime(5.*CLHEP::microsecond);
+  trapezoid.SetDecayConstant(300.*CLHEP::microsecond);
+
+  EXOFiniteCuspFilter cusp;
+  cusp.SetRampTime(10.*CLHEP::microsecond);
+  cusp.SetFlatTime(5.*CLHEP::microsecond);
+  cusp.SetDecayConstant(300.*CLHEP::microsecond);
+
+  EXOSavitzkyGolaySmoother smoother(5, 0, 2);
+
+  EXOBandpassFilter bandpass;
+  bandpass.SetLowerBandpass(1.*CLHEP::kilohertz);
+  bandpass.SetUpperBandpass(100.*CLHEP::kilohertz);
+
+  EXOBandpassFilter narrowBandpass;
+  narrowBandpass.SetLowerBandpass(5.*CLHEP::kilohertz);
+  narrowBandpass.SetUpperBandpass(50.*CLHEP::kilohertz);
+
+  EXOMatchedFilter matched;
+  EXOWaveformPipeline pipeline;
+  pipeline.AddStage(baselineRemover);
+  pipeline.AddStage(transfer);
+  pipeline.AddStage(poleZero);
+
+  bool haveFFT = EXOFastFourierTransformFFTW::IsAvailable();
+  if(haveFFT) {
+    EXODoubleWaveform signal = MakeWaveform(0);
+    baselineRemover.Transform(&signal);
+    transfer.Transform(&signal);
+    matched.SetTemplateToMatch(signal, kLength, 100);
+    pipeline.AddStage(bandpass);
+    pipeline.AddStage(matched);
+  }
+  pipeline.AddStage(cusp);
+
+  // Fused pipelines against their stages.
+  size_t fusingFailures = 0;
+  EXOWaveformPipeline recursive;
+  recursive.AddStage(transfer);
+  recursive.AddStage(poleZero);
+  recursive.AddStage(integrator);
+  recursive.AddStage(differentiator);
+  fusingFailures += CheckFusing("recursive", recursive, inputs, true);
+  if(haveFFT) {
+    EXOWaveformPipeline spectral;
+    spectral.AddStage(bandpass);
+    spectral.AddStage(narrowBandpass);
+    fusingFailures += CheckFusing("spectral", spectral, inputs, false);
+
+    // The delay of the matched filter ends the first run; the second
+    // bandpass is applied on its own.
+    EXOWaveformPipeline delayed;
+    delayed.AddStage(bandpass);
+    delayed.AddStage(matched);
+    delayed.AddStage(narrowBandpass);
+    fusingFailures += CheckFusing("spectral with delay", delayed, inputs, false);
+  }
+  fusingFailures += CheckFusing("mixed", pipeline, inputs, not haveFFT);
+
+  EXOWaveformPipeline poleZeros;
+  poleZeros.AddStage(poleZero);
+  poleZeros.AddStage(poleZero);
+  EXODoubleWaveform single;
+  single.SetLength(1);
+  single.SetSamplingFreq(1.*CLHEP::megahertz);
+  single[0] = 1600.;
+  poleZeros.Transform(&single);
+  if(single.GetLength() != 1 or single[0] != 1600.) {
+    std::cout << "pole-zero pipeline changed a waveform of length one" << std::endl;
+    fusingFailures++;
+  }
+  if(fusingFailures != 0) return 1;
+
+  const EXOVWaveformTransformer* inPlace[] = {
+    &transfer, &integrator, &differentiator, &poleZero, &baselineRemover,
+    &trapezoid, &cusp, &smoother, &pipeline, &bandpass, &matched };
+  size_t nInPlace = sizeof(inPlace)/sizeof(inPlace[0]);
+  if(not haveFFT) nInPlace -= 2;
+
+  // Serial references from the plain interface.
+  std::vector<Case> cases;
+  for(size_t t = 0; t < nInPlace; t++) {
+    for(int outOfPlace = 0; outOfPlace < 2; outOfPlace++) {
+      Case test;
+      test.fTransformer = inPlace[t];
+      test.fOutOfPlace = outOfPlace;
+      for(size_t i = 0; i < inputs.size(); i++) {
+        EXODoubleWaveform wf = inputs[i];
+        EXODoubleWaveform out;
+        if(outOfPlace) {
+          test.fTransformer->Transform(&wf, &out);
+          test.fReference.push_back(out);
+        } else {
+          test.fTransformer->Transform(&wf);
+          test.fReference.push_back(wf);
+        }
+      }
+      if(not test.fTransformer->IsThreadSafe()) {
+        std::cout << test.fTransformer->GetName() << " is not thread-safe" << std::endl;
+        return 1;
+      }
+      cases.push_back(test);
+    }
+  }
+
+  EXOBaselineAndNoiseCalculator extractor;
+  extractor.SetTriggerSample(250);
+  std::vector<double> extracted;
+  for(size_t i = 0; i < inputs.size(); i++) {
+    const EXOMiscUtil::ParameterMap& params = extractor.ExtractAll(inputs[i]);
+    for(size_t k = 0; k < EXOBaselineAndNoiseCalculator::kNumParameters; k++) {
+      extracted.push_back(params.find(extractor.GetParameterName(k))->second);
+    }
+  }
+
+  std::vector<Worker> workers(nthreads, Worker(inputs, cases, extractor, extracted, passes));
+#ifdef USE_THREADS
+  boost::thread_group threads;
+  for(size_t i = 0; i < nthreads; i++) {
+    threads.create_thread(boost::bind(&Worker::Run, &workers[i]));
+  }
+  threads.join_all();
+#else
+  std::cout << "Built without USE_THREADS; running the workers serially." << std::endl;
+  for(size_t i = 0; i < nthreads; i++) workers[i].Run();
+#endif
+
+  size_t failures = 0;
+  for(size_t i = 0; i < nthreads; i++) failures += workers[i].GetFailures();
+  std::cout << nthreads << " threads x " << passes << " passes over "
+            << cases.size() << " transforms and 1 extractor: "
+            << failures << " mismatches" << std::endl;
+  return (failures == 0) ? 0 : 1;
+}
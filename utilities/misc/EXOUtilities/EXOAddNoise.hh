@@ -16,6 +16,9 @@ class EXOAddNoise : public EXOVWaveformTransformer
     // This transform is optimized for an in-place transformation
     virtual bool IsInPlace() const { return true; }
 
+    // Noise is drawn from gRandom and the noise cache is filled lazily.
+    virtual bool IsThreadSafe() const { return false; }
+
     // Add an differentiation stage 
     void AddDiffStageWithTime(Double_t time)
       { fDiffStages.push_back(time); Reset(); }
@@ -0,0 +1,34 @@
+#ifndef EXOAtomicFile_hh
+#define EXOAtomicFile_hh
+
+#include <cstdio>
+#include <string>
+
+class EXOAtomicFile
+{
+  public:
+    // Open a temporary file next to filename for writing; GetFile returns
+    // NULL if it could not be opened.
+    EXOAtomicFile(const std::string& filename);
+    // Remove the temporary file, unless it was committed.
+    ~EXOAtomicFile();
+
+    FILE* GetFile() const { return fFile; }
+    const std::string& GetFilename() const { return fFilename; }
+    const std::string& GetTemporaryName() const { return fTemporaryName; }
+
+    // Close the temporary file and, if ok and it closed cleanly, rename it
+    // to filename; otherwise remove it.  Returns true if the file is in
+    // place.
+    bool Commit(bool ok = true);
+
+  private:
+    EXOAtomicFile(const EXOAtomicFile&);
+    EXOAtomicFile& operator=(const EXOAtomicFile&);
+
+    std::string fFilename;
+    std::string fTemporaryName;
+    FILE* fFile;                  //!
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define EXOBandpassFilter_hh
 
 #include "EXOUtilities/EXOVWaveformTransformer.hh"
+#include <complex>
+#include <cstddef> //for size_t
 
 class EXOBandpassFilter : public EXOVWaveformTransformer 
 {
@@ -20,11 +22,19 @@ class EXOBandpassFilter : public EXOVWaveformTransformer
     virtual double GetUpperBandpass() const 
       { return fUpperBandpass; }
 
+    virtual bool GetFrequencyResponse(const EXODoubleWaveform& wf,
+                                      EXOWaveformFT& response,
+                                      size_t& delay) const;
+
    protected: 
      double fLowerBandpass; // The lower bandpass
      double fUpperBandpass; // The upper bandpass
     
       virtual void TransformInPlace(EXODoubleWaveform& anInput) const;
+      virtual void TransformInPlace(EXODoubleWaveform& anInput,
+                                    EXOWaveformWorkspace& workspace) const;
+      void ZeroOutsideBand(std::complex<double>* complex_data, size_t length,
+                           double samplingFreq) const;
 };
 
 #endif
@@ -7,13 +7,17 @@
 class EXOBaselineAndNoiseCalculator: public EXOVWaveformExtractor
 {
   public:
+    enum EParameter { kBaseline, kNoisecounts, kNumParameters };
+
     EXOBaselineAndNoiseCalculator();
 
-    virtual void DoExtractAll(const EXODoubleWaveform& wf) const;
+    virtual size_t GetNumParameters() const { return kNumParameters; }
+    virtual const char* GetParameterName(size_t index) const;
     void SetTriggerSample(size_t sample){fTriggerSample = sample;}
     void SetMaxIterations(Int_t val){fMaxIterations = val;}
 
   protected:
+    virtual void DoExtract(const EXODoubleWaveform& wf, double values[]) const;
     size_t fTriggerSample;
     Int_t fMaxIterations;
 };
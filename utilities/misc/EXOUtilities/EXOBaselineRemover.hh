@@ -13,6 +13,10 @@ class EXOBaselineRemover : public EXOVWaveformTransformer
     virtual bool IsInPlace() const { return true; }
     virtual void CalculateBaselineAndRMS(const EXODoubleWaveform& waveform) const;
 
+    // Thread-safe: returns the values without storing them.
+    void ComputeBaselineAndRMS(const EXODoubleWaveform& waveform,
+                               double& mean, double& rms) const;
+
     virtual double GetBaseline(const EXODoubleWaveform& waveform) const;
     
     //! Sets the region over which the baseline is averaged.  
@@ -39,6 +43,8 @@ class EXOBaselineRemover : public EXOVWaveformTransformer
 
   protected:
     virtual void TransformInPlace(EXODoubleWaveform& anInput) const;
+    virtual void TransformInPlace(EXODoubleWaveform& anInput,
+                                  EXOWaveformWorkspace& workspace) const;
     ERegionUnits fRegionUnits;
     size_t fBaselineSamples;
     size_t fStartSample;
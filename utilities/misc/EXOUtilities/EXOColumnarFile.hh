@@ -0,0 +1,84 @@
+#ifndef EXOColumnarFile_hh
+#define EXOColumnarFile_hh
+
+#include "Rtypes.h"
+#include <string>
+#include <vector>
+#include <cstddef> //for size_t
+
+class EXOColumnarFile
+{
+  public:
+    // Rows of a column are events, charge clusters or scintillation
+    // clusters.  The clusters of all events follow each other; see the
+    // event columns ncl/first_cl and nsc/first_sc written by the coutput
+    // module.
+    enum ELevel {
+      kEvent = 0,
+      kChargeCluster,
+      kScintillationCluster,
+      kNumLevels
+    };
+    enum EType {
+      kInt = 0,                     // Int_t
+      kLong64,                      // Long64_t
+      kDouble                       // Double_t
+    };
+    static size_t GetTypeSize(EType type);
+
+    // On-disk layout, shared with EXOColumnarFileWriter.
+    struct Header {
+      char      fMagic[8];          // "EXOCOLMN"
+      UInt_t    fVersion;
+      UInt_t    fNumColumns;
+      Long64_t  fNumRows[kNumLevels];
+    };
+    struct Column {
+      char      fName[48];          // Null terminated
+      UInt_t    fType;
+      UInt_t    fLevel;
+      ULong64_t fOffset;            // Byte offset of the values, 64-byte aligned
+    };
+    static const char* GetMagic();
+    static UInt_t GetVersion() { return 1; }
+
+    EXOColumnarFile();
+    ~EXOColumnarFile();
+
+    // Map filename read-only.  Returns false, logging why, if it is not a
+    // valid columnar file.
+    bool Open(const std::string& filename);
+    void Close();
+    bool IsOpen() const { return fMapping != NULL; }
+
+    Long64_t GetNumRows(ELevel level) const;
+    Long64_t GetNumEvents() const { return GetNumRows(kEvent); }
+
+    size_t GetNumColumns() const;
+    std::string GetColumnName(size_t column) const;
+    EType GetColumnType(size_t column) const;
+    ELevel GetColumnLevel(size_t column) const;
+    int FindColumn(const std::string& name) const; // -1 if there is none
+
+    // The values of a column, GetNumRows(level) of them, straight from the
+    // mapped file.  NULL, with an error, if there is no column of that name
+    // and type.  The pointers are valid until Close.
+    const Int_t* GetIntColumn(const std::string& name) const;
+    const Long64_t* GetLong64Column(const std::string& name) const;
+    const Double_t* GetDoubleColumn(const std::string& name) const;
+
+  private:
+    EXOColumnarFile(const EXOColumnarFile&);
+    EXOColumnarFile& operator=(const EXOColumnarFile&);
+
+    const Header& GetHeader() const
+      { return *static_cast<const Header*>(fMapping); }
+    const Column& GetColumn(size_t column) const
+      { return reinterpret_cast<const Column*>(&GetHeader() + 1)[column]; }
+    const void* GetValues(const std::string& name, EType type) const;
+
+    void* fMapping;                   //! Start of the mapped file
+    size_t fMappingSize;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef EXOColumnarFileWriter_hh
+#define EXOColumnarFileWriter_hh
+
+#include "EXOUtilities/EXOColumnarFile.hh"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <utility>
+
+class EXOColumnarFileWriter
+{
+  public:
+    EXOColumnarFileWriter();
+    ~EXOColumnarFileWriter();
+
+    // Declare a column; all columns must be declared before Open.  Returns
+    // the index to pass to Fill.
+    size_t AddColumn(const std::string& name, EXOColumnarFile::EType type,
+                     EXOColumnarFile::ELevel level);
+
+    bool Open(const std::string& filename);
+    bool IsOpen() const { return fSpool != NULL; }
+
+    // Append a value to a column; the type must be that of the column.
+    void Fill(size_t column, Int_t value) { Append(column, EXOColumnarFile::kInt, &value); }
+    void Fill(size_t column, Long64_t value) { Append(column, EXOColumnarFile::kLong64, &value); }
+    void Fill(size_t column, Double_t value) { Append(column, EXOColumnarFile::kDouble, &value); }
+
+    // Write the file.  Fails if the columns of a level have different
+    // numbers of values.
+    bool Close();
+
+  private:
+    EXOColumnarFileWriter(const EXOColumnarFileWriter&);
+    EXOColumnarFileWriter& operator=(const EXOColumnarFileWriter&);
+
+    struct PendingColumn {
+      EXOColumnarFile::Column fColumn;
+      std::vector<char> fBuffer;                       // Values not yet spooled
+      std::vector<std::pair<long, size_t> > fChunks;   // Spooled (offset, size)
+      ULong64_t fNumValues;
+    };
+
+    void Append(size_t column, EXOColumnarFile::EType type, const void* value);
+    bool Spool(PendingColumn& column);
+    bool WriteFile(FILE* file);
+
+    std::string fFilename;
+    std::string fSpoolName;
+    FILE* fSpool;                     //! Values of all columns in chunks, as they come
+    long fSpoolSize;
+    bool fOK;
+    std::vector<PendingColumn> fColumns;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef EXOCorrelatedNoiseGenerator_hh
+#define EXOCorrelatedNoiseGenerator_hh
+
+#include <vector>
+#include <cstddef> //for size_t
+
+class EXONoiseCorrelations;
+class EXOWaveformData;
+class TRandom;
+
+class EXOCorrelatedNoiseGenerator
+{
+  public:
+    EXOCorrelatedNoiseGenerator();
+    ~EXOCorrelatedNoiseGenerator();
+
+    // Factor the covariance matrices of noise; returns false, leaving the
+    // generator empty, if noise holds no usable correlations.
+    bool SetNoiseCorrelations(EXONoiseCorrelations& noise);
+    void Clear();
+    bool IsReady() const { return not fChannels.empty(); }
+
+    size_t GetNumChannels() const { return fChannels.size(); }
+    int GetChannel(size_t index) const { return fChannels[index]; }
+    size_t GetNumBlocks() const { return fBlocks.size(); }
+    size_t GetNoiseLength() const { return fLength; }
+
+    // Draw cache independent stretches of GetNoiseLength() samples once, and
+    // give each event noise from a random point of them, as EXOAddNoise
+    // does; 0 draws new noise for every event.
+    void SetCacheLength(size_t cache);
+    size_t GetCacheLength() const { return fCacheLength; }
+
+    // Draw new noise for all channels at once; see GetNoise.
+    void Generate(TRandom& random);
+    size_t GetRecordLength() const { return fRecordLength; }
+
+    // Noise (ADC counts) on channel from the last Generate, GetRecordLength()
+    // samples long, or NULL if channel is not correlated.  It is made of
+    // max(cache, 1) stretches of GetNoiseLength() samples, each periodic.
+    const float* GetNoise(int channel) const;
+
+    // Add noise to every waveform of wfData on a correlated channel, drawing
+    // it first if it is not cached.  Returns the number of waveforms
+    // changed.
+    size_t AddNoise(EXOWaveformData& wfData, TRandom& random);
+
+  private:
+    EXOCorrelatedNoiseGenerator(const EXOCorrelatedNoiseGenerator&);
+    EXOCorrelatedNoiseGenerator& operator=(const EXOCorrelatedNoiseGenerator&);
+
+    // Channels whose noise is drawn together; the blocks are independent.
+    struct Block {
+      std::vector<size_t> fIndices;    // Of the channels
+      size_t fOffset;                  // Of its factor within a frequency of fFactors
+    };
+
+    static int BlockOfChannel(int channel);
+    static bool Factor(double* packed, size_t size);
+    void ClearNoise();
+    void FreeArrays();
+
+    std::vector<int> fChannels;        // Correlated channels, by index
+    std::vector<int> fChannelIndex;    // Channel number -> index, or -1
+    std::vector<Block> fBlocks;
+    size_t fNumFrequencies;            // Including the 0-frequency component
+    size_t fLength;                    // Time-domain length of the correlations
+    size_t fCacheLength;
+    size_t fRecordLength;              // Of the noise in fNoise, 0 if none
+    std::vector<float> fFactors;       // Cholesky factors of the blocks, per frequency > 0
+    size_t fFactorsPerFrequency;
+    std::vector<std::vector<float> > fNoise; // Noise of each channel, by index
+    std::vector<void*> fArrays;        // FFT arrays of one noise length, one per channel
+    std::vector<float> fNormal;        // Scratch for the random draws
+    std::vector<float> fCorrelated;
+};
+
+#endif
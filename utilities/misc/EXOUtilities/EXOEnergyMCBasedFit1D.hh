@@ -2,6 +2,7 @@
 #define EXOEnergyMCBasedFit1D_hh
 
 #include "EXOUtilities/EXOEnergyMCBasedFitBase.hh"
+#include "EXOUtilities/EXOGaussianSmearing.hh"
 
 class EXOEnergyMCBasedFit1D : public EXOEnergyMCBasedFitBase
 {
@@ -44,8 +45,13 @@ protected:
   
   virtual bool SmearedMCHistoCalib(std::vector<double>& e_up, double& elow, const TH1D& histo);
   virtual bool SmearedMCHistoResol(std::vector<double>& weight, const std::vector<Double_t>& energy, const std::vector<Double_t>& pdf, const std::vector<double>& e_up, double elow);  
+  bool SmearedMCHistoResolFFT(std::vector<double>& weight, const std::vector<Double_t>& energy, const std::vector<Double_t>& pdf, const std::vector<double>& e_up, double elow);
+  virtual bool SmearedMCHistoCalibGradient(std::vector<double>& gradient, const TH1D& histo);
+  bool FillSmearedMCHistogramGradient(TH1D& histo, std::vector<double>& gradient, const std::vector<Double_t>& energy, const std::vector<Double_t>& pdf);
   void GetScaleHistogram(TH1D& hScale, const TH1D& hData, const TH1D& hMC, bool usePrescaleModel = false);
+  void GetScaleGradient(std::vector<double>& gradient, const TH1D& hData, const TH1D& hMC, const std::vector<double>& mcGradient, bool usePrescaleModel = false);
   double FitFunction(const double* x);
+  double FitFunctionGradient(const double* x, double* grad);
 
   
   ClassDef(EXOEnergyMCBasedFit1D,2)
@@ -2,6 +2,7 @@
 #define EXOEnergyMCBasedFit2D_hh
 
 #include "EXOUtilities/EXOEnergyMCBasedFitBase.hh"
+#include "EXOUtilities/EXOGaussianSmearing.hh"
 
 class EXOEnergyMCBasedFit2D : public EXOEnergyMCBasedFitBase
 {
@@ -21,6 +22,7 @@ public:
   void SetOffset(double offset = 0.);
   void SetMaxOffset(double maxOffset = 0.001,bool activate = true,bool stopaccov = true);
   void SetMaxIterations(int maxIter= 1000);
+  void SetSmearingWindow(Double_t numSigma = 8.) { fSmearingWindow = numSigma; } // <= 0 for no window
 
   Double_t GetPeakPosition(Double_t energy, TString channel, bool fitted = true);
   Double_t GetPeakPositionError(Double_t energy, TString channel, Int_t nDraws = 1000, TH1D *saveDraws = NULL);
@@ -42,6 +44,27 @@ protected:
   void FillSmearedMCHistogram(TH2F& histo, const std::vector<Double_t>& energy, const std::vector<Double_t>& pdf);
   void FillSmearedMC2DHistogram(const double* x, TH2F& histo, const std::vector<std::pair<Double_t,Double_t> >& energy, const std::vector<Double_t>& pdf);
   void FillSmearedMC2DHistogram(TH2F& histo, const std::vector<std::pair<Double_t,Double_t> >& energy, const std::vector<Double_t>& pdf);
+
+  // Inputs of the smearing: MC energies, their resolution terms and the
+  // quadrature points of the bins, see FillSmearedHistogram.
+  struct SmearingTerms
+  {
+    SmearingTerms() : fOnDiagonal(false) {}
+    bool fOnDiagonal; // Equal ionization and scintillation energies
+    std::vector<Float_t> fEnergyCC, fEnergySC;
+    std::vector<Float_t> fNormXPdf, fSigmaCC, fSigmaSC, fCorr, fLimit;
+    std::vector<Float_t> fResolCC, fResolSC;
+    std::vector<size_t> fFirstCC, fLastCC, fFirstSC, fLastSC;
+    std::vector<Float_t> fSumCC, fSubCC, fMidCC;
+    std::vector<Float_t> fSumSC, fSubSC, fMidSC;
+  };
+  void FillSmearedHistogram(TH2F& histo, SmearingTerms& terms, const std::vector<Double_t>& pdf);
+  void SmearMCEnergiesFFT(const SmearingTerms& terms, const std::vector<Double_t>& pdf, std::vector<float>& content);
+  void FindSmearingWindows(SmearingTerms& terms) const;
+  static void FindSmearingWindow(const std::vector<Float_t>& sum, const std::vector<Float_t>& sub, const std::vector<Float_t>& mid, float ene, float sigma, float limit, size_t& first, size_t& last);
+  void SmearMCEnergies(const SmearingTerms& terms, std::vector<float>& content);
+  void SmearRows(const SmearingTerms& terms, std::vector<float>& content, size_t firstRow, size_t rowStep);
+
   void GetScaleHistogram(TH2F& hScale, const TH2F& hData, const TH2F& hMC);
   double FitFunction(const double* x);
 
@@ -55,8 +78,9 @@ protected:
   bool fMaxOffsetActivated;
   bool fMaxOffsetStopSuccessCov;
   int fMaxIterations;
+  Double_t fSmearingWindow; // Number of sigmas around each MC energy to smear into
 
-  ClassDef(EXOEnergyMCBasedFit2D,2)
+  ClassDef(EXOEnergyMCBasedFit2D,3)
 };
 
 #endif
@@ -37,6 +37,9 @@ typedef struct MCEntry {
   std::vector<Double_t> MCEnergyPDF;
   TH1* MCSmearedHisto;
   Bool_t Is2D;
+  std::string CacheKey; // Key of the binned energies on disk, see EXOEnergyMCBasedFitBase::SetMCCacheDirectory
+  Int_t BinnedGran; // Granularity the energies are binned with, 0 if not binned
+  Double_t BinnedCutoff;
 
   void InitializeMembers(Int_t sourceAtomicNumber, Int_t sourceMassNumber, Float_t sourceX, Float_t sourceY, Float_t sourceZ){
     SourceAtomicNumber = sourceAtomicNumber;
@@ -50,6 +53,9 @@ typedef struct MCEntry {
     MCEnergyPDF.clear();
     MCSmearedHisto = 0;
     Is2D = false;
+    CacheKey = "";
+    BinnedGran = 0;
+    BinnedCutoff = 0;
   }
 
   void SetEnergy(Double_t *mcPoints, Double_t *mcWeights, Int_t nMC){
@@ -203,6 +209,24 @@ public:
   bool AddMC(const char* id, Int_t sourceAtomicNumber, Int_t sourceMassNumber, Float_t sourceX, Float_t sourceY, Float_t sourceZ, Double_t *mcPoints, Double_t *mcWeights, Int_t nMC);
 
   void BinMCEnergy(Int_t gran = 1, std::string mcId = "all", Double_t cutoff = 0); // granularity = 1/gran keV
+
+  // Binned MC energies can be kept on local disk, in files named after a key
+  // given by the caller, which must identify the MC files, the selection and
+  // the multiplicity (e.g. "<file hashes>/<cuts>/ss").  BinMCEnergy saves the
+  // MC entries that have a key; AddCachedMC adds an MC entry from a saved
+  // binning, so the MC trees need not be read again.  An entry which holds
+  // its MC energies only takes the saved binning if it was made from as
+  // many energies with the same sum of weights.
+  void SetMCCacheDirectory(const char* dir){fMCCacheDirectory = dir;};
+  bool SetMCCacheKey(const char* mcId, const char* key);
+  bool AddCachedMC(const char* id, const char* key, Int_t sourceAtomicNumber, Int_t sourceMassNumber, Float_t sourceX, Float_t sourceY, Float_t sourceZ, Bool_t is2D = false, Int_t gran = 1, Double_t cutoff = 0);
+  void SetNumThreads(Int_t numThreads = 1){fNumThreads = numThreads;}; // Only with USE_THREADS
+
+  // Give MIGRAD the derivatives of the NLL with respect to the parameters,
+  // computed in the same pass as its value, instead of finite differences.
+  // Set before BuildFitter; only used by the fits that implement
+  // FitFunctionGradient.
+  void SetAnalyticGradient(bool use){fUseAnalyticGradient = use;};
   virtual bool BuildFitter();
   bool ApplyFittedParameters();
   void SaveHistosIn(const char* name, const char* option, int rebinX = 1, int rebinY = 1);
@@ -215,10 +239,29 @@ public:
 
   // only use this function if you know what you are doing!
   void SetAllFitCalculations(bool onoff){fAllFitCalculations = onoff;}; 
+
+  // Smear the MC by FFT convolution over segments of the energy axis in which
+  // the resolution varies by less than the relative tolerance, instead of
+  // summing over every MC energy.  Each MC energy is smeared with the width
+  // of its segment rather than its own, which differs by at most the
+  // tolerance (twice the tolerance in 2D, where a segment takes the widths
+  // of its middle energy); the grid adds about a fifth of the tolerance.  A
+  // relative width error d moves the smeared weight below any energy by at
+  // most d/sqrt(2 pi e) = 0.24 d of the weight of the MC energy, so a bin is
+  // off by at most about 0.6 times the tolerance (about twice it in 2D) of
+  // the MC weight within a few resolutions of it.  Segments are smeared over
+  // their whole extent plus 8 resolutions, so their edges add nothing to
+  // this and are not evaluated directly.
+  void SetFFTSmearing(bool use, Double_t tolerance = 0.01){fUseFFTSmearing = use; fFFTSmearingTolerance = tolerance;};
   
 protected:
   Int_t fDimension;
   bool fAllFitCalculations;
+  bool fUseFFTSmearing;
+  Double_t fFFTSmearingTolerance;
+  std::string fMCCacheDirectory; //! Empty for no cache of binned MC
+  Int_t fNumThreads; //! Threads binning and smearing the MC
+  bool fUseAnalyticGradient; //!
   
   TFitter *fFitter;
   TMatrixDSym *fCov;
@@ -241,8 +284,16 @@ protected:
   bool SetFitFunctionParameters(const double* x);
   std::vector<Double_t> GetFittedParameters();
   virtual double FitFunction(const double* x);
+  virtual double FitFunctionGradient(const double* x, double* grad);
+  std::vector<Int_t> GetFitParameterIndices(const TF1* function) const;
   virtual double GetErrorDef(double delta);
   void ApplyCalibration(std::vector<Double_t>& energies, TF1* calibFunction);
+  std::string GetMCCacheFile(const std::string& key, bool is2D, Int_t gran, Double_t cutoff) const;
+  bool ReadBinnedMC(MCEntry& mc, const std::string& key, bool is2D, Int_t gran, Double_t cutoff, bool checkRaw) const;
+  bool WriteBinnedMC(const MCEntry& mc, ULong64_t numRawPoints, Double_t rawWeightSum) const;
+  static void SummarizeMC(const MCEntry& mc, ULong64_t& numPoints, Double_t& weightSum);
+  static void BinEnergies(MCEntry& mc, Int_t gran, Double_t cutoff);
+  static void BinEntries(std::vector<MCEntry*>& entries, Int_t gran, Double_t cutoff, size_t first, size_t step);
 
 
   std::vector<Double_t> DrawGausFitPars();
@@ -250,8 +301,9 @@ protected:
   ROOT::Math::Functor *fFitFunction;
   static void Fcn(int &, double *, double& f, double *, int);
   static ROOT::Math::IMultiGenFunction *fFCN;
+  static EXOEnergyMCBasedFitBase *fGradientFit; // Fit computing the gradient for Fcn, if any
 
-  ClassDef(EXOEnergyMCBasedFitBase,2)
+  ClassDef(EXOEnergyMCBasedFitBase,3)
 };
 
 #endif
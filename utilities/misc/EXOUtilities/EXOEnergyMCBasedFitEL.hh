@@ -22,6 +22,7 @@ public:
 protected:
 
   bool SmearedMCHistoCalib(std::vector<double>& e_up, double& elow, const TH1D& histo);
+  bool SmearedMCHistoCalibGradient(std::vector<double>& gradient, const TH1D& histo);
 
   bool fHasSplittedZbins;
   std::vector<Double_t> fZbins; // low edges
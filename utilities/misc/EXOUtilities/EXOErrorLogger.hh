@@ -2,12 +2,43 @@
 #define EXOErrorLogger_hh
 #include <map>
 #include <string>
+#include <vector>
+#include <sstream>
 
 #define LogEXOMsg(errmsg, severity) \
  EXOErrorLogger::GetLogger().LogError(__PRETTY_FUNCTION__,__FILE__, __LINE__,errmsg, severity)
 #define LogEXOMsgShort(errmsg, severity) \
  EXOErrorLogger::GetLogger().LogError(__FUNCTION__,__FILE__, __LINE__,errmsg, severity)
 
+#ifndef __CINT__
+// Cheap logging for hot paths.  Each call site keeps a static record, so a
+// call that won't be printed costs a comparison and an increment: the message
+// is only built the first time and whenever it is actually printed.  The
+// severity must be the same for every call from a given site.
+//
+//   LogEXOMsgF(EEWarning, "Channel %d has no gain", channel);
+//   LogEXOMsgStream(EEWarning, "U index off: " << u);
+#define LogEXOMsgF(severity, ...)                                              \
+  do {                                                                         \
+    static EXOErrorLogger::LogSite exoLogSite__(__PRETTY_FUNCTION__, __FILE__, \
+                                                __LINE__, severity);           \
+    EXOErrorLogger& exoLogger__ = EXOErrorLogger::GetLogger();                 \
+    if (exoLogger__.CountOrFormat(exoLogSite__))                               \
+      exoLogger__.LogFormatted(exoLogSite__, __VA_ARGS__);                     \
+  } while(0)
+#define LogEXOMsgStream(severity, streamexpr)                                  \
+  do {                                                                         \
+    static EXOErrorLogger::LogSite exoLogSite__(__PRETTY_FUNCTION__, __FILE__, \
+                                                __LINE__, severity);           \
+    EXOErrorLogger& exoLogger__ = EXOErrorLogger::GetLogger();                 \
+    if (exoLogger__.CountOrFormat(exoLogSite__)) {                             \
+      std::ostringstream exoLogStream__;                                       \
+      exoLogStream__ << streamexpr;                                            \
+      exoLogger__.LogSiteMessage(exoLogSite__, exoLogStream__.str());          \
+    }                                                                          \
+  } while(0)
+#endif
+
 enum EXOErrorLevel {
   EEOk = 0,   // all fine
   EEDebug,    // debug-level
@@ -45,7 +76,28 @@ private:
   typedef std::map<LoggedError, int> ErrSet;
   ErrSet fErrors;           // Map holding msgs 
 
+public:
+  // Record of a single LogEXOMsgF/LogEXOMsgStream call site.  It has a
+  // trivial destructor so it is still valid when the logger prints the
+  // summary at exit.
+  class LogSite {
+    public:
+      LogSite(const char* func, const char* afile, int aline, EXOErrorLevel level);
+      const char*   fFunction;
+      const char*   fFilename; // without the path
+      int           fLine;
+      EXOErrorLevel fSeverity;
+      int           fCount;    // number of calls
+  };
+
+private:
+  std::vector<LogSite*>    fSites;        // Call sites that have been used
+  std::vector<std::string> fSiteMessages; // First message logged from each site
+
   void PrintError( const LoggedError& err ) const;
+  void LogOverflow();
+
+  static const int fCountMax;
   
   // Make private to make it a singleton
   EXOErrorLogger();
@@ -63,8 +115,19 @@ public:
     static EXOErrorLogger gfLogger; return gfLogger; 
   } 
 
-  void LogError(std::string classfuncname, std::string filename, int aline,
-                std::string msg, EXOErrorLevel severity );
+  void LogError(const std::string& classfuncname, const std::string& filename, int aline,
+                const std::string& msg, EXOErrorLevel severity );
+
+  // Used by LogEXOMsgF and LogEXOMsgStream.  CountOrFormat only counts the
+  // call and returns false if the message won't be printed, otherwise the
+  // caller builds the message and passes it on.
+  bool CountOrFormat(LogSite& site);
+  void LogSiteMessage(LogSite& site, const std::string& msg);
+  void LogFormatted(LogSite& site, const char* format, ...)
+#ifndef __CINT__
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
 
   std::string GetSummary(bool Suppress = true) const;
 
@@ -82,9 +145,24 @@ public:
   static void RedirectAllOutputTo(std::ostream& out);
   static void ResetRedirection();
   static void RedirectAllOutputToDevNull();
-  static void ClearOutputRecord() { GetLogger().fErrors.clear(); }
+  static void ClearOutputRecord();
 };
 
+//---- inlines -----------------------------------------------------------------
+
+inline bool EXOErrorLogger::CountOrFormat(LogSite& site)
+{
+  // Returns true if the message for this call has to be built, i.e. on the
+  // first call from the site and whenever it is going to be printed.
+  // Otherwise the call is counted and nothing else is done.
+  if (site.fCount > 0 and (site.fSeverity < fThreshold or site.fCount >= fPrintMax)) {
+    if (site.fCount < fCountMax) site.fCount++;
+    else LogOverflow();
+    return false;
+  }
+  return true;
+}
+
 #endif
 
 
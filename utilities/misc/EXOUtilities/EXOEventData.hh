@@ -50,6 +50,7 @@
 #include "EXODelegates.hh"
 #endif
 #include <cstddef> //for size_t
+#include <vector>
 
 class EXOEventData : public TObject
 {
@@ -62,6 +63,8 @@ class EXOEventData : public TObject
     Int_t     fEventNumber;                 //ne    : Unique event number.
     Bool_t    fHasSaturatedChannel;         //sat_chan : true when at least one channel is saturated.  Set by recon.
     Bool_t    fSkippedByClustering;         // true when event was skipped by the clustering module.
+    std::vector<ULong64_t> fReconProvenance; // Provenance hash of each reconstruction stage, see EXOReconstructionModule.  Set by recon.
+    std::vector<Double_t> fReconStageSignals; // Signals passed between reconstruction stages, kept to rerun only the later ones, see EXOReconstructionModule.  Set by recon.
 
     Double_t  GetTotalPurityCorrectedEnergy() const;
 
@@ -139,6 +142,7 @@ class EXOEventData : public TObject
     void Remove(EXOScintillationCluster* scint);
 
     void ResetForReconstruction(); 
+    void ResetClusters(); 
 
     virtual void Clear( Option_t* option = "");
 
@@ -211,7 +215,7 @@ class EXOEventData : public TObject
 
   EXO_DEFINE_DELEGATED_FUNCTION(EXOEventData, bool, IsVetoed)
 
-  ClassDef(EXOEventData,15)
+  ClassDef(EXOEventData,17)
 };
 
 //---- inlines -----------------------------------------------------------------
@@ -713,9 +717,19 @@ inline void EXOEventData::ResetForReconstruction()
   GetUWireInductionSignalArray()->Delete();
   GetVWireSignalArray()->Delete();
   GetChargeInjectionSignalArray()->Delete();
+  GetAPDSignalArray()->Delete();
+  ResetClusters();
+  fReconProvenance.clear();
+  fReconStageSignals.clear();
+}
+
+inline void EXOEventData::ResetClusters()
+{
+  // Clears the charge and scintillation clusters, keeping the signals they
+  // are built from.  Delete is called for the same reason as in
+  // ResetForReconstruction.
   GetChargeClusterArray()->Delete();
   GetScintillationClusterArray()->Delete();
-  GetAPDSignalArray()->Delete();
 }
 #endif
 
@@ -26,6 +26,12 @@ public:
   
   /// Returns the value of the extremum point found by the last Transform call. 
   virtual double GetTheExtremumValue() const { return fTheExtremumValue; }
+
+  /// Thread-safe search: returns the extremum without storing it.
+  void FindExtremum(const EXODoubleWaveform& wf, size_t& point, double& value) const;
+
+  /// Transform stores its result in the finder.
+  virtual bool IsThreadSafe() const { return false; }
   
 protected:
   virtual void TransformInPlace(EXODoubleWaveform& anInput) const;
@@ -51,6 +51,14 @@ class EXOFastFourierTransformFFTW
     // Provide direct access to the raw FFT function.  Internal array is used.
     virtual void PerformInverseFFT_inplace();
 
+    // Thread-safe versions of the above on an array owned by the caller,
+    // which must come from AllocateArray.
+    void PerformFFT_inplace(void* array) const;
+    void PerformInverseFFT_inplace(void* array) const;
+
+    static void* AllocateArray(size_t length);
+    static void FreeArray(void* array);
+
     static EXOFastFourierTransformFFTW& GetFFT(size_t length); 
 
     // Direct access to the internal array (for optimization when copy steps are undesirable).
@@ -6,6 +6,7 @@
 #define _EXOFiniteCuspFilter_HH
 
 #include "EXOUtilities/EXOVWaveformTransformer.hh"
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
 #include <vector>
 
 class EXOFiniteCuspFilter : public EXOVWaveformTransformer 
@@ -34,11 +35,13 @@ class EXOFiniteCuspFilter : public EXOVWaveformTransformer
 
   protected:
     virtual void TransformOutOfPlace(const EXODoubleWaveform& anInput, EXODoubleWaveform& anOutput) const;
+    virtual void TransformOutOfPlace(const EXODoubleWaveform& anInput, EXODoubleWaveform& anOutput,
+                                     EXOWaveformWorkspace& workspace) const;
     double fRampTime;      ///< duration of rising edge of trapezoid (CLHEP time units)
     double fFlatTime;      ///< duration of flat top of trapezoid (CLHEP time units)
     double fDecayConstant; ///< decay constant for pole-zero correction (CLHEP time units)
     bool fDoNormalize;     ///< flag to set whether trapezoid will be normalized to the input wf y-scale
-    mutable std::vector<double> fVector; ///< internal vector to implement efficent recursive method
+    mutable EXOWaveformWorkspace fWorkspace; ///< used by the plain TransformOutOfPlace
 
 };
 
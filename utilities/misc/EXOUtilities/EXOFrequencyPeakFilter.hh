@@ -10,12 +10,20 @@ class EXOFrequencyPeakFilter: public EXOVWaveformTransformer
   public:
     EXOFrequencyPeakFilter();
     void SetSpectrum(const EXOWaveformFT& spectrum, double nsigma, size_t nbins);
+    // The mask applied to the spectrum (1 to keep a frequency, 0 to cut it).
+    const EXODoubleWaveform& GetFilter() const {return fFilter;}
+    virtual bool GetFrequencyResponse(const EXODoubleWaveform& input,
+                                      EXOWaveformFT& response,
+                                      size_t& delay) const;
 
   protected:
     virtual bool IsOutOfPlace() const {return true;}
     virtual bool IsInPlace() const {return true;}
     virtual void TransformInPlace(EXODoubleWaveform& input) const;
     virtual void TransformOutOfPlace(const EXODoubleWaveform& input, EXODoubleWaveform& output) const;
+    virtual void TransformInPlace(EXODoubleWaveform& input, EXOWaveformWorkspace& workspace) const;
+    virtual void TransformOutOfPlace(const EXODoubleWaveform& input, EXODoubleWaveform& output,
+                                     EXOWaveformWorkspace& workspace) const;
 
     EXODoubleWaveform fFilter;
 };
@@ -0,0 +1,33 @@
+#ifndef EXOGaussianSmearing_hh
+#define EXOGaussianSmearing_hh
+
+#include <vector>
+#include <cstddef> //for size_t
+
+class EXOGaussianSmearing
+{
+  public:
+    EXOGaussianSmearing();
+
+    // Smear the n weights at energies (sorted, increasing) with a gaussian
+    // of width sigma.  The energies are put on a grid of spacing step.  If
+    // cumulative, Evaluate returns the smeared weight below x, otherwise
+    // the smeared density at x.
+    void Smear(const double* energy, const double* weight, size_t n,
+               double sigma, double step, bool cumulative);
+
+    double Evaluate(double x) const;
+
+    // Range outside of which the density vanishes (the cumulative weight is
+    // 0 below and the total above).
+    double GetLow() const { return fStart; }
+    double GetHigh() const;
+
+  private:
+    double fStart;                  // Energy of grid point 0
+    double fStep;
+    bool fCumulative;
+    std::vector<double> fValues;    // Density at the grid points, or weight below the cell edges
+};
+
+#endif
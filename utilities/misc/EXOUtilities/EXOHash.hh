@@ -0,0 +1,23 @@
+#ifndef EXOHash_hh
+#define EXOHash_hh
+
+#include "Rtypes.h"
+#include <cstddef>
+#include <string>
+
+// 64-bit FNV-1a hash.  Start from FNV1aBasis() and continue the hash with
+// each piece of data in turn:
+//
+//   ULong64_t hash = EXOHash::FNV1aBasis();
+//   hash = EXOHash::FNV1a(hash, &value, sizeof(value));
+//   hash = EXOHash::FNV1a(hash, name);
+namespace EXOHash
+{
+  ULong64_t FNV1aBasis();
+  ULong64_t FNV1a(ULong64_t hash, const void* data, size_t length);
+  // Including the terminating null, so that consecutive strings cannot
+  // run into each other.
+  ULong64_t FNV1a(ULong64_t hash, const std::string& str);
+}
+
+#endif
@@ -25,6 +25,10 @@ class EXOMatchedFilter : public EXOVWaveformTransformer
     template <typename _Tp>
     bool WaveformMatchesFilterSettings(const EXOTemplWaveform<_Tp>& wf) const;
 
+    virtual bool GetFrequencyResponse(const EXODoubleWaveform& wf,
+                                      EXOWaveformFT& response,
+                                      size_t& delay) const;
+
     // Reset the matched filter
     void Reset() { fMatchedFilter.SetLength(0); fOffset = 0; }
 
@@ -35,6 +39,10 @@ class EXOMatchedFilter : public EXOVWaveformTransformer
                
   protected: 
     virtual void TransformInPlace(EXODoubleWaveform& anInput) const;
+    virtual void TransformInPlace(EXODoubleWaveform& anInput,
+                                  EXOWaveformWorkspace& workspace) const;
+    bool CheckWaveform(const EXODoubleWaveform& wf) const;
+    void RetrieveFiltered(const void* fftw_array, EXODoubleWaveform& wf) const;
     EXOWaveformFT fMatchedFilter;
     EXODoubleWaveform fNoisePowerSpectrum;
     EXOFastFourierTransformFFTW* fFFT;
@@ -63,6 +63,7 @@ class EXONoiseCorrelations : public TObject
 
   void AddChannelToMap(UChar_t channel);
   void SetNumFrequencies(unsigned short nfreq);
+  unsigned short GetNumFrequencies() const { return fRR.size(); }
 
   UChar_t GetNumChannels() const { return fChannelToIndex.size(); }
   bool HasChannel(UChar_t channel) const { return (fChannelToIndex.count(channel) > 0); }
@@ -18,6 +18,9 @@ class EXOPoleZeroCorrection : public EXOVWaveformTransformer
     /*! Set the baseline of the wf (asymptote). */
     virtual void SetRestingBaselineValue(double aVal) { fRestingBaselineValue = aVal; }
     virtual inline double GetRestingBaselineValue() const { return fRestingBaselineValue; }
+
+    virtual bool GetRecursiveSections(const EXODoubleWaveform& wf,
+                                      std::vector<RecursiveSection>& sections) const;
   
   protected:
     virtual void TransformOutOfPlace(const EXODoubleWaveform& anInput, EXODoubleWaveform& anOutput) const;
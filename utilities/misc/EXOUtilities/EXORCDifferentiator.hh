@@ -20,6 +20,10 @@ class EXORCDifferentiator : public EXOVWaveformTransformer
     ///* Set the RC time constant (tau). */
     void SetTimeConstant( double aVal ) { fTimeConstant = aVal; }
 
+    virtual bool GetRecursiveSections(const EXODoubleWaveform& wf,
+                                      std::vector<RecursiveSection>& sections) const;
+    static RecursiveSection MakeSection(double samplingPeriod, double timeConstant);
+
    protected: 
     virtual void TransformInPlace(EXODoubleWaveform& anInput) const;
     virtual void TransformOutOfPlace(const EXODoubleWaveform& anInput, EXODoubleWaveform& anOutput) const;
@@ -17,6 +17,10 @@ class EXORCIntegrator : public EXOVWaveformTransformer
     ///* Set the RC Time constant (tau). */
     virtual void SetTimeConstant( double aVal ) { fTimeConstant = aVal; }
 
+    virtual bool GetRecursiveSections(const EXODoubleWaveform& wf,
+                                      std::vector<RecursiveSection>& sections) const;
+    static RecursiveSection MakeSection(double samplingPeriod, double timeConstant);
+
    protected: 
     virtual void TransformInPlace(EXODoubleWaveform& anInput) const;
     double fTimeConstant;
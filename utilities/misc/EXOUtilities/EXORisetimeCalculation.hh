@@ -49,6 +49,22 @@ class EXORisetimeCalculation : public EXOVWaveformTransformer
     //! Returns the final threshold crossing estimate, based upon linear interpolation 
     double GetFinalThresholdCrossingEstimate() const { return fFinalThresholdEstimate; }
 
+    //! Results of a calculation, see the Get functions above.
+    struct Result {
+      double fRiseTime;
+      double fInitThresholdEstimate;
+      double fFinalThresholdEstimate;
+      size_t fInitThresholdCrossing;
+      size_t fFinalThresholdCrossing;
+    };
+
+    //! Thread-safe calculation with the given peak height.  Returns false
+    //! on failure, when result may be partially filled.
+    bool Calculate(const EXODoubleWaveform& anInput, double peakHeight, Result& result) const;
+
+    //! Transform stores its result in the calculator.
+    virtual bool IsThreadSafe() const { return false; }
+
 
   protected:
     virtual void TransformInPlace(EXODoubleWaveform& anInput) const;
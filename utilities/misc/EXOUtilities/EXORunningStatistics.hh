@@ -0,0 +1,52 @@
+#ifndef EXORunningStatistics_hh
+#define EXORunningStatistics_hh
+
+#include <vector>
+#include <cstddef> //for size_t
+
+class EXORunningStatistics
+{
+  public:
+    EXORunningStatistics();
+
+    // Track the p-quantile (0 < p < 1) as well; call before the first Add.
+    void AddQuantile(double p);
+    void Clear();
+
+    void Add(double x);
+
+    size_t GetN() const { return fN; }
+    double GetMean() const { return fMean; }
+    double GetVariance() const;           // Sample variance (N-1)
+    double GetRMS() const;                // Square root of GetVariance
+    double GetMin() const { return fMin; }
+    double GetMax() const { return fMax; }
+
+    size_t GetNumQuantiles() const { return fQuantiles.size(); }
+    double GetQuantileProbability(size_t i) const { return fQuantiles[i].fP; }
+    double GetQuantile(size_t i) const;   // Estimate of the i-th quantile added
+
+  protected:
+    // P-square estimator of one quantile (Jain and Chlamtac, 1985).
+    struct Quantile {
+      double fP;
+      double fHeights[5];
+      double fPositions[5];
+      double fDesired[5];
+      double fIncrements[5];
+    };
+    static void Reset(Quantile& q);
+    static void Update(Quantile& q, double x);
+    static double Parabolic(const Quantile& q, size_t i, double d);
+    static double Linear(const Quantile& q, size_t i, int d);
+
+    size_t fN;
+    double fMean;
+    double fM2;                           // Sum of squared deviations from the mean
+    double fMin;
+    double fMax;
+    std::vector<Quantile> fQuantiles;
+    double fFirst[5];                     // The first observations, before the estimators start
+};
+
+#endif
@@ -20,18 +20,27 @@
 class EXOStopwatch : public TStopwatch
 {
   public:
-    EXOStopwatch() : TStopwatch() {}
+    EXOStopwatch() : TStopwatch(), fStartedSinceReset(false) {}
     void SetName(const std::string& aname) 
       { fWatchName = aname; }
     const char* GetName() const { return fWatchName; }
     const char* GetTitle() const { return GetName(); }
     void Clear( Option_t* opt = "" )
-      { TStopwatch::Clear(opt); fWatchName = ""; }
+      { TStopwatch::Clear(opt); fWatchName = ""; fStartedSinceReset = false; }
+
+    // Track whether the watch ran since the last Reset, so that a timer
+    // reading 0 can be told from a stage that did not run.
+    void Start(Bool_t reset = kTRUE)
+      { TStopwatch::Start(reset); fStartedSinceReset = true; }
+    void Reset()
+      { TStopwatch::Reset(); fStartedSinceReset = false; }
+    bool WasStartedSinceReset() const { return fStartedSinceReset; }
 
     void Print(Option_t* /*opt*/ = "") const;
 
   protected:
     TString fWatchName; // Stopwatch name
+    bool fStartedSinceReset; //! Start called since the last Reset
     
   ClassDef(EXOStopwatch,1) 
 };
@@ -52,6 +61,8 @@ class EXOTimingStatisticInfo : public TNamed
     void StartTimerForTag(const std::string& tag, bool reset = true);
     void StopTimerForTag(const std::string& tag);
     void ResetTimerForTag(const std::string& tag);
+    size_t GetNumberOfTimers() const;
+    EXOStopwatch* GetTimerAt(size_t i) const;
 
     void SetStatisticForTag(const std::string& tag, double aVal);
     double GetStatisticForTag(const std::string& tag) const;
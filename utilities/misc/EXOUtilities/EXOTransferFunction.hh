@@ -2,6 +2,7 @@
 #define EXOTransferFunction_hh
 
 #include "EXOUtilities/EXOVWaveformTransformer.hh"
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
 #include "EXOUtilities/EXORCDifferentiator.hh"
 #include "EXOUtilities/EXORCIntegrator.hh"
 #include <vector>
@@ -44,16 +45,20 @@ class EXOTransferFunction : public EXOVWaveformTransformer
     Double_t GetEffectiveIntegTime() const;
     Double_t GetEffectiveDiffTime() const;
 
+    // The integration stages followed by the differentiation stages.
+    virtual bool GetRecursiveSections(const EXODoubleWaveform& wf,
+                                      std::vector<RecursiveSection>& sections) const;
+
   protected: 
     typedef std::vector<Double_t> DblVec;
     virtual void TransformInPlace(EXODoubleWaveform& anInput) const;
+    virtual void TransformInPlace(EXODoubleWaveform& anInput,
+                                  EXOWaveformWorkspace& workspace) const;
 
   private:
     DblVec fDiffStages;
     DblVec fIntegStages;
-    mutable EXORCDifferentiator fDiff;
-    mutable EXORCIntegrator fInteg;
-    mutable EXODoubleWaveform fScratch;
+    mutable EXOWaveformWorkspace fWorkspace; // Used by the plain TransformInPlace
     mutable std::map<size_t, EXODoubleWaveform> fCachedNoiseSpectra; // Temporary fix (cgd, 9/2/2011)
 
 };
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <cstddef> //for size_t
 #include "EXOUtilities/EXOTemplWaveform.hh"
 #include "EXOUtilities/EXOMiscUtil.hh"
 
@@ -15,8 +16,20 @@ class EXOVWaveformExtractor
     virtual double Extract(const EXODoubleWaveform& wf) const;
     virtual const EXOMiscUtil::ParameterMap& ExtractAll(const EXODoubleWaveform& wf) const;
 
+    // Indexed interface.  Parameters are numbered 0..GetNumParameters()-1
+    // (derived classes provide an enum) and returned in an array supplied by
+    // the caller, so the extractor is not modified and may be shared between
+    // threads.  It also avoids building a map for every waveform.
+    virtual size_t GetNumParameters() const { return 0; }
+    virtual const char* GetParameterName(size_t /*index*/) const { return ""; }
+    void ExtractAll(const EXODoubleWaveform& wf, double values[]) const;
+    double Extract(const EXODoubleWaveform& wf, size_t index) const;
+
   protected:
-    virtual void DoExtractAll(const EXODoubleWaveform& wf) const = 0;
+    // Derived classes implement DoExtract (with GetNumParameters and
+    // GetParameterName), or only DoExtractAll for the map interface.
+    virtual void DoExtract(const EXODoubleWaveform& wf, double values[]) const;
+    virtual void DoExtractAll(const EXODoubleWaveform& wf) const;
     EXOMiscUtil::ParameterMap& GetParameterMapForUpdates() const;
 
   private:
@@ -18,8 +18,12 @@
 #define _EXOVWaveformTransformer_HH
 
 #include <string> 
+#include <vector>
 #include "EXOUtilities/EXOTemplWaveform.hh" 
 
+class EXOWaveformFT;
+class EXOWaveformWorkspace;
+
 class EXOVWaveformTransformer
 {
   public:
@@ -34,12 +38,57 @@ class EXOVWaveformTransformer
     virtual bool IsOutOfPlace() const { return !IsInPlace(); }
 
     virtual void Transform(EXODoubleWaveform* input, EXODoubleWaveform* output = NULL) const;
+
+    // Same as Transform, but all scratch space is taken from workspace and
+    // the transformer is not modified.  If IsThreadSafe(), several threads
+    // may transform with one transformer at the same time, each with its own
+    // workspace.
+    void Transform(EXODoubleWaveform* input, EXODoubleWaveform* output,
+                   EXOWaveformWorkspace& workspace) const;
+    virtual bool IsThreadSafe() const { return true; }
+
     const std::string& GetStringName() const { return fName; }
     const char* GetName() const { return fName.c_str(); }
+
+    // First-order recursive section y[n] = f(x[n], x[n-1], y[n-1]) with
+    // y[0] = x[0].  The arithmetic of each type is that of the transformer
+    // it describes, so a cascade of sections reproduces it exactly.
+    struct RecursiveSection {
+      enum EType { kIntegrator, kDifferentiator, kPoleZero };
+      EType  fType;
+      double fGain;     // 1-w for kIntegrator, (1+w)/2 for kDifferentiator
+      double fWeight;   // w = exp(-T/tau)
+      double fBaseline; // resting baseline for kPoleZero
+    };
+
+    // Linear time-invariant transformers may describe themselves so that
+    // EXOWaveformPipeline can fuse them with neighbouring stages.  A
+    // transformer which is a cascade of recursive sections appends them and
+    // returns true.  A transformer which multiplies the spectrum returns the
+    // response such that its output is the (unnormalized) inverse FFT of
+    // FFT(input)*response, delayed by delay samples with the first samples
+    // zeroed.  Both return false (and leave the arguments untouched) if the
+    // transformer can not be described for waveforms like wf.
+    virtual bool GetRecursiveSections(const EXODoubleWaveform& /*wf*/,
+                                      std::vector<RecursiveSection>& /*sections*/) const
+      { return false; }
+    virtual bool GetFrequencyResponse(const EXODoubleWaveform& /*wf*/,
+                                      EXOWaveformFT& /*response*/,
+                                      size_t& /*delay*/) const
+      { return false; }
     
   protected:
     virtual void TransformInPlace(EXODoubleWaveform& input) const;
     virtual void TransformOutOfPlace(const EXODoubleWaveform& input, EXODoubleWaveform& output) const;
+
+    // Workspace versions.  The defaults call the versions above, which is
+    // correct for transformers which keep no state while transforming;
+    // transformers with scratch members overload these instead.
+    virtual void TransformInPlace(EXODoubleWaveform& input,
+                                  EXOWaveformWorkspace& workspace) const;
+    virtual void TransformOutOfPlace(const EXODoubleWaveform& input,
+                                     EXODoubleWaveform& output,
+                                     EXOWaveformWorkspace& workspace) const;
   
   private:
     // Make the default constructor private to force usage of the other constructor.
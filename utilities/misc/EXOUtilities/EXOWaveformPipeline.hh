@@ -0,0 +1,56 @@
+#ifndef EXOWaveformPipeline_hh
+#define EXOWaveformPipeline_hh
+
+#include "EXOUtilities/EXOVWaveformTransformer.hh"
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
+#include <vector>
+#include <cstddef> //for size_t
+
+class EXOWaveformPipeline : public EXOVWaveformTransformer
+{
+  public:
+    EXOWaveformPipeline();
+
+    // The pipeline is applied in place, using one scratch waveform for
+    // out-of-place stages.  It is thread-safe if all of its stages are.
+    virtual bool IsInPlace() const { return true; }
+    virtual bool IsThreadSafe() const;
+
+    // Append a stage.  Stages are not owned and must outlive the pipeline;
+    // their parameters are read at every Transform.
+    void AddStage(const EXOVWaveformTransformer& stage) { fStages.push_back(&stage); }
+    void Clear() { fStages.clear(); }
+    size_t GetNumStages() const { return fStages.size(); }
+    const EXOVWaveformTransformer& GetStage(size_t i) const { return *fStages[i]; }
+
+    // Turn fusing of linear stages off to apply the stages one by one, e.g.
+    // to validate the fused result.
+    void SetFuseStages(bool fuse = true) { fFuseStages = fuse; }
+    bool GetFuseStages() const { return fFuseStages; }
+
+    // The pipeline is itself linear if all of its stages are.
+    virtual bool GetRecursiveSections(const EXODoubleWaveform& wf,
+                                      std::vector<RecursiveSection>& sections) const;
+
+    // Run a cascade of recursive sections over wf in a single pass.
+    static void ApplyRecursiveSections(const std::vector<RecursiveSection>& sections,
+                                       EXODoubleWaveform& wf);
+
+  protected:
+    virtual void TransformInPlace(EXODoubleWaveform& wf) const;
+    virtual void TransformInPlace(EXODoubleWaveform& wf,
+                                  EXOWaveformWorkspace& workspace) const;
+    void ApplyStage(const EXOVWaveformTransformer& stage, EXODoubleWaveform& wf,
+                    EXODoubleWaveform*& current, EXODoubleWaveform& scratch,
+                    EXOWaveformWorkspace& workspace) const;
+    void ApplyFrequencyResponse(const EXOWaveformFT& response, size_t delay,
+                                EXODoubleWaveform& wf,
+                                EXOWaveformWorkspace& workspace) const;
+
+    std::vector<const EXOVWaveformTransformer*> fStages;
+    bool fFuseStages;
+
+    mutable EXOWaveformWorkspace fWorkspace; // Used by the plain TransformInPlace
+};
+
+#endif
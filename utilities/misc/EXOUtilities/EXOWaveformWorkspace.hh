@@ -0,0 +1,66 @@
+#ifndef EXOWaveformWorkspace_hh
+#define EXOWaveformWorkspace_hh
+
+#include "EXOUtilities/EXOVWaveformTransformer.hh"
+#include "EXOUtilities/EXOWaveformFT.hh"
+#include <vector>
+#include <cstddef> //for size_t
+
+class EXOWaveformWorkspace
+{
+  public:
+    typedef std::vector<EXOVWaveformTransformer::RecursiveSection> SectionVec;
+
+    EXOWaveformWorkspace();
+    ~EXOWaveformWorkspace();
+
+    // Scratch space is never shared: a copy starts out empty, and assignment
+    // leaves the workspace unchanged.  This keeps classes holding a workspace
+    // copyable.
+    EXOWaveformWorkspace(const EXOWaveformWorkspace&);
+    EXOWaveformWorkspace& operator=(const EXOWaveformWorkspace&) { return *this; }
+
+    // Scratch objects are handed out in stack order.  Create a Frame before
+    // taking scratch objects; they are given back when the Frame goes out of
+    // scope, and are reused (with their memory) by later calls.
+    class Frame
+    {
+      public:
+        Frame(EXOWaveformWorkspace& workspace);
+        ~Frame();
+      private:
+        EXOWaveformWorkspace& fWorkspace;
+        size_t fNumWaveforms;
+        size_t fNumWaveformFTs;
+        size_t fNumBuffers;
+        size_t fNumSections;
+        size_t fNumFFTArrays;
+    };
+
+    EXODoubleWaveform& GetWaveform();
+    EXOWaveformFT& GetWaveformFT();
+    std::vector<double>& GetBuffer();
+    SectionVec& GetSections();
+
+    // Array for in-place FFTs of logical length length, see
+    // EXOFastFourierTransformFFTW::PerformFFT_inplace(void*).
+    void* GetFFTArray(size_t length);
+
+  private:
+    friend class Frame;
+
+    std::vector<EXODoubleWaveform*>   fWaveforms;
+    std::vector<EXOWaveformFT*>       fWaveformFTs;
+    std::vector<std::vector<double>*> fBuffers;
+    std::vector<SectionVec*>          fSections;
+    std::vector<void*>                fFFTArrays;
+    std::vector<size_t>               fFFTArrayLengths;
+
+    size_t fNumWaveforms;   // Number of objects of each kind in use
+    size_t fNumWaveformFTs;
+    size_t fNumBuffers;
+    size_t fNumSections;
+    size_t fNumFFTArrays;
+};
+
+#endif
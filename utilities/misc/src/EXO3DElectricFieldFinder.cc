@@ -39,7 +39,7 @@ void EXO3DElectricFieldFinder::GetEField(double x, double y, double z, double& e
   //Check to see how close you are to z=200 the end of the Efield file
   //Carried from old code is this correct since we have an Efield definded
   if((fZMax-z) < fDZ) {
-    LogEXOMsg("Tried to get electric field too close to the APD face. ", EEError);
+    LogEXOMsgF(EEError, "Tried to get electric field too close to the APD face. ");
     ex = 0.0*CLHEP::megavolt/CLHEP::mm;
     ey = 0.0*CLHEP::megavolt/CLHEP::mm;
     ez = -1000.0*ez_sign*CLHEP::megavolt/CLHEP::mm; // very large repulsive electric field -- electrons don't enter here.
@@ -67,9 +67,7 @@ void EXO3DElectricFieldFinder::GetEField(double x, double y, double z, double& e
   v += 0.5; // to make rounding correct.
   size_t iv = (size_t)v;
   if(iv < 0 or iv > fNV-1) {
-      std::stringstream Stream;
-      Stream << "V index off: " << v  << std::endl;
-      LogEXOMsg(Stream.str(), EEWarning);
+      LogEXOMsgStream(EEWarning, "V index off: " << v);
   }
 
   uhold = u;
@@ -78,9 +76,7 @@ void EXO3DElectricFieldFinder::GetEField(double x, double y, double z, double& e
   u += 0.5;
   size_t iu = (size_t)u;
   if(iu<0 or iu > fNU-1){
-      std::stringstream Stream;
-      Stream << "U index off: " << uhold << std::endl;
-      LogEXOMsg(Stream.str(), EEWarning);
+      LogEXOMsgStream(EEWarning, "U index off: " << uhold);
   }
 
   // Find the correct Z-index.
@@ -93,10 +89,7 @@ void EXO3DElectricFieldFinder::GetEField(double x, double y, double z, double& e
 
   if(field_index > (fNV*fNU*fNZ - 1))
   {
-      std::stringstream Stream;
-      Stream << "Total index off " << field_index << " " << x << " " << y << " " << z << std::endl;
-      LogEXOMsg(Stream.str(), EEWarning);
-
+      LogEXOMsgStream(EEWarning, "Total index off " << field_index << " " << x << " " << y << " " << z);
   }
 
   //Mirror the X-axis (x -> -x for TPC2)
@@ -0,0 +1,49 @@
+//______________________________________________________________________________
+// EXOAtomicFile
+//
+// Writes a file under a temporary name in the same directory (filename
+// followed by ".tmp." and the process id) and renames it into place once it
+// is complete.  The rename is atomic, so a job reading the file, possibly
+// while others are writing it, sees either the previous file or the whole
+// new one, never a partial one; at worst several jobs write the same file.
+// The caches and outputs written this way check the headers of the files
+// they read, so a file from another version is rejected rather than used.
+//
+//   EXOAtomicFile out(filename);
+//   FILE* file = out.GetFile();
+//   if(not file) return false;
+//   bool ok = fwrite(...) == ...;
+//   return out.Commit(ok);
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOAtomicFile.hh"
+#include <unistd.h>
+#include <sstream>
+
+//______________________________________________________________________________
+EXOAtomicFile::EXOAtomicFile(const std::string& filename)
+: fFilename(filename),
+  fFile(NULL)
+{
+  std::ostringstream tmpName;
+  tmpName << filename << ".tmp." << getpid();
+  fTemporaryName = tmpName.str();
+  fFile = fopen(fTemporaryName.c_str(), "wb");
+}
+
+//______________________________________________________________________________
+EXOAtomicFile::~EXOAtomicFile()
+{
+  if(fFile) Commit(false);
+}
+
+//______________________________________________________________________________
+bool EXOAtomicFile::Commit(bool ok)
+{
+  if(not fFile) return false;
+  if(fclose(fFile) != 0) ok = false;
+  fFile = NULL;
+  if(ok and rename(fTemporaryName.c_str(), fFilename.c_str()) != 0) ok = false;
+  if(not ok) remove(fTemporaryName.c_str());
+  return ok;
+}
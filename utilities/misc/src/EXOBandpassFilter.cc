@@ -19,6 +19,7 @@
 
 #include "EXOUtilities/EXOBandpassFilter.hh"
 #include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
 #include <limits>
 
 //______________________________________________________________________________
@@ -48,16 +49,63 @@ void EXOBandpassFilter::TransformInPlace(EXODoubleWaveform& input) const
   fft.PerformFFT_inplace();
 
   // Do filter directly on fft internal array.
-  std::complex<double>* complex_data = fft.GetInternalArray<std::complex<double> >();
+  ZeroOutsideBand(fft.GetInternalArray<std::complex<double> >(),
+                  fft.GetFreqDomainLength(), input.GetSamplingFreq());
+
+  // Perform inverse fft, then copy result back into input.
+  fft.PerformInverseFFT_inplace();
+  input.SetData(fft.GetInternalArray<double>(), fft.GetTimeDomainLength());
+}
+
+//______________________________________________________________________________
+void EXOBandpassFilter::TransformInPlace(EXODoubleWaveform& input,
+                                         EXOWaveformWorkspace& workspace) const
+{
+  // Thread-safe version of the above, working on an array from the
+  // workspace instead of the internal array of the FFT.
+  const EXOFastFourierTransformFFTW& fft = 
+    EXOFastFourierTransformFFTW::GetFFT(input.GetLength());
+
+  EXOWaveformWorkspace::Frame frame(workspace);
+  void* array = workspace.GetFFTArray(input.GetLength());
+  memcpy(array, reinterpret_cast<const void*>(&input[0]),
+         sizeof(double)*input.GetLength());
+  fft.PerformFFT_inplace(array);
+  ZeroOutsideBand(static_cast<std::complex<double>*>(array),
+                  fft.GetFreqDomainLength(), input.GetSamplingFreq());
+  fft.PerformInverseFFT_inplace(array);
+  input.SetData(static_cast<double*>(array), fft.GetTimeDomainLength());
+}
+
+//______________________________________________________________________________
+void EXOBandpassFilter::ZeroOutsideBand(std::complex<double>* complex_data,
+                                        size_t length,
+                                        double samplingFreq) const
+{
+  // Zero the frequencies outside the band in a spectrum of length bins.
   size_t i = 0;
-  while (i < fft.GetFreqDomainLength()) {
-    double theFreq = i*(input.GetSamplingFreq()/(2.*(fft.GetFreqDomainLength()-1)));
+  while (i < length) {
+    double theFreq = i*(samplingFreq/(2.*(length-1)));
     if (theFreq < fLowerBandpass) complex_data[i] = std::complex<double>(0,0);
     if (theFreq > fUpperBandpass) complex_data[i] = std::complex<double>(0,0);
     i++;
   }
+}
 
-  // Perform inverse fft, then copy result back into input.
-  fft.PerformInverseFFT_inplace();
-  input.SetData(fft.GetInternalArray<double>(), fft.GetTimeDomainLength());
+//______________________________________________________________________________
+bool EXOBandpassFilter::GetFrequencyResponse(const EXODoubleWaveform& input,
+                                             EXOWaveformFT& response,
+                                             size_t& delay) const
+{
+  // The bandpass keeps the frequencies in [fLowerBandpass, fUpperBandpass].
+  size_t length = input.GetLength()/2 + 1;
+  if(length < 2) return false;
+  response.SetLength(length);
+  for(size_t i = 0; i < length; i++) {
+    double theFreq = i*(input.GetSamplingFreq()/(2.*(length-1)));
+    if (theFreq < fLowerBandpass or theFreq > fUpperBandpass) response[i] = 0.0;
+    else response[i] = 1.0;
+  }
+  delay = 0;
+  return true;
 }
@@ -9,9 +9,17 @@ EXOBaselineAndNoiseCalculator::EXOBaselineAndNoiseCalculator()
 
 }
 
-void EXOBaselineAndNoiseCalculator::DoExtractAll(const EXODoubleWaveform& wf) const
+const char* EXOBaselineAndNoiseCalculator::GetParameterName(size_t index) const
+{
+  switch(index) {
+    case kBaseline: return "Baseline";
+    case kNoisecounts: return "Noisecounts";
+    default: return "";
+  }
+}
+
+void EXOBaselineAndNoiseCalculator::DoExtract(const EXODoubleWaveform& wf, double values[]) const
 {
-  EXOMiscUtil::ParameterMap& params = GetParameterMapForUpdates();
   double baseline = wf[0];
   double noisecounts = 4096.;
 
@@ -53,7 +61,7 @@ void EXOBaselineAndNoiseCalculator::DoExtractAll(const EXODoubleWaveform& wf) co
     noisecounts = noisecounts_temp;
   }
   
-  // Insert and return the results.
-  params.insert(std::pair<std::string,double>("Baseline",baseline));
-  params.insert(std::pair<std::string,double>("Noisecounts",noisecounts));
+  // Return the results.
+  values[kBaseline] = baseline;
+  values[kNoisecounts] = noisecounts;
 }
@@ -45,10 +45,26 @@ void EXOBaselineRemover::TransformInPlace(EXODoubleWaveform& input) const
   input -= GetBaseline(input);
 }
 
+//______________________________________________________________________________
+void EXOBaselineRemover::TransformInPlace(EXODoubleWaveform& input,
+                                          EXOWaveformWorkspace& /*workspace*/) const
+{
+  // Same as above, but leaves GetBaselineMean/GetBaselineRMS untouched.
+  double mean, rms;
+  ComputeBaselineAndRMS(input, mean, rms);
+  input -= mean;
+}
+
 //______________________________________________________________________________
 void EXOBaselineRemover::CalculateBaselineAndRMS(const EXODoubleWaveform& waveform) const
 {
+  ComputeBaselineAndRMS(waveform, fBaselineMean, fBaselineRMS);
+}
 
+//______________________________________________________________________________
+void EXOBaselineRemover::ComputeBaselineAndRMS(const EXODoubleWaveform& waveform,
+                                               double& mean, double& rms) const
+{
   size_t startSample = fStartSample;
   size_t nSamplesToAverage = fBaselineSamples;
   if(fRegionUnits == kTime) {
@@ -58,18 +74,18 @@ void EXOBaselineRemover::CalculateBaselineAndRMS(const EXODoubleWaveform& wavefo
   if ( startSample + nSamplesToAverage > waveform.GetLength() ) { 
     nSamplesToAverage = waveform.GetLength()-startSample; 
   }
-  fBaselineMean = 0.0;
+  double baselineMean = 0.0;
   double baselineAverageSquared = 0.0;
   double waveformAti=0.0;
   for ( size_t i=startSample; i<startSample+nSamplesToAverage; i++ ){
     waveformAti=waveform.At(i);
-    fBaselineMean += waveformAti; 
+    baselineMean += waveformAti; 
     baselineAverageSquared += waveformAti*waveformAti; 
   }
-  fBaselineMean /= nSamplesToAverage;
+  baselineMean /= nSamplesToAverage;
   baselineAverageSquared /= nSamplesToAverage;
-  fBaselineRMS = sqrt( baselineAverageSquared - fBaselineMean*fBaselineMean);
-
+  mean = baselineMean;
+  rms = sqrt( baselineAverageSquared - baselineMean*baselineMean);
 }
 
 //______________________________________________________________________________
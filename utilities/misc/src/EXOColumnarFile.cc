@@ -0,0 +1,202 @@
+//______________________________________________________________________________
+// EXOColumnarFile
+//
+// Reader of the columnar files written by EXOColumnarFileWriter (and by the
+// coutput module).  Analyses which only need event and cluster quantities
+// can read them from these files instead of deserializing EXOEventData from
+// the ROOT trees.  Each column is stored as one contiguous array of native
+// values:
+//
+//   header | column directory | values of column 0 | values of column 1 | ...
+//
+// with every array starting on a 64-byte boundary.  The file is mapped
+// read-only and the columns are returned as pointers into the mapping, so
+// nothing is copied or decoded; a cut over all events is a loop over plain
+// arrays.  The values are in the byte order of the machine which wrote the
+// file.
+//
+//   EXOColumnarFile file;
+//   file.Open("run.col");
+//   const Double_t* energy = file.GetDoubleColumn("cl_epurity");
+//   for(Long64_t i = 0; i < file.GetNumRows(EXOColumnarFile::kChargeCluster); i++) ...
+//
+// From python, the pointers can be wrapped without copying, e.g.
+//
+//   energy = file.GetDoubleColumn("cl_epurity")
+//   energy.SetSize(8*n)
+//   numpy.frombuffer(energy, dtype=numpy.float64, count=n)
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOColumnarFile.hh"
+#include "EXOUtilities/EXOErrorLogger.hh"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+//______________________________________________________________________________
+const char* EXOColumnarFile::GetMagic()
+{
+  // The first 8 bytes of a columnar file (not null terminated).
+  return "EXOCOLMN";
+}
+
+//______________________________________________________________________________
+size_t EXOColumnarFile::GetTypeSize(EType type)
+{
+  switch(type) {
+    case kInt: return sizeof(Int_t);
+    case kLong64: return sizeof(Long64_t);
+    case kDouble: return sizeof(Double_t);
+  }
+  return 0;
+}
+
+//______________________________________________________________________________
+EXOColumnarFile::EXOColumnarFile()
+: fMapping(NULL),
+  fMappingSize(0)
+{}
+
+//______________________________________________________________________________
+EXOColumnarFile::~EXOColumnarFile()
+{
+  Close();
+}
+
+//______________________________________________________________________________
+bool EXOColumnarFile::Open(const std::string& filename)
+{
+  Close();
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0) {
+    LogEXOMsg("Unable to open " + filename, EEError);
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 or size_t(st.st_size) < sizeof(Header)) {
+    close(fd);
+    LogEXOMsg(filename + " is not a columnar file", EEError);
+    return false;
+  }
+  void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) {
+    LogEXOMsg("Unable to map " + filename, EEError);
+    return false;
+  }
+  fMapping = mapping;
+  fMappingSize = st.st_size;
+
+  // Check that every column lies within the file, so the pointers handed
+  // out never run past the mapping.
+  const Header& header = GetHeader();
+  bool ok = memcmp(header.fMagic, GetMagic(), sizeof(header.fMagic)) == 0 and
+            header.fVersion == GetVersion() and
+            sizeof(Header) + sizeof(Column)*ULong64_t(header.fNumColumns) <= fMappingSize;
+  for(size_t i = 0; ok and i < header.fNumColumns; i++) {
+    const Column& column = GetColumn(i);
+    ok = memchr(column.fName, '\0', sizeof(column.fName)) != NULL and
+         column.fType <= kDouble and column.fLevel < kNumLevels and
+         column.fOffset % 64 == 0;
+    if(not ok) break;
+    Long64_t numRows = header.fNumRows[column.fLevel];
+    ok = numRows >= 0 and column.fOffset <= fMappingSize and
+         ULong64_t(numRows) <= (fMappingSize - column.fOffset)/GetTypeSize(EType(column.fType));
+  }
+  if(not ok) {
+    LogEXOMsg(filename + " is not a valid columnar file, or from another version", EEError);
+    Close();
+    return false;
+  }
+
+  // Columns are mostly read from start to end.
+  madvise(fMapping, fMappingSize, MADV_SEQUENTIAL);
+  return true;
+}
+
+//______________________________________________________________________________
+void EXOColumnarFile::Close()
+{
+  if(fMapping) munmap(fMapping, fMappingSize);
+  fMapping = NULL;
+  fMappingSize = 0;
+}
+
+//______________________________________________________________________________
+Long64_t EXOColumnarFile::GetNumRows(ELevel level) const
+{
+  if(not IsOpen() or level < 0 or level >= kNumLevels) return 0;
+  return GetHeader().fNumRows[level];
+}
+
+//______________________________________________________________________________
+size_t EXOColumnarFile::GetNumColumns() const
+{
+  if(not IsOpen()) return 0;
+  return GetHeader().fNumColumns;
+}
+
+//______________________________________________________________________________
+std::string EXOColumnarFile::GetColumnName(size_t column) const
+{
+  if(column >= GetNumColumns()) return "";
+  return GetColumn(column).fName;
+}
+
+//______________________________________________________________________________
+EXOColumnarFile::EType EXOColumnarFile::GetColumnType(size_t column) const
+{
+  if(column >= GetNumColumns()) return kInt;
+  return EType(GetColumn(column).fType);
+}
+
+//______________________________________________________________________________
+EXOColumnarFile::ELevel EXOColumnarFile::GetColumnLevel(size_t column) const
+{
+  if(column >= GetNumColumns()) return kEvent;
+  return ELevel(GetColumn(column).fLevel);
+}
+
+//______________________________________________________________________________
+int EXOColumnarFile::FindColumn(const std::string& name) const
+{
+  for(size_t i = 0; i < GetNumColumns(); i++) {
+    if(name == GetColumn(i).fName) return i;
+  }
+  return -1;
+}
+
+//______________________________________________________________________________
+const void* EXOColumnarFile::GetValues(const std::string& name, EType type) const
+{
+  int column = FindColumn(name);
+  if(column < 0) {
+    LogEXOMsg("No column " + name, EEError);
+    return NULL;
+  }
+  if(GetColumnType(column) != type) {
+    LogEXOMsg("Column " + name + " holds values of another type", EEError);
+    return NULL;
+  }
+  return static_cast<const char*>(fMapping) + GetColumn(column).fOffset;
+}
+
+//______________________________________________________________________________
+const Int_t* EXOColumnarFile::GetIntColumn(const std::string& name) const
+{
+  return static_cast<const Int_t*>(GetValues(name, kInt));
+}
+
+//______________________________________________________________________________
+const Long64_t* EXOColumnarFile::GetLong64Column(const std::string& name) const
+{
+  return static_cast<const Long64_t*>(GetValues(name, kLong64));
+}
+
+//______________________________________________________________________________
+const Double_t* EXOColumnarFile::GetDoubleColumn(const std::string& name) const
+{
+  return static_cast<const Double_t*>(GetValues(name, kDouble));
+}
@@ -0,0 +1,185 @@
+//______________________________________________________________________________
+// EXOColumnarFileWriter
+//
+// Writes the columnar files read by EXOColumnarFile.  Since each column is
+// one contiguous array, no column is complete before the last value is
+// filled.  The values are collected in a small buffer per column, and full
+// buffers are appended in chunks to a spool file next to the output.  Close
+// then copies the chunks of each column in turn behind the header, so
+// memory use does not grow with the number of events and the output is
+// written sequentially once.
+//
+// The file is assembled with EXOAtomicFile, so a reader never sees a
+// partial file.
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOColumnarFileWriter.hh"
+#include "EXOUtilities/EXOErrorLogger.hh"
+#include "EXOUtilities/EXOAtomicFile.hh"
+#include <unistd.h>
+#include <cassert>
+#include <cstring>
+#include <sstream>
+
+namespace {
+  const size_t gfBufferSize = 65536;   // Bytes per column kept before spooling
+  const size_t gfAlignment = 64;
+}
+
+//______________________________________________________________________________
+EXOColumnarFileWriter::EXOColumnarFileWriter()
+: fSpool(NULL),
+  fSpoolSize(0),
+  fOK(true)
+{}
+
+//______________________________________________________________________________
+EXOColumnarFileWriter::~EXOColumnarFileWriter()
+{
+  // A file still open was not finished; leave nothing behind.
+  if(fSpool) {
+    fclose(fSpool);
+    remove(fSpoolName.c_str());
+  }
+}
+
+//______________________________________________________________________________
+size_t EXOColumnarFileWriter::AddColumn(const std::string& name,
+                                        EXOColumnarFile::EType type,
+                                        EXOColumnarFile::ELevel level)
+{
+  assert(not IsOpen());
+  PendingColumn column;
+  memset(&column.fColumn, 0, sizeof(column.fColumn));
+  if(name.size() >= sizeof(column.fColumn.fName)) {
+    LogEXOMsg("Column name " + name + " is too long and was truncated", EEWarning);
+  }
+  strncpy(column.fColumn.fName, name.c_str(), sizeof(column.fColumn.fName) - 1);
+  column.fColumn.fType = type;
+  column.fColumn.fLevel = level;
+  column.fNumValues = 0;
+  fColumns.push_back(column);
+  return fColumns.size() - 1;
+}
+
+//______________________________________________________________________________
+bool EXOColumnarFileWriter::Open(const std::string& filename)
+{
+  assert(not IsOpen());
+  std::ostringstream spoolName;
+  spoolName << filename << ".spool." << getpid();
+  fSpool = fopen(spoolName.str().c_str(), "w+b");
+  if(not fSpool) {
+    LogEXOMsg("Unable to open " + spoolName.str(), EEError);
+    return false;
+  }
+  fFilename = filename;
+  fSpoolName = spoolName.str();
+  fSpoolSize = 0;
+  fOK = true;
+  for(size_t i = 0; i < fColumns.size(); i++) {
+    fColumns[i].fBuffer.reserve(gfBufferSize);
+    fColumns[i].fBuffer.clear();
+    fColumns[i].fChunks.clear();
+    fColumns[i].fNumValues = 0;
+  }
+  return true;
+}
+
+//______________________________________________________________________________
+void EXOColumnarFileWriter::Append(size_t index, EXOColumnarFile::EType type, const void* value)
+{
+  assert(IsOpen() and index < fColumns.size());
+  PendingColumn& column = fColumns[index];
+  assert(column.fColumn.fType == UInt_t(type));
+  const char* bytes = static_cast<const char*>(value);
+  column.fBuffer.insert(column.fBuffer.end(), bytes, bytes + EXOColumnarFile::GetTypeSize(type));
+  column.fNumValues++;
+  if(column.fBuffer.size() >= gfBufferSize) Spool(column);
+}
+
+//______________________________________________________________________________
+bool EXOColumnarFileWriter::Spool(PendingColumn& column)
+{
+  if(column.fBuffer.empty() or not fOK) return fOK;
+  if(fwrite(&column.fBuffer[0], 1, column.fBuffer.size(), fSpool) != column.fBuffer.size()) {
+    LogEXOMsg("Unable to write to " + fSpoolName, EEError);
+    fOK = false;
+    return false;
+  }
+  column.fChunks.push_back(std::make_pair(fSpoolSize, column.fBuffer.size()));
+  fSpoolSize += column.fBuffer.size();
+  column.fBuffer.clear();
+  return true;
+}
+
+//______________________________________________________________________________
+bool EXOColumnarFileWriter::Close()
+{
+  if(not IsOpen()) return false;
+  EXOAtomicFile out(fFilename);
+  if(not out.GetFile()) LogEXOMsg("Unable to open " + out.GetTemporaryName(), EEError);
+  bool ok = fOK and out.GetFile() and WriteFile(out.GetFile());
+  ok = out.Commit(ok);
+  if(not ok) LogEXOMsg("Failed to write columnar file " + fFilename, EEError);
+  fclose(fSpool);
+  remove(fSpoolName.c_str());
+  fSpool = NULL;
+  return ok;
+}
+
+//______________________________________________________________________________
+bool EXOColumnarFileWriter::WriteFile(FILE* file)
+{
+  EXOColumnarFile::Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.fMagic, EXOColumnarFile::GetMagic(), sizeof(header.fMagic));
+  header.fVersion = EXOColumnarFile::GetVersion();
+  header.fNumColumns = fColumns.size();
+  for(size_t i = 0; i < EXOColumnarFile::kNumLevels; i++) header.fNumRows[i] = -1;
+
+  // All columns of a level must have the same number of rows; lay the
+  // columns out one after another.
+  ULong64_t offset = sizeof(header) + sizeof(EXOColumnarFile::Column)*fColumns.size();
+  for(size_t i = 0; i < fColumns.size(); i++) {
+    EXOColumnarFile::Column& column = fColumns[i].fColumn;
+    Long64_t& numRows = header.fNumRows[column.fLevel];
+    if(numRows < 0) numRows = fColumns[i].fNumValues;
+    if(ULong64_t(numRows) != fColumns[i].fNumValues) {
+      LogEXOMsg(std::string("Column ") + column.fName + " has a different number of rows", EEError);
+      return false;
+    }
+    offset = ((offset + gfAlignment - 1)/gfAlignment)*gfAlignment;
+    column.fOffset = offset;
+    offset += fColumns[i].fNumValues*EXOColumnarFile::GetTypeSize(EXOColumnarFile::EType(column.fType));
+  }
+  for(size_t i = 0; i < EXOColumnarFile::kNumLevels; i++) {
+    if(header.fNumRows[i] < 0) header.fNumRows[i] = 0;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for(size_t i = 0; ok and i < fColumns.size(); i++) {
+    ok = fwrite(&fColumns[i].fColumn, sizeof(EXOColumnarFile::Column), 1, file) == 1;
+  }
+
+  std::vector<char> chunk;
+  for(size_t i = 0; ok and i < fColumns.size(); i++) {
+    PendingColumn& column = fColumns[i];
+    ok = fseek(file, column.fColumn.fOffset, SEEK_SET) == 0;
+    for(size_t j = 0; ok and j < column.fChunks.size(); j++) {
+      chunk.resize(column.fChunks[j].second);
+      ok = fseek(fSpool, column.fChunks[j].first, SEEK_SET) == 0 and
+           fread(&chunk[0], 1, chunk.size(), fSpool) == chunk.size() and
+           fwrite(&chunk[0], 1, chunk.size(), file) == chunk.size();
+    }
+    if(ok and not column.fBuffer.empty()) {
+      ok = fwrite(&column.fBuffer[0], 1, column.fBuffer.size(), file) == column.fBuffer.size();
+    }
+  }
+  // Columns without values may point to the end of the file; make sure the
+  // file reaches that far.
+  if(ok and fseek(file, 0, SEEK_END) == 0 and ULong64_t(ftell(file)) < offset) {
+    ok = fseek(file, offset - 1, SEEK_SET) == 0 and fputc(0, file) != EOF;
+  }
+  return ok;
+}
@@ -0,0 +1,396 @@
+//______________________________________________________________________________
+// EXOCorrelatedNoiseGenerator
+//
+// DESCRIPTION:
+//
+// Generates noise for many channels at once with the channel-channel
+// correlations stored in an EXONoiseCorrelations object.  EXOAddNoise draws
+// the noise of each channel independently from a transfer-function spectrum;
+// here the noise of all channels at a given frequency f is drawn together.
+//
+// For each frequency the real and imaginary parts of the noise on the n
+// channels form a vector of length 2n with covariance
+//
+//   C(f) = | RR(f)    RI(f) |
+//          | RI(f)^T  II(f) |
+//
+// (see EXONoiseCorrelations for the definitions).  The channels are split
+// into blocks which are taken to be independent: the APD gangs, and the u
+// and v wires of each TPC half, so C(f) is block diagonal.
+// SetNoiseCorrelations computes the Cholesky factor L(f), C(f) = L(f) L(f)^T,
+// of each block once, and logs the largest correlation between blocks that
+// this drops.  Generate then draws a vector z of standard normal numbers for
+// each frequency and sets the noise spectrum to L(f) z, which has covariance
+// C(f).  The spectra of all channels are filled in one pass over the
+// frequencies and brought to the time domain with one inverse FFT plan
+// shared by all channels.
+//
+// Conventions follow EXORefitAPDs: frequency index 0 is the 0-frequency
+// component, and the correlations are those of the (unnormalized) forward
+// FFT of the noise in ADC counts, so the time-domain length is
+// 2*(nfreq - 1).  The 0-frequency component is not generated; the baseline
+// is left to the digitizer.  Waveforms shorter than the noise length get
+// noise; longer ones are left alone with a warning.
+//
+// As in EXOAddNoise, the noise is by default drawn once and cached, and each
+// event gets a stretch of it starting from a random point, the same for all
+// channels so that the correlations are kept.  The cache holds cache
+// independent draws of one noise length each, kept as floats; every draw is
+// periodic, so an event reads around the draw its starting point falls in.
+// The FFT arrays, one noise length per channel, are freed once the cache is
+// filled.  With the default cache of 100 the noise takes 185 MB for 226
+// channels of 2048 samples, half of what the per-channel EXOAddNoise caches
+// of the same length take in doubles.  With SetCacheLength(0) new noise is
+// drawn for every event.
+//
+// Matrices which are only positive semi-definite (e.g. II at 0 and Nyquist
+// frequency, where the imaginary part vanishes) are handled by dropping the
+// degenerate directions.
+//
+// The factors are stored as floats, (2m)(2m+1)/2 per block of m channels and
+// frequency: 45 MB for the 74 APD gangs and 48 MB for the four wire planes
+// over 1025 frequencies, against 840 MB in doubles for one matrix of all
+// 226 channels.  A draw costs the normal numbers and one inverse FFT per
+// channel, as for uncached EXOAddNoise, plus the products L(f) z, which
+// grow as the sum of the squared block sizes.
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOCorrelatedNoiseGenerator.hh"
+#include "EXOUtilities/EXONoiseCorrelations.hh"
+#include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
+#include "EXOUtilities/EXOWaveformData.hh"
+#include "EXOUtilities/EXOWaveform.hh"
+#include "EXOUtilities/EXOMiscUtil.hh"
+#include "EXOUtilities/EXOErrorLogger.hh"
+#include "TRandom.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+//______________________________________________________________________________
+EXOCorrelatedNoiseGenerator::EXOCorrelatedNoiseGenerator()
+: fNumFrequencies(0),
+  fLength(0),
+  fCacheLength(100),
+  fRecordLength(0),
+  fFactorsPerFrequency(0)
+{}
+
+//______________________________________________________________________________
+EXOCorrelatedNoiseGenerator::~EXOCorrelatedNoiseGenerator()
+{
+  Clear();
+}
+
+//______________________________________________________________________________
+void EXOCorrelatedNoiseGenerator::Clear()
+{
+  // Forget the correlations and the noise; the cache length is kept.
+  ClearNoise();
+  fChannels.clear();
+  fChannelIndex.clear();
+  fBlocks.clear();
+  fFactors.clear();
+  fFactorsPerFrequency = 0;
+  fNormal.clear();
+  fCorrelated.clear();
+  fNumFrequencies = 0;
+  fLength = 0;
+}
+
+//______________________________________________________________________________
+void EXOCorrelatedNoiseGenerator::ClearNoise()
+{
+  // Free the noise drawn so far and the FFT arrays.
+  FreeArrays();
+  std::vector<std::vector<float> >().swap(fNoise);
+  fRecordLength = 0;
+}
+
+//______________________________________________________________________________
+void EXOCorrelatedNoiseGenerator::FreeArrays()
+{
+  for(size_t i = 0; i < fArrays.size(); i++) EXOFastFourierTransformFFTW::FreeArray(fArrays[i]);
+  fArrays.clear();
+}
+
+//______________________________________________________________________________
+void EXOCorrelatedNoiseGenerator::SetCacheLength(size_t cache)
+{
+  // Set the length of the noise drawn at once, in units of the noise length;
+  // 0 draws new noise for every event.  Noise already drawn is dropped.
+  fCacheLength = cache;
+  ClearNoise();
+}
+
+//______________________________________________________________________________
+int EXOCorrelatedNoiseGenerator::BlockOfChannel(int channel)
+{
+  // The block of channel: all APDs together, each wire plane of each TPC
+  // half on its own, anything else together.
+  EXOMiscUtil::EChannelType type = EXOMiscUtil::TypeOfChannel(channel);
+  if(EXOMiscUtil::ChannelIsAPD(type)) return 0;
+  if(EXOMiscUtil::ChannelIsWire(type)) {
+    return 1 + 2*EXOMiscUtil::GetTPCSide(channel) + (EXOMiscUtil::ChannelIsVWire(type) ? 1 : 0);
+  }
+  return 5;
+}
+
+//______________________________________________________________________________
+bool EXOCorrelatedNoiseGenerator::SetNoiseCorrelations(EXONoiseCorrelations& noise)
+{
+  // Factor the covariance matrix of every block at every frequency of
+  // noise.  This is the expensive step (O(m^3) per block of m channels and
+  // frequency) and is done once.
+  Clear();
+  size_t numChannels = noise.GetNumChannels();
+  size_t numFrequencies = noise.GetNumFrequencies();
+  if(numChannels == 0 or numFrequencies < 2) {
+    LogEXOMsg("Noise correlations are empty", EEError);
+    return false;
+  }
+
+  std::map<int, size_t> blockOfKey;
+  std::vector<size_t> blockOfIndex(numChannels);
+  for(size_t i = 0; i < numChannels; i++) {
+    int key = BlockOfChannel(noise.GetChannelOfIndex(i));
+    if(blockOfKey.count(key) == 0) {
+      blockOfKey[key] = fBlocks.size();
+      fBlocks.push_back(Block());
+    }
+    blockOfIndex[i] = blockOfKey[key];
+    fBlocks[blockOfIndex[i]].fIndices.push_back(i);
+  }
+  size_t largestSize = 0;
+  for(size_t k = 0; k < fBlocks.size(); k++) {
+    size_t size = 2*fBlocks[k].fIndices.size();
+    fBlocks[k].fOffset = fFactorsPerFrequency;
+    fFactorsPerFrequency += size*(size+1)/2;
+    largestSize = std::max(largestSize, size);
+  }
+  fFactors.resize((numFrequencies-1)*fFactorsPerFrequency);
+
+  std::vector<double> packed(largestSize*(largestSize+1)/2);
+  size_t numIndefinite = 0;
+  double largestDropped = 0.0;
+  for(size_t f = 1; f < numFrequencies; f++) {
+    EXONoiseCorrelations::SymmetricMatrix& rr = noise.GetRR(f);
+    EXONoiseCorrelations::SymmetricMatrix& ii = noise.GetII(f);
+    EXONoiseCorrelations::GeneralMatrix& ri = noise.GetRI(f);
+    bool ok = true;
+    for(size_t k = 0; k < fBlocks.size(); k++) {
+      const std::vector<size_t>& indices = fBlocks[k].fIndices;
+      size_t n = indices.size();
+      size_t size = 2*n;
+
+      // Row a of the packed lower triangle holds C(a, b) for b <= a; indices
+      // below n are real parts, the others imaginary parts.
+      for(size_t a = 0; a < size; a++) {
+        double* row = &packed[a*(a+1)/2];
+        size_t ca = indices[a % n];
+        for(size_t b = 0; b <= a; b++) {
+          size_t cb = indices[b % n];
+          if(a < n) row[b] = rr[ca][cb];
+          else if(b >= n) row[b] = ii[ca][cb];
+          else row[b] = ri[cb][ca];
+        }
+      }
+      if(not Factor(&packed[0], size)) ok = false;
+
+      // Store the factor by columns, column b holding rows b to size-1, so
+      // that Generate runs down contiguous columns.
+      float* factor = &fFactors[(f-1)*fFactorsPerFrequency + fBlocks[k].fOffset];
+      for(size_t b = 0; b < size; b++) {
+        for(size_t a = b; a < size; a++) *factor++ = packed[a*(a+1)/2 + b];
+      }
+    }
+    if(not ok) numIndefinite++;
+
+    // The correlations between blocks which the factors leave out.
+    for(size_t i = 0; i < numChannels; i++) {
+      for(size_t j = 0; j < numChannels; j++) {
+        if(blockOfIndex[i] == blockOfIndex[j]) continue;
+        double normRR = std::sqrt(rr[i][i]*rr[j][j]);
+        double normII = std::sqrt(ii[i][i]*ii[j][j]);
+        double normRI = std::sqrt(rr[i][i]*ii[j][j]);
+        if(i < j and normRR > 0) largestDropped = std::max(largestDropped, std::fabs(rr[i][j])/normRR);
+        if(i < j and normII > 0) largestDropped = std::max(largestDropped, std::fabs(ii[i][j])/normII);
+        if(normRI > 0) largestDropped = std::max(largestDropped, std::fabs(ri[i][j])/normRI);
+      }
+    }
+  }
+  if(numIndefinite > 0) {
+    std::ostringstream os;
+    os << "Noise covariance is not positive semi-definite at " << numIndefinite
+       << " frequencies; negative directions were dropped";
+    LogEXOMsg(os.str(), EEWarning);
+  }
+  if(fBlocks.size() > 1) {
+    std::ostringstream os;
+    os << "Correlated noise in " << fBlocks.size() << " independent blocks of channels; "
+       << "the largest correlation between blocks, left out, is " << largestDropped;
+    LogEXOMsg(os.str(), (largestDropped > 0.1) ? EEWarning : EENotice);
+  }
+
+  for(size_t i = 0; i < numChannels; i++) {
+    int channel = noise.GetChannelOfIndex(i);
+    if(size_t(channel) >= fChannelIndex.size()) fChannelIndex.resize(channel+1, -1);
+    fChannelIndex[channel] = i;
+    fChannels.push_back(channel);
+  }
+  fNumFrequencies = numFrequencies;
+  fLength = 2*(numFrequencies-1);
+  fNormal.resize(largestSize);
+  fCorrelated.resize(largestSize);
+  return true;
+}
+
+//______________________________________________________________________________
+bool EXOCorrelatedNoiseGenerator::Factor(double* packed, size_t size)
+{
+  // In-place Cholesky decomposition of the symmetric matrix whose lower
+  // triangle is packed by rows.  A pivot which is not significantly positive
+  // means the matrix is degenerate in that direction, and its column is set to
+  // zero.  Returns false if a pivot was significantly negative.
+  bool ok = true;
+  for(size_t j = 0; j < size; j++) {
+    double* rowJ = packed + j*(j+1)/2;
+    double diag = rowJ[j];
+    double pivot = diag;
+    for(size_t k = 0; k < j; k++) pivot -= rowJ[k]*rowJ[k];
+    if(pivot < -1e-9*std::fabs(diag)) ok = false;
+    pivot = (diag > 0 and pivot > 1e-12*diag) ? std::sqrt(pivot) : 0.0;
+    rowJ[j] = pivot;
+    for(size_t i = j+1; i < size; i++) {
+      double* rowI = packed + i*(i+1)/2;
+      if(pivot == 0.0) {
+        rowI[j] = 0.0;
+        continue;
+      }
+      double sum = rowI[j];
+      for(size_t k = 0; k < j; k++) sum -= rowI[k]*rowJ[k];
+      rowI[j] = sum/pivot;
+    }
+  }
+  return ok;
+}
+
+//______________________________________________________________________________
+void EXOCorrelatedNoiseGenerator::Generate(TRandom& random)
+{
+  // Draw max(cache, 1) independent stretches of noise, one noise length
+  // each.  For every stretch, fill the spectra of all channels frequency by
+  // frequency, transform them with the inverse FFT, and store them as
+  // floats.  The factor 1/length undoes the normalization of the
+  // unnormalized transforms.
+  if(not IsReady()) return;
+  size_t numChannels = fChannels.size();
+  size_t numStretches = std::max(fCacheLength, size_t(1));
+  if(fArrays.empty()) {
+    for(size_t ch = 0; ch < numChannels; ch++) {
+      fArrays.push_back(EXOFastFourierTransformFFTW::AllocateArray(fLength));
+    }
+  }
+  fRecordLength = numStretches*fLength;
+  fNoise.resize(numChannels);
+  for(size_t ch = 0; ch < numChannels; ch++) fNoise[ch].resize(fRecordLength);
+  double norm = 1.0/fLength;
+  const EXOFastFourierTransformFFTW& fft = EXOFastFourierTransformFFTW::GetFFT(fLength);
+
+  for(size_t stretch = 0; stretch < numStretches; stretch++) {
+    for(size_t ch = 0; ch < numChannels; ch++) {
+      double* spectrum = static_cast<double*>(fArrays[ch]);
+      spectrum[0] = spectrum[1] = 0.0;
+    }
+    for(size_t f = 1; f < fNumFrequencies; f++) {
+      const float* factors = &fFactors[(f-1)*fFactorsPerFrequency];
+      for(size_t k = 0; k < fBlocks.size(); k++) {
+        const std::vector<size_t>& indices = fBlocks[k].fIndices;
+        size_t n = indices.size();
+        size_t size = 2*n;
+        for(size_t a = 0; a < size; a += 2) {
+          double z1, z2;
+          random.Rannor(z1, z2);
+          fNormal[a] = z1;
+          fNormal[a+1] = z2;
+          fCorrelated[a] = fCorrelated[a+1] = 0.0;
+        }
+        // L z, one column at a time.
+        const float* column = factors + fBlocks[k].fOffset;
+        for(size_t b = 0; b < size; b++) {
+          float z = fNormal[b];
+          float* out = &fCorrelated[b];
+          size_t rows = size - b;
+          for(size_t a = 0; a < rows; a++) out[a] += column[a]*z;
+          column += rows;
+        }
+        for(size_t i = 0; i < n; i++) {
+          double* spectrum = static_cast<double*>(fArrays[indices[i]]);
+          spectrum[2*f] = fCorrelated[i]*norm;
+          spectrum[2*f+1] = fCorrelated[n+i]*norm;
+        }
+      }
+    }
+
+    for(size_t ch = 0; ch < numChannels; ch++) {
+      fft.PerformInverseFFT_inplace(fArrays[ch]);
+      const double* noise = static_cast<const double*>(fArrays[ch]);
+      float* record = &fNoise[ch][stretch*fLength];
+      for(size_t i = 0; i < fLength; i++) record[i] = noise[i];
+    }
+  }
+
+  // Without a cache the arrays are needed again for the next event.
+  if(fCacheLength > 0) FreeArrays();
+}
+
+//______________________________________________________________________________
+const float* EXOCorrelatedNoiseGenerator::GetNoise(int channel) const
+{
+  if(channel < 0 or size_t(channel) >= fChannelIndex.size() or
+     fChannelIndex[channel] < 0 or fRecordLength == 0) return NULL;
+  return &fNoise[fChannelIndex[channel]][0];
+}
+
+//______________________________________________________________________________
+size_t EXOCorrelatedNoiseGenerator::AddNoise(EXOWaveformData& wfData, TRandom& random)
+{
+  // Add correlated noise to the waveforms of wfData, rounded to the nearest
+  // ADC count.  Without a cache the noise is drawn for this event; with one,
+  // it is drawn on the first call and every event starts at a random point
+  // of it, reading around the stretch that point falls in.
+  if(not IsReady()) return 0;
+  size_t stretch = 0;
+  size_t start = 0;
+  if(fCacheLength == 0 or fRecordLength == 0) Generate(random);
+  if(fCacheLength > 0) {
+    start = size_t(fRecordLength*random.Rndm()) % fRecordLength;
+    stretch = start - start % fLength;
+    start -= stretch;
+  }
+
+  size_t numChanged = 0;
+  bool tooLong = false;
+  for(size_t i = 0; i < wfData.GetNumWaveforms(); i++) {
+    EXOWaveform& wf = *wfData.GetWaveformToEdit(i);
+    const float* noise = GetNoise(wf.fChannel);
+    if(not noise) continue;
+    if(wf.GetLength() > fLength) {
+      tooLong = true;
+      continue;
+    }
+    noise += stretch;
+    size_t readPoint = start;
+    for(size_t j = 0; j < wf.GetLength(); j++) {
+      if(readPoint >= fLength) readPoint = 0;
+      wf[j] += int(std::floor(noise[readPoint] + 0.5));
+      readPoint++;
+    }
+    numChanged++;
+  }
+  if(tooLong) {
+    LogEXOMsg("Waveforms longer than the noise correlations were left without noise", EEWarning);
+  }
+  return numChanged;
+}
@@ -32,6 +32,9 @@ bool EXOEnergyMCBasedFit1D::SmearedMCHistoCalib(std::vector<double>& e_up, doubl
 
 bool EXOEnergyMCBasedFit1D::SmearedMCHistoResol(std::vector<double>& weight, const std::vector<Double_t>& energy, const std::vector<Double_t>& pdf, const std::vector<double>& e_up, double elow)
 {
+  if(fUseFFTSmearing && fFFTSmearingTolerance > 0)
+    return SmearedMCHistoResolFFT(weight,energy,pdf,e_up,elow);
+
   long int n = energy.size();
   int nBins = e_up.size();
   
@@ -49,6 +52,72 @@ bool EXOEnergyMCBasedFit1D::SmearedMCHistoResol(std::vector<double>& weight, con
   return true;
 }
 
+bool EXOEnergyMCBasedFit1D::SmearedMCHistoResolFFT(std::vector<double>& weight, const std::vector<Double_t>& energy, const std::vector<Double_t>& pdf, const std::vector<double>& e_up, double elow)
+{
+  // Split the (sorted) MC energies into segments in which the resolution
+  // varies by less than fFFTSmearingTolerance, smear each segment with its
+  // mean resolution on a grid of step sigma*sqrt(tolerance) (see
+  // EXOGaussianSmearing), and add the smeared weight in each bin.  Segments
+  // too short to gain from the grid are smeared directly, as in
+  // SmearedMCHistoResol.  Energies near the segment edges get no special
+  // treatment; see SetFFTSmearing for the error.
+  const size_t minSegment = 32;
+  size_t n = energy.size();
+  int nBins = e_up.size();
+
+  std::vector<std::pair<double,double> > points(n);
+  for(size_t i = 0; i < n; i++)
+    points[i] = std::make_pair(energy.at(i), pdf.at(i));
+  std::sort(points.begin(), points.end());
+
+  std::vector<double> ene(n), wgt(n), res(n);
+  for(size_t i = 0; i < n; i++){
+    ene[i] = points[i].first;
+    wgt[i] = points[i].second;
+    res[i] = fFitResolFunction->Eval(ene[i]);
+  }
+
+  EXOGaussianSmearing smearing;
+  size_t first = 0;
+  while(first < n){
+    double resLow = res[first];
+    double resHigh = res[first];
+    size_t last = first + 1;
+    for(; last < n; last++){
+      double low = std::min(resLow, res[last]);
+      double high = std::max(resHigh, res[last]);
+      if(high - low > fFFTSmearingTolerance*(high + low))
+        break;
+      resLow = low;
+      resHigh = high;
+    }
+
+    if(last - first < minSegment || !(resLow > 0)){
+      for(size_t i = first; i < last; i++){
+        double const_res = 0.7071067811865474 / res[i];
+        double erflow = erf(const_res * (elow - ene[i]) );
+        for(int b = 0; b < nBins; b++){
+          double erfup = erf(const_res * (e_up.at(b) - ene[i]) );
+          weight[b] += (erfup - erflow)*wgt[i];
+          erflow = erfup;
+        }
+      }
+    }
+    else{
+      double sigma = (resLow + resHigh)/2.;
+      smearing.Smear(&ene[first], &wgt[first], last - first, sigma, sigma*sqrt(fFFTSmearingTolerance), true);
+      double below = smearing.Evaluate(elow);
+      for(int b = 0; b < nBins; b++){
+        double up = smearing.Evaluate(e_up.at(b));
+        weight[b] += 2.*(up - below); // in the units of the erf differences
+        below = up;
+      }
+    }
+    first = last;
+  }
+  return true;
+}
+
 bool EXOEnergyMCBasedFit1D::FillSmearedMCHistogram(const double* x, TH1D& histo, const std::vector<Double_t>& energy, const std::vector<Double_t>& pdf)
 {
   if(fVerboseLevel > 1)
@@ -75,6 +144,162 @@ bool EXOEnergyMCBasedFit1D::FillSmearedMCHistogram(const double* x, TH1D& histo,
   return true;
 }
 
+bool EXOEnergyMCBasedFit1D::SmearedMCHistoCalibGradient(std::vector<double>& gradient, const TH1D& histo)
+{
+  // Derivatives of the calibrated bin edges of SmearedMCHistoCalib (the low
+  // edge, then the upper edge of each bin) with respect to the parameters
+  // of the calibration function, GetNpar() per edge.
+  int nPar = fFitCalibFunction->GetNpar();
+  gradient.assign((histo.GetNbinsX() + 1)*nPar, 0.);
+  for(int b = 0; b <= histo.GetNbinsX(); b++){
+    double edge = (b == 0) ? histo.GetBinLowEdge(1) : histo.GetBinLowEdge(b) + histo.GetBinWidth(b);
+    fFitCalibFunction->GradientPar(&edge, &gradient[b*nPar]);
+  }
+  return true;
+}
+
+bool EXOEnergyMCBasedFit1D::FillSmearedMCHistogramGradient(TH1D& histo, std::vector<double>& gradient, const std::vector<Double_t>& energy, const std::vector<Double_t>& pdf)
+{
+  // Fill histo as FillSmearedMCHistogram does with the direct smearing, and
+  // gradient (fNpar per bin) with the derivatives of its contents.  For an
+  // energy E of resolution sigma, c = 1/(sqrt(2) sigma), a bin gets
+  // pdf/2 (erf(c (up - E)) - erf(c (low - E))), and
+  //   d erf(c (e - E)) = 2/sqrt(pi) exp(-c^2 (e - E)^2) (c de + (e - E) dc),
+  // so the terms at each edge are summed over the energies once, in the
+  // same pass as the erf, for the calibration parameters (through de) and
+  // the resolution parameters (through dc = -c dsigma/sigma).
+  if(fVerboseLevel > 1)
+    std::cout << "Creating 1D smearing with gradient...\n";
+
+  std::vector<double> e_up;
+  double elow;
+  SmearedMCHistoCalib(e_up,elow,histo);
+  std::vector<double> edgeGradient;
+  SmearedMCHistoCalibGradient(edgeGradient,histo);
+
+  std::vector<Int_t> calibIndex = GetFitParameterIndices(fFitCalibFunction);
+  std::vector<Int_t> resolIndex = GetFitParameterIndices(fFitResolFunction);
+  int nCalib = calibIndex.size();
+  int nResol = resolIndex.size();
+
+  int nBins = e_up.size();
+  std::vector<double> edges(nBins + 1);
+  edges[0] = elow;
+  for(int b = 0; b < nBins; b++)
+    edges[b+1] = e_up[b];
+
+  std::vector<double> weight(nBins, 0.);
+  std::vector<double> edgeCalib(nBins + 1, 0.);
+  std::vector<double> edgeResol((nBins + 1)*nResol, 0.);
+  std::vector<double> resolGradient(nResol);
+  std::vector<double> dc(nResol);
+  for(size_t i = 0; i < energy.size(); i++){
+    double e_mc = energy.at(i);
+    double res = fFitResolFunction->Eval(e_mc);
+    double const_res = 0.7071067811865474 / res;
+    double erflow = erf(const_res * (elow - e_mc) );
+    for(int b = 0; b < nBins; b++){
+      double erfup = erf(const_res * (e_up.at(b) - e_mc) );
+      weight[b] += (erfup - erflow)*pdf.at(i);
+      erflow = erfup;
+    }
+
+    if(nResol > 0)
+      fFitResolFunction->GradientPar(&e_mc, &resolGradient[0]);
+    for(int q = 0; q < nResol; q++)
+      dc[q] = -const_res*resolGradient[q]/res;
+    for(int k = 0; k <= nBins; k++){
+      double diff = edges[k] - e_mc;
+      double arg = const_res*diff;
+      if(arg*arg > 50.) // exp(-50) is negligible
+        continue;
+      double term = 1.1283791670955126*exp(-arg*arg)*pdf.at(i);
+      edgeCalib[k] += term*const_res;
+      for(int q = 0; q < nResol; q++)
+        edgeResol[k*nResol + q] += term*diff*dc[q];
+    }
+  }
+
+  gradient.assign(nBins*fNpar, 0.);
+  for(int b = 0; b < nBins; b++){
+    histo.SetBinContent(b+1, weight[b]/2.);
+    histo.SetBinError(b+1,sqrt(histo.GetBinContent(b+1)));
+
+    for(int p = 0; p < nCalib; p++)
+      if(calibIndex[p] >= 0)
+        gradient[b*fNpar + calibIndex[p]] += (edgeCalib[b+1]*edgeGradient[(b+1)*nCalib + p] - edgeCalib[b]*edgeGradient[b*nCalib + p])/2.;
+    for(int q = 0; q < nResol; q++)
+      if(resolIndex[q] >= 0)
+        gradient[b*fNpar + resolIndex[q]] += (edgeResol[(b+1)*nResol + q] - edgeResol[b*nResol + q])/2.;
+  }
+    
+  histo.SetEntries(histo.Integral(1,histo.GetNbinsX()));
+
+  return true;
+}
+
+void EXOEnergyMCBasedFit1D::GetScaleGradient(std::vector<double>& gradient, const TH1D& hData, const TH1D& hMC, const std::vector<double>& mcGradient, bool usePrescaleModel)
+{
+  // Derivatives of the scale of GetScaleHistogram (fNpar per bin), given
+  // those of the MC bins.  The scale is a ratio of integrals, and with the
+  // prescale model also depends on the trigger efficiency function; the
+  // cut between its low and high parts moves by whole bins and does not
+  // contribute.
+  int nBins = hMC.GetNbinsX();
+  gradient.assign(hData.GetNbinsX()*fNpar, 0.);
+
+  double eCut = 0;
+  if(usePrescaleModel && fFitTrigEffFunction)
+    if(fFitTrigEffFunction->GetNpar() > 0)
+        eCut = fFitTrigEffFunction->GetParameter(0);
+
+  // The scales of the bins below and above the cut, or of all bins.
+  int cutBin = hMC.FindFixBin(eCut);
+  int dataCutBin = hData.FindFixBin(eCut);
+  bool split = (1 < cutBin && cutBin < nBins);
+  int firstBins[2] = {1, cutBin};
+  int lastBins[2] = {split ? cutBin - 1 : nBins, nBins};
+  int firstDataBins[2] = {1, dataCutBin};
+  int lastDataBins[2] = {split ? dataCutBin - 1 : hData.GetNbinsX(), hData.GetNbinsX()};
+  double scales[2];
+  std::vector<double> scaleGradients[2];
+  for(int part = 0; part < (split ? 2 : 1); part++){
+    double totData = hData.Integral(firstDataBins[part], lastDataBins[part]);
+    double totMC = hMC.Integral(firstBins[part], lastBins[part]);
+    scaleGradients[part].assign(fNpar, 0.);
+    scales[part] = 1.;
+    if(totMC > 0){
+      scales[part] = totData/totMC;
+      for(int b = firstBins[part]; b <= lastBins[part]; b++)
+        for(int p = 0; p < fNpar; p++)
+          scaleGradients[part][p] -= scales[part]/totMC*mcGradient[(b-1)*fNpar + p];
+    }
+  }
+
+  if(!split){
+    for(int b = 0; b < hData.GetNbinsX(); b++)
+      for(int p = 0; p < fNpar; p++)
+        gradient[b*fNpar + p] = scaleGradients[0][p];
+    return;
+  }
+
+  // scale = low + (high - low)*trigEff(center)
+  std::vector<Int_t> trigIndex = GetFitParameterIndices(fFitTrigEffFunction);
+  std::vector<double> trigGradient(trigIndex.size());
+  for(int b = 0; b < hData.GetNbinsX(); b++){
+    double center = hData.GetBinCenter(b+1);
+    double trigEff = fFitTrigEffFunction->Eval(center);
+    for(int p = 0; p < fNpar; p++)
+      gradient[b*fNpar + p] = scaleGradients[0][p] + (scaleGradients[1][p] - scaleGradients[0][p])*trigEff;
+    if(trigIndex.empty())
+      continue;
+    fFitTrigEffFunction->GradientPar(&center, &trigGradient[0]);
+    for(size_t q = 0; q < trigIndex.size(); q++)
+      if(trigIndex[q] >= 0)
+        gradient[b*fNpar + trigIndex[q]] += (scales[1] - scales[0])*trigGradient[q];
+  }
+}
+
 void EXOEnergyMCBasedFit1D::GetScaleHistogram(TH1D& hScale, const TH1D& hData, const TH1D& hMC, bool usePrescaleModel)
 {
   double eCut = 0;
@@ -413,6 +638,19 @@ bool EXOEnergyMCBasedFit1D::BuildFitter()
   commandList[0] = (fFitType == 2) ? GetErrorDef(1) : GetErrorDef(0.5);
   fFitter->ExecuteCommand("SET ERR",commandList,1);
 
+  fGradientFit = NULL;
+  if(fUseAnalyticGradient)
+  {
+    if(fFitType == 1 && !fUseFFTSmearing)
+    {
+      fGradientFit = this;
+      commandList[0] = 1; // trust the gradient, without checking it against finite differences
+      fFitter->ExecuteCommand("SET GRAdient",commandList,1);
+    }
+    else
+      std::cerr << "The analytic gradient is only available for the NLL fit without FFT smearing, using finite differences...\n";
+  }
+
   return true;
 }
 
@@ -478,6 +716,15 @@ bool EXOEnergyMCBasedFit1D::ExecuteFit(Int_t fitType, const char* minimizer, Flo
 
 double EXOEnergyMCBasedFit1D::FitFunction(const double* x)
 {
+  return FitFunctionGradient(x,NULL);
+}
+
+double EXOEnergyMCBasedFit1D::FitFunctionGradient(const double* x, double* grad)
+{
+  // Without grad, the NLL or chi2 from the smeared MC.  With grad (NLL
+  // only), also its derivatives with respect to the fit parameters: those
+  // of the smeared MC bins (FillSmearedMCHistogramGradient) are propagated
+  // through the scale of each data set and the sum over bins.
 
   //print out starting parameters
   if(fVerboseLevel > 1 && x){
@@ -489,6 +736,7 @@ double EXOEnergyMCBasedFit1D::FitFunction(const double* x)
 
   // loop through MC entries and smearing histograms
   bool allOk = true;
+  std::map<TString, std::vector<double> > mcGradients; // bin-major, fNpar per bin
   for(std::map<TString, MCEntry>::iterator mcEntry = fMCList.begin(); mcEntry != fMCList.end(); mcEntry++)
   {
     MCEntry &mc = mcEntry->second;
@@ -497,17 +745,28 @@ double EXOEnergyMCBasedFit1D::FitFunction(const double* x)
     TH1D* mcHisto1D = dynamic_cast<TH1D*>(mc.MCSmearedHisto);
     if(!mcHisto1D)
       continue;
-    if(!FillSmearedMCHistogram(x,*mcHisto1D,mc.MCEnergyPoints,mc.MCEnergyPDF))
+    if(grad)
+    {
+      if(!SetFitFunctionParameters(x) || !FillSmearedMCHistogramGradient(*mcHisto1D,mcGradients[mcEntry->first],mc.MCEnergyPoints,mc.MCEnergyPDF))
+        allOk = false;
+    }
+    else if(!FillSmearedMCHistogram(x,*mcHisto1D,mc.MCEnergyPoints,mc.MCEnergyPDF))
       allOk = false;
   }
 
+  if(grad)
+    for(int p = 0; p < fNpar; p++)
+      grad[p] = 0.;
   if(!allOk)
     return std::numeric_limits<double>::max();
+
+  std::vector<std::vector<double> > histoGradients(fHistoList.size());
   
   //GetTriggerScale(*fScaleHisto1D,*fDataHisto1D,*fSmearedMCHisto1D);
   for(std::vector<HistoEntry>::iterator histoEntry = fHistoList.begin(); histoEntry != fHistoList.end(); histoEntry++)
   {
     HistoEntry &histo = (*histoEntry);
+    std::vector<double>& histoGradient = histoGradients[histoEntry - fHistoList.begin()];
 
     if(histo.DataHisto)
       histo.DataHisto->Reset("ICES");
@@ -536,6 +795,23 @@ double EXOEnergyMCBasedFit1D::FitFunction(const double* x)
         idMCSmearedHisto1D->SetBinContent(b,scale*expected);
         idMCSmearedHisto1D->SetBinError(b,scale*sqrt(expected));
       }
+
+      if(grad)
+      {
+        // d(scale*expected) = dscale*expected + scale*dexpected
+        const std::vector<double>& mcGradient = mcGradients.at(data.MCId);
+        std::vector<double> scaleGradient;
+        GetScaleGradient(scaleGradient,*idDataHisto1D,*fullMCSmearedHisto1D,mcGradient,data.UsePrescaleTriggerEff);
+        int nBins = idDataHisto1D->GetNbinsX();
+        histoGradient.resize(nBins*fNpar, 0.);
+        for(int b = 0; b < nBins; b++)
+        {
+          double expected = fullMCSmearedHisto1D->GetBinContent(b+1);
+          double scale = idScaleHisto1D->GetBinContent(b+1);
+          for(int p = 0; p < fNpar; p++)
+            histoGradient[b*fNpar + p] += scaleGradient[b*fNpar + p]*expected + scale*mcGradient[b*fNpar + p];
+        }
+      }
       idMCSmearedHisto1D->SetEntries(idMCSmearedHisto1D->Integral(1,idMCSmearedHisto1D->GetNbinsX()));
 
       dataHisto1D->Add(idDataHisto1D);
@@ -563,6 +839,8 @@ double EXOEnergyMCBasedFit1D::FitFunction(const double* x)
     double histoNDF = 0.;
     double histoChi2 = 0;
     double histoNLL = 0;
+    std::vector<double> histoNLLGradient(grad ? fNpar : 0, 0.);
+    const std::vector<double>& histoGradient = histoGradients[histoEntry - fHistoList.begin()];
     for(std::set<int>::iterator pb = histo.FitBins.begin(); pb != histo.FitBins.end(); pb++)//int b = 1; b <= dataHisto1D->GetNbinsX(); b++)
     {
       int b = (*pb);
@@ -579,6 +857,14 @@ double EXOEnergyMCBasedFit1D::FitFunction(const double* x)
         histoNDF += 1.;
       }
 
+      if(grad && expected > 0 && !histoGradient.empty())
+      {
+        // d(expected - observed*log(expected)) = (1 - observed/expected) dexpected
+        double factor = 1. - observed/expected;
+        for(int p = 0; p < fNpar; p++)
+          histoNLLGradient[p] += factor*histoGradient[(b-1)*fNpar + p];
+      }
+
       if(expected <= 0)
         expected = 1e-32;
  
@@ -603,11 +889,15 @@ double EXOEnergyMCBasedFit1D::FitFunction(const double* x)
       Chi2 += histoChi2; //* histo.Weight / histo.NumberOfEvents;
       NDF += histoNDF; //* histo.Weight / histo.NumberOfEvents;
       NLL += histoNLL; //* histo.Weight / histo.NumberOfEvents;
+      for(int p = 0; grad && p < fNpar; p++)
+        grad[p] += histoNLLGradient[p];
     }
     else {
       Chi2 += histoChi2*histo.Weight / histo.NumberOfEvents;
       NDF += histoNDF* histo.Weight / histo.NumberOfEvents;
       NLL += histoNLL* histo.Weight / histo.NumberOfEvents;
+      for(int p = 0; grad && p < fNpar; p++)
+        grad[p] += histoNLLGradient[p]*histo.Weight / histo.NumberOfEvents;
     
     }
   }
@@ -616,6 +906,8 @@ double EXOEnergyMCBasedFit1D::FitFunction(const double* x)
   Chi2 *= weightNorm;
   NDF *= weightNorm;
   NLL *= weightNorm;
+  for(int p = 0; grad && p < fNpar; p++)
+    grad[p] *= weightNorm;
   }
   //NDF -= fNpar;
     
@@ -625,7 +917,11 @@ double EXOEnergyMCBasedFit1D::FitFunction(const double* x)
     std::cout << "FCN = " << FCN << " (Chi2/NDF = " << Chi2/NDF << ")" << std::endl;
 
   if(!std::isfinite(FCN))
+  {
     FCN = std::numeric_limits<double>::max();
+    for(int p = 0; grad && p < fNpar; p++)
+      grad[p] = 0.;
+  }
 
   fChi2 = Chi2/NDF;
   
@@ -1,4 +1,8 @@
 #include "EXOUtilities/EXOEnergyMCBasedFit2D.hh"
+#ifdef USE_THREADS
+#include "boost/thread/thread.hpp"
+#include "boost/bind.hpp"
+#endif
 
 ClassImp(EXOEnergyMCBasedFit2D)
 
@@ -29,6 +33,7 @@ EXOEnergyMCBasedFit2D::EXOEnergyMCBasedFit2D() : EXOEnergyMCBasedFitBase()
   SetOffset(0.);
   SetMaxOffset(0.1,true,true);
   SetMaxIterations(500);
+  SetSmearingWindow(8.);
 }
 
 float EXOEnergyMCBasedFit2D::FastExp(float x) // returns exponential divided by 0.0001984127f to save 1 multiplication per call
@@ -69,7 +74,48 @@ void EXOEnergyMCBasedFit2D::FillSmearedMCHistogram(TH2F& histo, const std::vecto
 
   if(fVerboseLevel > 1)
     std::cout << "Creating 2D smearing...\n";
-  
+
+  SmearingTerms terms;
+  terms.fOnDiagonal = true;
+  for(size_t e = 0; e < energy.size(); e++)
+  {
+    float ene = energy[e];
+    terms.fEnergyCC.push_back(ene);
+    terms.fEnergySC.push_back(ene);
+  }
+
+  return FillSmearedHistogram(histo,terms,pdf);
+}
+
+void EXOEnergyMCBasedFit2D::FillSmearedMC2DHistogram(const double* x, TH2F& histo, const std::vector<std::pair<Double_t,Double_t> >& energy, const std::vector<Double_t>& pdf)
+{
+  SetFitFunctionParameters(x);
+
+  return FillSmearedMC2DHistogram(histo,energy,pdf);
+}
+
+void EXOEnergyMCBasedFit2D::FillSmearedMC2DHistogram(TH2F& histo, const std::vector<std::pair<Double_t,Double_t> >& energy, const std::vector<Double_t>& pdf)
+{
+  if(fVerboseLevel > 1)
+    std::cout << "Creating 2D smearing from MC2D ...\n";
+
+  // eneX = energy_mc is what we've been using to represent the rotated
+  // energy, it also sets the correlation
+  SmearingTerms terms;
+  for(size_t e = 0; e < energy.size(); e++)
+  {
+    terms.fEnergyCC.push_back(energy[e].first);
+    terms.fEnergySC.push_back(energy[e].second);
+  }
+
+  return FillSmearedHistogram(histo,terms,pdf);
+}
+
+void EXOEnergyMCBasedFit2D::FillSmearedHistogram(TH2F& histo, SmearingTerms& terms, const std::vector<Double_t>& pdf)
+{
+  // Smear the MC energies in terms (ionization, scintillation) with the
+  // bivariate gaussian resolution and fill histo.  The bin integrals are
+  // done with a 3x3 Gauss-Legendre rule in the calibrated energies.
   TAxis *ccAxis = histo.GetXaxis();
   TAxis *scAxis = histo.GetYaxis();
 
@@ -80,7 +126,6 @@ void EXOEnergyMCBasedFit2D::FillSmearedMCHistogram(TH2F& histo, const std::vecto
   std::vector<float> content(ccBins*scBins, 1.e-12);
 
   std::vector<Float_t> widthCC;
-  std::vector<Float_t> sumCC, subCC, midCC;
   for(int i = 1; i < ccBins+1; i++)
   {
     float mean = (ccAxis->GetBinUpEdge(i) + ccAxis->GetBinLowEdge(i))/2.;
@@ -90,14 +135,13 @@ void EXOEnergyMCBasedFit2D::FillSmearedMCHistogram(TH2F& histo, const std::vecto
     float sub = fFitIonizCalibFunction->Eval(mean - width*0.7745966692414834);
     float mid = fFitIonizCalibFunction->Eval(mean);
     
-    sumCC.push_back(sum);
-    subCC.push_back(sub);
-    midCC.push_back(mid);
+    terms.fSumCC.push_back(sum);
+    terms.fSubCC.push_back(sub);
+    terms.fMidCC.push_back(mid);
     widthCC.push_back(width);
   }
 
   std::vector<Float_t> widthSC;
-  std::vector<Float_t> sumSC, subSC, midSC;
   for(int i = 1; i < scBins+1; i++)
   {
     float mean = (scAxis->GetBinUpEdge(i) + scAxis->GetBinLowEdge(i))/2.;
@@ -107,25 +151,21 @@ void EXOEnergyMCBasedFit2D::FillSmearedMCHistogram(TH2F& histo, const std::vecto
     float sub = fFitScintCalibFunction->Eval(mean - width*0.7745966692414834);
     float mid = fFitScintCalibFunction->Eval(mean);
     
-    sumSC.push_back(sum);
-    subSC.push_back(sub);
-    midSC.push_back(mid);
+    terms.fSumSC.push_back(sum);
+    terms.fSubSC.push_back(sub);
+    terms.fMidSC.push_back(mid);
     widthSC.push_back(width);
   }
   
   // calculate bivariate gaussian energy variables 
-  std::vector<Float_t> normGauss, sigmaCC, sigmaSC, corrTerm;
-  std::vector<float> emcCC, emcSC;
-  
-  for(size_t e = 0; e < energy.size(); e++)
+  for(size_t e = 0; e < terms.fEnergyCC.size(); e++)
   {
-    float ene = energy[e];
-    emcCC.push_back(ene);
-    emcSC.push_back(ene);
+    float eneCC = terms.fEnergyCC[e];
+    float eneSC = terms.fEnergySC[e];
 
-    float tempCC = fFitIonizResolFunction->Eval(ene);
-    float tempSC = fFitScintResolFunction->Eval(ene);
-    float tempCorr = fFitCorrelationFunction->Eval(ene);
+    float tempCC = fFitIonizResolFunction->Eval(eneCC);
+    float tempSC = fFitScintResolFunction->Eval(eneSC);
+    float tempCorr = fFitCorrelationFunction->Eval(eneCC);
     
     float tempCorr2 = tempCorr*tempCorr;
 
@@ -159,59 +199,23 @@ void EXOEnergyMCBasedFit2D::FillSmearedMCHistogram(TH2F& histo, const std::vecto
       
     float tempSqrt = sqrt(2.*(1-tempCorr2));
 
-    normGauss.push_back(0.225079079039277f / tempCC / tempSC / tempSqrt);
-    sigmaCC.push_back(1. / tempCC / tempSqrt);
-    sigmaSC.push_back(1. / tempSC / tempSqrt);
-    corrTerm.push_back(2.*tempCorr);
+    float normGauss = 0.225079079039277f / tempCC / tempSC / tempSqrt;
+    float normXpdf = normGauss*pdf[e];
+    terms.fNormXPdf.push_back(normXpdf);
+    terms.fSigmaCC.push_back(1. / tempCC / tempSqrt);
+    terms.fSigmaSC.push_back(1. / tempSC / tempSqrt);
+    terms.fCorr.push_back(2.*tempCorr);
+    terms.fLimit.push_back(fSmearingWindow / tempSqrt);
+    terms.fResolCC.push_back(tempCC);
+    terms.fResolSC.push_back(tempSC);
   }
 
-  // main loop, fill bins with contribution from each energy
-  for(size_t e = 0; e < energy.size(); e++)
+  if(fUseFFTSmearing && fFFTSmearingTolerance > 0 && terms.fOnDiagonal)
+    SmearMCEnergiesFFT(terms,pdf,content);
+  else
   {
-    float eneCC = emcCC[e];
-    float eneSC = emcSC[e];
-    float corr = corrTerm[e];
-    float sigmai = sigmaCC[e];
-    float sigmaj = sigmaSC[e];  
-    float normXpdf = normGauss[e]*pdf[e];
-
-    for(int i = 0; i < ccBins; i++)
-    {
-      float sumi = sumCC[i];
-      float subi = subCC[i];
-      float midi = midCC[i];
-      
-      float pi = (sumi-eneCC)*sigmai;
-      float mi = (subi-eneCC)*sigmai;
-      float ci = (midi-eneCC)*sigmai;
-
-      for(int j = 0; j < scBins; j++)
-      {
-        float subj = subSC[j];
-        float sumj = sumSC[j];
-        float midj = midSC[j];        
-
-        float pj = (sumj-eneSC)*sigmaj;
-        float mj = (subj-eneSC)*sigmaj;
-        float cj = (midj-eneSC)*sigmaj;
-
-        float texpp = FastExp(GaussTerm2(pi,pj,corr));//exp(gaussTerm2(pi,pj,corr));
-        float texpm = FastExp(GaussTerm2(pi,mj,corr));//exp(gaussTerm2(pi,mj,corr));
-        float texpc = FastExp(GaussTerm2(pi,cj,corr));//exp(gaussTerm2(pi,cj,corr));
-
-        float texcp = FastExp(GaussTerm2(ci,pj,corr));//exp(gaussTerm2(ci,pj,corr));
-        float texcm = FastExp(GaussTerm2(ci,mj,corr));//exp(gaussTerm2(ci,mj,corr));
-        float texcc = FastExp(GaussTerm2(ci,cj,corr));//exp(gaussTerm2(ci,cj,corr));
-
-        float texmp = FastExp(GaussTerm2(mi,pj,corr));//exp(gaussTerm2(mi,pj,corr));
-        float texmm = FastExp(GaussTerm2(mi,mj,corr));//exp(gaussTerm2(mi,mj,corr));
-        float texmc = FastExp(GaussTerm2(mi,cj,corr));//exp(gaussTerm2(mi,cj,corr));
-
-        float sum = 0.308641975308f*(texpp + texpm + texmp + texmm) + 0.493827160493f*(texpc + texcp + texcm + texmc) + 0.79012345679f*texcc;
-        
-        content[j + scBins*i] += sum*normXpdf;
-      }
-    }
+    FindSmearingWindows(terms);
+    SmearMCEnergies(terms,content);
   }
 
   // set histo bin contents
@@ -231,178 +235,272 @@ void EXOEnergyMCBasedFit2D::FillSmearedMCHistogram(TH2F& histo, const std::vecto
   return ;
 }
 
-void EXOEnergyMCBasedFit2D::FillSmearedMC2DHistogram(const double* x, TH2F& histo, const std::vector<std::pair<Double_t,Double_t> >& energy, const std::vector<Double_t>& pdf)
+void EXOEnergyMCBasedFit2D::SmearMCEnergiesFFT(const SmearingTerms& terms, const std::vector<Double_t>& pdf, std::vector<float>& content)
 {
-  SetFitFunctionParameters(x);
-
-  return FillSmearedMC2DHistogram(histo,energy,pdf);
-}
-
-void EXOEnergyMCBasedFit2D::FillSmearedMC2DHistogram(TH2F& histo, const std::vector<std::pair<Double_t,Double_t> >& energy, const std::vector<Double_t>& pdf)
-{
-  if(fVerboseLevel > 1)
-    std::cout << "Creating 2D smearing from MC2D ...\n";
-
-  TAxis *ccAxis = histo.GetXaxis();
-  TAxis *scAxis = histo.GetYaxis();
-
-  // get histo properties
-  Int_t ccBins = ccAxis->GetNbins();
-  Int_t scBins = scAxis->GetNbins();
-
-  std::vector<float> content(ccBins*scBins, 1.e-12);
-
-  std::vector<Float_t> widthCC;
-  std::vector<Float_t> sumCC, subCC, midCC;
-  for(int i = 1; i < ccBins+1; i++)
+  // For MC energies E on the diagonal, the smeared density is
+  // f(x,y) = sum_E pdf(E) N2(x-E, y-E).  The difference u = x - y does not
+  // depend on E, so f = N(u; sigmaU) s(x - beta u), where s is the MC
+  // spectrum smeared with the width sigmaW of x at fixed u.  The energies
+  // are split into segments in which sigmaCC, sigmaSC, sigmaU and sigmaW
+  // vary by less than fFFTSmearingTolerance; s is computed for each segment
+  // by EXOGaussianSmearing on a grid of step sigmaW*sqrt(tolerance) and
+  // evaluated at the quadrature points of the bins.  Segments too short to
+  // gain from the grid are smeared directly.  Energies near the segment
+  // edges get no special treatment; see SetFFTSmearing for the error.
+  const size_t minSegment = 32;
+  const float qWeight[3] = {0.555555555556f, 0.888888888889f, 0.555555555556f};
+  size_t numEnergies = terms.fEnergyCC.size();
+  size_t ccBins = terms.fSumCC.size();
+  size_t scBins = terms.fSumSC.size();
+
+  std::vector<std::pair<float,size_t> > order(numEnergies);
+  std::vector<double> sigmaU(numEnergies), sigmaW(numEnergies);
+  for(size_t e = 0; e < numEnergies; e++)
   {
-    float mean = (ccAxis->GetBinUpEdge(i) + ccAxis->GetBinLowEdge(i))/2.;
-    float width = (ccAxis->GetBinUpEdge(i) - ccAxis->GetBinLowEdge(i))/2.;
-
-    float sum = fFitIonizCalibFunction->Eval(mean + width*0.7745966692414834);
-    float sub = fFitIonizCalibFunction->Eval(mean - width*0.7745966692414834);
-    float mid = fFitIonizCalibFunction->Eval(mean);
-    
-    sumCC.push_back(sum);
-    subCC.push_back(sub);
-    midCC.push_back(mid);
-    widthCC.push_back(width);
+    order[e] = std::make_pair(terms.fEnergyCC[e], e);
+    double sx = terms.fResolCC[e];
+    double sy = terms.fResolSC[e];
+    double rho = terms.fCorr[e]/2.;
+    sigmaU[e] = sqrt(std::max(sx*sx + sy*sy - 2.*rho*sx*sy, 0.));
+    sigmaW[e] = (sigmaU[e] > 0) ? sx*sy*sqrt(1. - rho*rho)/sigmaU[e] : 0.;
   }
+  std::sort(order.begin(), order.end());
 
-  std::vector<Float_t> widthSC;
-  std::vector<Float_t> sumSC, subSC, midSC;
-  for(int i = 1; i < scBins+1; i++)
-  {
-    float mean = (scAxis->GetBinUpEdge(i) + scAxis->GetBinLowEdge(i))/2.;
-    float width = (scAxis->GetBinUpEdge(i) - scAxis->GetBinLowEdge(i))/2.;
+  SmearingTerms direct;
+  direct.fSumCC = terms.fSumCC; direct.fSubCC = terms.fSubCC; direct.fMidCC = terms.fMidCC;
+  direct.fSumSC = terms.fSumSC; direct.fSubSC = terms.fSubSC; direct.fMidSC = terms.fMidSC;
 
-    float sum = fFitScintCalibFunction->Eval(mean + width*0.7745966692414834);
-    float sub = fFitScintCalibFunction->Eval(mean - width*0.7745966692414834);
-    float mid = fFitScintCalibFunction->Eval(mean);
-    
-    sumSC.push_back(sum);
-    subSC.push_back(sub);
-    midSC.push_back(mid);
-    widthSC.push_back(width);
-  }
-  
-  // calculate bivariate gaussian energy variables 
-  std::vector<Float_t> normGauss, sigmaCC, sigmaSC, corrTerm;
-  std::vector<float> emcCC, emcSC;
-  
-  for(size_t e = 0; e < energy.size(); e++)
+  EXOGaussianSmearing smearing;
+  std::vector<double> ene, wgt;
+  size_t first = 0;
+  while(first < numEnergies)
   {
-    float eneX = energy[e].first;
-    float eneY = energy[e].second;
-    emcCC.push_back(eneX);
-    emcSC.push_back(eneY);
+    // Extend the segment while every width stays within the tolerance.
+    double low[4] = {0., 0., 0., 0.};
+    double high[4] = {0., 0., 0., 0.};
+    size_t last = first;
+    for(; last < numEnergies; last++)
+    {
+      size_t e = order[last].second;
+      double widths[4] = {terms.fResolCC[e], terms.fResolSC[e], sigmaU[e], sigmaW[e]};
+      bool inside = true;
+      for(int k = 0; k < 4 && last > first; k++)
+      {
+        double l = std::min(low[k], widths[k]);
+        double h = std::max(high[k], widths[k]);
+        if(h - l > fFFTSmearingTolerance*(h + l))
+          inside = false;
+      }
+      if(!inside)
+        break;
+      for(int k = 0; k < 4; k++)
+      {
+        low[k] = (last > first) ? std::min(low[k], widths[k]) : widths[k];
+        high[k] = (last > first) ? std::max(high[k], widths[k]) : widths[k];
+      }
+    }
 
-    float tempCC = fFitIonizResolFunction->Eval(eneX);
-    float tempSC = fFitScintResolFunction->Eval(eneY);
-    float tempCorr = fFitCorrelationFunction->Eval(eneX);//Y); eneX = energy_mc is what we've been using to represent the rotated energy
-    
-    float tempCorr2 = tempCorr*tempCorr;
+    if(last - first < minSegment || !(std::min(low[2], low[3]) > 0))
+    {
+      for(size_t k = first; k < last; k++)
+      {
+        size_t e = order[k].second;
+        direct.fEnergyCC.push_back(terms.fEnergyCC[e]);
+        direct.fEnergySC.push_back(terms.fEnergySC[e]);
+        direct.fNormXPdf.push_back(terms.fNormXPdf[e]);
+        direct.fSigmaCC.push_back(terms.fSigmaCC[e]);
+        direct.fSigmaSC.push_back(terms.fSigmaSC[e]);
+        direct.fCorr.push_back(terms.fCorr[e]);
+        direct.fLimit.push_back(terms.fLimit[e]);
+      }
+      first = last;
+      continue;
+    }
 
-    if(tempCorr2 >= 1)
+    // The widths of the middle energy stand for the segment.
+    size_t mid = order[(first + last)/2].second;
+    double sx = terms.fResolCC[mid];
+    double sy = terms.fResolSC[mid];
+    double rho = terms.fCorr[mid]/2.;
+    double sU = sigmaU[mid];
+    double sW = sigmaW[mid];
+    double beta = (sx*sx - rho*sx*sy)/(sU*sU);
+    double limitU = 8.*sU;
+    double normU = 0.3989422804014327/sU/0.0001984127; // in the units of FastExp
+
+    ene.clear();
+    wgt.clear();
+    for(size_t k = first; k < last; k++)
     {
-      //std::cout << "Correlation is set to greater than 1, please set limits to the correlation fitting function!\n";
-      //exit(1);
-      //std::cout << "Correlation is set to greater than 1, will use maximum correlation!\n";
-      //tempCorr = tempCorr > 0 ? 0.99999 : -0.99999;
-      //tempCorr2 = tempCorr*tempCorr;
+      ene.push_back(order[k].first);
+      wgt.push_back(pdf[order[k].second]);
+    }
+    smearing.Smear(&ene[0], &wgt[0], ene.size(), sW, sW*sqrt(fFFTSmearingTolerance), false);
+    double lowX = smearing.GetLow() - std::fabs(beta)*limitU;
+    double highX = smearing.GetHigh() + std::fabs(beta)*limitU;
 
-      std::cout << "Correlation is set to greater than 1, MC bin contents set to minimum!\n";
-      // set histo bin contents
-      for(int i = 1; i < ccBins+1; i++)
+    for(size_t i = 0; i < ccBins; i++)
+    {
+      float x[3] = {terms.fSumCC[i], terms.fMidCC[i], terms.fSubCC[i]};
+      if(std::max(x[0], std::max(x[1], x[2])) < lowX || std::min(x[0], std::min(x[1], x[2])) > highX)
+        continue;
+      float* row = &content[scBins*i];
+      for(size_t j = 0; j < scBins; j++)
       {
-        for(int j = 1; j < scBins+1; j++)
+        float y[3] = {terms.fSumSC[j], terms.fMidSC[j], terms.fSubSC[j]};
+        double sum = 0.;
+        for(int q = 0; q < 3; q++)
         {
-          histo.SetBinContent(i,j,0.);
+          for(int r = 0; r < 3; r++)
+          {
+            double u = x[q] - y[r];
+            if(std::fabs(u) > limitU)
+              continue;
+            sum += qWeight[q]*qWeight[r]*exp(-0.5*u*u/(sU*sU))*smearing.Evaluate(x[q] - beta*u);
+          }
         }
-      }      
-      histo.SetEntries(histo.Integral(1,histo.GetNbinsX(),1,histo.GetNbinsY()));
-      return ;
-
-    }
-    
-    if(!std::isfinite(tempCC) || !std::isfinite(tempSC) || !std::isfinite(tempCorr))
-    {
-      std::cout << "Resolution functions diverge. Quitting...\n";
-      exit(1);
+        row[j] += sum*normU;
+      }
     }
-      
-    float tempSqrt = sqrt(2.*(1-tempCorr2));
+    first = last;
+  }
 
-    normGauss.push_back(0.225079079039277f / tempCC / tempSC / tempSqrt);
-    sigmaCC.push_back(1. / tempCC / tempSqrt);
-    sigmaSC.push_back(1. / tempSC / tempSqrt);
-    corrTerm.push_back(2.*tempCorr);
+  if(!direct.fEnergyCC.empty())
+  {
+    FindSmearingWindows(direct);
+    SmearMCEnergies(direct,content);
   }
+}
 
-  // main loop, fill bins with contribution from each energy
-  for(size_t e = 0; e < energy.size(); e++)
+void EXOEnergyMCBasedFit2D::FindSmearingWindows(SmearingTerms& terms) const
+{
+  // For each MC energy, find the first and last ionization and scintillation
+  // bins within fSmearingWindow sigmas of it.  In the scaled variables of
+  // GaussTerm2, x = (E_bin - E)/(sigma*sqrt(2(1-rho^2))), and whatever y is
+  // the exponent is at most -x^2(1-rho^2) = -(E_bin - E)^2/(2 sigma^2).
+  // Beyond sqrt(50) sigmas this is below -25, where FastExp returns 0, so
+  // any window larger than that leaves the histogram unchanged.
+  size_t numEnergies = terms.fEnergyCC.size();
+  terms.fFirstCC.assign(numEnergies, 0);
+  terms.fLastCC.assign(numEnergies, terms.fSumCC.size());
+  terms.fFirstSC.assign(numEnergies, 0);
+  terms.fLastSC.assign(numEnergies, terms.fSumSC.size());
+  if(fSmearingWindow <= 0)
+    return;
+
+  for(size_t e = 0; e < numEnergies; e++)
+  {
+    FindSmearingWindow(terms.fSumCC, terms.fSubCC, terms.fMidCC, terms.fEnergyCC[e], terms.fSigmaCC[e], terms.fLimit[e], terms.fFirstCC[e], terms.fLastCC[e]);
+    FindSmearingWindow(terms.fSumSC, terms.fSubSC, terms.fMidSC, terms.fEnergySC[e], terms.fSigmaSC[e], terms.fLimit[e], terms.fFirstSC[e], terms.fLastSC[e]);
+  }
+}
+
+void EXOEnergyMCBasedFit2D::FindSmearingWindow(const std::vector<Float_t>& sum, const std::vector<Float_t>& sub, const std::vector<Float_t>& mid, float ene, float sigma, float limit, size_t& first, size_t& last)
+{
+  // Bins [first, last) cover all bins with a quadrature point within limit
+  // of ene in scaled units.  The calibration need not be monotonic, so all
+  // bins are checked.
+  first = last = 0;
+  bool found = false;
+  for(size_t i = 0; i < sum.size(); i++)
+  {
+    float p = std::fabs((sum[i]-ene)*sigma);
+    float m = std::fabs((sub[i]-ene)*sigma);
+    float c = std::fabs((mid[i]-ene)*sigma);
+    if(std::min(p,std::min(m,c)) > limit)
+      continue;
+    if(!found)
+      first = i;
+    found = true;
+    last = i+1;
+  }
+}
+
+void EXOEnergyMCBasedFit2D::SmearMCEnergies(const SmearingTerms& terms, std::vector<float>& content)
+{
+  // Split the ionization bins (rows of content) between fNumThreads threads.
+  // Every bin is filled by one thread, adding the MC energies in the same
+  // order as a single thread would, so the result does not depend on the
+  // number of threads.
+#ifdef USE_THREADS
+  size_t numThreads = std::max(size_t(1), std::min(size_t(std::max(fNumThreads, 1)), terms.fSumCC.size()));
+  boost::thread_group threads;
+  for(size_t t = 1; t < numThreads; t++)
+    threads.create_thread(boost::bind(&EXOEnergyMCBasedFit2D::SmearRows, this, boost::cref(terms), boost::ref(content), t, numThreads));
+  SmearRows(terms,content,0,numThreads);
+  threads.join_all();
+#else
+  SmearRows(terms,content,0,1);
+#endif
+}
+
+void EXOEnergyMCBasedFit2D::SmearRows(const SmearingTerms& terms, std::vector<float>& content, size_t firstRow, size_t rowStep)
+{
+  // Fill rows firstRow, firstRow + rowStep, ... of content with the
+  // contribution of each MC energy within its window.
+  size_t scBins = terms.fSumSC.size();
+  std::vector<float> scaledSC(3*scBins);
+  float* pSC = &scaledSC[0];
+  float* mSC = pSC + scBins;
+  float* cSC = mSC + scBins;
+
+  for(size_t e = 0; e < terms.fEnergyCC.size(); e++)
   {
-    float eneCC = emcCC[e];
-    float eneSC = emcSC[e];
-    float corr = corrTerm[e];
-    float sigmai = sigmaCC[e];
-    float sigmaj = sigmaSC[e];  
-    float normXpdf = normGauss[e]*pdf[e];
+    size_t firstCC = terms.fFirstCC[e];
+    size_t lastCC = terms.fLastCC[e];
+    size_t firstSC = terms.fFirstSC[e];
+    size_t lastSC = terms.fLastSC[e];
+    if(firstCC >= lastCC || firstSC >= lastSC)
+      continue;
+
+    float eneCC = terms.fEnergyCC[e];
+    float eneSC = terms.fEnergySC[e];
+    float corr = terms.fCorr[e];
+    float sigmai = terms.fSigmaCC[e];
+    float sigmaj = terms.fSigmaSC[e];
+    float normXpdf = terms.fNormXPdf[e];
+
+    for(size_t j = firstSC; j < lastSC; j++)
+    {
+      pSC[j] = (terms.fSumSC[j]-eneSC)*sigmaj;
+      mSC[j] = (terms.fSubSC[j]-eneSC)*sigmaj;
+      cSC[j] = (terms.fMidSC[j]-eneSC)*sigmaj;
+    }
 
-    for(int i = 0; i < ccBins; i++)
+    size_t i = firstRow;
+    if(firstCC > firstRow)
+      i += ((firstCC - firstRow + rowStep - 1)/rowStep)*rowStep;
+    for(; i < lastCC; i += rowStep)
     {
-      float sumi = sumCC[i];
-      float subi = subCC[i];
-      float midi = midCC[i];
-      
-      float pi = (sumi-eneCC)*sigmai;
-      float mi = (subi-eneCC)*sigmai;
-      float ci = (midi-eneCC)*sigmai;
+      float pi = (terms.fSumCC[i]-eneCC)*sigmai;
+      float mi = (terms.fSubCC[i]-eneCC)*sigmai;
+      float ci = (terms.fMidCC[i]-eneCC)*sigmai;
+      float* row = &content[scBins*i];
 
-      for(int j = 0; j < scBins; j++)
+      for(size_t j = firstSC; j < lastSC; j++)
       {
-        float subj = subSC[j];
-        float sumj = sumSC[j];
-        float midj = midSC[j];        
-
-        float pj = (sumj-eneSC)*sigmaj;
-        float mj = (subj-eneSC)*sigmaj;
-        float cj = (midj-eneSC)*sigmaj;
+        float pj = pSC[j];
+        float mj = mSC[j];
+        float cj = cSC[j];
 
-        float texpp = FastExp(GaussTerm2(pi,pj,corr));//exp(gaussTerm2(pi,pj,corr));
-        float texpm = FastExp(GaussTerm2(pi,mj,corr));//exp(gaussTerm2(pi,mj,corr));
-        float texpc = FastExp(GaussTerm2(pi,cj,corr));//exp(gaussTerm2(pi,cj,corr));
+        float texpp = FastExp(GaussTerm2(pi,pj,corr));
+        float texpm = FastExp(GaussTerm2(pi,mj,corr));
+        float texpc = FastExp(GaussTerm2(pi,cj,corr));
 
-        float texcp = FastExp(GaussTerm2(ci,pj,corr));//exp(gaussTerm2(ci,pj,corr));
-        float texcm = FastExp(GaussTerm2(ci,mj,corr));//exp(gaussTerm2(ci,mj,corr));
-        float texcc = FastExp(GaussTerm2(ci,cj,corr));//exp(gaussTerm2(ci,cj,corr));
+        float texcp = FastExp(GaussTerm2(ci,pj,corr));
+        float texcm = FastExp(GaussTerm2(ci,mj,corr));
+        float texcc = FastExp(GaussTerm2(ci,cj,corr));
 
-        float texmp = FastExp(GaussTerm2(mi,pj,corr));//exp(gaussTerm2(mi,pj,corr));
-        float texmm = FastExp(GaussTerm2(mi,mj,corr));//exp(gaussTerm2(mi,mj,corr));
-        float texmc = FastExp(GaussTerm2(mi,cj,corr));//exp(gaussTerm2(mi,cj,corr));
+        float texmp = FastExp(GaussTerm2(mi,pj,corr));
+        float texmm = FastExp(GaussTerm2(mi,mj,corr));
+        float texmc = FastExp(GaussTerm2(mi,cj,corr));
 
         float sum = 0.308641975308f*(texpp + texpm + texmp + texmm) + 0.493827160493f*(texpc + texcp + texcm + texmc) + 0.79012345679f*texcc;
         
-        content[j + scBins*i] += sum*normXpdf;
+        row[j] += sum*normXpdf;
       }
     }
   }
-
-  // set histo bin contents
-  for(int i = 1; i < ccBins+1; i++)
-  {
-    float widthi = widthCC[i-1];
-    for(int j = 1; j < scBins+1; j++){
-      //std::cout << i << " " << j << " " << content[(j-1)+scBins*(i-1)] << std::endl;
-      float widthj = widthSC[j-1];
-      float correction = widthi*widthj*0.0001984127f;
-      histo.SetBinContent(i,j,content[(j-1)+scBins*(i-1)]*correction);//0.0083333333f);
-    }
-  }
-
-  histo.SetEntries(histo.Integral(1,histo.GetNbinsX(),1,histo.GetNbinsY()));
-  
-  return ;
 }
 
 
@@ -693,6 +791,9 @@ bool EXOEnergyMCBasedFit2D::BuildFitter()
   fFitter = new TFitter(fNpar);
   fFitter->GetMinuit()->SetPrintLevel(fVerboseLevel);
   fFitter->SetFCN(&EXOEnergyMCBasedFitBase::Fcn);
+  fGradientFit = NULL;
+  if(fUseAnalyticGradient)
+    std::cout << "The analytic gradient is not available for the 2D fit, using finite differences...\n";
     
   DefineInitialParameters();
 
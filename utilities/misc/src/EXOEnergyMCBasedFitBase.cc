@@ -1,11 +1,20 @@
 #include "EXOUtilities/EXOEnergyMCBasedFitBase.hh"
+#include "EXOUtilities/EXOAtomicFile.hh"
+#include "EXOUtilities/EXOHash.hh"
+#include <cstdio>
+#ifdef USE_THREADS
+#include "boost/thread/thread.hpp"
+#include "boost/bind.hpp"
+#endif
 
 ClassImp(EXOEnergyMCBasedFitBase)
 
 ROOT::Math::IMultiGenFunction* EXOEnergyMCBasedFitBase::fFCN;
+EXOEnergyMCBasedFitBase* EXOEnergyMCBasedFitBase::fGradientFit = NULL;
 
 EXOEnergyMCBasedFitBase::~EXOEnergyMCBasedFitBase()
 {
+  if(fGradientFit == this) fGradientFit = NULL;
   if(fFitter) delete fFitter;
   if(fCov) delete fCov;
   if(fChol) delete fChol;
@@ -45,6 +54,11 @@ void EXOEnergyMCBasedFitBase::Initialize()
 
   fDimension = 0;
   fAllFitCalculations = true;
+  fUseFFTSmearing = false;
+  fFFTSmearingTolerance = 0.01;
+  fMCCacheDirectory = "";
+  fNumThreads = 1;
+  fUseAnalyticGradient = false;
   fFitType = 0;
   fNpar = 0;
 
@@ -64,9 +78,13 @@ void EXOEnergyMCBasedFitBase::Initialize()
   return;
 }
 
-void EXOEnergyMCBasedFitBase::Fcn(int &, double *, double &f, double *x, int /* iflag */)
+void EXOEnergyMCBasedFitBase::Fcn(int &, double *gin, double &f, double *x, int iflag)
 {
-  f = fFCN->operator()(x);
+  // Minuit asks for the gradient with iflag = 2, after SET GRAdient.
+  if(iflag == 2 && fGradientFit)
+    f = fGradientFit->FitFunctionGradient(x,gin);
+  else
+    f = fFCN->operator()(x);
 }
 
 void EXOEnergyMCBasedFitBase::SetVerboseLevel(Int_t level)
@@ -166,88 +184,329 @@ const TH1* EXOEnergyMCBasedFitBase::GetHisto(const TString list, const TString i
 
 void EXOEnergyMCBasedFitBase::BinMCEnergy(Int_t gran, std::string mcId, Double_t cutoff) // granularity = 1/gran keV
 {
+  // Bin the energies of the MC entries, reading the binning from the cache
+  // when there is one, with the entries split between fNumThreads threads.
+  // A cached binning is only used if it was made from as many points, with
+  // the same sum of weights, as the entry holds; otherwise it is replaced.
+  std::vector<MCEntry*> toBin;
+  std::vector<bool> toSave; // Binned from the original energies, with a key
+  std::vector<ULong64_t> rawPoints;
+  std::vector<Double_t> rawWeights;
   for(std::map<TString, MCEntry>::iterator mcEntry = fMCList.begin(); mcEntry != fMCList.end(); mcEntry++)
   {
     if(mcId != "all" && mcId != mcEntry->first)
       continue;
     
     MCEntry &mc = mcEntry->second;
-
+    if(mc.BinnedGran == gran && mc.BinnedCutoff == cutoff)
+      continue;
+    if(mc.BinnedGran == 0 && !mc.CacheKey.empty() && ReadBinnedMC(mc, mc.CacheKey, mc.Is2D, gran, cutoff, true))
+    {
+      if(fVerboseLevel > 0)
+        std::cout << "Binned MC " << mcEntry->first << " read from " << GetMCCacheFile(mc.CacheKey, mc.Is2D, gran, cutoff) << std::endl;
+      continue;
+    }
     if(mc.Is2D)
     {
       if(mc.MCEnergyPoints2D.empty())
         continue;
-
       std::cout << "Length before binning: " << mc.MCEnergyPoints2D.size() << std::endl;
-      
-      std::vector<Double_t> eneX;
-      std::vector<Double_t> eneY;
-      for(std::vector<std::pair<Double_t, Double_t> >::iterator energy = mc.MCEnergyPoints2D.begin(); energy != mc.MCEnergyPoints2D.end();  energy++)
-      {
-        eneX.push_back(energy->first);
-        eneY.push_back(energy->second);
-      }
+    }
+    else if(mc.MCEnergyPoints.empty())
+      continue;
+    toBin.push_back(&mc);
+    toSave.push_back(mc.BinnedGran == 0 && !mc.CacheKey.empty());
+    rawPoints.push_back(0);
+    rawWeights.push_back(0);
+    SummarizeMC(mc, rawPoints.back(), rawWeights.back());
+  }
+
+#ifdef USE_THREADS
+  size_t numThreads = std::max(size_t(1), std::min(size_t(std::max(fNumThreads, 1)), toBin.size()));
+  boost::thread_group threads;
+  for(size_t t = 1; t < numThreads; t++)
+    threads.create_thread(boost::bind(&EXOEnergyMCBasedFitBase::BinEntries, boost::ref(toBin), gran, cutoff, t, numThreads));
+  BinEntries(toBin, gran, cutoff, 0, numThreads);
+  threads.join_all();
+#else
+  BinEntries(toBin, gran, cutoff, 0, 1);
+#endif
+
+  for(size_t i = 0; i < toBin.size(); i++)
+  {
+    MCEntry &mc = *toBin[i];
+    if(mc.Is2D)
+      std::cout << "Length after binning: " << mc.MCEnergyPoints2D.size() << std::endl;
+    if(toSave[i] && !WriteBinnedMC(mc, rawPoints[i], rawWeights[i]))
+      std::cerr << "Could not save the binned MC in " << GetMCCacheFile(mc.CacheKey, mc.Is2D, gran, cutoff) << std::endl;
+  }
+  return;
+}
+
+void EXOEnergyMCBasedFitBase::BinEntries(std::vector<MCEntry*>& entries, Int_t gran, Double_t cutoff, size_t first, size_t step)
+{
+  for(size_t i = first; i < entries.size(); i += step)
+    BinEnergies(*entries[i], gran, cutoff);
+}
 
-      Double_t maxEnergyX = *std::max_element(eneX.begin(),eneX.end());
-      Int_t intMaxEnergyX = static_cast<int> (ceil(maxEnergyX));
-      //intMaxEnergyX = (intMaxEnergyX % 2 == 0) ? intMaxEnergyX: intMaxEnergyX+1;
-      Double_t maxEnergyY = *std::max_element(eneY.begin(),eneY.end());
-      Int_t intMaxEnergyY = static_cast<int> (ceil(maxEnergyY));
-      //intMaxEnergyY = (intMaxEnergyY % 2 == 0) ? intMaxEnergyY: intMaxEnergyY+1;
-
-      TH2D tempEnergy2D("tempEnergy2D","",intMaxEnergyX*gran,0,intMaxEnergyX,intMaxEnergyY*gran,0,intMaxEnergyY);
-      for(size_t i = 0; i < mc.MCEnergyPoints2D.size(); i++)
-        tempEnergy2D.Fill(eneX.at(i),eneY.at(i),mc.MCEnergyPDF.at(i));
-
-      mc.MCEnergyPoints2D.clear();
-      mc.MCEnergyPDF.clear();
-      
-      for(int xb = 1; xb < tempEnergy2D.GetXaxis()->GetNbins()+1; xb++)
+void EXOEnergyMCBasedFitBase::BinEnergies(MCEntry& mc, Int_t gran, Double_t cutoff)
+{
+  // Replace the energies of mc by the centers of the bins of width 1/gran
+  // from 0 to the maximum energy, weighted by the sum of the weights in the
+  // bin.  This gives the same bins and contents (rounded to float) as
+  // filling a TH1D or TH2D, without the histograms, so that the entries can
+  // be binned in parallel.  1D bins are kept if their content is positive,
+  // 2D bins if it is above the cutoff.
+  if(mc.Is2D)
+  {
+    Double_t maxEnergyX = 0, maxEnergyY = 0;
+    for(size_t i = 0; i < mc.MCEnergyPoints2D.size(); i++)
+    {
+      if(i == 0 || mc.MCEnergyPoints2D[i].first > maxEnergyX)
+        maxEnergyX = mc.MCEnergyPoints2D[i].first;
+      if(i == 0 || mc.MCEnergyPoints2D[i].second > maxEnergyY)
+        maxEnergyY = mc.MCEnergyPoints2D[i].second;
+    }
+    Int_t intMaxEnergyX = static_cast<int> (ceil(maxEnergyX));
+    Int_t intMaxEnergyY = static_cast<int> (ceil(maxEnergyY));
+    Int_t nBinsX = intMaxEnergyX*gran;
+    Int_t nBinsY = intMaxEnergyY*gran;
+    Double_t widthX = Double_t(intMaxEnergyX)/Double_t(nBinsX);
+    Double_t widthY = Double_t(intMaxEnergyY)/Double_t(nBinsY);
+
+    // Sorting (bin, point) keeps the points of each bin in the order they
+    // would have been filled.
+    std::vector<std::pair<Long64_t, size_t> > bins;
+    bins.reserve(mc.MCEnergyPoints2D.size());
+    for(size_t i = 0; i < mc.MCEnergyPoints2D.size() && nBinsX > 0 && nBinsY > 0; i++)
+    {
+      Double_t x = mc.MCEnergyPoints2D[i].first;
+      Double_t y = mc.MCEnergyPoints2D[i].second;
+      if(x < 0 || !(x < intMaxEnergyX) || y < 0 || !(y < intMaxEnergyY))
+        continue;
+      Long64_t xb = int(nBinsX*x/intMaxEnergyX);
+      Long64_t yb = int(nBinsY*y/intMaxEnergyY);
+      bins.push_back(std::make_pair(xb*nBinsY + yb, i));
+    }
+    std::sort(bins.begin(), bins.end());
+
+    std::vector<std::pair<Double_t,Double_t> > points;
+    std::vector<Double_t> pdf;
+    for(size_t i = 0; i < bins.size(); )
+    {
+      Long64_t bin = bins[i].first;
+      Double_t sum = 0;
+      for(; i < bins.size() && bins[i].first == bin; i++)
+        sum += mc.MCEnergyPDF.at(bins[i].second);
+      float content = sum;
+      if(content > cutoff)
       {
-        for(int yb = 1; yb < tempEnergy2D.GetYaxis()->GetNbins()+1; yb++)
-        {
-          float content = tempEnergy2D.GetBinContent(xb,yb);
-          if(content > cutoff)
-          {
-            mc.MCEnergyPoints2D.push_back(std::make_pair(tempEnergy2D.GetXaxis()->GetBinCenter(xb),tempEnergy2D.GetYaxis()->GetBinCenter(yb)));
-            mc.MCEnergyPDF.push_back(content);
-          }
-        }
+        Long64_t xb = bin/nBinsY, yb = bin%nBinsY;
+        points.push_back(std::make_pair(xb*widthX + 0.5*widthX, yb*widthY + 0.5*widthY));
+        pdf.push_back(content);
       }
-      std::cout << "Length after binning: " << mc.MCEnergyPoints2D.size() << std::endl;
-      //TFile ftemp("bin.root","RECREATE");
-      //tempEnergy2D.Write();
-      //ftemp.Close();
     }
-  
-    else
+    mc.MCEnergyPoints2D.swap(points);
+    mc.MCEnergyPDF.swap(pdf);
+  }
+  else
+  {
+    Double_t maxEnergy = *std::max_element(mc.MCEnergyPoints.begin(),mc.MCEnergyPoints.end());
+    Int_t intMaxEnergy = static_cast<int> (ceil(maxEnergy));
+    Int_t nBins = intMaxEnergy*gran;
+    Double_t width = Double_t(intMaxEnergy)/Double_t(nBins);
+
+    std::vector<Double_t> sum(std::max(nBins, 0), 0.);
+    for(size_t i = 0; i < mc.MCEnergyPoints.size() && nBins > 0; i++)
     {
-      if(mc.MCEnergyPoints.empty())
+      Double_t x = mc.MCEnergyPoints[i];
+      if(x < 0 || !(x < intMaxEnergy))
         continue;
-      
-      Double_t maxEnergy = *std::max_element(mc.MCEnergyPoints.begin(),mc.MCEnergyPoints.end());
-      Int_t intMaxEnergy = static_cast<int> (ceil(maxEnergy));
-  
-      TH1D tempEnergy("tempEnergy","",intMaxEnergy*gran,0,intMaxEnergy);
-      for(size_t i = 0; i < mc.MCEnergyPoints.size(); i++)
-        tempEnergy.Fill(mc.MCEnergyPoints.at(i),mc.MCEnergyPDF.at(i));
-      
-      mc.MCEnergyPoints.clear();
-      mc.MCEnergyPDF.clear();
-
-      for(int b = 1; b < tempEnergy.GetNbinsX()+1; b++)
+      sum[int(nBins*x/intMaxEnergy)] += mc.MCEnergyPDF.at(i);
+    }
+
+    mc.MCEnergyPoints.clear();
+    mc.MCEnergyPDF.clear();
+    for(Int_t b = 0; b < nBins; b++)
+    {
+      float content = sum[b];
+      if(content > 0)
       {
-        float content = tempEnergy.GetBinContent(b);
-        if(content > 0)
-        {
-          mc.MCEnergyPoints.push_back(tempEnergy.GetBinCenter(b));
-          mc.MCEnergyPDF.push_back(content);
-        }
+        mc.MCEnergyPoints.push_back(b*width + 0.5*width);
+        mc.MCEnergyPDF.push_back(content);
       }
     }
-    
-  }  
-  return;
+  }
+  mc.BinnedGran = gran;
+  mc.BinnedCutoff = cutoff;
+}
+
+bool EXOEnergyMCBasedFitBase::SetMCCacheKey(const char* mcId, const char* key)
+{
+  if(!fMCList.count(mcId))
+  {
+    std::cerr << "MC id " << mcId << " not found, cache key not set!\n";
+    return false;
+  }
+  fMCList[mcId].CacheKey = key;
+  return true;
+}
+
+bool EXOEnergyMCBasedFitBase::AddCachedMC(const char* mcId, const char* key, Int_t sourceAtomicNumber, Int_t sourceMassNumber, Float_t sourceX, Float_t sourceY, Float_t sourceZ, Bool_t is2D, Int_t gran, Double_t cutoff)
+{
+  // Returns false, without adding anything, if the binning is not in the
+  // cache; then add the MC as usual, with SetMCCacheKey, and BinMCEnergy
+  // will save it.  Without the MC points, the key is trusted to identify
+  // them.
+  if(fMCList.count(mcId))
+  {
+    std::cerr << "MC id already exists, given MC not added to the MC list!\n";
+    return false;
+  }
+
+  MCEntry newMCEntry;
+  newMCEntry.InitializeMembers(sourceAtomicNumber,sourceMassNumber,sourceX,sourceY,sourceZ);
+  if(!ReadBinnedMC(newMCEntry, key, is2D, gran, cutoff, false))
+    return false;
+
+  if(fVerboseLevel > 0)
+    std::cout << "Adding cached MC to MCList: " << mcId << std::endl;
+  fMCList[mcId] = newMCEntry;
+  return true;
+}
+
+namespace {
+  const char gfMCCacheMagic[8] = {'E','X','O','M','C','B','N','2'};
+
+  struct MCCacheHeader
+  {
+    char fMagic[8];
+    UInt_t fKeyLength;
+    Int_t fIs2D;
+    Int_t fGran;
+    Double_t fCutoff;
+    ULong64_t fNumPoints;
+    ULong64_t fNumRawPoints; // Of the MC entry the binning was made from
+    Double_t fRawWeightSum;
+  };
+}
+
+void EXOEnergyMCBasedFitBase::SummarizeMC(const MCEntry& mc, ULong64_t& numPoints, Double_t& weightSum)
+{
+  numPoints = mc.MCEnergyPDF.size();
+  weightSum = 0;
+  for(size_t i = 0; i < mc.MCEnergyPDF.size(); i++)
+    weightSum += mc.MCEnergyPDF[i];
+}
+
+std::string EXOEnergyMCBasedFitBase::GetMCCacheFile(const std::string& key, bool is2D, Int_t gran, Double_t cutoff) const
+{
+  // The file is named after a hash of what the binning depends on; the
+  // file header repeats it, in case of collisions.
+  ULong64_t hash = EXOHash::FNV1a(EXOHash::FNV1aBasis(), key);
+  Int_t dim = is2D ? 2 : 1;
+  hash = EXOHash::FNV1a(hash, &dim, sizeof(dim));
+  hash = EXOHash::FNV1a(hash, &gran, sizeof(gran));
+  hash = EXOHash::FNV1a(hash, &cutoff, sizeof(cutoff));
+  return fMCCacheDirectory + "/" + Form("%016llx.mcbin", (unsigned long long) hash);
+}
+
+bool EXOEnergyMCBasedFitBase::ReadBinnedMC(MCEntry& mc, const std::string& key, bool is2D, Int_t gran, Double_t cutoff, bool checkRaw) const
+{
+  // Replace the energies of mc by the cached binning.  With checkRaw, mc
+  // holds the unbinned energies, and the binning must have been made from
+  // as many points with the same sum of weights.
+  if(fMCCacheDirectory.empty())
+    return false;
+  FILE* file = fopen(GetMCCacheFile(key, is2D, gran, cutoff).c_str(), "rb");
+  if(!file)
+    return false;
+
+  MCCacheHeader header;
+  std::vector<char> fileKey;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+            std::equal(gfMCCacheMagic, gfMCCacheMagic + 8, header.fMagic) &&
+            header.fKeyLength == key.size() &&
+            header.fIs2D == Int_t(is2D) && header.fGran == gran && header.fCutoff == cutoff;
+  if(ok && checkRaw)
+  {
+    ULong64_t numRawPoints;
+    Double_t rawWeightSum;
+    SummarizeMC(mc, numRawPoints, rawWeightSum);
+    ok = header.fNumRawPoints == numRawPoints && header.fRawWeightSum == rawWeightSum;
+  }
+  if(ok)
+  {
+    fileKey.resize(key.size() + 1);
+    ok = fread(&fileKey[0], 1, key.size(), file) == key.size() && key == &fileKey[0];
+  }
+
+  // Energies (x, then y in 2D), then weights.
+  size_t n = ok ? header.fNumPoints : 0;
+  std::vector<Double_t> x(n), y(is2D ? n : 0), pdf(n);
+  if(ok && n > 0)
+    ok = fread(&x[0], sizeof(Double_t), n, file) == n &&
+         (!is2D || fread(&y[0], sizeof(Double_t), n, file) == n) &&
+         fread(&pdf[0], sizeof(Double_t), n, file) == n;
+  fclose(file);
+  if(!ok)
+    return false;
+
+  mc.Is2D = is2D;
+  mc.MCEnergyPoints.clear();
+  mc.MCEnergyPoints2D.clear();
+  if(is2D)
+    for(size_t i = 0; i < n; i++)
+      mc.MCEnergyPoints2D.push_back(std::make_pair(x[i], y[i]));
+  else
+    mc.MCEnergyPoints.swap(x);
+  mc.MCEnergyPDF.swap(pdf);
+  mc.CacheKey = key;
+  mc.BinnedGran = gran;
+  mc.BinnedCutoff = cutoff;
+  return true;
+}
+
+bool EXOEnergyMCBasedFitBase::WriteBinnedMC(const MCEntry& mc, ULong64_t numRawPoints, Double_t rawWeightSum) const
+{
+  if(fMCCacheDirectory.empty())
+    return true;
+  std::string filename = GetMCCacheFile(mc.CacheKey, mc.Is2D, mc.BinnedGran, mc.BinnedCutoff);
+
+  MCCacheHeader header;
+  std::copy(gfMCCacheMagic, gfMCCacheMagic + 8, header.fMagic);
+  header.fKeyLength = mc.CacheKey.size();
+  header.fIs2D = mc.Is2D;
+  header.fGran = mc.BinnedGran;
+  header.fCutoff = mc.BinnedCutoff;
+  header.fNumPoints = mc.MCEnergyPDF.size();
+  header.fNumRawPoints = numRawPoints;
+  header.fRawWeightSum = rawWeightSum;
+
+  size_t n = mc.MCEnergyPDF.size();
+  std::vector<Double_t> x(n), y(mc.Is2D ? n : 0);
+  for(size_t i = 0; i < n; i++)
+  {
+    if(mc.Is2D)
+    {
+      x[i] = mc.MCEnergyPoints2D[i].first;
+      y[i] = mc.MCEnergyPoints2D[i].second;
+    }
+    else
+      x[i] = mc.MCEnergyPoints[i];
+  }
+
+  EXOAtomicFile out(filename);
+  FILE* file = out.GetFile();
+  if(!file)
+    return false;
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(mc.CacheKey.c_str(), 1, mc.CacheKey.size(), file) == mc.CacheKey.size();
+  if(ok && n > 0)
+    ok = fwrite(&x[0], sizeof(Double_t), n, file) == n &&
+         (!mc.Is2D || fwrite(&y[0], sizeof(Double_t), n, file) == n) &&
+         fwrite(&mc.MCEnergyPDF[0], sizeof(Double_t), n, file) == n;
+  return out.Commit(ok);
 }
 
 Int_t EXOEnergyMCBasedFitBase::GetNumberOfFreeParameters()
@@ -323,6 +582,36 @@ double EXOEnergyMCBasedFitBase::FitFunction(const double* x)
   return 0.;
 }
 
+double EXOEnergyMCBasedFitBase::FitFunctionGradient(const double* x, double* grad)
+{
+  // Fits without an analytic gradient never set fGradientFit.
+  for(Int_t p = 0; p < fNpar; p++)
+    grad[p] = 0;
+  return FitFunction(x);
+}
+
+std::vector<Int_t> EXOEnergyMCBasedFitBase::GetFitParameterIndices(const TF1* function) const
+{
+  // Index among the fit parameters of each parameter of function, -1 if it
+  // is fixed or function is not fitted; as in SetFitFunctionParameters.
+  std::vector<Int_t> indices(function ? function->GetNpar() : 0, -1);
+  Int_t fitP = 0;
+  for(std::vector<TF1*>::const_iterator fitFunction = fFitFunctions.begin(); fitFunction != fFitFunctions.end(); fitFunction++)
+  {
+    for(Int_t p = 0; p < (*fitFunction)->GetNpar(); p++)
+    {
+      Double_t pMin(0), pMax(0);
+      (*fitFunction)->GetParLimits(p,pMin,pMax);
+      if((pMin != 0 || pMax != 0) && (pMin == pMax)) // pMin == pMax -> fixed parameter, unless if they are both zero's
+        continue;
+      if(*fitFunction == function)
+        indices[p] = fitP;
+      fitP++;
+    }
+  }
+  return indices;
+}
+
 double EXOEnergyMCBasedFitBase::GetErrorDef(double delta)
 {
   double errorDef = 0.;
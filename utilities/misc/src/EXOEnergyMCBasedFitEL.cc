@@ -28,6 +28,22 @@ bool EXOEnergyMCBasedFitEL::SmearedMCHistoCalib(std::vector<double>& e_up, doubl
   return true;
 }
 
+bool EXOEnergyMCBasedFitEL::SmearedMCHistoCalibGradient(std::vector<double>& gradient, const TH1D& histo)
+{
+  std::string zTitle = histo.GetTitle();
+  size_t pos = zTitle.find("Z = ");
+  std::string zVal = zTitle.substr(pos+4);
+  float z = atof(zVal.c_str());
+
+  int nPar = fFitCalibFunction->GetNpar();
+  gradient.assign((histo.GetNbinsX() + 1)*nPar, 0.);
+  for(int b = 0; b <= histo.GetNbinsX(); b++){
+    double point[2] = {(b == 0) ? histo.GetBinLowEdge(1) : histo.GetBinLowEdge(b) + histo.GetBinWidth(b), z};
+    fFitCalibFunction->GradientPar(point, &gradient[b*nPar]);
+  }
+  return true;
+}
+
 bool EXOEnergyMCBasedFitEL::AddMC(const char* mcId, Int_t sourceAtomicNumber, Int_t sourceMassNumber, Float_t sourceX, Float_t sourceY, Float_t sourceZ, Double_t *mcPoints, Double_t *mcWeights, Double_t *mcZpos, Int_t nMC)
 {
   if(fHasSplittedZbins)
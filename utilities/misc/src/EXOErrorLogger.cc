@@ -21,6 +21,18 @@
 //
 //   cout << EXOErrorLogger::GetLogger().GetSummary();
 //
+// In code that is called very often, and in particular where the message is
+// built with Form or a stringstream, use instead:
+//
+//   LogEXOMsgF(EEWarning, "V index off: %f", v);
+//   LogEXOMsgStream(EEWarning, "V index off: " << v);
+//
+// These keep a static record per call site instead of looking the message up
+// in a map.  The message is only built on the first call and when it gets
+// printed, so a message below the output threshold or one that is already
+// suppressed costs almost nothing.  Every call is still counted for the
+// summary, where each site is listed once with the first message it logged.
+//
 //______________________________________________________________________________
 
 #include "EXOUtilities/EXOErrorLogger.hh"
@@ -30,8 +42,13 @@
 #include <iomanip>
 #include <algorithm>
 #include <limits>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
 using namespace std;
 
+const int EXOErrorLogger::fCountMax = std::numeric_limits<int>::max();
+
 static char const * const EXOErrorLevelNames[] = { 
   "Ok", 
   "Debug", /*"EEInfo",*/ 
@@ -73,6 +90,20 @@ bool EXOErrorLogger::LoggedError::operator>(const EXOErrorLogger::LoggedError& r
   return (rhs < *this);
 }
 
+//______________________________________________________________________________
+EXOErrorLogger::LogSite::LogSite(const char* func, const char* afile, int aline,
+                                 EXOErrorLevel level) :
+fFunction(func),
+fFilename(afile),
+fLine(aline),
+fSeverity(level),
+fCount(0)
+{
+  // Strip the path once, rather than on every call.
+  const char* lastSlash = strrchr(afile, '/');
+  if (lastSlash) fFilename = lastSlash + 1;
+}
+
 //______________________________________________________________________________
 EXOErrorLogger::EXOErrorLogger() : 
   fPrintMax(10), 
@@ -88,8 +119,8 @@ EXOErrorLogger::~EXOErrorLogger()
   std::cout << GetSummary();
 }
 //______________________________________________________________________________
-void EXOErrorLogger::LogError(std::string CLASSNAME, std::string filename, int aline,
-			      std::string MESSAGE, EXOErrorLevel SEVERITY )
+void EXOErrorLogger::LogError(const std::string& CLASSNAME, const std::string& filename, int aline,
+			      const std::string& MESSAGE, EXOErrorLevel SEVERITY )
 {
   // Log a message.  Users should consider instead using the macro:
   //
@@ -106,7 +137,7 @@ void EXOErrorLogger::LogError(std::string CLASSNAME, std::string filename, int a
   ErrSet::iterator iter = fErrors.find(err);
   
   if ( iter != fErrors.end() ) {
-    if(iter->second == std::numeric_limits<int>::max()) LogEXOMsg("OVERFLOW in EXOErrorLogger.", EEAlert);
+    if(iter->second == fCountMax) LogOverflow();
     if (iter->second < fPrintMax && iter->first.fSeverity >= fThreshold) {
       PrintError(iter->first);
       if ( iter->second == fPrintMax - 1 ) {
@@ -126,6 +157,56 @@ void EXOErrorLogger::LogError(std::string CLASSNAME, std::string filename, int a
   fErrors[err] = 1;
 
 }
+//______________________________________________________________________________
+void EXOErrorLogger::LogSiteMessage(LogSite& site, const std::string& msg)
+{
+  // Log a message from a call site of LogEXOMsgF or LogEXOMsgStream, for which
+  // CountOrFormat returned true.  The first message from a site is kept for
+  // the summary.
+
+  if (site.fCount == 0) {
+    fSites.push_back(&site);
+    fSiteMessages.push_back(msg);
+  }
+  if (site.fCount == fCountMax) LogOverflow();
+  site.fCount++;
+  if (site.fSeverity < fThreshold or site.fCount > fPrintMax) return;
+
+  PrintError(LoggedError(site.fFunction, site.fFilename, site.fLine, msg, site.fSeverity));
+  if (site.fCount == fPrintMax) {
+    std::cout << "Suppressing further output of this error" << std::endl;
+  }
+}
+
+//______________________________________________________________________________
+void EXOErrorLogger::LogFormatted(LogSite& site, const char* format, ...)
+{
+  // Format a printf-style message and log it; see LogSiteMessage.
+  char buffer[1024];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  LogSiteMessage(site, buffer);
+}
+
+//______________________________________________________________________________
+void EXOErrorLogger::LogOverflow()
+{
+  LogEXOMsg("OVERFLOW in EXOErrorLogger.", EEAlert);
+}
+
+//______________________________________________________________________________
+void EXOErrorLogger::ClearOutputRecord()
+{
+  // Forget all messages logged until now.
+  EXOErrorLogger& me = GetLogger();
+  me.fErrors.clear();
+  for (size_t i = 0; i < me.fSites.size(); i++) me.fSites[i]->fCount = 0;
+  me.fSites.clear();
+  me.fSiteMessages.clear();
+}
+
 //______________________________________________________________________________
 std::string EXOErrorLogger::GetSummary(bool Suppress) const
 {
@@ -170,9 +251,29 @@ std::string EXOErrorLogger::GetSummary(bool Suppress) const
       Stream << setfill(' ') << setw(outputWidth/2 - 1) << " " 
              << "--" << std::endl;
     }
+    for (size_t i = 0; i < fSites.size(); i++) {
+      const LogSite& site = *fSites[i];
+      if ( site.fSeverity != level ) continue;
+      didPrintOut = true;
+      if (firstTime) {
+          Stream << setfill(' ') << setw(levelWidth) 
+                 << left << ErrorLevel(site.fSeverity) << std::endl;
+          firstTime = false;
+      }
+      Stream << setw(levelWidth+descWidth) << right 
+             << "Calls: " << site.fCount << std::endl 
+             << setw(levelWidth+descWidth) << right 
+             << "Function: " << site.fFunction << std::endl 
+             << setw(levelWidth+descWidth) << right 
+             << "Location: " << site.fFilename << ":" << site.fLine << std::endl 
+             << setw(levelWidth+descWidth) << right 
+             << "Message: " << fSiteMessages[i] << std::endl; 
+      Stream << setfill(' ') << setw(outputWidth/2 - 1) << " " 
+             << "--" << std::endl;
+    }
   }
 
-  if ( fErrors.size() == 0 ) Stream << "No errors or messages reported" << std::endl;
+  if ( fErrors.size() == 0 and fSites.size() == 0 ) Stream << "No errors or messages reported" << std::endl;
   else if ( not didPrintOut ) Stream << "Some suppressed errors/messages seen" << std::endl;
 
   Stream << setfill('-') << setw(outputWidth) << "-" << std::endl;
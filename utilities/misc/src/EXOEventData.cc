@@ -290,6 +290,8 @@ void EXOEventData::Clear( Option_t* /*option*/ )
 
   fHasSaturatedChannel = false;
   fSkippedByClustering = false;
+  fReconProvenance.clear();
+  fReconStageSignals.clear();
   fNoiseTags.ResetAllBits();
 }
 
@@ -314,6 +316,8 @@ EXOEventData::EXOEventData(const EXOEventData& other) : TObject(other)
   fWaveformData = other.fWaveformData;
   fHasSaturatedChannel = other.fHasSaturatedChannel;
   fSkippedByClustering = other.fSkippedByClustering;
+  fReconProvenance = other.fReconProvenance;
+  fReconStageSignals = other.fReconStageSignals;
   fNoiseTags = other.fNoiseTags;
 }
 //______________________________________________________________________________
@@ -337,6 +341,8 @@ EXOEventData& EXOEventData::operator=(const EXOEventData& other)
   fWaveformData = other.fWaveformData;
   fHasSaturatedChannel = other.fHasSaturatedChannel;
   fSkippedByClustering = other.fSkippedByClustering;
+  fReconProvenance = other.fReconProvenance;
+  fReconStageSignals = other.fReconStageSignals;
   fNoiseTags = other.fNoiseTags;
 
   return *this;
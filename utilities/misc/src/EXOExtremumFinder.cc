@@ -5,7 +5,8 @@
 // DESCRIPTION: 
 //
 // A class finding the extremum of a waveform.  One can also call FindExtremum
-// directly.  Access to the extremum is through the access functions
+// directly, or
+// FindExtremum(wf, point, value) from several threads.  Access to the extremum is through the access functions
 // GetTheExtremumValue() and GetTheExtremumPoint().  Originally in the MGDO
 // framework written by M. Marino, ported to EXOUtilities by M. Marino
 //
@@ -52,26 +53,36 @@ void EXOExtremumFinder::FindExtremum(const EXODoubleWaveform& wf) const
   // overload this to provide a more sophisticated method to find the extremum
   // value of a waveform. 
 
+  FindExtremum(wf, fTheExtremumPoint, fTheExtremumValue);
+}
+
+//______________________________________________________________________________
+void EXOExtremumFinder::FindExtremum(const EXODoubleWaveform& wf,
+                                     size_t& point, double& value) const
+{
+  // Find the extremum of wf and return it in point and value; the finder is
+  // not modified.  wf must not be empty.
+
   // FIXME: should probably use EXOWaveformRegion.
   size_t locMaxStep = (fLocMaxTime == 0.0) ? wf.GetLength()
                       : (size_t) wf.GetIndexAtTime(fLocMaxTime);
   size_t locMinStep = (size_t) wf.GetIndexAtTime(fLocMinTime);
   
   //set the extremum to be at the first point to be tested
-  fTheExtremumPoint = locMinStep;
-  fTheExtremumValue = wf.At(locMinStep);
+  point = locMinStep;
+  value = wf.At(locMinStep);
   if (fFindMaximum) {
     for(size_t i=locMinStep;i<locMaxStep;i++) {
-      if(wf.At(i) > fTheExtremumValue) {
-        fTheExtremumPoint = i;
-        fTheExtremumValue = wf.At(i);
+      if(wf.At(i) > value) {
+        point = i;
+        value = wf.At(i);
       }
     }
   } else {
     for(size_t i=locMinStep;i<locMaxStep;i++) {
-      if(wf.At(i) < fTheExtremumValue) {
-        fTheExtremumPoint = i;
-        fTheExtremumValue = wf.At(i);
+      if(wf.At(i) < value) {
+        point = i;
+        value = wf.At(i);
       }
     }
   }
@@ -1,7 +1,11 @@
 #include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
 #include "EXOUtilities/EXOErrorLogger.hh"
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
+#ifdef USE_THREADS
+#include "boost/thread/mutex.hpp"
+#endif
 #ifdef USE_ROOT_FFTW
 // The following is to avoid using ROOT's cludgy interface.  fftw_plan_dft_r2c
 // is defined in libFFTW, but we also need the header information (copied
@@ -28,6 +32,10 @@ FFTW_EXTERN void X(execute)(const X(plan) p);                              \
                                                                            \
 FFTW_EXTERN void X(destroy_plan)(X(plan) p);                               \
                                                                            \
+FFTW_EXTERN void X(execute_dft_r2c)(const X(plan) p, R *in, C *out);       \
+                                                                           \
+FFTW_EXTERN void X(execute_dft_c2r)(const X(plan) p, C *in, R *out);       \
+                                                                           \
 FFTW_EXTERN X(plan) X(plan_dft_c2r)(int rank, const int *n,                \
                         C *in, R *out, unsigned flags);                    \
 FFTW_EXTERN X(plan) X(plan_dft_r2c)(int rank, const int *n,                \
@@ -82,6 +90,13 @@ FFTW_DEFINE_API(FFTW_MANGLE_DOUBLE, double, fftw_complex)
 //               important as we move toward storing wisdom).  Copies should now be avoided
 //               by accessing this internal array directly.
 //
+// The internal array is shared by all users of an FFT length, so the
+// functions above must not be called from several threads at once.  Threads
+// should instead allocate their own arrays with AllocateArray (e.g. through
+// EXOWaveformWorkspace) and use the PerformFFT_inplace(void*) and
+// PerformInverseFFT_inplace(void*) overloads, which only read the plans.
+// GetFFT is safe to call from several threads when built with USE_THREADS.
+//
 //______________________________________________________________________________
 
 
@@ -155,6 +170,11 @@ EXOFastFourierTransformFFTW&
 EXOFastFourierTransformFFTW& EXOFastFourierTransformFFTW::GetFFT( size_t length )
 {
   // Return Object given a processing length.
+#ifdef USE_THREADS
+  // Planning and insertion into the map are not thread-safe.
+  static boost::mutex mapMutex;
+  boost::mutex::scoped_lock lock(mapMutex);
+#endif
   FFTMap::iterator iter;
   if ( (iter = fMap.find(length)) == fMap.end() ) {
       iter = fMap.insert(std::make_pair(length,new EXOFastFourierTransformFFTW(length))).first;
@@ -261,6 +281,60 @@ void EXOFastFourierTransformFFTW::PerformInverseFFT_inplace()
 #endif
 }
 
+//______________________________________________________________________________
+void EXOFastFourierTransformFFTW::PerformFFT_inplace(void* array) const
+{
+  // Perform an in-place forward transform on array, which must have been
+  // allocated with AllocateArray.  Only the plan is shared, so this may be
+  // called from several threads at once with different arrays.
+#ifdef HAVE_FFTW
+  assert(array);
+  assert(fTheForwardPlan);
+  fftw_execute_dft_r2c( (fftw_plan)fTheForwardPlan,
+                        static_cast<double*>(array),
+                        static_cast<fftw_complex*>(array) );
+#else
+  LogEXOMsg("Compiled without FFTW3", EEError);
+#endif
+}
+
+//______________________________________________________________________________
+void EXOFastFourierTransformFFTW::PerformInverseFFT_inplace(void* array) const
+{
+  // Perform an in-place inverse transform on array, see PerformFFT_inplace.
+#ifdef HAVE_FFTW
+  assert(array);
+  assert(fTheInversePlan);
+  fftw_execute_dft_c2r( (fftw_plan)fTheInversePlan,
+                        static_cast<fftw_complex*>(array),
+                        static_cast<double*>(array) );
+#else
+  LogEXOMsg("Compiled without FFTW3", EEError);
+#endif
+}
+
+//______________________________________________________________________________
+void* EXOFastFourierTransformFFTW::AllocateArray(size_t length)
+{
+  // Allocate an array for in-place transforms of logical length length,
+  // aligned like the internal arrays.  Free it with FreeArray.
+#ifdef HAVE_FFTW
+  return fftw_malloc(sizeof(double)*2*(length/2 + 1));
+#else
+  return malloc(sizeof(double)*2*(length/2 + 1));
+#endif
+}
+
+//______________________________________________________________________________
+void EXOFastFourierTransformFFTW::FreeArray(void* array)
+{
+#ifdef HAVE_FFTW
+  fftw_free(array);
+#else
+  free(array);
+#endif
+}
+
 //______________________________________________________________________________
 bool EXOFastFourierTransformFFTW::IsAvailable()
 {
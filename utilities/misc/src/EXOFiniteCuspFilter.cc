@@ -40,6 +40,12 @@ EXOFiniteCuspFilter::EXOFiniteCuspFilter() :
 }
 
 void EXOFiniteCuspFilter::TransformOutOfPlace(const EXODoubleWaveform& anInput, EXODoubleWaveform& anOutput) const 
+{
+  TransformOutOfPlace(anInput, anOutput, fWorkspace);
+}
+
+void EXOFiniteCuspFilter::TransformOutOfPlace(const EXODoubleWaveform& anInput, EXODoubleWaveform& anOutput,
+                                              EXOWaveformWorkspace& workspace) const 
 {
     //! Perform the transformation.  This cannot be done in place. 
     /*!
@@ -64,16 +70,19 @@ void EXOFiniteCuspFilter::TransformOutOfPlace(const EXODoubleWaveform& anInput,
   size_t flatStep = static_cast<size_t>(fFlatTime*anInput.GetSamplingFreq());
   double decayConstant = fDecayConstant*anInput.GetSamplingFreq();
   
-  if(fVector.size() != anInput.GetLength()) {
-    fVector.resize(anInput.GetLength());
+  // Scratch vectors for the recursion come from the workspace.
+  EXOWaveformWorkspace::Frame frame(workspace);
+  std::vector<double>& sVector = workspace.GetBuffer();
+  if(sVector.size() != anInput.GetLength()) {
+    sVector.resize(anInput.GetLength());
   }
-  fVector[0] = anInput.At(0);
+  sVector[0] = anInput.At(0);
   anOutput[0] = (decayConstant+1.)*anInput.At(0);
   double scratch = 0.0;
 
   //I added this
-  std::vector<double> pVector;
-  pVector.resize(anInput.GetLength() , 0.0);
+  std::vector<double>& pVector = workspace.GetBuffer();
+  pVector.assign(anInput.GetLength() , 0.0);
   double inMax = anInput.GetMaxValue();//in case this is somehow in place, get max value of input before for loop
 
 
@@ -105,8 +114,8 @@ void EXOFiniteCuspFilter::TransformOutOfPlace(const EXODoubleWaveform& anInput,
     //This is the pole-zero cancellation
     //if decayConstant != 0, add fraction to output to remove undershoot
     if(decayConstant != 0.0) {
-      fVector[i] = fVector[i-1] + scratch; 
-      anOutput[i] = anOutput[i-1] + fVector[i] + decayConstant*scratch;
+      sVector[i] = sVector[i-1] + scratch; 
+      anOutput[i] = anOutput[i-1] + sVector[i] + decayConstant*scratch;
     } 
     else anOutput[i] = anOutput[i-1] + scratch;
 
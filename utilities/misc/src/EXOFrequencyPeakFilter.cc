@@ -1,9 +1,11 @@
 #include "EXOUtilities/EXOFrequencyPeakFilter.hh"
 
 #include <complex>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
 #include "EXOUtilities/EXOMiscUtil.hh"
 #include "TH1D.h"
 
@@ -84,3 +86,44 @@ void EXOFrequencyPeakFilter::TransformOutOfPlace(const EXODoubleWaveform& input,
   EXOFastFourierTransformFFTW::GetFFT(input.GetLength()).PerformInverseFFT(output,fourier);
   output /= double(output.GetLength());
 }
+
+void EXOFrequencyPeakFilter::TransformInPlace(EXODoubleWaveform& input, EXOWaveformWorkspace& workspace) const
+{
+  TransformOutOfPlace(input,input,workspace);
+}
+
+void EXOFrequencyPeakFilter::TransformOutOfPlace(const EXODoubleWaveform& input, EXODoubleWaveform& output,
+                                                 EXOWaveformWorkspace& workspace) const
+{
+  // Thread-safe version of the above; the spectrum is filtered in an array
+  // from the workspace.
+  if(input.GetLength()/2 + 1 != fFilter.GetLength()){
+    LogEXOMsg("Waveform length incompatible to filter!",EEError);
+    output = input;
+    return;
+  }
+  const EXOFastFourierTransformFFTW& fft = EXOFastFourierTransformFFTW::GetFFT(input.GetLength());
+  EXOWaveformWorkspace::Frame frame(workspace);
+  void* array = workspace.GetFFTArray(input.GetLength());
+  memcpy(array, reinterpret_cast<const void*>(&input[0]), sizeof(double)*input.GetLength());
+  fft.PerformFFT_inplace(array);
+  complex<double>* complex_data = static_cast<complex<double>*>(array);
+  for(size_t i=0; i<fFilter.GetLength(); i++) complex_data[i] *= fFilter[i];
+  fft.PerformInverseFFT_inplace(array);
+  output.SetData(static_cast<double*>(array), fft.GetTimeDomainLength());
+  output /= double(output.GetLength());
+}
+
+bool EXOFrequencyPeakFilter::GetFrequencyResponse(const EXODoubleWaveform& input, EXOWaveformFT& response, size_t& delay) const
+{
+  // The filter mask, with the normalization of the inverse transform.
+  if(input.GetLength()/2 + 1 != fFilter.GetLength()){
+    return false;
+  }
+  response.SetLength(fFilter.GetLength());
+  for(size_t i=0; i<fFilter.GetLength(); i++){
+    response[i] = fFilter[i]/double(input.GetLength());
+  }
+  delay = 0;
+  return true;
+}
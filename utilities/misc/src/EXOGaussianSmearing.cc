@@ -0,0 +1,140 @@
+//______________________________________________________________________________
+// EXOGaussianSmearing
+//
+// Smears a set of weighted energies with one gaussian resolution by
+// convolution on a uniform grid, using EXOFastFourierTransformFFTW.  The
+// weights are shared between the two nearest grid points (which keeps their
+// mean energy), convolved with the gaussian integrated over each grid cell,
+// and the result is linearly interpolated between grid points.  The error
+// is of order (step/sigma)^2, independent of the number of energies, while
+// the cost is that of two transforms of the grid.
+//
+// The energy fits use it for segments of the MC spectrum in which the
+// resolution is nearly constant; see SetFFTSmearing in
+// EXOEnergyMCBasedFitBase.
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOGaussianSmearing.hh"
+#include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
+#include <cmath>
+
+namespace {
+  const double gfNumSigma = 8.;        // Extent of the gaussian on either side
+}
+
+//______________________________________________________________________________
+EXOGaussianSmearing::EXOGaussianSmearing()
+: fStart(0.),
+  fStep(1.),
+  fCumulative(false)
+{}
+
+//______________________________________________________________________________
+void EXOGaussianSmearing::Smear(const double* energy, const double* weight, size_t n,
+                                double sigma, double step, bool cumulative)
+{
+  fValues.clear();
+  fCumulative = cumulative;
+  fStep = step;
+  if(n == 0 or sigma <= 0. or step <= 0.) return;
+
+  // Grid points 0 to size-1 cover the energies with halfWidth points to
+  // spare on either side, so the smeared values all fall on the grid.
+  size_t halfWidth = size_t(std::ceil(gfNumSigma*sigma/step));
+  size_t numPoints = size_t((energy[n-1] - energy[0])/step) + 2;
+  size_t size = numPoints + 2*halfWidth;
+  fStart = energy[0] - halfWidth*step;
+
+  // Cell-integrated gaussian, normalized to 1 over its extent.
+  std::vector<double> kernel(halfWidth+1);
+  double scale = step/(sigma*std::sqrt(2.));
+  double norm = 0.;
+  for(size_t m = 0; m <= halfWidth; m++) {
+    kernel[m] = 0.5*(erf((m + 0.5)*scale) - erf((double(m) - 0.5)*scale));
+    norm += (m == 0) ? kernel[m] : 2.*kernel[m];
+  }
+  for(size_t m = 0; m <= halfWidth; m++) kernel[m] /= norm;
+
+  std::vector<double> smeared(size, 0.);
+  if(EXOFastFourierTransformFFTW::IsAvailable()) {
+    // A power of two at least as long as the grid, so that the circular
+    // convolution does not wrap around.
+    size_t length = 2;
+    while(length < size) length *= 2;
+    double* grid = static_cast<double*>(EXOFastFourierTransformFFTW::AllocateArray(length));
+    double* response = static_cast<double*>(EXOFastFourierTransformFFTW::AllocateArray(length));
+    for(size_t k = 0; k < 2*(length/2 + 1); k++) grid[k] = response[k] = 0.;
+    for(size_t i = 0; i < n; i++) {
+      double t = (energy[i] - energy[0])/step;
+      size_t j = size_t(t);
+      grid[halfWidth + j] += weight[i]*(1. - (t - j));
+      grid[halfWidth + j + 1] += weight[i]*(t - j);
+    }
+    response[0] = kernel[0];
+    for(size_t m = 1; m <= halfWidth; m++) response[m] = response[length - m] = kernel[m];
+
+    const EXOFastFourierTransformFFTW& fft = EXOFastFourierTransformFFTW::GetFFT(length);
+    fft.PerformFFT_inplace(grid);
+    fft.PerformFFT_inplace(response);
+    for(size_t f = 0; f < length/2 + 1; f++) {
+      double re = grid[2*f]*response[2*f] - grid[2*f+1]*response[2*f+1];
+      double im = grid[2*f]*response[2*f+1] + grid[2*f+1]*response[2*f];
+      grid[2*f] = re/length;
+      grid[2*f+1] = im/length;
+    }
+    fft.PerformInverseFFT_inplace(grid);
+    for(size_t k = 0; k < size; k++) smeared[k] = grid[k];
+    EXOFastFourierTransformFFTW::FreeArray(grid);
+    EXOFastFourierTransformFFTW::FreeArray(response);
+  }
+  else {
+    // Without FFTW, convolve directly.
+    for(size_t i = 0; i < n; i++) {
+      double t = (energy[i] - energy[0])/step;
+      size_t j = size_t(t);
+      double low = weight[i]*(1. - (t - j));
+      double high = weight[i]*(t - j);
+      for(size_t m = 0; m <= 2*halfWidth; m++) {
+        double k = kernel[(m > halfWidth) ? m - halfWidth : halfWidth - m];
+        smeared[j + m] += low*k;
+        if(j + m + 1 < size) smeared[j + m + 1] += high*k;
+      }
+    }
+  }
+
+  if(cumulative) {
+    fValues.resize(size + 1);
+    fValues[0] = 0.;
+    for(size_t k = 0; k < size; k++) fValues[k+1] = fValues[k] + smeared[k];
+  }
+  else {
+    fValues.resize(size);
+    for(size_t k = 0; k < size; k++) fValues[k] = smeared[k]/step;
+  }
+}
+
+//______________________________________________________________________________
+double EXOGaussianSmearing::GetHigh() const
+{
+  if(fValues.empty()) return fStart;
+  if(fCumulative) return fStart + (fValues.size() - 1.5)*fStep;
+  return fStart + (fValues.size() - 1)*fStep;
+}
+
+//______________________________________________________________________________
+double EXOGaussianSmearing::Evaluate(double x) const
+{
+  if(fValues.empty()) return 0.;
+  if(fCumulative) {
+    // fValues[i] is the weight below the lower edge of cell i.
+    double t = (x - fStart)/fStep + 0.5;
+    if(t <= 0.) return 0.;
+    size_t i = size_t(t);
+    if(i >= fValues.size() - 1) return fValues.back();
+    return fValues[i] + (t - i)*(fValues[i+1] - fValues[i]);
+  }
+  double t = (x - fStart)/fStep;
+  if(t < 0. or t >= fValues.size() - 1) return 0.;
+  size_t i = size_t(t);
+  return fValues[i] + (t - i)*(fValues[i+1] - fValues[i]);
+}
@@ -0,0 +1,32 @@
+//______________________________________________________________________________
+// EXOHash
+//
+// The 64-bit FNV-1a hash, used for the names of cached files and the
+// provenance of reconstructed signals.  It is fast and well spread but not
+// cryptographic; whatever a hash names also checks what it reads.
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOHash.hh"
+
+//______________________________________________________________________________
+ULong64_t EXOHash::FNV1aBasis()
+{
+  return 14695981039346656037ULL;
+}
+
+//______________________________________________________________________________
+ULong64_t EXOHash::FNV1a(ULong64_t hash, const void* data, size_t length)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for(size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+//______________________________________________________________________________
+ULong64_t EXOHash::FNV1a(ULong64_t hash, const std::string& str)
+{
+  return FNV1a(hash, str.c_str(), str.size() + 1);
+}
@@ -1,6 +1,7 @@
 #include "EXOUtilities/EXOMatchedFilter.hh"
 #include "EXOUtilities/EXOErrorLogger.hh"
 #include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
 #include <sstream>
 
 #ifdef HAVE_FFTW
@@ -74,16 +75,23 @@ void EXOMatchedFilter::SetTemplateToMatch(const EXODoubleWaveform& wf,
 
 }
 
+bool EXOMatchedFilter::GetFrequencyResponse(const EXODoubleWaveform& wf,
+                                            EXOWaveformFT& response,
+                                            size_t& delay) const
+{
+  // The filter multiplies the spectrum by the conjugate template (with the
+  // factor 0.5 of TransformInPlace folded in) and delays by the offset.
+  if(fOffset < 0 or not WaveformMatchesFilterSettings(wf)) return false;
+  response = fMatchedFilter;
+  response *= 0.5;
+  delay = fOffset;
+  return true;
+}
+
 void EXOMatchedFilter::TransformInPlace(EXODoubleWaveform& wf) const
 {
 #ifdef HAVE_FFTW
-  if(not WaveformMatchesFilterSettings(wf)) {
-    std::ostringstream os;
-    os << " Input waveform and matched filter waveform do not match: "
-       << " length =  "<< wf.GetLength() <<", matched filter length = "<< (fMatchedFilter.GetLength()-1)*2;
-    LogEXOMsg(os.str().c_str(), EEError); 
-    return;
-  }
+  if(not CheckWaveform(wf)) return;
 
   // Make use of in-place FFTs.  We fill the array ourselves at the beginning (and retrieve it at the end).
   void* fftw_array;
@@ -128,18 +136,53 @@ void EXOMatchedFilter::TransformInPlace(EXODoubleWaveform& wf) const
     fFFT->PerformInverseFFT_inplace();
   }
 
+  RetrieveFiltered(fftw_array, wf);
+#else
+  LogEXOMsg("Cannot use EXOMatchedFilter when we don't have an fft library", EEAlert);
+#endif
+}
+
+void EXOMatchedFilter::TransformInPlace(EXODoubleWaveform& wf,
+                                        EXOWaveformWorkspace& workspace) const
+{
+  // Thread-safe version: the FFTs are done on an array from the workspace,
+  // independently of fUseNewArrayInterface.
+#ifdef HAVE_FFTW
+  if(not CheckWaveform(wf)) return;
+
+  EXOWaveformWorkspace::Frame frame(workspace);
+  void* fftw_array = workspace.GetFFTArray(wf.GetLength());
+  memcpy(fftw_array, reinterpret_cast<const void*>(&wf[0]), sizeof(double)*wf.GetLength());
+  fFFT->PerformFFT_inplace(fftw_array);
+  for(size_t i = 0; i < fFFT->GetFreqDomainLength(); i++) {
+    reinterpret_cast<std::complex<double>*>(fftw_array)[i] *= fMatchedFilter[i];
+  }
+  fFFT->PerformInverseFFT_inplace(fftw_array);
+  RetrieveFiltered(fftw_array, wf);
+#else
+  LogEXOMsg("Cannot use EXOMatchedFilter when we don't have an fft library", EEAlert);
+#endif
+}
+
+bool EXOMatchedFilter::CheckWaveform(const EXODoubleWaveform& wf) const
+{
+  if(WaveformMatchesFilterSettings(wf)) return true;
+  std::ostringstream os;
+  os << " Input waveform and matched filter waveform do not match: "
+     << " length =  "<< wf.GetLength() <<", matched filter length = "<< (fMatchedFilter.GetLength()-1)*2;
+  LogEXOMsg(os.str().c_str(), EEError); 
+  return false;
+}
+
+void EXOMatchedFilter::RetrieveFiltered(const void* fftw_array, EXODoubleWaveform& wf) const
+{
   // Retrieve values from fftw_array into wf.
   // Simultaneously, restore conventions from Numerical recipes by multiplying by 0.5.
   // Also, eliminate offset, since the user shouldn't need to deal with it.
   for(Int_t i = wf.GetLength() - 1; i >= fOffset; i--) {
-    wf[i] = 0.5*reinterpret_cast<double*>(fftw_array)[i-fOffset];
+    wf[i] = 0.5*reinterpret_cast<const double*>(fftw_array)[i-fOffset];
   }
   if ( fOffset != 0 ) {
     for (Int_t i = fOffset - 1; i >= 0; i--) wf[i] = 0.0; 
   }
-#else
-  LogEXOMsg("Cannot use EXOMatchedFilter when we don't have an fft library", EEAlert);
-#endif
 }
-
-
@@ -62,6 +62,20 @@ void EXOPoleZeroCorrection::TransformOutOfPlace(const EXODoubleWaveform& anInput
 
 }
 
+bool EXOPoleZeroCorrection::GetRecursiveSections(const EXODoubleWaveform& wf,
+                                                 std::vector<RecursiveSection>& sections) const
+{
+  // Describe the correction as one recursive section, see
+  // EXOWaveformPipeline.
+  RecursiveSection section;
+  section.fType = RecursiveSection::kPoleZero;
+  section.fGain = 1.0;
+  section.fWeight = exp(-1./(fDecayConstant*wf.GetSamplingFreq()));
+  section.fBaseline = fRestingBaselineValue;
+  sections.push_back(section);
+  return true;
+}
+
 EXOPoleZeroCorrection::~EXOPoleZeroCorrection()
 {
 }
@@ -76,3 +76,26 @@ void EXORCDifferentiator::TransformOutOfPlace(const EXODoubleWaveform& anInput,
     anOutput[i] = (anInput[i] - anInput[i-1])*b + anOutput[i-1]*w;
   }
 }
+
+//______________________________________________________________________________
+bool EXORCDifferentiator::GetRecursiveSections(const EXODoubleWaveform& wf,
+                                               std::vector<RecursiveSection>& sections) const
+{
+  // Describe this differentiator as one recursive section, see
+  // EXOWaveformPipeline.
+  sections.push_back(MakeSection(wf.GetSamplingPeriod(), fTimeConstant));
+  return true;
+}
+
+//______________________________________________________________________________
+EXOVWaveformTransformer::RecursiveSection
+EXORCDifferentiator::MakeSection(double samplingPeriod, double timeConstant)
+{
+  // The section of an RC differentiator with time constant timeConstant.
+  RecursiveSection section;
+  section.fType = RecursiveSection::kDifferentiator;
+  section.fWeight = exp( -samplingPeriod/timeConstant );
+  section.fGain = (1+section.fWeight)/2.;
+  section.fBaseline = 0.0;
+  return section;
+}
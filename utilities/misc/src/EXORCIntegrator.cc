@@ -61,3 +61,26 @@ void EXORCIntegrator::TransformInPlace(EXODoubleWaveform& anInput) const
   }
 
 }
+
+//______________________________________________________________________________
+bool EXORCIntegrator::GetRecursiveSections(const EXODoubleWaveform& wf,
+                                           std::vector<RecursiveSection>& sections) const
+{
+  // Describe this integrator as one recursive section, see
+  // EXOWaveformPipeline.
+  sections.push_back(MakeSection(wf.GetSamplingPeriod(), fTimeConstant));
+  return true;
+}
+
+//______________________________________________________________________________
+EXOVWaveformTransformer::RecursiveSection
+EXORCIntegrator::MakeSection(double samplingPeriod, double timeConstant)
+{
+  // The section of an RC integrator with time constant timeConstant.
+  RecursiveSection section;
+  section.fType = RecursiveSection::kIntegrator;
+  section.fWeight = exp( -samplingPeriod/timeConstant );
+  section.fGain = 1. - section.fWeight;
+  section.fBaseline = 0.0;
+  return section;
+}
@@ -48,34 +48,57 @@ EXORisetimeCalculation::EXORisetimeCalculation() :
 //______________________________________________________________________________
 void EXORisetimeCalculation::TransformInPlace(EXODoubleWaveform& anInput) const
 {
+  // Calculate with the stored peak height and store the results.  On failure
+  // the results keep whatever the calculation had reached.
+  Result result;
+  result.fRiseTime = fRiseTime;
+  result.fInitThresholdEstimate = fInitThresholdEstimate;
+  result.fFinalThresholdEstimate = fFinalThresholdEstimate;
+  result.fInitThresholdCrossing = fInitThresholdCrossing;
+  result.fFinalThresholdCrossing = fFinalThresholdCrossing;
+  Calculate(anInput, fPeakHeight, result);
+  fRiseTime = result.fRiseTime;
+  fInitThresholdEstimate = result.fInitThresholdEstimate;
+  fFinalThresholdEstimate = result.fFinalThresholdEstimate;
+  fInitThresholdCrossing = result.fInitThresholdCrossing;
+  fFinalThresholdCrossing = result.fFinalThresholdCrossing;
+}
+
+//______________________________________________________________________________
+bool EXORisetimeCalculation::Calculate(const EXODoubleWaveform& anInput,
+                                       double peakHeight,
+                                       Result& result) const
+{
+  // Calculate the risetime of anInput for a pulse of height peakHeight.  The
+  // calculator is not modified, so this may be called from several threads.
   if(anInput.GetLength() < 2)
   {
     LogEXOMsg("Waveform is too short", EEError);
-    return;
+    return false;
   }
   if(anInput.GetSamplingPeriod() <= 0.0) {
     LogEXOMsg("Waveform has invalid sampling period", EEAlert);
-    return;
+    return false;
   }
   if(fInitThreshold >= fInitialScanToPercentage or fInitialScanToPercentage >= fFinalThreshold) {
     LogEXOMsg("Initial thresholds set incorrectly in EXORisetimeCalculation", EEAlert);
-    return;
+    return false;
   }
-  if(fPeakHeight == 0) {
+  if(peakHeight == 0) {
     LogEXOMsg("Peak height set to zero", EEAlert);
-    return;
+    return false;
   }
 
-  fInitThresholdCrossing = 0;
-  fFinalThresholdCrossing = anInput.GetLength();
+  result.fInitThresholdCrossing = 0;
+  result.fFinalThresholdCrossing = anInput.GetLength();
   size_t middleOfPulse = 0;
 
   /* First find the middle of the pulse. */
   size_t i = (fScanFrom >= anInput.GetLength()) ? anInput.GetLength()-1 : fScanFrom;
 
-  if (fPeakHeight < 0) {
+  if (peakHeight < 0) {
       while (i < anInput.GetLength()) {
-        if ( anInput.At(i) <= fInitialScanToPercentage*fPeakHeight ) {
+        if ( anInput.At(i) <= fInitialScanToPercentage*peakHeight ) {
           middleOfPulse = i;
           break;
         }  
@@ -83,7 +106,7 @@ void EXORisetimeCalculation::TransformInPlace(EXODoubleWaveform& anInput) const
       }
   } else {
      while (i < anInput.GetLength()) {
-        if ( anInput.At(i) >= fInitialScanToPercentage*fPeakHeight ) {
+        if ( anInput.At(i) >= fInitialScanToPercentage*peakHeight ) {
           middleOfPulse = i;
           break;
         }  
@@ -96,14 +119,14 @@ void EXORisetimeCalculation::TransformInPlace(EXODoubleWaveform& anInput) const
     // We could try scanning over the whole waveform, but what if there was a specific signal the user tried to select?
     // Just exit.
     LogEXOMsg("Failed to find midpoint of signal", EEError);
-    return;
+    return false;
   }
-  if(fPeakHeight < 0 ? anInput[middleOfPulse-1] <= fInitialScanToPercentage*fPeakHeight :
-                       anInput[middleOfPulse-1] >= fInitialScanToPercentage*fPeakHeight) {
+  if(peakHeight < 0 ? anInput[middleOfPulse-1] <= fInitialScanToPercentage*peakHeight :
+                       anInput[middleOfPulse-1] >= fInitialScanToPercentage*peakHeight) {
     // middleOfPulse is not actually the first datapoint to exceed threshold.  Try scanning backward.
     while(middleOfPulse > 0) {
-      if(fPeakHeight < 0 ? anInput[middleOfPulse-1] > fInitialScanToPercentage*fPeakHeight :
-                           anInput[middleOfPulse-1] < fInitialScanToPercentage*fPeakHeight) {
+      if(peakHeight < 0 ? anInput[middleOfPulse-1] > fInitialScanToPercentage*peakHeight :
+                           anInput[middleOfPulse-1] < fInitialScanToPercentage*peakHeight) {
         break;
       }
       middleOfPulse--;
@@ -111,7 +134,7 @@ void EXORisetimeCalculation::TransformInPlace(EXODoubleWaveform& anInput) const
     if(middleOfPulse == 0) {
       // Well, we scanned all the way back to the beginning, and never fell below the threshold.  Give up.
       LogEXOMsg("Midpoint of signal occurs before waveform begins", EEError);
-      return;
+      return false;
     }
   }
   // OK, we can guarantee that 0 < middleOfPulse < anInput.GetLength(),
@@ -122,73 +145,73 @@ void EXORisetimeCalculation::TransformInPlace(EXODoubleWaveform& anInput) const
   /* It occurs somewhere strictly before middleOfPulse */
   /* If we fail to find it, exit with an error */
   i = middleOfPulse;
-  if (fPeakHeight < 0) {
+  if (peakHeight < 0) {
       while (i > 0) {
-        if ( anInput.At(i-1) >= fInitThreshold*fPeakHeight ) {
-          fInitThresholdCrossing = i-1;
+        if ( anInput.At(i-1) >= fInitThreshold*peakHeight ) {
+          result.fInitThresholdCrossing = i-1;
           break;
         }  
         i--;
         if(i == 0) {
           LogEXOMsg("Failed to find initial threshold crossing", EEError);
-          return;
+          return false;
         }
       }
   } else {
       while (i > 0) {
-        if ( anInput.At(i-1) <= fInitThreshold*fPeakHeight ) {
-          fInitThresholdCrossing = i-1;
+        if ( anInput.At(i-1) <= fInitThreshold*peakHeight ) {
+          result.fInitThresholdCrossing = i-1;
           break;
         }  
         i--;
         if(i == 0) {
           LogEXOMsg("Failed to find initial threshold crossing", EEError);
-          return;
+          return false;
         }
       }
   }
   // OK, if we've reached this point at all, then we can guarantee fInitThreshold was set to the first point that meets or falls below threshold.
-  // 0 <= fInitThresholdCrossing < middleOfPulse < anInput.GetLength()
-  // and for fPeakHeight > 0:
-  // anInput[fInitThresholdCrossing] <= fInitThreshold*fPeakHeight < fInitialScanToPercentage*fPeakHeight <= anInput[middleOfPulse]
+  // 0 <= result.fInitThresholdCrossing < middleOfPulse < anInput.GetLength()
+  // and for peakHeight > 0:
+  // anInput[result.fInitThresholdCrossing] <= fInitThreshold*peakHeight < fInitialScanToPercentage*peakHeight <= anInput[middleOfPulse]
 
   i = middleOfPulse;
-  if (fPeakHeight < 0) {
+  if (peakHeight < 0) {
       while (i < anInput.GetLength()) {
-        if ( anInput.At(i) <= fFinalThreshold*fPeakHeight ) {
-          fFinalThresholdCrossing = i;
+        if ( anInput.At(i) <= fFinalThreshold*peakHeight ) {
+          result.fFinalThresholdCrossing = i;
           break;
         }  
         i++;
       }
   } else {
       while (i < anInput.GetLength()) {
-        if ( anInput.At(i) >= fFinalThreshold*fPeakHeight ) {
-          fFinalThresholdCrossing = i;
+        if ( anInput.At(i) >= fFinalThreshold*peakHeight ) {
+          result.fFinalThresholdCrossing = i;
           break;
         }  
         i++;
       }
   }
-  if(fFinalThresholdCrossing == anInput.GetLength()) {
-    // We never did find a point where the waveform met or exceeded fFinalThreshold*fPeakHeight.
+  if(result.fFinalThresholdCrossing == anInput.GetLength()) {
+    // We never did find a point where the waveform met or exceeded fFinalThreshold*peakHeight.
     // We can't go back -- this is clearly a signal here -- so fail.
     LogEXOMsg("Signal failed to exceed final crossing threshold", EEError);
-    return;
+    return false;
   }
 
   // Now linearly interpolate to grab a more exact time
   // y = first*x
   // Note first and second are not zero.  We've already checked that GetSamplingPeriod() doesn't return 0.
-  double first = -(anInput[fInitThresholdCrossing] - anInput[fInitThresholdCrossing+1])/anInput.GetSamplingPeriod();
-  double second = (anInput[fFinalThresholdCrossing] - anInput[fFinalThresholdCrossing-1])/anInput.GetSamplingPeriod();
-  fFinalThresholdEstimate = (fFinalThresholdCrossing - 1)*anInput.GetSamplingPeriod() + 
-                            (fFinalThreshold*fPeakHeight - anInput[fFinalThresholdCrossing-1])/second;
-  fInitThresholdEstimate = fInitThresholdCrossing*anInput.GetSamplingPeriod() + 
-                           (fInitThreshold*fPeakHeight - anInput[fInitThresholdCrossing])/first;
-
-  fRiseTime = fFinalThresholdEstimate - fInitThresholdEstimate; 
+  double first = -(anInput[result.fInitThresholdCrossing] - anInput[result.fInitThresholdCrossing+1])/anInput.GetSamplingPeriod();
+  double second = (anInput[result.fFinalThresholdCrossing] - anInput[result.fFinalThresholdCrossing-1])/anInput.GetSamplingPeriod();
+  result.fFinalThresholdEstimate = (result.fFinalThresholdCrossing - 1)*anInput.GetSamplingPeriod() + 
+                            (fFinalThreshold*peakHeight - anInput[result.fFinalThresholdCrossing-1])/second;
+  result.fInitThresholdEstimate = result.fInitThresholdCrossing*anInput.GetSamplingPeriod() + 
+                           (fInitThreshold*peakHeight - anInput[result.fInitThresholdCrossing])/first;
 
+  result.fRiseTime = result.fFinalThresholdEstimate - result.fInitThresholdEstimate; 
+  return true;
 }
 
 //______________________________________________________________________________
@@ -0,0 +1,172 @@
+//______________________________________________________________________________
+// EXORunningStatistics
+//
+// DESCRIPTION:
+//
+// Summary statistics of a stream of values, computed as the values arrive
+// and in constant memory: count, mean and variance (Welford's algorithm,
+// which does not lose precision on large offsets such as ADC baselines),
+// minimum, maximum and any number of quantiles.  Quantiles are estimated with
+// the P-square algorithm (R. Jain and I. Chlamtac, Commun. ACM 28 (1985)
+// 1076), which keeps five markers per quantile; the estimate is exact for
+// up to five values and converges to the true quantile for long streams.
+//
+//   EXORunningStatistics stats;
+//   stats.AddQuantile(0.5);
+//   for(...) stats.Add(x);
+//   double median = stats.GetQuantile(0);
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXORunningStatistics.hh"
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+//______________________________________________________________________________
+EXORunningStatistics::EXORunningStatistics()
+{
+  Clear();
+}
+
+//______________________________________________________________________________
+void EXORunningStatistics::AddQuantile(double p)
+{
+  assert(fN == 0);
+  assert(p > 0.0 and p < 1.0);
+  Quantile quantile;
+  quantile.fP = p;
+  double increments[5] = {0., p/2., p, (1. + p)/2., 1.};
+  std::copy(increments, increments + 5, quantile.fIncrements);
+  Reset(quantile);
+  fQuantiles.push_back(quantile);
+}
+
+//______________________________________________________________________________
+void EXORunningStatistics::Clear()
+{
+  // Forget all values; the quantiles to track are kept.
+  fN = 0;
+  fMean = 0.;
+  fM2 = 0.;
+  fMin = 0.;
+  fMax = 0.;
+  for(size_t i = 0; i < fQuantiles.size(); i++) Reset(fQuantiles[i]);
+}
+
+//______________________________________________________________________________
+void EXORunningStatistics::Reset(Quantile& q)
+{
+  // Put the markers back at their starting positions.
+  double p = q.fP;
+  double desired[5] = {1., 1. + 2.*p, 1. + 4.*p, 3. + 2.*p, 5.};
+  for(size_t i = 0; i < 5; i++) {
+    q.fHeights[i] = 0.;
+    q.fPositions[i] = i + 1;
+    q.fDesired[i] = desired[i];
+  }
+}
+
+//______________________________________________________________________________
+void EXORunningStatistics::Add(double x)
+{
+  fN++;
+  double delta = x - fMean;
+  fMean += delta/fN;
+  fM2 += delta*(x - fMean);
+  if(fN == 1 or x < fMin) fMin = x;
+  if(fN == 1 or x > fMax) fMax = x;
+
+  if(fN <= 5) {
+    fFirst[fN-1] = x;
+    if(fN == 5) {
+      std::sort(fFirst, fFirst + 5);
+      for(size_t i = 0; i < fQuantiles.size(); i++) {
+        std::copy(fFirst, fFirst + 5, fQuantiles[i].fHeights);
+      }
+    }
+    return;
+  }
+  for(size_t i = 0; i < fQuantiles.size(); i++) Update(fQuantiles[i], x);
+}
+
+//______________________________________________________________________________
+void EXORunningStatistics::Update(Quantile& q, double x)
+{
+  // One step of the P-square algorithm: find the cell of x, shift the marker
+  // positions above it, and move the three middle markers towards their
+  // desired positions.
+  size_t k;
+  if(x < q.fHeights[0]) {
+    q.fHeights[0] = x;
+    k = 0;
+  }
+  else if(x >= q.fHeights[4]) {
+    q.fHeights[4] = x;
+    k = 3;
+  }
+  else {
+    k = 0;
+    while(x >= q.fHeights[k+1]) k++;
+  }
+  for(size_t i = k+1; i < 5; i++) q.fPositions[i] += 1.;
+  for(size_t i = 0; i < 5; i++) q.fDesired[i] += q.fIncrements[i];
+
+  for(size_t i = 1; i < 4; i++) {
+    double d = q.fDesired[i] - q.fPositions[i];
+    if((d >= 1. and q.fPositions[i+1] - q.fPositions[i] > 1.) or
+       (d <= -1. and q.fPositions[i-1] - q.fPositions[i] < -1.)) {
+      int sign = (d > 0.) ? 1 : -1;
+      double height = Parabolic(q, i, sign);
+      if(q.fHeights[i-1] < height and height < q.fHeights[i+1]) q.fHeights[i] = height;
+      else q.fHeights[i] = Linear(q, i, sign);
+      q.fPositions[i] += sign;
+    }
+  }
+}
+
+//______________________________________________________________________________
+double EXORunningStatistics::Parabolic(const Quantile& q, size_t i, double d)
+{
+  const double* n = q.fPositions;
+  const double* h = q.fHeights;
+  return h[i] + d/(n[i+1] - n[i-1])*
+    ((n[i] - n[i-1] + d)*(h[i+1] - h[i])/(n[i+1] - n[i]) +
+     (n[i+1] - n[i] - d)*(h[i] - h[i-1])/(n[i] - n[i-1]));
+}
+
+//______________________________________________________________________________
+double EXORunningStatistics::Linear(const Quantile& q, size_t i, int d)
+{
+  const double* n = q.fPositions;
+  const double* h = q.fHeights;
+  size_t j = (d > 0) ? i + 1 : i - 1;
+  return h[i] + d*(h[j] - h[i])/(n[j] - n[i]);
+}
+
+//______________________________________________________________________________
+double EXORunningStatistics::GetVariance() const
+{
+  return (fN > 1) ? fM2/(fN - 1) : 0.;
+}
+
+//______________________________________________________________________________
+double EXORunningStatistics::GetRMS() const
+{
+  return std::sqrt(GetVariance());
+}
+
+//______________________________________________________________________________
+double EXORunningStatistics::GetQuantile(size_t i) const
+{
+  // With five values or fewer, the linearly interpolated quantile of the
+  // values themselves; 0 without values.
+  if(fN == 0) return 0.;
+  if(fN > 5) return fQuantiles[i].fHeights[2];
+  double sorted[5];
+  std::copy(fFirst, fFirst + fN, sorted);
+  std::sort(sorted, sorted + fN);
+  double position = fQuantiles[i].fP*(fN - 1);
+  size_t below = size_t(position);
+  if(below + 1 >= fN) return sorted[fN-1];
+  return sorted[below] + (position - below)*(sorted[below+1] - sorted[below]);
+}
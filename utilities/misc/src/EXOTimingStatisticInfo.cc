@@ -97,6 +97,20 @@ void EXOTimingStatisticInfo::ResetTimerForTag(const std::string & tag)
   GetOrCreateTimerForTag(tag).Reset();
 }
 
+//______________________________________________________________________________
+size_t EXOTimingStatisticInfo::GetNumberOfTimers() const
+{
+  // Number of timers, in order of creation.
+  return fTimingInfo->GetEntriesFast();
+}
+
+//______________________________________________________________________________
+EXOStopwatch* EXOTimingStatisticInfo::GetTimerAt(size_t i) const
+{
+  // Get timer i, see GetNumberOfTimers.
+  return static_cast<EXOStopwatch*>(fTimingInfo->At(i));
+}
+
 //______________________________________________________________________________
 void EXOTimingStatisticInfo::Print(Option_t* opt) const
 {
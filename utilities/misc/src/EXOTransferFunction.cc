@@ -15,6 +15,7 @@
 //______________________________________________________________________________
 
 #include "EXOUtilities/EXOTransferFunction.hh"
+#include "EXOUtilities/EXOWaveformPipeline.hh"
 #include "EXOUtilities/EXOErrorLogger.hh"
 #include "EXOUtilities/EXODimensions.hh"
 #include "TMath.h"
@@ -44,26 +45,37 @@ void EXOTransferFunction::AddIntegStageWithTime(Double_t time)
 
 void EXOTransferFunction::TransformInPlace(EXODoubleWaveform& wf) const
 {
-  // Perform the transformation in place 
+  TransformInPlace(wf, fWorkspace);
+}
+
+//______________________________________________________________________________
+void EXOTransferFunction::TransformInPlace(EXODoubleWaveform& wf,
+                                           EXOWaveformWorkspace& workspace) const
+{
+  // Perform the transformation in place.  All stages are run as one cascade
+  // of recursive sections in a single pass over the waveform; this gives the
+  // same result as applying the integrators and differentiators one by one.
+  if (GetNumIntegStages() == 0 and GetNumDiffStages() == 0) return;
+  EXOWaveformWorkspace::Frame frame(workspace);
+  EXOWaveformWorkspace::SectionVec& sections = workspace.GetSections();
+  GetRecursiveSections(wf, sections);
+  EXOWaveformPipeline::ApplyRecursiveSections(sections, wf);
+}
+
+//______________________________________________________________________________
+bool EXOTransferFunction::GetRecursiveSections(const EXODoubleWaveform& wf,
+                                               std::vector<RecursiveSection>& sections) const
+{
+  // Append one section per stage: the integrators first, then the
+  // differentiators, in the order they were added.
+  double period = wf.GetSamplingPeriod();
   for (size_t i=0;i<GetNumIntegStages();i++) {
-    fInteg.SetTimeConstant(GetIntegTime(i));
-    fInteg.Transform(&wf);
-  } 
-
-  size_t numOutOfPlaceStages = GetNumDiffStages()/2;
-  for (size_t i=0;i<numOutOfPlaceStages;i++) {
-    // Doing this because it's a little faster to go out-of-place if there's
-    // more than one transformation.
-    fDiff.SetTimeConstant(GetDiffTime(2*i));
-    fDiff.Transform(&wf, &fScratch);
-    fDiff.SetTimeConstant(GetDiffTime(2*i+1)); 
-    fDiff.Transform(&fScratch, &wf);
+    sections.push_back(EXORCIntegrator::MakeSection(period, GetIntegTime(i)));
   }
-  if (numOutOfPlaceStages*2 != GetNumDiffStages() ) {
-    // Handle the last one if necessary.
-    fDiff.SetTimeConstant(GetDiffTime(numOutOfPlaceStages*2)); 
-    fDiff.Transform(&wf);
+  for (size_t i=0;i<GetNumDiffStages();i++) {
+    sections.push_back(EXORCDifferentiator::MakeSection(period, GetDiffTime(i)));
   }
+  return true;
 }
 
 //______________________________________________________________________________
@@ -1,4 +1,5 @@
 #include "EXOUtilities/EXOVWaveformExtractor.hh"
+#include <vector>
 
 using namespace std;
 
@@ -29,3 +30,37 @@ const EXOMiscUtil::ParameterMap& EXOVWaveformExtractor::ExtractAll(const EXODoub
   DoExtractAll(wf);
   return fParameterMap;
 }
+
+void EXOVWaveformExtractor::ExtractAll(const EXODoubleWaveform& wf, double values[]) const
+{
+  // Fill values[0..GetNumParameters()-1].  Thread-safe.
+  DoExtract(wf, values);
+}
+
+double EXOVWaveformExtractor::Extract(const EXODoubleWaveform& wf, size_t index) const
+{
+  // Return parameter index.  Thread-safe.
+  if(index >= GetNumParameters()){
+    LogEXOMsg("Parameter index out of range!",EECritical);
+    return 0.0;
+  }
+  std::vector<double> values(GetNumParameters());
+  DoExtract(wf, &values[0]);
+  return values[index];
+}
+
+void EXOVWaveformExtractor::DoExtract(const EXODoubleWaveform& /*wf*/, double /*values*/[]) const
+{
+  LogEXOMsg("Implementation does not provide the indexed interface!",EECritical);
+}
+
+void EXOVWaveformExtractor::DoExtractAll(const EXODoubleWaveform& wf) const
+{
+  // Default for extractors implementing DoExtract: fill the map by name.
+  EXOMiscUtil::ParameterMap& params = GetParameterMapForUpdates();
+  size_t n = GetNumParameters();
+  if(n == 0) return;
+  std::vector<double> values(n);
+  DoExtract(wf, &values[0]);
+  for(size_t i = 0; i < n; i++) params[GetParameterName(i)] = values[i];
+}
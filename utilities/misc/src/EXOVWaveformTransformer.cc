@@ -1,4 +1,5 @@
 #include "EXOUtilities/EXOVWaveformTransformer.hh"
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
 #include "EXOUtilities/EXOErrorLogger.hh"
 #include <cassert>
 
@@ -20,6 +21,15 @@
 // latter, the most efficient is to implement a function that contains the same
 // algorithm and have both TransformInPlace and TransformOutOfPlace call this
 // function. 
+//
+// Transformers used from several threads are called through
+// Transform(input, output, workspace), which takes its scratch space from an
+// EXOWaveformWorkspace owned by the calling thread.  A derived class which
+// keeps scratch members (FFT arrays, temporary waveforms) overloads the
+// workspace versions of TransformInPlace/TransformOutOfPlace and lets its
+// plain versions call them with a workspace of its own.  A derived class
+// which can not avoid shared state (e.g. a random number generator) returns
+// false from IsThreadSafe().
 
 void EXOVWaveformTransformer::Transform(EXODoubleWaveform* input, EXODoubleWaveform* output) const 
 {
@@ -78,3 +88,52 @@ void EXOVWaveformTransformer::TransformOutOfPlace(const EXODoubleWaveform& input
   output = input;
   TransformInPlace(output);
 }
+
+void EXOVWaveformTransformer::Transform(EXODoubleWaveform* input,
+                                        EXODoubleWaveform* output,
+                                        EXOWaveformWorkspace& workspace) const
+{
+  // Thread-safe version of Transform; see the class description.
+  if(input == NULL) {
+    LogEXOMsg("input is NULL.", EEError);
+    return;
+  }
+
+  if(output == NULL) TransformInPlace(*input, workspace);
+  else {
+    output->MakeSimilarTo(*input);
+    TransformOutOfPlace(*input, *output, workspace);
+  }
+}
+
+void EXOVWaveformTransformer::TransformInPlace(EXODoubleWaveform& input,
+                                               EXOWaveformWorkspace& workspace) const
+{
+  // Same as TransformInPlace(input), with the temporary waveform taken from
+  // workspace instead of fTmpWaveform.
+  if(IsInPlace()) {
+    TransformInPlace(input);
+    return;
+  }
+  assert(IsOutOfPlace());
+
+  EXOWaveformWorkspace::Frame frame(workspace);
+  EXODoubleWaveform& tmp = workspace.GetWaveform();
+  tmp.MakeSimilarTo(input);
+  TransformOutOfPlace(input, tmp, workspace);
+  input = tmp;
+}
+
+void EXOVWaveformTransformer::TransformOutOfPlace(const EXODoubleWaveform& input,
+                                                  EXODoubleWaveform& output,
+                                                  EXOWaveformWorkspace& workspace) const
+{
+  if(IsOutOfPlace()) {
+    TransformOutOfPlace(input, output);
+    return;
+  }
+  assert(IsInPlace());
+
+  output = input;
+  TransformInPlace(output, workspace);
+}
@@ -0,0 +1,235 @@
+//______________________________________________________________________________
+// EXOWaveformPipeline
+//
+// DESCRIPTION:
+//
+// A chain of EXOVWaveformTransformers applied to a waveform as one
+// transformer.  Applying a chain stage by stage streams the whole waveform
+// through memory once per stage (and once more for every copy made for
+// out-of-place stages).  The pipeline instead fuses neighbouring stages
+// where it can:
+//
+//   - consecutive stages which are cascades of first-order recursive
+//     sections (RC integrators and differentiators, pole-zero corrections,
+//     EXOTransferFunction) are run as one cascade in a single pass, with the
+//     state of every section kept in registers;
+//   - consecutive stages which multiply the spectrum (matched, bandpass and
+//     frequency peak filters) are combined into one response, so that one
+//     forward and one inverse FFT are done for all of them;
+//   - the other stages are applied in turn on the same buffer; out-of-place
+//     stages alternate between the waveform and one scratch waveform
+//     instead of copying back after every stage.
+//
+// Stages describe themselves through
+// EXOVWaveformTransformer::GetRecursiveSections and GetFrequencyResponse.
+// The cascade uses the arithmetic of the individual stages and gives the
+// same result as applying them one by one; the combined spectral response
+// agrees to within floating-point rounding.  SetFuseStages(false) applies
+// the stages one by one for comparison.
+//
+// Example:
+//
+//   EXOWaveformPipeline pipeline;
+//   pipeline.AddStage(transferFunction);
+//   pipeline.AddStage(poleZeroCorrection);
+//   pipeline.AddStage(matchedFilter);
+//   pipeline.Transform(&wf);
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOWaveformPipeline.hh"
+#include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
+#include "EXOUtilities/EXOErrorLogger.hh"
+#include <complex>
+#include <cstring>
+
+EXOWaveformPipeline::EXOWaveformPipeline()
+: EXOVWaveformTransformer("EXOWaveformPipeline"),
+  fFuseStages(true)
+{}
+
+//______________________________________________________________________________
+void EXOWaveformPipeline::TransformInPlace(EXODoubleWaveform& wf) const
+{
+  TransformInPlace(wf, fWorkspace);
+}
+
+//______________________________________________________________________________
+void EXOWaveformPipeline::TransformInPlace(EXODoubleWaveform& wf,
+                                           EXOWaveformWorkspace& workspace) const
+{
+  EXOWaveformWorkspace::Frame frame(workspace);
+  EXODoubleWaveform& scratch = workspace.GetWaveform();          // Output of out-of-place stages
+  EXOWaveformWorkspace::SectionVec& sections = workspace.GetSections(); // Current run of recursive stages
+  EXOWaveformFT& response = workspace.GetWaveformFT();           // Product of responses of the current run
+  EXOWaveformFT& stageResponse = workspace.GetWaveformFT();      // Response of a single stage
+
+  EXODoubleWaveform* current = &wf;
+  size_t i = 0;
+  while(i < fStages.size()) {
+    if(not fFuseStages) {
+      ApplyStage(*fStages[i], wf, current, scratch, workspace);
+      i++;
+      continue;
+    }
+
+    // Collect the longest run of recursive stages.
+    sections.clear();
+    size_t first = i;
+    while(i < fStages.size() and fStages[i]->GetRecursiveSections(*current, sections)) i++;
+    if(i - first > 1) {
+      ApplyRecursiveSections(sections, *current);
+      continue;
+    }
+    if(i - first == 1) {
+      ApplyStage(*fStages[first], wf, current, scratch, workspace);
+      continue;
+    }
+
+    // Collect the longest run of frequency-domain stages.  A delayed stage
+    // ends the run, since the delay zeroes the start of the waveform.
+    size_t delay = 0;
+    if(EXOFastFourierTransformFFTW::IsAvailable()) {
+      while(i < fStages.size() and delay == 0 and
+            fStages[i]->GetFrequencyResponse(*current, stageResponse, delay)) {
+        if(i == first) response = stageResponse;
+        else {
+          for(size_t j = 0; j < response.GetLength(); j++) response[j] *= stageResponse[j];
+        }
+        i++;
+      }
+    }
+    if(i - first > 1) {
+      ApplyFrequencyResponse(response, delay, *current, workspace);
+      continue;
+    }
+
+    // A single stage gains nothing from fusing; use its own implementation.
+    i = first;
+    ApplyStage(*fStages[i], wf, current, scratch, workspace);
+    i++;
+  }
+
+  if(current != &wf) wf = *current;
+}
+
+//______________________________________________________________________________
+void EXOWaveformPipeline::ApplyStage(const EXOVWaveformTransformer& stage,
+                                     EXODoubleWaveform& wf,
+                                     EXODoubleWaveform*& current,
+                                     EXODoubleWaveform& scratch,
+                                     EXOWaveformWorkspace& workspace) const
+{
+  // Apply one stage to *current.  An out-of-place stage writes to the other
+  // of wf and scratch, and current is pointed there.
+  if(stage.IsInPlace()) {
+    stage.Transform(current, NULL, workspace);
+    return;
+  }
+  EXODoubleWaveform* other = (current == &wf) ? &scratch : &wf;
+  stage.Transform(current, other, workspace);
+  current = other;
+}
+
+//______________________________________________________________________________
+void EXOWaveformPipeline::ApplyRecursiveSections(const std::vector<RecursiveSection>& sections,
+                                                 EXODoubleWaveform& wf)
+{
+  // Run the cascade of sections over wf in one pass.  Each sample goes
+  // through all sections before the next sample is read.
+  size_t n = wf.GetLength();
+  size_t nsec = sections.size();
+  if(nsec == 0) return;
+  if(n <= 1) {
+    // All sections pass the first sample through, so there is nothing to do.
+    // As the stages themselves do, integrators and differentiators report
+    // such a waveform as an error; EXOPoleZeroCorrection accepts it.
+    for(size_t k = 0; k < nsec; k++) {
+      if(sections[k].fType != RecursiveSection::kPoleZero) {
+        LogEXOMsg(" anInput of length zero or one", EEError);
+        break;
+      }
+    }
+    return;
+  }
+
+  // Previous input and output of each section; all sections pass the first
+  // sample through.
+  std::vector<double> prevIn(nsec, wf[0]);
+  std::vector<double> prevOut(nsec, wf[0]);
+  double* data = &wf[0];
+  for(size_t i = 1; i < n; i++) {
+    double x = data[i];
+    for(size_t k = 0; k < nsec; k++) {
+      const RecursiveSection& sec = sections[k];
+      double y;
+      switch(sec.fType) {
+        case RecursiveSection::kIntegrator:
+          y = sec.fGain*x + sec.fWeight*prevOut[k];
+          break;
+        case RecursiveSection::kDifferentiator:
+          y = (x - prevIn[k])*sec.fGain + prevOut[k]*sec.fWeight;
+          break;
+        default: // kPoleZero
+          y = prevOut[k] - sec.fWeight*(prevIn[k] - sec.fBaseline) + (x - sec.fBaseline);
+      }
+      prevIn[k] = x;
+      prevOut[k] = y;
+      x = y;
+    }
+    data[i] = x;
+  }
+}
+
+//______________________________________________________________________________
+void EXOWaveformPipeline::ApplyFrequencyResponse(const EXOWaveformFT& response,
+                                                 size_t delay,
+                                                 EXODoubleWaveform& wf,
+                                                 EXOWaveformWorkspace& workspace) const
+{
+  // Multiply the spectrum of wf by response, using one forward and one
+  // inverse FFT on a workspace array.
+  size_t n = wf.GetLength();
+  const EXOFastFourierTransformFFTW& fft = EXOFastFourierTransformFFTW::GetFFT(n);
+  if(response.GetLength() != fft.GetFreqDomainLength()) {
+    LogEXOMsg("Frequency response does not match the waveform length", EEError);
+    return;
+  }
+  EXOWaveformWorkspace::Frame frame(workspace);
+  void* array = workspace.GetFFTArray(n);
+  memcpy(array, reinterpret_cast<const void*>(&wf[0]), sizeof(double)*n);
+  fft.PerformFFT_inplace(array);
+  std::complex<double>* complex_data = static_cast<std::complex<double>*>(array);
+  for(size_t i = 0; i < fft.GetFreqDomainLength(); i++) complex_data[i] *= response[i];
+  fft.PerformInverseFFT_inplace(array);
+
+  const double* real_data = static_cast<const double*>(array);
+  if(delay > n) delay = n;
+  for(size_t i = n; i > delay; i--) wf[i-1] = real_data[i-1-delay];
+  for(size_t i = 0; i < delay; i++) wf[i] = 0.0;
+}
+
+//______________________________________________________________________________
+bool EXOWaveformPipeline::GetRecursiveSections(const EXODoubleWaveform& wf,
+                                               std::vector<RecursiveSection>& sections) const
+{
+  // A pipeline of recursive stages is a cascade itself, so it can be fused
+  // into an enclosing pipeline.
+  if(fStages.empty()) return false;
+  size_t oldSize = sections.size();
+  for(size_t i = 0; i < fStages.size(); i++) {
+    if(not fStages[i]->GetRecursiveSections(wf, sections)) {
+      sections.resize(oldSize);
+      return false;
+    }
+  }
+  return true;
+}
+
+//______________________________________________________________________________
+bool EXOWaveformPipeline::IsThreadSafe() const
+{
+  for(size_t i = 0; i < fStages.size(); i++) {
+    if(not fStages[i]->IsThreadSafe()) return false;
+  }
+  return true;
+}
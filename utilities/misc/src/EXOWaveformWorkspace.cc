@@ -0,0 +1,123 @@
+//______________________________________________________________________________
+// EXOWaveformWorkspace
+//
+// DESCRIPTION:
+//
+// Scratch space for the thread-safe interfaces of EXOVWaveformTransformer and
+// EXOVWaveformExtractor.  Those interfaces do not modify the transformer or
+// extractor; every temporary they need is taken from a workspace passed in
+// by the caller.  A transformer may then be shared between threads, as long
+// as each thread uses its own workspace:
+//
+//   // In each thread:
+//   EXOWaveformWorkspace workspace;
+//   for(...) transferFunction.Transform(&wf, NULL, workspace);
+//
+// Scratch objects are taken in stack order inside a Frame:
+//
+//   EXOWaveformWorkspace::Frame frame(workspace);
+//   EXODoubleWaveform& tmp = workspace.GetWaveform();
+//
+// Objects are kept when the frame closes, so a workspace which is reused for
+// many waveforms stops allocating after the first one.
+//______________________________________________________________________________
+
+#include "EXOUtilities/EXOWaveformWorkspace.hh"
+#include "EXOUtilities/EXOFastFourierTransformFFTW.hh"
+
+EXOWaveformWorkspace::EXOWaveformWorkspace()
+: fNumWaveforms(0),
+  fNumWaveformFTs(0),
+  fNumBuffers(0),
+  fNumSections(0),
+  fNumFFTArrays(0)
+{}
+
+//______________________________________________________________________________
+EXOWaveformWorkspace::EXOWaveformWorkspace(const EXOWaveformWorkspace&)
+: fNumWaveforms(0),
+  fNumWaveformFTs(0),
+  fNumBuffers(0),
+  fNumSections(0),
+  fNumFFTArrays(0)
+{}
+
+//______________________________________________________________________________
+EXOWaveformWorkspace::~EXOWaveformWorkspace()
+{
+  for(size_t i = 0; i < fWaveforms.size(); i++) delete fWaveforms[i];
+  for(size_t i = 0; i < fWaveformFTs.size(); i++) delete fWaveformFTs[i];
+  for(size_t i = 0; i < fBuffers.size(); i++) delete fBuffers[i];
+  for(size_t i = 0; i < fSections.size(); i++) delete fSections[i];
+  for(size_t i = 0; i < fFFTArrays.size(); i++) {
+    EXOFastFourierTransformFFTW::FreeArray(fFFTArrays[i]);
+  }
+}
+
+//______________________________________________________________________________
+EXOWaveformWorkspace::Frame::Frame(EXOWaveformWorkspace& workspace)
+: fWorkspace(workspace),
+  fNumWaveforms(workspace.fNumWaveforms),
+  fNumWaveformFTs(workspace.fNumWaveformFTs),
+  fNumBuffers(workspace.fNumBuffers),
+  fNumSections(workspace.fNumSections),
+  fNumFFTArrays(workspace.fNumFFTArrays)
+{}
+
+//______________________________________________________________________________
+EXOWaveformWorkspace::Frame::~Frame()
+{
+  fWorkspace.fNumWaveforms = fNumWaveforms;
+  fWorkspace.fNumWaveformFTs = fNumWaveformFTs;
+  fWorkspace.fNumBuffers = fNumBuffers;
+  fWorkspace.fNumSections = fNumSections;
+  fWorkspace.fNumFFTArrays = fNumFFTArrays;
+}
+
+//______________________________________________________________________________
+EXODoubleWaveform& EXOWaveformWorkspace::GetWaveform()
+{
+  if(fNumWaveforms == fWaveforms.size()) fWaveforms.push_back(new EXODoubleWaveform);
+  return *fWaveforms[fNumWaveforms++];
+}
+
+//______________________________________________________________________________
+EXOWaveformFT& EXOWaveformWorkspace::GetWaveformFT()
+{
+  if(fNumWaveformFTs == fWaveformFTs.size()) fWaveformFTs.push_back(new EXOWaveformFT);
+  return *fWaveformFTs[fNumWaveformFTs++];
+}
+
+//______________________________________________________________________________
+std::vector<double>& EXOWaveformWorkspace::GetBuffer()
+{
+  if(fNumBuffers == fBuffers.size()) fBuffers.push_back(new std::vector<double>);
+  return *fBuffers[fNumBuffers++];
+}
+
+//______________________________________________________________________________
+EXOWaveformWorkspace::SectionVec& EXOWaveformWorkspace::GetSections()
+{
+  // The returned vector is empty.
+  if(fNumSections == fSections.size()) fSections.push_back(new SectionVec);
+  SectionVec& sections = *fSections[fNumSections++];
+  sections.clear();
+  return sections;
+}
+
+//______________________________________________________________________________
+void* EXOWaveformWorkspace::GetFFTArray(size_t length)
+{
+  // The array holds length/2 + 1 complex values; it is reallocated if an
+  // earlier user needed a smaller one.
+  if(fNumFFTArrays == fFFTArrays.size()) {
+    fFFTArrays.push_back(EXOFastFourierTransformFFTW::AllocateArray(length));
+    fFFTArrayLengths.push_back(length);
+  }
+  else if(fFFTArrayLengths[fNumFFTArrays] < length) {
+    EXOFastFourierTransformFFTW::FreeArray(fFFTArrays[fNumFFTArrays]);
+    fFFTArrays[fNumFFTArrays] = EXOFastFourierTransformFFTW::AllocateArray(length);
+    fFFTArrayLengths[fNumFFTArrays] = length;
+  }
+  return fFFTArrays[fNumFFTArrays++];
+}